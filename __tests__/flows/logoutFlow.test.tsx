@@ -43,6 +43,7 @@ jest.mock('../../src/contexts/ConfigContext', () => ({
 jest.mock('../../src/services/k2Service', () => ({ setK2UserId: jest.fn() }));
 
 import { setK2UserId } from '../../src/services/k2Service';
+import { clearKeyCache } from 'jarvis-crypto';
 
 const HOUSEHOLDS = [
   { id: 'hh-1', name: 'Home', role: 'admin', created_at: '2026-01-01T00:00:00Z' },
@@ -150,6 +151,9 @@ describe('Logout — flow integration (real AuthContext + clearUserData security
     // react-query cache cleared + K2 in-memory userId reset (no cross-user leak).
     expect(clearSpy).toHaveBeenCalled();
     expect(setK2UserId).toHaveBeenCalledWith(null);
+
+    // Cached Argon2 derivations wiped from native memory.
+    expect(clearKeyCache).toHaveBeenCalledTimes(1);
   });
 
   it('forces the unauthenticated state even if the cache wipe throws', async () => {
@@ -0,0 +1,66 @@
+import { aesGcmEncryptBytes, randomBuffer } from 'jarvis-crypto';
+
+import { encryptAndPushConfig } from '../../src/services/configPushService';
+import { getK2 } from '../../src/services/k2Service';
+import { pushConfigToNode } from '../../src/api/smartHomeApi';
+
+jest.mock('jarvis-crypto', () => ({
+  aesGcmEncryptBytes: jest.fn(),
+  randomBuffer: jest.fn(),
+}));
+
+jest.mock('../../src/services/k2Service', () => ({
+  getK2: jest.fn(),
+}));
+
+jest.mock('../../src/api/smartHomeApi', () => ({
+  pushConfigToNode: jest.fn().mockResolvedValue({ id: 'push-1', status: 'queued' }),
+}));
+
+describe('configPushService', () => {
+  const mockNodeId = 'test-node-abc';
+
+  beforeEach(() => {
+    jest.clearAllMocks();
+  });
+
+  it('should throw when no K2 key found for node', async () => {
+    (getK2 as jest.Mock).mockResolvedValue(null);
+
+    await expect(
+      encryptAndPushConfig(mockNodeId, 'home_assistant', { url: 'http://ha' }),
+    ).rejects.toThrow(`No K2 key found for node ${mockNodeId}`);
+
+    expect(pushConfigToNode).not.toHaveBeenCalled();
+  });
+
+  it('should encrypt the UTF-8 JSON bytes and push base64url fields', async () => {
+    (getK2 as jest.Mock).mockResolvedValue({
+      k2: 'AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8', // bytes 0..31
+      kid: 'k2-202603-xyz',
+      nodeId: mockNodeId,
+      createdAt: '2026-03-01T00:00:00.000Z',
+    });
+    (randomBuffer as jest.Mock).mockResolvedValue(new Uint8Array(12).fill(0xff));
+    (aesGcmEncryptBytes as jest.Mock).mockResolvedValue({
+      ciphertext: new Uint8Array([0xfb, 0xff, 0x00]),
+      tag: new Uint8Array(16),
+    });
+
+    const configData = { url: 'http://ha', verify_ssl: false };
+    await encryptAndPushConfig(mockNodeId, 'home_assistant', configData);
+
+    const [key, nonce, plaintext, aad] = (aesGcmEncryptBytes as jest.Mock).mock.calls[0];
+    expect(Array.from(key)).toEqual(Array.from({ length: 32 }, (_, i) => i));
+    expect(nonce).toHaveLength(12);
+    expect(new TextDecoder().decode(plaintext)).toBe(JSON.stringify(configData));
+    expect(aad).toBe(`${mockNodeId}:home_assistant`);
+
+    expect(pushConfigToNode).toHaveBeenCalledWith(mockNodeId, {
+      config_type: 'home_assistant',
+      ciphertext: '-_8A',
+      nonce: '________________',
+      tag: 'AAAAAAAAAAAAAAAAAAAAAA',
+    });
+  });
+});
@@ -1,4 +1,5 @@
 import * as SecureStore from 'expo-secure-store';
+import { randomBuffers } from 'jarvis-crypto';
 
 import {
   generateK2,
@@ -45,6 +46,20 @@ describe('k2Service', () => {
       expect(result.kid).toMatch(/^k2-\d{6}-/);
     });
 
+    it('should draw the key and kid suffix in one native call', async () => {
+      (randomBuffers as jest.Mock).mockResolvedValueOnce([
+        new Uint8Array(32).fill(0xfb),
+        new Uint8Array([0xff, 0xff, 0xff, 0xff]),
+      ]);
+
+      const result = await generateK2('test-node-5');
+
+      expect(randomBuffers).toHaveBeenCalledTimes(1);
+      expect(randomBuffers).toHaveBeenCalledWith([32, 4]);
+      expect(result.k2).toHaveLength(43);
+      expect(result.kid).toMatch(/-_____w$/);
+    });
+
     it('should set createdAt to an ISO string', async () => {
       const result = await generateK2('test-node-4');
 
@@ -1,4 +1,7 @@
+import { randomBuffers } from 'jarvis-crypto';
+
 import {
+  generateEncryptedQRPayload,
   generatePlainQRPayload,
   encodeQRPayload,
   decodeQRPayload,
@@ -38,6 +41,19 @@ describe('qrPayloadService', () => {
     });
   });
 
+  describe('generateEncryptedQRPayload', () => {
+    it('should draw the salt and nonce in one native call', async () => {
+      (randomBuffers as jest.Mock).mockClear();
+
+      const payload = await generateEncryptedQRPayload(mockKeyPair, 'hunter2');
+
+      expect(randomBuffers).toHaveBeenCalledTimes(1);
+      expect(randomBuffers).toHaveBeenCalledWith([16, 12]);
+      expect(payload.salt).toBe('AAAAAAAAAAAAAAAAAAAAAA');
+      expect(payload.nonce).toBe('AAAAAAAAAAAAAAAA');
+    });
+  });
+
   describe('encodeQRPayload / decodeQRPayload', () => {
     it('should round-trip a plain payload through encode/decode', () => {
       const payload = generatePlainQRPayload(mockKeyPair);
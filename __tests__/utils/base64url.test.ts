@@ -0,0 +1,39 @@
+import { base64urlDecode, base64urlEncode } from 'jarvis-crypto';
+
+import { base64urlToBytes, bytesToBase64url } from '../../src/utils/base64url';
+
+describe('base64url', () => {
+  beforeEach(() => {
+    jest.clearAllMocks();
+  });
+
+  it('should encode without padding using the URL-safe alphabet', () => {
+    expect(bytesToBase64url(new Uint8Array([0xfb, 0xff]))).toBe('-_8');
+    expect(bytesToBase64url(new Uint8Array([]))).toBe('');
+    expect(bytesToBase64url(new TextEncoder().encode('test-k2-value'))).toBe('dGVzdC1rMi12YWx1ZQ');
+  });
+
+  it('should decode unpadded input', () => {
+    expect(Array.from(base64urlToBytes('-_8'))).toEqual([0xfb, 0xff]);
+    expect(new TextDecoder().decode(base64urlToBytes('dGVzdC1rMi12YWx1ZQ'))).toBe('test-k2-value');
+  });
+
+  it('should convert short values in JS', () => {
+    const nonce = new Uint8Array(12).fill(0xff);
+
+    expect(base64urlToBytes(bytesToBase64url(nonce))).toEqual(nonce);
+    expect(base64urlEncode).not.toHaveBeenCalled();
+    expect(base64urlDecode).not.toHaveBeenCalled();
+  });
+
+  it('should hand large buffers to the native codec', () => {
+    const bytes = new Uint8Array(100_003);
+    for (let i = 0; i < bytes.length; i++) {
+      bytes[i] = (i * 31) & 0xff;
+    }
+
+    expect(base64urlToBytes(bytesToBase64url(bytes))).toEqual(bytes);
+    expect(base64urlEncode).toHaveBeenCalledTimes(1);
+    expect(base64urlDecode).toHaveBeenCalledTimes(1);
+  });
+});
@@ -49,18 +49,46 @@ jest.mock('expo-notifications', () => ({
 // Mock jarvis-crypto native module.
 // IMPORTANT: keep these method names in sync with modules/jarvis-crypto/index.ts.
 // The real module exports AES-256-GCM (aesGcmEncrypt/aesGcmDecrypt) + argon2id +
-// randomBytes — NOT chacha20poly1305. A prior version of this mock named chacha*
-// methods the module never exports, so any test exercising the AEAD path
-// (config-push / QR import / settings-decrypt) got `undefined` and silently
-// passed. EncryptResult is { ciphertext, tag } (the IV is an input, not returned).
+// randomBytes, their byte-buffer variants (*Bytes, randomBuffer, randomBuffers),
+// argon2idWithStats, clearKeyCache, createAeadKey (batched AES-GCM under one
+// key) and the sync base64url codec — NOT chacha20poly1305. A prior version of
+// this mock named chacha* methods the module never exports, so any test
+// exercising the AEAD path (config-push / QR import / settings-decrypt) got
+// `undefined` and silently passed. EncryptResult is { ciphertext, tag } (the IV
+// is an input, not returned).
 jest.mock('./modules/jarvis-crypto', () => ({
   argon2id: jest.fn().mockResolvedValue('mock-argon2-hash'),
+  argon2idWithStats: jest.fn().mockResolvedValue({ key: 'mock-argon2-hash', stats: {} }),
   aesGcmEncrypt: jest.fn().mockResolvedValue({
     ciphertext: 'mock-ciphertext',
     tag: 'mock-tag',
   }),
   aesGcmDecrypt: jest.fn().mockResolvedValue('mock-plaintext'),
   randomBytes: jest.fn().mockResolvedValue('mock-random-bytes-base64'),
+  argon2idBytes: jest.fn().mockResolvedValue(new Uint8Array(32)),
+  aesGcmEncryptBytes: jest.fn().mockResolvedValue({
+    ciphertext: new Uint8Array([1, 2, 3]),
+    tag: new Uint8Array(16),
+  }),
+  aesGcmDecryptBytes: jest.fn().mockResolvedValue(new Uint8Array(0)),
+  randomBuffer: jest.fn().mockImplementation((n) => Promise.resolve(new Uint8Array(n))),
+  randomBuffers: jest
+    .fn()
+    .mockImplementation((lengths) => Promise.resolve(lengths.map((n) => new Uint8Array(n)))),
+  clearKeyCache: jest.fn(),
+  base64urlEncode: jest.fn((data) => Buffer.from(data).toString('base64url')),
+  base64urlDecode: jest.fn((text) => new Uint8Array(Buffer.from(text, 'base64url'))),
+  createAeadKey: jest.fn().mockImplementation(() => ({
+    encryptBatch: jest.fn().mockImplementation((records) =>
+      Promise.resolve(
+        records.map(() => ({ ciphertext: new Uint8Array([1, 2, 3]), tag: new Uint8Array(16) }))
+      )
+    ),
+    decryptBatch: jest.fn().mockImplementation((records) =>
+      Promise.resolve(records.map(() => new Uint8Array(0)))
+    ),
+    release: jest.fn(),
+  })),
 }));
 
 // Mock SafeAreaContext
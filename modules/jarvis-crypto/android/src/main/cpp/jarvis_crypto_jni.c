@@ -0,0 +1,491 @@
+/*
+ * JNI entry points for NativeCrypto.kt over the shared C core in
+ * ios/Argon2 (the same sources the iOS pod compiles).
+ *
+ * Inputs are direct ByteBuffers, read in place through
+ * GetDirectBufferAddress over their whole capacity; outputs are byte[]
+ * the caller sized. Every function returns ARGON2_OK / AES_GCM_OK (0) or
+ * the core's negative error code, which NativeCrypto turns into an
+ * exception; the base64url pair returns its String / byte[] instead, or
+ * null for invalid input.
+ *
+ * Argon2 goes through one process-wide scheduler sized like iOS's
+ * Argon2Scheduler.shared (two workers, 64 MiB), so concurrent derivations
+ * share the same memory budget and priorities on both platforms, and the
+ * same derived-key cache (16 entries, five minutes). A derivation over the
+ * budget runs alone rather than failing. The calling thread -
+ * an Expo module worker - blocks until its job is done. Random bytes come
+ * from one process-wide ChaCha20 pool (drbg.h), like iOS's RandomPool.
+ */
+
+#include <jni.h>
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aes_gcm.h"
+#include "argon2.h"
+#include "argon2_cache.h"
+#include "argon2_scheduler.h"
+#include "base64url.h"
+#include "drbg.h"
+
+#define SCHEDULER_WORKERS 2
+#define SCHEDULER_BUDGET_KIB (64 * 1024)
+#define CACHE_ENTRIES 16
+#define CACHE_TTL_MS (5 * 60 * 1000)
+#define HASH_MAX_BYTES 64
+#define STATS_SLICES 4  /* argon2_stats.slice_ns */
+
+/*
+ * argon2idHash's optional long[] stats, in NativeCrypto.STATS_* order:
+ * nanosecond phases, then counters, then slice_ns[4] and pass_ns[16].
+ */
+enum {
+    STATS_QUEUE_NS, STATS_ALLOC_NS, STATS_INIT_NS, STATS_FILL_NS,
+    STATS_FINALIZE_NS, STATS_WIPE_NS, STATS_TOTAL_NS, STATS_BLOCKS,
+    STATS_MINOR_FAULTS, STATS_MAJOR_FAULTS, STATS_PASSES, STATS_THREADS,
+    STATS_KERNEL, STATS_CACHED, STATS_SLICE_NS,
+    STATS_PASS_NS = STATS_SLICE_NS + STATS_SLICES,
+    STATS_LENGTH = STATS_PASS_NS + ARGON2_STATS_MAX_PASSES
+};
+
+static void export_stats(JNIEnv *env, const argon2_stats *stats, jlongArray out) {
+    jlong values[STATS_LENGTH];
+
+    values[STATS_QUEUE_NS] = (jlong)stats->queue_ns;
+    values[STATS_ALLOC_NS] = (jlong)stats->alloc_ns;
+    values[STATS_INIT_NS] = (jlong)stats->init_ns;
+    values[STATS_FILL_NS] = (jlong)stats->fill_ns;
+    values[STATS_FINALIZE_NS] = (jlong)stats->finalize_ns;
+    values[STATS_WIPE_NS] = (jlong)stats->wipe_ns;
+    values[STATS_TOTAL_NS] = (jlong)stats->total_ns;
+    values[STATS_BLOCKS] = (jlong)stats->blocks;
+    values[STATS_MINOR_FAULTS] = (jlong)stats->minor_faults;
+    values[STATS_MAJOR_FAULTS] = (jlong)stats->major_faults;
+    values[STATS_PASSES] = (jlong)stats->passes;
+    values[STATS_THREADS] = (jlong)stats->threads;
+    values[STATS_KERNEL] = (jlong)stats->kernel;
+    values[STATS_CACHED] = (jlong)stats->cached;
+    for (int i = 0; i < STATS_SLICES; ++i) {
+        values[STATS_SLICE_NS + i] = (jlong)stats->slice_ns[i];
+    }
+    for (int i = 0; i < ARGON2_STATS_MAX_PASSES; ++i) {
+        values[STATS_PASS_NS + i] = (jlong)stats->pass_ns[i];
+    }
+    (*env)->SetLongArrayRegion(env, out, 0, STATS_LENGTH, values);
+}
+
+/* argon2_secure_wipe is internal to the core; same idea. */
+static void wipe(void *v, size_t n) {
+    volatile uint8_t *p = (volatile uint8_t *)v;
+    while (n--) *p++ = 0;
+}
+
+static argon2_scheduler *scheduler;
+static argon2_cache *cache;
+static pthread_once_t scheduler_once = PTHREAD_ONCE_INIT;
+
+static void create_scheduler(void) {
+    if (argon2_scheduler_create(&scheduler, SCHEDULER_WORKERS, SCHEDULER_BUDGET_KIB) != ARGON2_OK) {
+        scheduler = NULL;
+        return;
+    }
+    /* Without a cache every derivation simply runs. */
+    if (argon2_cache_create(&cache, CACHE_ENTRIES, CACHE_TTL_MS) == ARGON2_OK) {
+        argon2_scheduler_set_cache(scheduler, cache);
+    }
+}
+
+static drbg *pool;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+
+static void create_pool(void) {
+    if (drbg_create(&pool) != DRBG_OK) {
+        pool = NULL;
+    }
+}
+
+/* A direct buffer's memory and size; NULL/0 for a null or empty buffer. */
+static int direct_buffer(JNIEnv *env, jobject buffer, uint8_t **data, size_t *len) {
+    *data = NULL;
+    *len = 0;
+    if (buffer == NULL) {
+        return 0;
+    }
+    jlong capacity = (*env)->GetDirectBufferCapacity(env, buffer);
+    if (capacity < 0) {
+        return -1;  /* heap buffer */
+    }
+    *len = (size_t)capacity;
+    if (capacity > 0) {
+        *data = (uint8_t *)(*env)->GetDirectBufferAddress(env, buffer);
+        if (*data == NULL) return -1;
+    }
+    return 0;
+}
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int done;
+    int result;
+} job_wait;
+
+static void job_done(uint64_t job_id, int result, void *user) {
+    job_wait *wait = (job_wait *)user;
+    (void)job_id;
+    pthread_mutex_lock(&wait->mutex);
+    wait->result = result;
+    wait->done = 1;
+    pthread_cond_signal(&wait->cond);
+    pthread_mutex_unlock(&wait->mutex);
+}
+
+JNIEXPORT jint JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_argon2idHash(JNIEnv *env, jclass cls,
+                                                         jobject password, jobject salt,
+                                                         jint t_cost, jint m_cost, jint lanes,
+                                                         jint priority, jbyteArray out,
+                                                         jlongArray stats_out) {
+    uint8_t *pwd, *salt_data, tag[HASH_MAX_BYTES];
+    argon2_stats stats;
+    size_t pwdlen, saltlen;
+    jsize outlen = out != NULL ? (*env)->GetArrayLength(env, out) : 0;
+    (void)cls;
+
+    if (direct_buffer(env, password, &pwd, &pwdlen) != 0 ||
+        direct_buffer(env, salt, &salt_data, &saltlen) != 0) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+    if (outlen <= 0 || outlen > HASH_MAX_BYTES) return ARGON2_OUTPUT_TOO_LONG;
+    if (stats_out != NULL && (*env)->GetArrayLength(env, stats_out) != STATS_LENGTH) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+    if (t_cost < 0 || m_cost < 0 || lanes < 0) return ARGON2_INCORRECT_PARAMETER;
+    if (priority < 0 || priority >= ARGON2_PRIORITY_LEVELS) return ARGON2_INCORRECT_PARAMETER;
+
+    pthread_once(&scheduler_once, create_scheduler);
+    if (scheduler == NULL) return ARGON2_MEMORY_ALLOCATION_ERROR;
+
+    argon2_context context = {
+        tag, (uint32_t)outlen,
+        pwd, (uint32_t)pwdlen,
+        salt_data, (uint32_t)saltlen,
+        NULL, 0, NULL, 0,
+        (uint32_t)t_cost, (uint32_t)m_cost, (uint32_t)lanes, 0,
+        ARGON2_VERSION_NUMBER, 0, stats_out != NULL ? &stats : NULL
+    };
+    job_wait wait = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0};
+    uint64_t job_id;
+
+    int result = argon2_scheduler_submit(scheduler, &context, Argon2_id, (argon2_priority)priority,
+                                         job_done, &wait, &job_id);
+    if (result == ARGON2_OK) {
+        pthread_mutex_lock(&wait.mutex);
+        while (!wait.done) {
+            pthread_cond_wait(&wait.cond, &wait.mutex);
+        }
+        pthread_mutex_unlock(&wait.mutex);
+        result = wait.result;
+    }
+    pthread_cond_destroy(&wait.cond);
+    pthread_mutex_destroy(&wait.mutex);
+
+    if (result == ARGON2_OK) {
+        (*env)->SetByteArrayRegion(env, out, 0, outlen, (const jbyte *)tag);
+        if (stats_out != NULL) {
+            export_stats(env, &stats, stats_out);
+        }
+    }
+    wipe(tag, sizeof(tag));
+    return result;
+}
+
+/*
+ * Keyed AEAD handles for NativeCrypto.AeadKey: an expanded key on the
+ * native heap, passed around as a jlong. Kotlin serialises use and
+ * destruction of a handle.
+ */
+JNIEXPORT jlong JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_aeadKeyCreate(JNIEnv *env, jclass cls, jobject key_buffer) {
+    uint8_t *raw;
+    size_t rawlen;
+    (void)cls;
+
+    if (direct_buffer(env, key_buffer, &raw, &rawlen) != 0 || rawlen != AES256GCM_KEYBYTES) {
+        return 0;
+    }
+    aes256gcm_key *key = (aes256gcm_key *)malloc(sizeof(*key));
+    if (key == NULL) {
+        return 0;
+    }
+    if (aes256gcm_key_init(key, raw) != AES_GCM_OK) {
+        free(key);
+        return 0;
+    }
+    return (jlong)(intptr_t)key;
+}
+
+JNIEXPORT void JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_aeadKeyDestroy(JNIEnv *env, jclass cls, jlong handle) {
+    aes256gcm_key *key = (aes256gcm_key *)(intptr_t)handle;
+    (void)env;
+    (void)cls;
+    if (key != NULL) {
+        aes256gcm_key_wipe(key);
+        free(key);
+    }
+}
+
+/* Output bytes of a packed batch (aes_gcm.h), or a negative AES_GCM_* error. */
+JNIEXPORT jlong JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_aeadBatchMeasure(JNIEnv *env, jclass cls,
+                                                             jobject batch, jboolean open) {
+    uint8_t *records;
+    size_t len, outlen;
+    (void)cls;
+
+    if (direct_buffer(env, batch, &records, &len) != 0) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+    int result = aes256gcm_batch_measure(records, len, open ? 1 : 0, NULL, &outlen);
+    if (result != AES_GCM_OK) {
+        return result;
+    }
+    return outlen > INT32_MAX ? AES_GCM_TOO_LONG : (jlong)outlen;
+}
+
+/*
+ * Seals or opens a packed batch into out, sized by aeadBatchMeasure. A
+ * failed open leaves the failing record's index in failed[0].
+ */
+static jint aead_batch(JNIEnv *env, jlong handle, jobject batch, jbyteArray out,
+                       jintArray failed, int open) {
+    const aes256gcm_key *key = (const aes256gcm_key *)(intptr_t)handle;
+    uint8_t *records;
+    size_t len, outlen, failed_record = 0;
+
+    if (key == NULL || direct_buffer(env, batch, &records, &len) != 0 || out == NULL) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+    int result = aes256gcm_batch_measure(records, len, open, NULL, &outlen);
+    if (result != AES_GCM_OK) {
+        return result;
+    }
+    if ((size_t)(*env)->GetArrayLength(env, out) != outlen) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+
+    uint8_t *data = outlen != 0 ? (uint8_t *)(*env)->GetPrimitiveArrayCritical(env, out, NULL) : NULL;
+    if (outlen != 0 && data == NULL) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+    result = open ? aes256gcm_open_batch(key, records, len, data, &failed_record)
+                  : aes256gcm_seal_batch(key, records, len, data);
+    if (data != NULL) {
+        (*env)->ReleasePrimitiveArrayCritical(env, out, data, 0);
+    }
+    if (result == AES_GCM_AUTH_FAILED && failed != NULL) {
+        jint index = (jint)failed_record;
+        (*env)->SetIntArrayRegion(env, failed, 0, 1, &index);
+    }
+    return result;
+}
+
+JNIEXPORT jint JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_aeadSealBatch(JNIEnv *env, jclass cls, jlong handle,
+                                                          jobject batch, jbyteArray out) {
+    (void)cls;
+    return aead_batch(env, handle, batch, out, NULL, 0);
+}
+
+JNIEXPORT jint JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_aeadOpenBatch(JNIEnv *env, jclass cls, jlong handle,
+                                                          jobject batch, jbyteArray out,
+                                                          jintArray failed) {
+    (void)cls;
+    return aead_batch(env, handle, batch, out, failed, 1);
+}
+
+JNIEXPORT jstring JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_base64UrlEncodeBuffer(JNIEnv *env, jclass cls,
+                                                                  jobject data) {
+    uint8_t *in;
+    size_t inlen;
+    (void)cls;
+
+    if (direct_buffer(env, data, &in, &inlen) != 0) {
+        return NULL;
+    }
+    size_t textlen = base64url_encoded_len(inlen);
+    char *text = (char *)malloc(textlen + 1);
+    if (text == NULL) {
+        return NULL;
+    }
+    base64url_encode(in, inlen, text);
+    text[textlen] = '\0';
+    jstring result = (*env)->NewStringUTF(env, text);
+    free(text);
+    return result;
+}
+
+/* Modified UTF-8 has no bytes the alphabet would accept for non-ASCII text. */
+JNIEXPORT jbyteArray JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_base64UrlDecodeText(JNIEnv *env, jclass cls,
+                                                                jstring text) {
+    (void)cls;
+
+    if (text == NULL) {
+        return NULL;
+    }
+    size_t textlen = (size_t)(*env)->GetStringUTFLength(env, text);
+    const char *chars = (*env)->GetStringUTFChars(env, text, NULL);
+    if (chars == NULL) {
+        return NULL;
+    }
+    size_t max = base64url_decoded_max(textlen), outlen = 0;
+    uint8_t *out = (uint8_t *)malloc(max != 0 ? max : 1);
+    int result = out != NULL ? base64url_decode(chars, textlen, out, &outlen) : BASE64URL_INVALID;
+    (*env)->ReleaseStringUTFChars(env, text, chars);
+
+    jbyteArray bytes = NULL;
+    if (result == BASE64URL_OK) {
+        bytes = (*env)->NewByteArray(env, (jsize)outlen);
+        if (bytes != NULL) {
+            (*env)->SetByteArrayRegion(env, bytes, 0, (jsize)outlen, (const jbyte *)out);
+        }
+    }
+    if (out != NULL) {
+        wipe(out, max);  /* may be key material */
+        free(out);
+    }
+    return bytes;
+}
+
+/*
+ * Fills out from the pool. Generated into scratch memory first: the pool
+ * takes a lock, which must not be waited on inside a critical region.
+ */
+JNIEXPORT jint JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_randomFill(JNIEnv *env, jclass cls, jbyteArray out) {
+    (void)cls;
+
+    pthread_once(&pool_once, create_pool);
+    if (out == NULL) {
+        return DRBG_INVALID_PARAMETER;
+    }
+    size_t len = (size_t)(*env)->GetArrayLength(env, out);
+    uint8_t *bytes = (uint8_t *)malloc(len != 0 ? len : 1);
+    if (bytes == NULL) {
+        return DRBG_MEMORY_ALLOCATION_ERROR;
+    }
+    int result = drbg_generate(pool, bytes, len);
+    if (result == DRBG_OK) {
+        (*env)->SetByteArrayRegion(env, out, 0, (jsize)len, (const jbyte *)bytes);
+    }
+    wipe(bytes, len);  /* may become a key */
+    free(bytes);
+    return result;
+}
+
+JNIEXPORT jstring JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_kernelName(JNIEnv *env, jclass cls, jint kernel) {
+    (void)cls;
+    return (*env)->NewStringUTF(env, argon2_kernel_name((argon2_kernel)kernel));
+}
+
+JNIEXPORT void JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_clearKeyCache(JNIEnv *env, jclass cls) {
+    (void)env;
+    (void)cls;
+    pthread_once(&scheduler_once, create_scheduler);
+    argon2_cache_clear(cache);
+}
+
+/* Expanded key for one call; wiped by the caller. */
+static int load_key(JNIEnv *env, jobject key_buffer, jobject iv_buffer, aes256gcm_key *key,
+                    uint8_t **iv) {
+    uint8_t *raw;
+    size_t keylen, ivlen;
+
+    if (direct_buffer(env, key_buffer, &raw, &keylen) != 0 ||
+        direct_buffer(env, iv_buffer, iv, &ivlen) != 0) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+    if (keylen != AES256GCM_KEYBYTES || ivlen != AES256GCM_IVBYTES) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+    return aes256gcm_key_init(key, raw);
+}
+
+/* Writes ciphertext || tag to out, which must hold plaintext + 16 bytes. */
+JNIEXPORT jint JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_aesGcmSeal(JNIEnv *env, jclass cls, jobject key_buffer,
+                                                       jobject iv_buffer, jobject aad,
+                                                       jobject plaintext, jbyteArray out) {
+    aes256gcm_key key;
+    uint8_t *iv, *ad, *in;
+    size_t adlen, inlen;
+    (void)cls;
+
+    if (direct_buffer(env, aad, &ad, &adlen) != 0 ||
+        direct_buffer(env, plaintext, &in, &inlen) != 0) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+    if (out == NULL || (size_t)(*env)->GetArrayLength(env, out) != inlen + AES256GCM_TAGBYTES) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+
+    int result = load_key(env, key_buffer, iv_buffer, &key, &iv);
+    if (result == AES_GCM_OK) {
+        /* No JNI calls until released; the array stays where it is meanwhile. */
+        uint8_t *sealed = (uint8_t *)(*env)->GetPrimitiveArrayCritical(env, out, NULL);
+        if (sealed == NULL) {
+            result = AES_GCM_INVALID_PARAMETER;
+        } else {
+            result = aes256gcm_encrypt(&key, iv, ad, adlen, in, inlen, sealed, sealed + inlen);
+            (*env)->ReleasePrimitiveArrayCritical(env, out, sealed, 0);
+        }
+    }
+    aes256gcm_key_wipe(&key);
+    return result;
+}
+
+/* Writes the plaintext to out, which must be as long as the ciphertext. */
+JNIEXPORT jint JNICALL
+Java_expo_modules_jarviscrypto_NativeCrypto_aesGcmOpen(JNIEnv *env, jclass cls, jobject key_buffer,
+                                                       jobject iv_buffer, jobject aad,
+                                                       jobject ciphertext, jobject tag_buffer,
+                                                       jbyteArray out) {
+    aes256gcm_key key;
+    uint8_t *iv, *ad, *in, *tag;
+    size_t adlen, inlen, taglen;
+    (void)cls;
+
+    if (direct_buffer(env, aad, &ad, &adlen) != 0 ||
+        direct_buffer(env, ciphertext, &in, &inlen) != 0 ||
+        direct_buffer(env, tag_buffer, &tag, &taglen) != 0) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+    if (taglen != AES256GCM_TAGBYTES || out == NULL ||
+        (size_t)(*env)->GetArrayLength(env, out) != inlen) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+
+    int result = load_key(env, key_buffer, iv_buffer, &key, &iv);
+    if (result == AES_GCM_OK) {
+        uint8_t *plain = inlen != 0 ? (uint8_t *)(*env)->GetPrimitiveArrayCritical(env, out, NULL) : NULL;
+        if (inlen != 0 && plain == NULL) {
+            result = AES_GCM_INVALID_PARAMETER;
+        } else {
+            result = aes256gcm_decrypt(&key, iv, ad, adlen, in, inlen, tag, plain);
+            if (plain != NULL) {
+                (*env)->ReleasePrimitiveArrayCritical(env, out, plain, 0);
+            }
+        }
+    }
+    aes256gcm_key_wipe(&key);
+    return result;
+}
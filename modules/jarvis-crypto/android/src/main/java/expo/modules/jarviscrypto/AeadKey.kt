@@ -0,0 +1,33 @@
+package expo.modules.jarviscrypto
+
+import expo.modules.kotlin.sharedobjects.SharedObject
+import java.nio.ByteBuffer
+
+/**
+ * The native side of a JS AeadKey: a key the C core expanded once, used
+ * for every batch until JS releases the object or it is collected. Calls
+ * on one key are serialised so a release never frees it mid-batch.
+ */
+class AeadKey(key: ByteBuffer) : SharedObject() {
+  private var handle = NativeCrypto.createKey(key)
+
+  fun sealBatch(batch: ByteBuffer): ByteArray = synchronized(this) {
+    NativeCrypto.sealBatch(live(), batch)
+  }
+
+  fun openBatch(batch: ByteBuffer): ByteArray = synchronized(this) {
+    NativeCrypto.openBatch(live(), batch)
+  }
+
+  override fun sharedObjectDidRelease() {
+    synchronized(this) {
+      NativeCrypto.destroyKey(handle)
+      handle = 0L
+    }
+  }
+
+  private fun live(): Long {
+    check(handle != 0L) { "AeadKey was released" }
+    return handle
+  }
+}
@@ -3,15 +3,7 @@ package expo.modules.jarviscrypto
 import expo.modules.kotlin.modules.Module
 import expo.modules.kotlin.modules.ModuleDefinition
 import expo.modules.kotlin.Promise
-import org.signal.argon2.Argon2
-import org.signal.argon2.MemoryCost
-import org.signal.argon2.Type
-import org.signal.argon2.Version
-import java.security.SecureRandom
-import java.util.Base64
-import javax.crypto.Cipher
-import javax.crypto.spec.GCMParameterSpec
-import javax.crypto.spec.SecretKeySpec
+import expo.modules.kotlin.typedarray.Uint8Array
 
 class JarvisCryptoModule : Module() {
   override fun definition() = ModuleDefinition {
@@ -24,88 +16,169 @@ class JarvisCryptoModule : Module() {
         val t = params["t"] ?: throw IllegalArgumentException("Missing param 't'")
         val p = params["p"] ?: throw IllegalArgumentException("Missing param 'p'")
 
-        val result = Argon2.Builder(Version.V13)
-          .type(Type.Argon2id)
-          .memoryCost(MemoryCost.KiB(m))
-          .parallelism(p)
-          .iterations(t)
-          .hashLength(32)
-          .build()
-          .hash(password.toByteArray(Charsets.UTF_8), salt)
-
-        promise.resolve(base64UrlEncode(result.hash))
+        val passwordBytes = password.toByteArray(Charsets.UTF_8)
+        val passwordBuffer = passwordBytes.toDirectBuffer()
+        passwordBytes.fill(0)
+        try {
+          val hash = NativeCrypto.argon2id(passwordBuffer, salt.toDirectBuffer(), t, m, p, 32)
+          promise.resolve(base64UrlEncode(hash))
+        } finally {
+          passwordBuffer.wipe()
+        }
       } catch (e: Exception) {
         promise.reject("ARGON2_ERROR", e.message, e)
       }
     }
 
-    AsyncFunction("aesGcmEncrypt") { keyB64: String, ivB64: String, plaintextB64: String, aad: String, promise: Promise ->
+    // argon2id plus where the time went, for profiling on real devices.
+    AsyncFunction("argon2idWithStats") { password: String, saltB64: String, params: Map<String, Int>, promise: Promise ->
       try {
-        val key = base64UrlDecode(keyB64)
-        val iv = base64UrlDecode(ivB64)
-        val plaintext = base64UrlDecode(plaintextB64)
-        val aadBytes = aad.toByteArray(Charsets.UTF_8)
+        val salt = base64UrlDecode(saltB64)
+        val m = params["m"] ?: throw IllegalArgumentException("Missing param 'm'")
+        val t = params["t"] ?: throw IllegalArgumentException("Missing param 't'")
+        val p = params["p"] ?: throw IllegalArgumentException("Missing param 'p'")
 
-        if (key.size != 32) {
-          throw IllegalArgumentException("Key must be 32 bytes")
+        val passwordBytes = password.toByteArray(Charsets.UTF_8)
+        val passwordBuffer = passwordBytes.toDirectBuffer()
+        passwordBytes.fill(0)
+        try {
+          val (hash, stats) = NativeCrypto.argon2idWithStats(passwordBuffer, salt.toDirectBuffer(), t, m, p, 32)
+          promise.resolve(mapOf("key" to base64UrlEncode(hash), "stats" to stats))
+        } finally {
+          passwordBuffer.wipe()
         }
-        if (iv.size != 12) {
-          throw IllegalArgumentException("IV must be 12 bytes")
-        }
-
-        val cipher = Cipher.getInstance("AES/GCM/NoPadding")
-        val keySpec = SecretKeySpec(key, "AES")
-        val gcmSpec = GCMParameterSpec(128, iv)
+      } catch (e: Exception) {
+        promise.reject("ARGON2_ERROR", e.message, e)
+      }
+    }
 
-        cipher.init(Cipher.ENCRYPT_MODE, keySpec, gcmSpec)
-        cipher.updateAAD(aadBytes)
+    // Byte-buffer variants: typed arrays in, Uint8Array out. The C core reads
+    // the JS memory in place through direct ByteBuffers.
 
-        val ciphertextWithTag = cipher.doFinal(plaintext)
+    AsyncFunction("argon2idBytes") { password: Uint8Array, salt: Uint8Array, params: Map<String, Int>, promise: Promise ->
+      try {
+        val m = params["m"] ?: throw IllegalArgumentException("Missing param 'm'")
+        val t = params["t"] ?: throw IllegalArgumentException("Missing param 't'")
+        val p = params["p"] ?: throw IllegalArgumentException("Missing param 'p'")
 
-        // GCM appends the tag to the ciphertext
-        val ciphertext = ciphertextWithTag.copyOfRange(0, ciphertextWithTag.size - 16)
-        val tag = ciphertextWithTag.copyOfRange(ciphertextWithTag.size - 16, ciphertextWithTag.size)
+        promise.resolve(NativeCrypto.argon2id(password.toDirectBuffer(), salt.toDirectBuffer(), t, m, p, 32))
+      } catch (e: Exception) {
+        promise.reject("ARGON2_ERROR", e.message, e)
+      }
+    }
 
-        val result = mapOf(
-          "ciphertext" to base64UrlEncode(ciphertext),
-          "tag" to base64UrlEncode(tag)
+    AsyncFunction("aesGcmSealBytes") { key: Uint8Array, iv: Uint8Array, plaintext: Uint8Array, aad: Uint8Array, promise: Promise ->
+      try {
+        promise.resolve(
+          NativeCrypto.seal(key.toDirectBuffer(), iv.toDirectBuffer(), aad.toDirectBuffer(), plaintext.toDirectBuffer())
         )
-        promise.resolve(result)
       } catch (e: Exception) {
         promise.reject("ENCRYPT_ERROR", e.message, e)
       }
     }
 
-    AsyncFunction("aesGcmDecrypt") { keyB64: String, ivB64: String, ciphertextB64: String, tagB64: String, aad: String, promise: Promise ->
+    AsyncFunction("aesGcmOpenBytes") { key: Uint8Array, iv: Uint8Array, ciphertext: Uint8Array, tag: Uint8Array, aad: Uint8Array, promise: Promise ->
       try {
-        val key = base64UrlDecode(keyB64)
-        val iv = base64UrlDecode(ivB64)
-        val ciphertext = base64UrlDecode(ciphertextB64)
-        val tag = base64UrlDecode(tagB64)
-        val aadBytes = aad.toByteArray(Charsets.UTF_8)
-
-        if (key.size != 32) {
-          throw IllegalArgumentException("Key must be 32 bytes")
-        }
-        if (iv.size != 12) {
-          throw IllegalArgumentException("IV must be 12 bytes")
+        promise.resolve(
+          NativeCrypto.open(
+            key.toDirectBuffer(), iv.toDirectBuffer(), aad.toDirectBuffer(),
+            ciphertext.toDirectBuffer(), tag.toDirectBuffer()
+          )
+        )
+      } catch (e: javax.crypto.AEADBadTagException) {
+        promise.reject("DECRYPT_ERROR", "Authentication failed", e)
+      } catch (e: Exception) {
+        promise.reject("DECRYPT_ERROR", e.message, e)
+      }
+    }
+
+    // A key expanded once and held natively, for many messages under it
+    // (every config pushed to one node). Records cross the bridge packed
+    // into one buffer each way; the layout is in aes_gcm.h.
+    Class(AeadKey::class) {
+      Constructor { key: Uint8Array ->
+        AeadKey(key.toDirectBuffer())
+      }
+
+      AsyncFunction("sealBatch") { aeadKey: AeadKey, batch: Uint8Array, promise: Promise ->
+        try {
+          promise.resolve(aeadKey.sealBatch(batch.toDirectBuffer()))
+        } catch (e: Exception) {
+          promise.reject("ENCRYPT_ERROR", e.message, e)
         }
-        if (tag.size != 16) {
-          throw IllegalArgumentException("Tag must be 16 bytes")
+      }
+
+      AsyncFunction("openBatch") { aeadKey: AeadKey, batch: Uint8Array, promise: Promise ->
+        try {
+          promise.resolve(aeadKey.openBatch(batch.toDirectBuffer()))
+        } catch (e: Exception) {
+          promise.reject("DECRYPT_ERROR", e.message, e)
         }
+      }
+    }
 
-        // Reconstruct ciphertext + tag for GCM
-        val ciphertextWithTag = ciphertext + tag
+    AsyncFunction("randomBuffer") { length: Int, promise: Promise ->
+      try {
+        promise.resolve(NativeCrypto.randomBytes(length))
+      } catch (e: Exception) {
+        promise.reject("RANDOM_ERROR", e.message, e)
+      }
+    }
 
-        val cipher = Cipher.getInstance("AES/GCM/NoPadding")
-        val keySpec = SecretKeySpec(key, "AES")
-        val gcmSpec = GCMParameterSpec(128, iv)
+    // Several random values (salt, nonce, key) in one crossing, back to
+    // back in one buffer; index.ts cuts them apart.
+    AsyncFunction("randomBuffers") { lengths: List<Int>, promise: Promise ->
+      try {
+        require(lengths.all { it >= 0 }) { "Lengths must not be negative" }
+        promise.resolve(NativeCrypto.randomBytes(lengths.sum()))
+      } catch (e: Exception) {
+        promise.reject("RANDOM_ERROR", e.message, e)
+      }
+    }
 
-        cipher.init(Cipher.DECRYPT_MODE, keySpec, gcmSpec)
-        cipher.updateAAD(aadBytes)
+    AsyncFunction("aesGcmEncrypt") { keyB64: String, ivB64: String, plaintextB64: String, aad: String, promise: Promise ->
+      try {
+        val key = base64UrlDecode(keyB64).toDirectBuffer()
+        try {
+          val sealed = NativeCrypto.seal(
+            key,
+            base64UrlDecode(ivB64).toDirectBuffer(),
+            aad.toByteArray(Charsets.UTF_8).toDirectBuffer(),
+            base64UrlDecode(plaintextB64).toDirectBuffer()
+          )
+
+          // The core writes the tag after the ciphertext
+          val ciphertext = sealed.copyOfRange(0, sealed.size - NativeCrypto.TAG_BYTES)
+          val tag = sealed.copyOfRange(sealed.size - NativeCrypto.TAG_BYTES, sealed.size)
+
+          val result = mapOf(
+            "ciphertext" to base64UrlEncode(ciphertext),
+            "tag" to base64UrlEncode(tag)
+          )
+          promise.resolve(result)
+        } finally {
+          key.wipe()
+        }
+      } catch (e: Exception) {
+        promise.reject("ENCRYPT_ERROR", e.message, e)
+      }
+    }
 
-        val plaintext = cipher.doFinal(ciphertextWithTag)
-        promise.resolve(base64UrlEncode(plaintext))
+    AsyncFunction("aesGcmDecrypt") { keyB64: String, ivB64: String, ciphertextB64: String, tagB64: String, aad: String, promise: Promise ->
+      try {
+        val key = base64UrlDecode(keyB64).toDirectBuffer()
+        try {
+          val plaintext = NativeCrypto.open(
+            key,
+            base64UrlDecode(ivB64).toDirectBuffer(),
+            aad.toByteArray(Charsets.UTF_8).toDirectBuffer(),
+            base64UrlDecode(ciphertextB64).toDirectBuffer(),
+            base64UrlDecode(tagB64).toDirectBuffer()
+          )
+          promise.resolve(base64UrlEncode(plaintext))
+        } finally {
+          key.wipe()
+        }
       } catch (e: javax.crypto.AEADBadTagException) {
         promise.reject("DECRYPT_ERROR", "Authentication failed", e)
       } catch (e: Exception) {
@@ -115,26 +188,34 @@ class JarvisCryptoModule : Module() {
 
     AsyncFunction("randomBytes") { length: Int, promise: Promise ->
       try {
-        val bytes = ByteArray(length)
-        SecureRandom().nextBytes(bytes)
-        promise.resolve(base64UrlEncode(bytes))
+        promise.resolve(base64UrlEncode(NativeCrypto.randomBytes(length)))
       } catch (e: Exception) {
         promise.reject("RANDOM_ERROR", e.message, e)
       }
     }
+
+    // base64url for JS, on the same codec the string API uses. Sync calls:
+    // typed arrays and strings cross JSI without a promise round trip.
+    Function("base64UrlEncode") { data: Uint8Array ->
+      NativeCrypto.base64UrlEncode(data.toDirectBuffer())
+    }
+
+    Function("base64UrlDecode") { text: String ->
+      NativeCrypto.base64UrlDecode(text)
+    }
+
+    // Forget every cached derivation, e.g. on sign-out.
+    Function("clearKeyCache") {
+      NativeCrypto.clearKeyCache()
+    }
   }
 
   private fun base64UrlEncode(data: ByteArray): String {
-    return Base64.getUrlEncoder().withoutPadding().encodeToString(data)
+    return NativeCrypto.base64UrlEncode(data.toDirectBuffer())
   }
 
+  // Padded or unpadded base64url
   private fun base64UrlDecode(data: String): ByteArray {
-    // Handle both padded and unpadded base64url
-    var padded = data
-    when (data.length % 4) {
-      2 -> padded += "=="
-      3 -> padded += "="
-    }
-    return Base64.getUrlDecoder().decode(padded)
+    return NativeCrypto.base64UrlDecode(data)
   }
 }
@@ -0,0 +1,247 @@
+package expo.modules.jarviscrypto
+
+import java.nio.ByteBuffer
+import javax.crypto.AEADBadTagException
+
+/**
+ * JNI bindings to the shared C core (ios/Argon2, built by
+ * android/CMakeLists.txt with src/main/cpp/jarvis_crypto_jni.c).
+ *
+ * Buffer arguments must be direct; the native side reads their whole
+ * capacity in place. Errors surface as exceptions, with AEAD tag
+ * mismatches as AEADBadTagException like javax.crypto.
+ */
+internal object NativeCrypto {
+  const val KEY_BYTES = 32
+  const val IV_BYTES = 12
+  const val TAG_BYTES = 16
+
+  // argon2_scheduler.h priorities
+  const val PRIORITY_INTERACTIVE = 0
+
+  private const val AES_GCM_AUTH_FAILED = -2
+
+  // Layout of argon2idHash's stats array (jarvis_crypto_jni.c)
+  private const val STATS_QUEUE_NS = 0
+  private const val STATS_ALLOC_NS = 1
+  private const val STATS_INIT_NS = 2
+  private const val STATS_FILL_NS = 3
+  private const val STATS_FINALIZE_NS = 4
+  private const val STATS_WIPE_NS = 5
+  private const val STATS_TOTAL_NS = 6
+  private const val STATS_BLOCKS = 7
+  private const val STATS_MINOR_FAULTS = 8
+  private const val STATS_MAJOR_FAULTS = 9
+  private const val STATS_PASSES = 10
+  private const val STATS_THREADS = 11
+  private const val STATS_KERNEL = 12
+  private const val STATS_CACHED = 13
+  private const val STATS_SLICE_NS = 14
+  private const val STATS_SLICES = 4
+  private const val STATS_PASS_NS = STATS_SLICE_NS + STATS_SLICES
+  private const val STATS_MAX_PASSES = 16
+  private const val STATS_LENGTH = STATS_PASS_NS + STATS_MAX_PASSES
+
+  init {
+    System.loadLibrary("jarviscrypto")
+  }
+
+  fun argon2id(password: ByteBuffer, salt: ByteBuffer, t: Int, m: Int, p: Int, hashLength: Int): ByteArray {
+    val out = ByteArray(hashLength)
+    val status = argon2idHash(password, salt, t, m, p, PRIORITY_INTERACTIVE, out, null)
+    if (status != 0) {
+      throw IllegalStateException("Argon2 failed ($status)")
+    }
+    return out
+  }
+
+  /**
+   * argon2id plus the core's per-phase timings, as the map the JS
+   * Argon2Stats type describes (milliseconds, same keys as iOS).
+   */
+  fun argon2idWithStats(
+    password: ByteBuffer, salt: ByteBuffer, t: Int, m: Int, p: Int, hashLength: Int
+  ): Pair<ByteArray, Map<String, Any>> {
+    val out = ByteArray(hashLength)
+    val stats = LongArray(STATS_LENGTH)
+    val status = argon2idHash(password, salt, t, m, p, PRIORITY_INTERACTIVE, out, stats)
+    if (status != 0) {
+      throw IllegalStateException("Argon2 failed ($status)")
+    }
+    return out to statsMap(stats)
+  }
+
+  private fun statsMap(stats: LongArray): Map<String, Any> {
+    fun ms(index: Int) = stats[index] / 1e6
+    val cached = stats[STATS_CACHED] != 0L
+    val fillNs = stats[STATS_FILL_NS]
+    val passes = minOf(stats[STATS_PASSES].toInt(), STATS_MAX_PASSES)
+
+    return mapOf(
+      "queueMs" to ms(STATS_QUEUE_NS),
+      "allocMs" to ms(STATS_ALLOC_NS),
+      "initMs" to ms(STATS_INIT_NS),
+      "fillMs" to ms(STATS_FILL_NS),
+      "passMs" to (0 until passes).map { ms(STATS_PASS_NS + it) },
+      "sliceMs" to (0 until STATS_SLICES).map { ms(STATS_SLICE_NS + it) },
+      "finalizeMs" to ms(STATS_FINALIZE_NS),
+      "wipeMs" to ms(STATS_WIPE_NS),
+      "totalMs" to ms(STATS_TOTAL_NS),
+      "blocks" to stats[STATS_BLOCKS].toDouble(),
+      "blocksPerSecond" to if (fillNs > 0) stats[STATS_BLOCKS] * 1e9 / fillNs else 0.0,
+      "minorFaults" to stats[STATS_MINOR_FAULTS].toDouble(),
+      "majorFaults" to stats[STATS_MAJOR_FAULTS].toDouble(),
+      "threads" to stats[STATS_THREADS].toInt(),
+      "kernel" to if (cached) "" else kernelName(stats[STATS_KERNEL].toInt()),
+      "cached" to cached
+    )
+  }
+
+  /** Returns ciphertext || tag. */
+  fun seal(key: ByteBuffer, iv: ByteBuffer, aad: ByteBuffer, plaintext: ByteBuffer): ByteArray {
+    checkKeyAndIv(key, iv)
+    val out = ByteArray(plaintext.capacity() + TAG_BYTES)
+    val status = aesGcmSeal(key, iv, aad, plaintext, out)
+    if (status != 0) {
+      throw IllegalStateException("AES-GCM encrypt failed ($status)")
+    }
+    return out
+  }
+
+  fun open(key: ByteBuffer, iv: ByteBuffer, aad: ByteBuffer, ciphertext: ByteBuffer, tag: ByteBuffer): ByteArray {
+    checkKeyAndIv(key, iv)
+    require(tag.capacity() == TAG_BYTES) { "Tag must be 16 bytes" }
+    val out = ByteArray(ciphertext.capacity())
+    when (val status = aesGcmOpen(key, iv, aad, ciphertext, tag, out)) {
+      0 -> return out
+      AES_GCM_AUTH_FAILED -> throw AEADBadTagException("Authentication failed")
+      else -> throw IllegalStateException("AES-GCM decrypt failed ($status)")
+    }
+  }
+
+  /** Expands key into a native handle for the batch calls; free it with destroyKey. */
+  fun createKey(key: ByteBuffer): Long {
+    require(key.capacity() == KEY_BYTES) { "Key must be 32 bytes" }
+    val handle = aeadKeyCreate(key)
+    check(handle != 0L) { "AES-GCM key setup failed" }
+    return handle
+  }
+
+  fun destroyKey(handle: Long) = aeadKeyDestroy(handle)
+
+  /** Seals a packed batch (aes_gcm.h); returns each record's ciphertext || tag, in order. */
+  fun sealBatch(handle: Long, batch: ByteBuffer): ByteArray {
+    val out = ByteArray(batchOutputSize(batch, open = false))
+    val status = aeadSealBatch(handle, batch, out)
+    if (status != 0) {
+      throw IllegalStateException("AES-GCM batch encrypt failed ($status)")
+    }
+    return out
+  }
+
+  /** Opens a packed batch of ciphertext || tag records; returns the plaintexts back to back. */
+  fun openBatch(handle: Long, batch: ByteBuffer): ByteArray {
+    val out = ByteArray(batchOutputSize(batch, open = true))
+    val failed = IntArray(1)
+    when (val status = aeadOpenBatch(handle, batch, out, failed)) {
+      0 -> return out
+      AES_GCM_AUTH_FAILED -> throw AEADBadTagException("Authentication failed (record ${failed[0]})")
+      else -> throw IllegalStateException("AES-GCM batch decrypt failed ($status)")
+    }
+  }
+
+  private fun batchOutputSize(batch: ByteBuffer, open: Boolean): Int {
+    val size = aeadBatchMeasure(batch, open)
+    require(size >= 0) { "Malformed AES-GCM batch ($size)" }
+    return size.toInt()
+  }
+
+  /**
+   * Random bytes from the core's ChaCha20 pool (drbg.h), seeded and
+   * reseeded from getrandom; one JNI call, no SecureRandom per request.
+   */
+  fun randomBytes(length: Int): ByteArray {
+    require(length >= 0) { "Length must not be negative" }
+    val out = ByteArray(length)
+    val status = randomFill(out)
+    if (status != 0) {
+      throw IllegalStateException("Random generation failed ($status)")
+    }
+    return out
+  }
+
+  /** Unpadded base64url through the core's SIMD codec (base64url.h). */
+  fun base64UrlEncode(data: ByteBuffer): String =
+    base64UrlEncodeBuffer(data) ?: throw IllegalStateException("base64url encode failed")
+
+  /** Accepts padded or unpadded input; throws on anything else, like java.util.Base64. */
+  fun base64UrlDecode(text: String): ByteArray =
+    base64UrlDecodeText(text) ?: throw IllegalArgumentException("Invalid base64url")
+
+  /** Wipes every cached derived key. */
+  @JvmStatic
+  external fun clearKeyCache()
+
+  @JvmStatic
+  private external fun kernelName(kernel: Int): String
+
+  @JvmStatic
+  private external fun randomFill(out: ByteArray): Int
+
+  @JvmStatic
+  private external fun base64UrlEncodeBuffer(data: ByteBuffer): String?
+
+  @JvmStatic
+  private external fun base64UrlDecodeText(text: String): ByteArray?
+
+  private fun checkKeyAndIv(key: ByteBuffer, iv: ByteBuffer) {
+    require(key.capacity() == KEY_BYTES) { "Key must be 32 bytes" }
+    require(iv.capacity() == IV_BYTES) { "IV must be 12 bytes" }
+  }
+
+  @JvmStatic
+  private external fun argon2idHash(
+    password: ByteBuffer, salt: ByteBuffer,
+    tCost: Int, mCost: Int, lanes: Int, priority: Int,
+    out: ByteArray, stats: LongArray?
+  ): Int
+
+  @JvmStatic
+  private external fun aesGcmSeal(
+    key: ByteBuffer, iv: ByteBuffer, aad: ByteBuffer, plaintext: ByteBuffer,
+    out: ByteArray
+  ): Int
+
+  @JvmStatic
+  private external fun aesGcmOpen(
+    key: ByteBuffer, iv: ByteBuffer, aad: ByteBuffer, ciphertext: ByteBuffer, tag: ByteBuffer,
+    out: ByteArray
+  ): Int
+
+  @JvmStatic
+  private external fun aeadKeyCreate(key: ByteBuffer): Long
+
+  @JvmStatic
+  private external fun aeadKeyDestroy(handle: Long)
+
+  @JvmStatic
+  private external fun aeadBatchMeasure(batch: ByteBuffer, open: Boolean): Long
+
+  @JvmStatic
+  private external fun aeadSealBatch(handle: Long, batch: ByteBuffer, out: ByteArray): Int
+
+  @JvmStatic
+  private external fun aeadOpenBatch(handle: Long, batch: ByteBuffer, out: ByteArray, failed: IntArray): Int
+}
+
+/** Copies into a direct buffer of exactly this size, for the string-based API. */
+internal fun ByteArray.toDirectBuffer(): ByteBuffer =
+  ByteBuffer.allocateDirect(size).also {
+    it.put(this)
+    it.rewind()
+  }
+
+/** Zeroes a direct buffer that held key material or a password. */
+internal fun ByteBuffer.wipe() {
+  for (i in 0 until capacity()) put(i, 0)
+}
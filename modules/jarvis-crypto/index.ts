@@ -1,6 +1,17 @@
 import { requireNativeModule } from 'expo-modules-core';
 
-import type { Argon2Params, EncryptResult, JarvisCryptoModule } from './src/JarvisCrypto.types';
+import type {
+  AeadKey,
+  Argon2Params,
+  Argon2Stats,
+  Argon2StatsResult,
+  BytesLike,
+  EncryptBytesResult,
+  EncryptResult,
+  JarvisCryptoModule,
+  OpenRecord,
+  SealRecord,
+} from './src/JarvisCrypto.types';
 
 const NativeModule = requireNativeModule<JarvisCryptoModule>('JarvisCrypto');
 
@@ -12,6 +23,14 @@ export async function argon2id(
   return NativeModule.argon2id(password, salt, params);
 }
 
+export async function argon2idWithStats(
+  password: string,
+  salt: string,
+  params: Argon2Params
+): Promise<Argon2StatsResult> {
+  return NativeModule.argon2idWithStats(password, salt, params);
+}
+
 export async function aesGcmEncrypt(
   key: string,
   iv: string,
@@ -35,4 +54,178 @@ export async function randomBytes(length: number): Promise<string> {
   return NativeModule.randomBytes(length);
 }
 
-export type { Argon2Params, EncryptResult };
+// Derivations are cached natively for a few minutes so a retry with the
+// same password, salt and params skips the Argon2 run; this wipes them.
+export function clearKeyCache(): void {
+  NativeModule.clearKeyCache();
+}
+
+// Byte-buffer variants. Inputs are passed to native as typed arrays (an
+// ArrayBuffer is wrapped in a view, not copied) and results come back as
+// Uint8Array, skipping the base64url round trip of the string API.
+
+const TAG_BYTES = 16;
+
+function asBytes(data: BytesLike): Uint8Array {
+  return data instanceof Uint8Array ? data : new Uint8Array(data);
+}
+
+function asAad(aad: BytesLike | string): Uint8Array {
+  return typeof aad === 'string' ? new TextEncoder().encode(aad) : asBytes(aad);
+}
+
+export async function argon2idBytes(
+  password: BytesLike | string,
+  salt: BytesLike,
+  params: Argon2Params
+): Promise<Uint8Array> {
+  const passwordBytes =
+    typeof password === 'string' ? new TextEncoder().encode(password) : asBytes(password);
+  return NativeModule.argon2idBytes(passwordBytes, asBytes(salt), params);
+}
+
+export async function aesGcmEncryptBytes(
+  key: BytesLike,
+  iv: BytesLike,
+  plaintext: BytesLike,
+  aad: BytesLike | string
+): Promise<EncryptBytesResult> {
+  const sealed = await NativeModule.aesGcmSealBytes(
+    asBytes(key),
+    asBytes(iv),
+    asBytes(plaintext),
+    asAad(aad)
+  );
+  const split = sealed.length - TAG_BYTES;
+  return { ciphertext: sealed.subarray(0, split), tag: sealed.subarray(split) };
+}
+
+export async function aesGcmDecryptBytes(
+  key: BytesLike,
+  iv: BytesLike,
+  ciphertext: BytesLike,
+  tag: BytesLike,
+  aad: BytesLike | string
+): Promise<Uint8Array> {
+  return NativeModule.aesGcmOpenBytes(
+    asBytes(key),
+    asBytes(iv),
+    asBytes(ciphertext),
+    asBytes(tag),
+    asAad(aad)
+  );
+}
+
+export async function randomBuffer(length: number): Promise<Uint8Array> {
+  return NativeModule.randomBuffer(length);
+}
+
+// Several random values (a salt and a nonce, a key and its id) from one
+// native call. Every random function draws on the same native ChaCha20
+// pool, reseeded from the OS.
+export async function randomBuffers(lengths: number[]): Promise<Uint8Array[]> {
+  const bytes = await NativeModule.randomBuffers(lengths);
+  let offset = 0;
+  return lengths.map((length) => bytes.subarray(offset, (offset += length)));
+}
+
+// base64url on the native SIMD codec the string API uses; synchronous.
+export function base64urlEncode(data: BytesLike): string {
+  return NativeModule.base64UrlEncode(asBytes(data));
+}
+
+export function base64urlDecode(text: string): Uint8Array {
+  return NativeModule.base64UrlDecode(text);
+}
+
+// Many messages under one key (e.g. every config pushed to a node): the key
+// is expanded once natively and each batch crosses the bridge as a single
+// packed buffer each way, rather than once per message.
+
+const IV_BYTES = 12;
+const BATCH_HEADER_BYTES = IV_BYTES + 8;
+
+function packBatch(records: { iv: Uint8Array; aad: Uint8Array; data: Uint8Array }[]): Uint8Array {
+  let size = 0;
+  for (const r of records) {
+    if (r.iv.length !== IV_BYTES) {
+      throw new Error('IV must be 12 bytes');
+    }
+    size += BATCH_HEADER_BYTES + r.aad.length + r.data.length;
+  }
+
+  const batch = new Uint8Array(size);
+  const view = new DataView(batch.buffer);
+  let offset = 0;
+  for (const r of records) {
+    batch.set(r.iv, offset);
+    view.setUint32(offset + IV_BYTES, r.aad.length, true);
+    view.setUint32(offset + IV_BYTES + 4, r.data.length, true);
+    offset += BATCH_HEADER_BYTES;
+    batch.set(r.aad, offset);
+    offset += r.aad.length;
+    batch.set(r.data, offset);
+    offset += r.data.length;
+  }
+  return batch;
+}
+
+export function createAeadKey(key: BytesLike): AeadKey {
+  const native = new NativeModule.AeadKey(asBytes(key));
+
+  return {
+    async encryptBatch(records: SealRecord[]): Promise<EncryptBytesResult[]> {
+      const plaintexts = records.map((r) => asBytes(r.plaintext));
+      const sealed = await native.sealBatch(
+        packBatch(records.map((r, i) => ({ iv: asBytes(r.iv), aad: asAad(r.aad), data: plaintexts[i] })))
+      );
+
+      let offset = 0;
+      return plaintexts.map((p) => {
+        const ciphertext = sealed.subarray(offset, offset + p.length);
+        const tag = sealed.subarray(offset + p.length, offset + p.length + TAG_BYTES);
+        offset += p.length + TAG_BYTES;
+        return { ciphertext, tag };
+      });
+    },
+
+    async decryptBatch(records: OpenRecord[]): Promise<Uint8Array[]> {
+      const packed = records.map((r) => {
+        const ciphertext = asBytes(r.ciphertext);
+        const tag = asBytes(r.tag);
+        if (tag.length !== TAG_BYTES) {
+          throw new Error('Tag must be 16 bytes');
+        }
+        const data = new Uint8Array(ciphertext.length + TAG_BYTES);
+        data.set(ciphertext);
+        data.set(tag, ciphertext.length);
+        return { iv: asBytes(r.iv), aad: asAad(r.aad), data };
+      });
+      const opened = await native.openBatch(packBatch(packed));
+
+      let offset = 0;
+      return packed.map((r) => {
+        const length = r.data.length - TAG_BYTES;
+        const plaintext = opened.subarray(offset, offset + length);
+        offset += length;
+        return plaintext;
+      });
+    },
+
+    release(): void {
+      native.release();
+    },
+  };
+}
+
+export type {
+  AeadKey,
+  Argon2Params,
+  Argon2Stats,
+  Argon2StatsResult,
+  BytesLike,
+  EncryptBytesResult,
+  EncryptResult,
+  OpenRecord,
+  SealRecord,
+};
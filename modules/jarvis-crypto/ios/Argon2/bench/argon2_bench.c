@@ -0,0 +1,1360 @@
+/*
+ * argon2_bench - throughput sweep and known-answer check for the Argon2 core.
+ *
+ * Runs the RFC 9106, BLAKE2b/BLAKE2bp and AES-256-GCM test vectors on every
+ * kernel this CPU supports (GCM also as STREAM and batches), checks the
+ * base64url codec against RFC 4648 and a plain reference, the ChaCha20
+ * random pool against RFC 8439 and the derived-key cache, then times
+ * argon2_ctx over the m/t/p/kernel grid and prints one JSON document on
+ * stdout. Exit status is non-zero if any known answer is wrong, so the
+ * same binary gates correctness (ctest) and measures speed.
+ *
+ *   argon2_bench [--m 19456,65536] [--t 2] [--p 1,2,4] [--type id]
+ *                [--kernels auto,ref,avx2] [--reps 5] [--arena] [--kat-only]
+ *                [--calibrate 500] [--blake2 64] [--aead 64] [--stats]
+ *                [--lane-local] [--base64 64]
+ *
+ * --calibrate MS runs argon2_calibrate for each --p with the largest --m as
+ * the ceiling, then times one hash with the suggested parameters.
+ * --blake2 MIB times blake2b and blake2bp over a MIB buffer on each kernel.
+ * --aead MIB times aes256gcm_encrypt over a MIB buffer on each kernel.
+ * --base64 MIB times base64url_encode/decode of a MIB buffer on each kernel.
+ * --stats adds the argon2_stats phase breakdown of the fastest rep to each
+ * result.
+ * --lane-local hashes with ARGON2_FLAG_LANE_LOCAL (no effect with --arena).
+ */
+
+#include "aes_gcm.h"
+#include "argon2.h"
+#include "argon2_cache.h"
+#include "argon2_scheduler.h"
+#include "base64url.h"
+#include "blake2b.h"
+#include "drbg.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define MAX_LIST 16
+
+typedef struct {
+    uint32_t values[MAX_LIST];
+    size_t count;
+} u32_list;
+
+typedef struct {
+    u32_list m, t, p;
+    argon2_kernel kernels[MAX_LIST];
+    size_t kernel_count;
+    argon2_type type;
+    unsigned reps;
+    int use_arena;
+    int kat_only;
+    int stats;
+    int lane_local;
+    uint32_t calibrate_ms;
+    uint32_t blake2_mib;
+    uint32_t aead_mib;
+    uint32_t base64_mib;
+} bench_options;
+
+/* RFC 9106 section 5: t=3, m=32, p=4, 32-byte tag, version 0x13. */
+static const struct {
+    argon2_type type;
+    const char *name;
+    const char *tag;
+} rfc9106_vectors[] = {
+    {Argon2_d, "argon2d", "512b391b6f1162975371d30919734294f868e3be3984f3c1a13a4db9fabe4acb"},
+    {Argon2_i, "argon2i", "c814d9d1dc7f37aa13f0d77f2494bda1c8de6b016dd388d29952a4c4672b6ce8"},
+    {Argon2_id, "argon2id", "0d640df58d78766c08c037a34a8b53c9d01ef0452d75b65eb52520e96b01e659"},
+};
+
+/*
+ * BLAKE2b-512("abc") from RFC 7693 appendix A; BLAKE2bp-512 keyed with
+ * 00..3f over in[i] = i mod 256 (the empty input is the first entry of the
+ * reference blake2bp-kat.txt); the 1 MiB case takes the threaded path.
+ */
+static const struct {
+    const char *name;
+    int parallel;
+    size_t inlen;
+    size_t keylen;
+    const char *hash;
+} blake2_vectors[] = {
+    {"blake2b", 0, 3, 0,
+     "ba80a53f981c4d0d6a2797b69f12f6e94c212f14685ac4b74b12bb6fdbffa2d1"
+     "7d87c5392aab792dc252d5de4533cc9518d38aa8dbf1925ab92386edd4009923"},
+    {"blake2bp", 1, 0, 64,
+     "9d9461073e4eb640a255357b839f394b838c6ff57c9b686a3f76107c1066728f"
+     "3c9956bd785cbc3bf79dc2ab578c5a0c063b9d9c405848de1dbe821cd05c940a"},
+    {"blake2bp", 1, 1025, 64,
+     "b1042aeddf0f6e6fd7449c7423587eadf441eb36f792826a94a4d347cd5d78d6"
+     "e00874077c3c0558308f36e53fbe9e66c8b080eacb144df156e6a8a5fb0945d6"},
+    {"blake2bp", 1, (1 << 20) + 333, 0,
+     "b6f9fe768f2e6be474f73ebb971616f023c90e683b0e705d0c4c20fbbe060770"
+     "c8e65c38aaa67ab0676fa4daf3233cde1f0d0fbb10131d8f50efc46c68a80c92"},
+};
+
+/* AES-256 test cases 13, 14 and 16 of the GCM specification (McGrew and Viega). */
+static const struct {
+    const char *name;
+    const char *key, *iv, *ad, *pt;
+    const char *ct_tag;
+} gcm_vectors[] = {
+    {"gcm-13",
+     "0000000000000000000000000000000000000000000000000000000000000000",
+     "000000000000000000000000", "", "",
+     "530f8afbc74536b9a963b4f1c4cb738b"},
+    {"gcm-14",
+     "0000000000000000000000000000000000000000000000000000000000000000",
+     "000000000000000000000000", "", "00000000000000000000000000000000",
+     "cea7403d4d606b6e074ec5d3baf39d18d0d1c8a799996bf0265b98b5d48ab919"},
+    {"gcm-16",
+     "feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308",
+     "cafebabefacedbaddecaf888", "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+     "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d"
+     "8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+     "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd"
+     "2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662"
+     "76fc6ece0f4e1768cddf8853bb2d551b"},
+};
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static long peak_rss_kib(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;  /* bytes on Darwin */
+#else
+    return usage.ru_maxrss;         /* KiB on Linux */
+#endif
+}
+
+static void to_hex(char *out, const uint8_t *in, size_t len) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < len; ++i) {
+        out[2 * i] = digits[in[i] >> 4];
+        out[2 * i + 1] = digits[in[i] & 0x0f];
+    }
+    out[2 * len] = '\0';
+}
+
+static size_t from_hex(uint8_t *out, const char *hex) {
+    size_t len = strlen(hex) / 2;
+    for (size_t i = 0; i < len; ++i) {
+        unsigned byte;
+        sscanf(hex + 2 * i, "%2x", &byte);
+        out[i] = (uint8_t)byte;
+    }
+    return len;
+}
+
+static int parse_u32_list(const char *arg, u32_list *list) {
+    char *end;
+    list->count = 0;
+    while (*arg != '\0') {
+        if (list->count == MAX_LIST) return -1;
+        unsigned long v = strtoul(arg, &end, 10);
+        if (end == arg || v == 0 || v > UINT32_MAX) return -1;
+        list->values[list->count++] = (uint32_t)v;
+        arg = (*end == ',') ? end + 1 : end;
+        if (*end != ',' && *end != '\0') return -1;
+    }
+    return list->count > 0 ? 0 : -1;
+}
+
+static int parse_kernel(const char *name, argon2_kernel *kernel) {
+    for (int k = ARGON2_KERNEL_AUTO; k <= ARGON2_KERNEL_NEON; ++k) {
+        if (strcmp(name, argon2_kernel_name((argon2_kernel)k)) == 0) {
+            *kernel = (argon2_kernel)k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static int parse_kernel_list(const char *arg, bench_options *opts) {
+    char buf[256];
+    if (strlen(arg) >= sizeof(buf)) return -1;
+    strcpy(buf, arg);
+
+    opts->kernel_count = 0;
+    for (char *tok = strtok(buf, ","); tok != NULL; tok = strtok(NULL, ",")) {
+        if (opts->kernel_count == MAX_LIST) return -1;
+        if (parse_kernel(tok, &opts->kernels[opts->kernel_count]) != 0) return -1;
+        opts->kernel_count++;
+    }
+    return opts->kernel_count > 0 ? 0 : -1;
+}
+
+static int parse_type(const char *arg, argon2_type *type) {
+    if (strcmp(arg, "d") == 0) *type = Argon2_d;
+    else if (strcmp(arg, "i") == 0) *type = Argon2_i;
+    else if (strcmp(arg, "id") == 0) *type = Argon2_id;
+    else return -1;
+    return 0;
+}
+
+static const char *type_name(argon2_type type) {
+    switch (type) {
+    case Argon2_d: return "argon2d";
+    case Argon2_i: return "argon2i";
+    default: return "argon2id";
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--m KiB,...] [--t N,...] [--p N,...] [--type d|i|id]\n"
+            "          [--kernels name,...] [--reps N] [--arena] [--kat-only]\n"
+            "          [--calibrate MS] [--blake2 MIB] [--aead MIB] [--stats]\n"
+            "          [--lane-local] [--base64 MIB]\n",
+            prog);
+}
+
+static int parse_args(int argc, char **argv, bench_options *opts) {
+    memset(opts, 0, sizeof(*opts));
+    parse_u32_list("19456,65536", &opts->m);
+    parse_u32_list("2", &opts->t);
+    parse_u32_list("1,2,4", &opts->p);
+    opts->type = Argon2_id;
+    opts->reps = 5;
+
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *val = (i + 1 < argc) ? argv[i + 1] : NULL;
+        int rc = 0;
+
+        if (strcmp(arg, "--arena") == 0) {
+            opts->use_arena = 1;
+            continue;
+        }
+        if (strcmp(arg, "--kat-only") == 0) {
+            opts->kat_only = 1;
+            continue;
+        }
+        if (strcmp(arg, "--stats") == 0) {
+            opts->stats = 1;
+            continue;
+        }
+        if (strcmp(arg, "--lane-local") == 0) {
+            opts->lane_local = 1;
+            continue;
+        }
+        if (val == NULL) return -1;
+
+        if (strcmp(arg, "--m") == 0) rc = parse_u32_list(val, &opts->m);
+        else if (strcmp(arg, "--t") == 0) rc = parse_u32_list(val, &opts->t);
+        else if (strcmp(arg, "--p") == 0) rc = parse_u32_list(val, &opts->p);
+        else if (strcmp(arg, "--type") == 0) rc = parse_type(val, &opts->type);
+        else if (strcmp(arg, "--kernels") == 0) rc = parse_kernel_list(val, opts);
+        else if (strcmp(arg, "--reps") == 0) {
+            opts->reps = (unsigned)strtoul(val, NULL, 10);
+            rc = opts->reps > 0 ? 0 : -1;
+        } else if (strcmp(arg, "--calibrate") == 0) {
+            opts->calibrate_ms = (uint32_t)strtoul(val, NULL, 10);
+            rc = opts->calibrate_ms > 0 ? 0 : -1;
+        } else if (strcmp(arg, "--blake2") == 0) {
+            opts->blake2_mib = (uint32_t)strtoul(val, NULL, 10);
+            rc = opts->blake2_mib > 0 ? 0 : -1;
+        } else if (strcmp(arg, "--aead") == 0) {
+            opts->aead_mib = (uint32_t)strtoul(val, NULL, 10);
+            rc = opts->aead_mib > 0 ? 0 : -1;
+        } else if (strcmp(arg, "--base64") == 0) {
+            opts->base64_mib = (uint32_t)strtoul(val, NULL, 10);
+            rc = opts->base64_mib > 0 ? 0 : -1;
+        } else return -1;
+
+        if (rc != 0) return -1;
+        ++i;
+    }
+
+    if (opts->kernel_count == 0) {
+        for (int k = ARGON2_KERNEL_REF; k <= ARGON2_KERNEL_NEON; ++k) {
+            if (argon2_kernel_supported((argon2_kernel)k)) {
+                opts->kernels[opts->kernel_count++] = (argon2_kernel)k;
+            }
+        }
+    }
+    return 0;
+}
+
+/*
+ * One BLAKE2 vector, one-shot and streamed in uneven chunks; the hex of the
+ * one-shot result goes to hex. Returns non-zero if both match.
+ */
+static int check_blake2(size_t v, char *hex) {
+    uint8_t key[BLAKE2B_KEYBYTES], out[BLAKE2B_OUTBYTES], streamed[BLAKE2B_OUTBYTES];
+    size_t inlen = blake2_vectors[v].inlen, keylen = blake2_vectors[v].keylen;
+    uint8_t *in = (uint8_t *)malloc(inlen + 1);
+    int ok = in != NULL;
+
+    for (size_t i = 0; i < sizeof(key); ++i) key[i] = (uint8_t)i;
+    if (ok && blake2_vectors[v].parallel) {
+        for (size_t i = 0; i < inlen; ++i) in[i] = (uint8_t)i;
+        blake2bp_state S;
+        ok = blake2bp(out, sizeof(out), in, inlen, key, keylen) == 0 &&
+             blake2bp_init_key(&S, sizeof(streamed), key, keylen) == 0;
+        for (size_t off = 0, step = 1; ok && off < inlen; off += step, step = step * 3 + 1) {
+            blake2bp_update(&S, in + off, off + step <= inlen ? step : inlen - off);
+        }
+        ok = ok && blake2bp_final(&S, streamed, sizeof(streamed)) == 0;
+    } else if (ok) {
+        memcpy(in, "abc", inlen);
+        blake2b_state S;
+        ok = blake2b(out, sizeof(out), in, inlen, key, keylen) == 0 &&
+             blake2b_init_key(&S, sizeof(streamed), key, keylen) == 0;
+        for (size_t off = 0; ok && off < inlen; ++off) {
+            blake2b_update(&S, in + off, 1);
+        }
+        ok = ok && blake2b_final(&S, streamed, sizeof(streamed)) == 0;
+    }
+    free(in);
+
+    to_hex(hex, out, sizeof(out));
+    return ok && strcmp(hex, blake2_vectors[v].hash) == 0 &&
+           memcmp(out, streamed, sizeof(out)) == 0;
+}
+
+/*
+ * One GCM vector: encrypt, decrypt in place, and reject a flipped tag bit.
+ * The hex of ciphertext || tag goes to hex. Returns non-zero if all hold.
+ */
+static int check_gcm(size_t v, char *hex) {
+    uint8_t raw[AES256GCM_KEYBYTES], iv[AES256GCM_IVBYTES], ad[32], pt[64];
+    uint8_t out[64 + AES256GCM_TAGBYTES];
+    aes256gcm_key key;
+
+    from_hex(raw, gcm_vectors[v].key);
+    from_hex(iv, gcm_vectors[v].iv);
+    size_t adlen = from_hex(ad, gcm_vectors[v].ad);
+    size_t ptlen = from_hex(pt, gcm_vectors[v].pt);
+
+    int ok = aes256gcm_key_init(&key, raw) == AES_GCM_OK &&
+             aes256gcm_encrypt(&key, iv, ad, adlen, pt, ptlen, out, out + ptlen) == AES_GCM_OK;
+    to_hex(hex, out, ptlen + AES256GCM_TAGBYTES);
+    ok = ok && strcmp(hex, gcm_vectors[v].ct_tag) == 0;
+
+    ok = ok && aes256gcm_decrypt(&key, iv, ad, adlen, out, ptlen, out + ptlen, out) == AES_GCM_OK &&
+         memcmp(out, pt, ptlen) == 0;
+    ok = ok && aes256gcm_encrypt(&key, iv, ad, adlen, pt, ptlen, out, out + ptlen) == AES_GCM_OK;
+    out[ptlen] ^= 0x01;
+    ok = ok && aes256gcm_decrypt(&key, iv, ad, adlen, out, ptlen, out + ptlen, out) ==
+                   AES_GCM_AUTH_FAILED;
+    aes256gcm_key_wipe(&key);
+    return ok;
+}
+
+/*
+ * STREAM over three uneven chunks: each sealed chunk equals plain GCM under
+ * prefix || index || last, the sequential API round-trips, and reordered,
+ * mis-flagged, tampered or truncated streams are rejected.
+ */
+static int check_stream(void) {
+    enum { CHUNKS = 3 };
+    static const size_t lens[CHUNKS] = {4101, 0, 77};
+    static const uint8_t prefix[AES256GCM_STREAM_PREFIXBYTES] = {1, 2, 3, 4, 5, 6, 7};
+    static const uint8_t ad[5] = "jrvis";
+    uint8_t raw[AES256GCM_KEYBYTES], iv[AES256GCM_IVBYTES];
+    uint8_t pt[4101], sealed[CHUNKS][4101 + AES256GCM_TAGBYTES], out[4101 + AES256GCM_TAGBYTES];
+    aes256gcm_key key;
+    aes256gcm_stream enc, dec;
+    int ok = 1;
+
+    for (size_t i = 0; i < sizeof(raw); ++i) raw[i] = (uint8_t)(0xa0 + i);
+    for (size_t i = 0; i < sizeof(pt); ++i) pt[i] = (uint8_t)(i * 7);
+    ok = aes256gcm_key_init(&key, raw) == AES_GCM_OK &&
+         aes256gcm_stream_init(&enc, raw, prefix) == AES_GCM_OK &&
+         aes256gcm_stream_init(&dec, raw, prefix) == AES_GCM_OK;
+
+    for (uint32_t c = 0; ok && c < CHUNKS; ++c) {
+        int last = c == CHUNKS - 1;
+        ok = aes256gcm_stream_push(&enc, last, ad, sizeof(ad), pt, lens[c], sealed[c]) == AES_GCM_OK;
+
+        memcpy(iv, prefix, sizeof(prefix));
+        iv[7] = 0; iv[8] = 0; iv[9] = 0; iv[10] = (uint8_t)c;
+        iv[11] = (uint8_t)last;
+        ok = ok && aes256gcm_encrypt(&key, iv, ad, sizeof(ad), pt, lens[c], out, out + lens[c]) ==
+                       AES_GCM_OK &&
+             memcmp(out, sealed[c], lens[c] + AES256GCM_TAGBYTES) == 0;
+    }
+    ok = ok && aes256gcm_stream_finished(&enc) == AES_GCM_OK &&
+         aes256gcm_stream_push(&enc, 1, NULL, 0, pt, 1, out) == AES_GCM_STREAM_FINISHED;
+
+    /* Out of order, wrong last flag, tampered. */
+    ok = ok && aes256gcm_stream_open_chunk(&key, prefix, 1, 0, ad, sizeof(ad), sealed[0],
+                                           lens[0] + AES256GCM_TAGBYTES, out) == AES_GCM_AUTH_FAILED;
+    ok = ok && aes256gcm_stream_open_chunk(&key, prefix, 0, 1, ad, sizeof(ad), sealed[0],
+                                           lens[0] + AES256GCM_TAGBYTES, out) == AES_GCM_AUTH_FAILED;
+    sealed[2][5] ^= 0x80;
+    ok = ok && aes256gcm_stream_open_chunk(&key, prefix, 2, 1, ad, sizeof(ad), sealed[2],
+                                           lens[2] + AES256GCM_TAGBYTES, out) == AES_GCM_AUTH_FAILED;
+    sealed[2][5] ^= 0x80;
+
+    for (uint32_t c = 0; ok && c < CHUNKS; ++c) {
+        ok = aes256gcm_stream_finished(&dec) == AES_GCM_TRUNCATED &&
+             aes256gcm_stream_pull(&dec, c == CHUNKS - 1, ad, sizeof(ad), sealed[c],
+                                   lens[c] + AES256GCM_TAGBYTES, out) == AES_GCM_OK &&
+             memcmp(out, pt, lens[c]) == 0;
+    }
+    ok = ok && aes256gcm_stream_finished(&dec) == AES_GCM_OK;
+
+    aes256gcm_key_wipe(&key);
+    aes256gcm_stream_wipe(&enc);
+    aes256gcm_stream_wipe(&dec);
+    return ok;
+}
+
+static void cache_job_done(uint64_t job_id, int result, void *user) {
+    (void)job_id;
+    __atomic_store_n((int *)user, result == ARGON2_OK ? 1 : -1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Submits ctx and waits; returns 1 if the callback had already run inside
+ * submit (always, with ARGON2_NO_THREADS).
+ */
+static int cache_submit(argon2_scheduler *scheduler, argon2_context *ctx, int *ok) {
+    int done = 0;
+    uint64_t id;
+    struct timespec pause = {0, 1000000};
+
+    *ok = argon2_scheduler_submit(scheduler, ctx, Argon2_id, ARGON2_PRIORITY_NORMAL,
+                                  cache_job_done, &done, &id) == ARGON2_OK;
+    int immediate = __atomic_load_n(&done, __ATOMIC_ACQUIRE) != 0;
+    while (*ok && __atomic_load_n(&done, __ATOMIC_ACQUIRE) == 0) {
+        nanosleep(&pause, NULL);
+    }
+    *ok = *ok && done == 1;
+    return immediate;
+}
+
+/*
+ * Derived-key cache: hits only on identical inputs, LRU eviction at the
+ * size cap, clear and TTL expiry wipe, and a scheduler with a cache
+ * answers a repeated submit inside the call with the hashed tag.
+ */
+static int check_cache(void) {
+    uint8_t pwd[8] = "password", salt[16] = "somesaltsomesalt", tag[32], out[32];
+    argon2_context a = {tag, sizeof(tag), pwd, 8, salt, 16, NULL, 0, NULL, 0,
+                        1, 32, 1, 0, ARGON2_VERSION_NUMBER, 0, NULL};
+    argon2_context b = a, c = a, probe;
+    argon2_cache *cache = NULL, *brief = NULL;
+    argon2_scheduler *scheduler = NULL;
+    argon2_stats stats;
+    struct timespec pause = {0, 5000000};
+    int ok;
+
+    b.t_cost = 2;
+    c.m_cost = 64;
+    memset(tag, 0x5a, sizeof(tag));
+    ok = argon2_cache_create(&cache, 2, 60000) == ARGON2_OK &&
+         argon2_cache_create(&brief, 4, 1) == ARGON2_OK;
+
+    probe = a;
+    probe.out = out;
+    ok = ok && argon2_cache_lookup(cache, &probe, Argon2_id) == ARGON2_CACHE_MISS &&
+         argon2_cache_store(cache, &a, Argon2_id) == ARGON2_OK &&
+         argon2_cache_lookup(cache, &probe, Argon2_id) == ARGON2_OK &&
+         memcmp(out, tag, sizeof(tag)) == 0;
+    probe.outlen = 16;
+    ok = ok && argon2_cache_lookup(cache, &probe, Argon2_id) == ARGON2_CACHE_MISS &&
+         argon2_cache_lookup(cache, &probe, Argon2_i) == ARGON2_CACHE_MISS;
+    probe.outlen = 32;
+    pwd[0] ^= 1;
+    ok = ok && argon2_cache_lookup(cache, &probe, Argon2_id) == ARGON2_CACHE_MISS;
+    pwd[0] ^= 1;
+
+    /* a was used after b was stored, so c evicts b. */
+    ok = ok && argon2_cache_store(cache, &b, Argon2_id) == ARGON2_OK &&
+         argon2_cache_lookup(cache, &probe, Argon2_id) == ARGON2_OK &&
+         argon2_cache_store(cache, &c, Argon2_id) == ARGON2_OK &&
+         argon2_cache_count(cache) == 2;
+    probe = b;
+    probe.out = out;
+    ok = ok && argon2_cache_lookup(cache, &probe, Argon2_id) == ARGON2_CACHE_MISS;
+    argon2_cache_clear(cache);
+    probe = a;
+    probe.out = out;
+    ok = ok && argon2_cache_count(cache) == 0 &&
+         argon2_cache_lookup(cache, &probe, Argon2_id) == ARGON2_CACHE_MISS;
+
+    ok = ok && argon2_cache_store(brief, &a, Argon2_id) == ARGON2_OK;
+    nanosleep(&pause, NULL);
+    ok = ok && argon2_cache_lookup(brief, &probe, Argon2_id) == ARGON2_CACHE_MISS &&
+         argon2_cache_count(brief) == 0;
+
+    /* Through the scheduler: the first submit hashes, the second is a hit. */
+    ok = ok && argon2_scheduler_create(&scheduler, 1, 0) == ARGON2_OK;
+    if (ok) {
+        int completed;
+        argon2_scheduler_set_cache(scheduler, cache);
+        memset(tag, 0, sizeof(tag));
+        cache_submit(scheduler, &a, &completed);
+        ok = completed && argon2_cache_count(cache) == 1;
+        memcpy(out, tag, sizeof(tag));
+        memset(tag, 0, sizeof(tag));
+        a.stats = &stats;
+        ok = ok && cache_submit(scheduler, &a, &completed) == 1 && completed && stats.cached &&
+             memcmp(out, tag, sizeof(tag)) == 0 &&
+             argon2id_hash_raw(1, 32, 1, pwd, 8, salt, 16, out, sizeof(out)) == ARGON2_OK &&
+             memcmp(out, tag, sizeof(tag)) == 0;
+        argon2_scheduler_destroy(scheduler);
+    }
+
+    argon2_cache_destroy(cache);
+    argon2_cache_destroy(brief);
+    return ok;
+}
+
+/*
+ * argon2_stats: the tag is unchanged, the per-pass and per-slice times
+ * add up to the fill time, and the counts match the geometry, both for a
+ * one-shot hash and one stepped a segment at a time (on the calling thread
+ * alone, so one thread).
+ */
+static int check_stats(void) {
+    uint8_t pwd[8] = "password", salt[16] = "somesaltsomesalt", plain[32], tag[32];
+    argon2_stats stats;
+    argon2_context ctx = {plain, sizeof(plain), pwd, 8, salt, 16, NULL, 0, NULL, 0,
+                          3, 64, 2, 0, ARGON2_VERSION_NUMBER, 0, NULL};
+    argon2_state *state;
+    int ok = argon2_ctx(&ctx, Argon2_id) == ARGON2_OK;
+
+    for (int stepped = 0; ok && stepped < 2; ++stepped) {
+        ctx.out = tag;
+        ctx.stats = &stats;
+        if (stepped) {
+            int rc = argon2_init(&state, NULL, &ctx, Argon2_id);
+            if (rc == ARGON2_OK) {
+                do {
+                    rc = argon2_step(state, 1);
+                } while (rc == ARGON2_PENDING);
+                ok = argon2_finish(state) == ARGON2_OK && rc == ARGON2_OK;
+            } else {
+                ok = 0;
+            }
+        } else {
+            ok = argon2_ctx(&ctx, Argon2_id) == ARGON2_OK;
+        }
+
+        uint64_t passes = 0, slices = 0;
+        for (int i = 0; i < ARGON2_STATS_MAX_PASSES; ++i) passes += stats.pass_ns[i];
+        for (int i = 0; i < 4; ++i) slices += stats.slice_ns[i];
+        ok = ok && memcmp(tag, plain, sizeof(tag)) == 0 && stats.passes == 3 &&
+             stats.blocks == 3 * 64 && stats.fill_ns > 0 && passes == stats.fill_ns &&
+             slices == stats.fill_ns && stats.pass_ns[3] == 0 && !stats.cached &&
+             stats.total_ns >= stats.alloc_ns + stats.init_ns + stats.fill_ns +
+                                stats.finalize_ns + stats.wipe_ns &&
+             stats.blocks_per_second > 0 && stats.kernel == argon2_active_kernel() &&
+             (stepped ? stats.threads == 1 : stats.threads >= 1 && stats.threads <= 2);
+    }
+    return ok;
+}
+
+/*
+ * Cost limits: a t_cost whose segment count (t * 4 * lanes) overflows 32
+ * bits, or an m_cost whose matrix overflows size_t, is rejected by every
+ * entry point rather than run wrapped; the largest t_cost that fits is
+ * still accepted, and is what argon2_calibrate suggests at most. A
+ * scheduler runs a job bigger than its budget rather than refusing it.
+ */
+static int check_limits(void) {
+    uint8_t pwd[8] = "password", salt[16] = "somesaltsomesalt", tag[32];
+    const uint32_t wrap = UINT32_C(1) << 30;
+    argon2_context ctx = {tag, sizeof(tag), pwd, 8, salt, 16, NULL, 0, NULL, 0,
+                          wrap, 8, 1, 0, ARGON2_VERSION_NUMBER, 0, NULL};
+    argon2_cache *cache = NULL;
+    argon2_state *state = NULL;
+    int ok = argon2_cache_create(&cache, 2, 60000) == ARGON2_OK;
+
+    ok = ok && argon2_ctx(&ctx, Argon2_id) == ARGON2_TIME_TOO_LARGE &&
+         argon2_init(&state, NULL, &ctx, Argon2_id) == ARGON2_TIME_TOO_LARGE &&
+         argon2_cache_store(cache, &ctx, Argon2_id) == ARGON2_TIME_TOO_LARGE &&
+         argon2id_hash_raw(wrap + 1, 8, 1, pwd, 8, salt, 16, tag, 32) ==
+             ARGON2_TIME_TOO_LARGE;
+
+    ctx.t_cost = wrap >> 2;
+    ctx.m_cost = 32;
+    ctx.lanes = ctx.threads = 4;
+    ok = ok && argon2_ctx(&ctx, Argon2_id) == ARGON2_TIME_TOO_LARGE;
+
+    /* A matrix whose size in bytes overflows size_t (32-bit ABIs only). */
+    if (ARGON2_MAX_MEMORY < UINT32_MAX) {
+        argon2_arena *arena = NULL;
+        argon2_context big = ctx;
+        big.t_cost = 1;
+        big.m_cost = ARGON2_MAX_MEMORY + 1;
+        ok = ok && argon2_ctx(&big, Argon2_id) == ARGON2_MEMORY_TOO_MUCH &&
+             argon2_arena_create(&arena, ARGON2_MAX_MEMORY + 1, 0) == ARGON2_MEMORY_TOO_MUCH &&
+             arena == NULL;
+    }
+
+    /* argon2_calibrate never suggests a t_cost the core then refuses. */
+    argon2_calibration fast = {1e-6, 0, 4, argon2_active_kernel()}, saved;
+    argon2_params params;
+    int had_saved = argon2_get_calibration(&saved) == ARGON2_OK;
+    argon2_set_calibration(&fast);
+    ok = ok && argon2_calibrate(UINT32_MAX, 32, 4, &params) == ARGON2_OK &&
+         params.t_cost == (wrap >> 2) - 1 && params.m_cost == 32 && params.lanes == 4;
+    argon2_set_calibration(had_saved ? &saved : NULL);
+
+    /* That t_cost, one pass short of the limit: set up, cancelled before filling. */
+    ctx.t_cost = params.t_cost;
+    if (ok && argon2_init(&state, NULL, &ctx, Argon2_id) == ARGON2_OK) {
+        argon2_cancel(state);
+        ok = argon2_finish(state) == ARGON2_CANCELLED;
+    } else {
+        ok = 0;
+    }
+
+    /* A job larger than a scheduler's whole budget still runs, alone. */
+    argon2_scheduler *scheduler = NULL;
+    ok = ok && argon2_scheduler_create(&scheduler, 2, 16) == ARGON2_OK;
+    if (ok) {
+        uint8_t expect[32];
+        int completed;
+        argon2_context over = {tag, sizeof(tag), pwd, 8, salt, 16, NULL, 0, NULL, 0,
+                               1, 64, 1, 0, ARGON2_VERSION_NUMBER, 0, NULL};
+        memset(tag, 0, sizeof(tag));
+        cache_submit(scheduler, &over, &completed);
+        ok = completed && argon2_scheduler_memory_in_use(scheduler) == 0 &&
+             argon2id_hash_raw(1, 64, 1, pwd, 8, salt, 16, expect, sizeof(expect)) ==
+                 ARGON2_OK &&
+             memcmp(expect, tag, sizeof(tag)) == 0;
+        argon2_scheduler_destroy(scheduler);
+    }
+    argon2_cache_destroy(cache);
+    return ok;
+}
+
+/*
+ * ARGON2_FLAG_LANE_LOCAL changes only where lanes live: tags must match the
+ * contiguous layout for one lane, for several (threaded, and stepped one
+ * segment at a time on the calling thread) and for lanes big enough to be
+ * huge-page strided.
+ */
+static int check_lane_local(void) {
+    static const uint32_t shapes[][3] = {{2, 64, 1}, {3, 256, 4}, {1, 5000, 2}};
+    uint8_t pwd[8] = "password", salt[16] = "somesaltsomesalt", plain[32], tag[32];
+    argon2_state *state;
+    int ok = 1;
+
+    for (size_t i = 0; ok && i < sizeof(shapes) / sizeof(shapes[0]); ++i) {
+        argon2_context ctx = {plain, sizeof(plain), pwd, 8, salt, 16, NULL, 0, NULL, 0,
+                              shapes[i][0], shapes[i][1], shapes[i][2], 0,
+                              ARGON2_VERSION_NUMBER, 0, NULL};
+        ok = argon2_ctx(&ctx, Argon2_id) == ARGON2_OK;
+
+        ctx.out = tag;
+        ctx.flags = ARGON2_FLAG_LANE_LOCAL;
+        memset(tag, 0, sizeof(tag));
+        ok = ok && argon2_ctx(&ctx, Argon2_id) == ARGON2_OK &&
+             memcmp(tag, plain, sizeof(tag)) == 0;
+
+        memset(tag, 0, sizeof(tag));
+        ok = ok && argon2_init(&state, NULL, &ctx, Argon2_id) == ARGON2_OK;
+        if (ok) {
+            int rc;
+            do {
+                rc = argon2_step(state, 1);
+            } while (rc == ARGON2_PENDING);
+            ok = argon2_finish(state) == ARGON2_OK && rc == ARGON2_OK &&
+                 memcmp(tag, plain, sizeof(tag)) == 0;
+        }
+    }
+    return ok;
+}
+
+static size_t put_record(uint8_t *p, const uint8_t *iv, const uint8_t *ad, uint32_t adlen,
+                         const uint8_t *in, uint32_t inlen) {
+    memcpy(p, iv, AES256GCM_IVBYTES);
+    for (int i = 0; i < 4; ++i) {
+        p[AES256GCM_IVBYTES + i] = (uint8_t)(adlen >> (8 * i));
+        p[AES256GCM_IVBYTES + 4 + i] = (uint8_t)(inlen >> (8 * i));
+    }
+    memcpy(p + AES256GCM_BATCH_HEADERBYTES, ad, adlen);
+    memcpy(p + AES256GCM_BATCH_HEADERBYTES + adlen, in, inlen);
+    return AES256GCM_BATCH_HEADERBYTES + adlen + inlen;
+}
+
+/*
+ * Batch seal must match record-by-record aes256gcm_encrypt, open must
+ * invert it, and one bad tag must fail the whole open and name the record.
+ */
+static int check_batch(void) {
+    enum { RECORDS = 3, MAXLEN = 300 };
+    static const uint32_t lens[RECORDS] = {37, 0, 300}, adlens[RECORDS] = {5, 0, 17};
+    uint8_t raw[AES256GCM_KEYBYTES], iv[RECORDS][AES256GCM_IVBYTES], ad[17], pt[MAXLEN];
+    uint8_t batch[RECORDS * (AES256GCM_BATCH_HEADERBYTES + 17 + MAXLEN + AES256GCM_TAGBYTES)];
+    uint8_t sealed[RECORDS * (MAXLEN + AES256GCM_TAGBYTES)], opened[RECORDS * MAXLEN];
+    uint8_t one[MAXLEN + AES256GCM_TAGBYTES];
+    size_t len = 0, count = 0, outlen = 0, failed = 0, off = 0;
+    aes256gcm_key key;
+
+    for (size_t i = 0; i < sizeof(raw); ++i) raw[i] = (uint8_t)(0x40 + i);
+    for (size_t i = 0; i < sizeof(ad); ++i) ad[i] = (uint8_t)(0xd0 ^ i);
+    for (size_t i = 0; i < sizeof(pt); ++i) pt[i] = (uint8_t)(i * 13);
+    int ok = aes256gcm_key_init(&key, raw) == AES_GCM_OK;
+
+    for (int r = 0; r < RECORDS; ++r) {
+        memset(iv[r], 0x10 + r, AES256GCM_IVBYTES);
+        len += put_record(batch + len, iv[r], ad, adlens[r], pt, lens[r]);
+    }
+    ok = ok && aes256gcm_batch_measure(batch, len, 0, &count, &outlen) == AES_GCM_OK &&
+         count == RECORDS && outlen == 37 + 0 + 300 + RECORDS * AES256GCM_TAGBYTES &&
+         aes256gcm_seal_batch(&key, batch, len, sealed) == AES_GCM_OK;
+    for (int r = 0; ok && r < RECORDS; ++r) {
+        ok = aes256gcm_encrypt(&key, iv[r], ad, adlens[r], pt, lens[r], one, one + lens[r]) ==
+                 AES_GCM_OK &&
+             memcmp(one, sealed + off, lens[r] + AES256GCM_TAGBYTES) == 0;
+        off += lens[r] + AES256GCM_TAGBYTES;
+    }
+
+    /* The sealed records, as an open batch. */
+    len = off = 0;
+    for (int r = 0; r < RECORDS; ++r) {
+        len += put_record(batch + len, iv[r], ad, adlens[r], sealed + off,
+                          lens[r] + AES256GCM_TAGBYTES);
+        off += lens[r] + AES256GCM_TAGBYTES;
+    }
+    ok = ok && aes256gcm_batch_measure(batch, len, 1, &count, &outlen) == AES_GCM_OK &&
+         outlen == 37 + 0 + 300 && aes256gcm_open_batch(&key, batch, len, opened, &failed) == AES_GCM_OK &&
+         memcmp(opened, pt, 37) == 0 && memcmp(opened + 37, pt, 300) == 0;
+
+    batch[len - 1] ^= 1;
+    ok = ok && aes256gcm_open_batch(&key, batch, len, opened, &failed) == AES_GCM_AUTH_FAILED &&
+         failed == 2 && opened[0] == 0 && opened[36] == 0;
+
+    /* A failure on the first record still zeroes the space of the later ones. */
+    batch[len - 1] ^= 1;
+    batch[AES256GCM_BATCH_HEADERBYTES + 5] ^= 1;
+    memset(opened, 0x5a, sizeof(opened));
+    ok = ok && aes256gcm_open_batch(&key, batch, len, opened, &failed) == AES_GCM_AUTH_FAILED &&
+         failed == 0;
+    for (size_t i = 0; ok && i < outlen; ++i) ok = opened[i] == 0;
+    ok = ok && aes256gcm_batch_measure(batch, len - 1, 1, NULL, NULL) == AES_GCM_INVALID_PARAMETER &&
+         aes256gcm_batch_measure(NULL, 0, 0, &count, &outlen) == AES_GCM_OK && count == 0;
+
+    aes256gcm_key_wipe(&key);
+    return ok;
+}
+
+/* RFC 4648 section 10, plus both URL-alphabet characters. */
+static const struct {
+    const char *in, *out;
+} base64url_vectors[] = {
+    {"", ""}, {"f", "Zg"}, {"fo", "Zm8"}, {"foo", "Zm9v"},
+    {"foob", "Zm9vYg"}, {"fooba", "Zm9vYmE"}, {"foobar", "Zm9vYmFy"},
+    {"\xfb\xff", "-_8"},
+};
+
+/* Straight-line encoder the kernels are checked against. */
+static void base64url_reference(const uint8_t *in, size_t len, char *out) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    uint32_t acc = 0;
+    int bits = 0;
+
+    for (size_t i = 0; i < len; ++i) {
+        acc = acc << 8 | in[i];
+        for (bits += 8; bits >= 6; bits -= 6) *out++ = alphabet[(acc >> (bits - 6)) & 63];
+    }
+    if (bits > 0) *out++ = alphabet[(acc << (6 - bits)) & 63];
+}
+
+/*
+ * Every length up to 300 (all kernel block/tail splits) plus a long one
+ * must match the reference and round-trip, padded or not; a character
+ * outside the alphabet anywhere, or misplaced padding, must be rejected
+ * with out wiped.
+ */
+static int check_base64url(void) {
+    enum { MAXLEN = 1000 };
+    static const char *const malformed[] = {"Z", "Zg=", "Zg===", "Z===", "====", "Zg==Zm8", "Zm 8", "Zm+8", "Zm/8"};
+    static const uint8_t bad_chars[] = {'+', '/', '=', ' ', 0x80, 0xff, 0};
+    uint8_t in[MAXLEN], out[MAXLEN];
+    char text[MAXLEN * 4 / 3 + 8], expect[MAXLEN * 4 / 3 + 8];
+    size_t outlen;
+    int ok = 1;
+
+    for (size_t v = 0; v < sizeof(base64url_vectors) / sizeof(base64url_vectors[0]); ++v) {
+        size_t len = strlen(base64url_vectors[v].in), textlen = strlen(base64url_vectors[v].out);
+        ok = ok && base64url_encoded_len(len) == textlen &&
+             base64url_encode((const uint8_t *)base64url_vectors[v].in, len, text) == BASE64URL_OK &&
+             memcmp(text, base64url_vectors[v].out, textlen) == 0 &&
+             base64url_decode(text, textlen, out, &outlen) == BASE64URL_OK && outlen == len &&
+             memcmp(out, base64url_vectors[v].in, len) == 0;
+    }
+
+    for (size_t i = 0; i < MAXLEN; ++i) in[i] = (uint8_t)(i * 7 + (i >> 8) * 13);
+    for (size_t len = 0; ok && len <= MAXLEN; len = len < 300 ? len + 1 : MAXLEN + (len == MAXLEN)) {
+        size_t textlen = base64url_encoded_len(len);
+        base64url_reference(in, len, expect);
+        memset(out, 0xaa, sizeof(out));
+        ok = base64url_encode(in, len, text) == BASE64URL_OK && memcmp(text, expect, textlen) == 0 &&
+             base64url_decoded_max(textlen) == len &&
+             base64url_decode(text, textlen, out, &outlen) == BASE64URL_OK && outlen == len &&
+             memcmp(out, in, len) == 0;
+        /* The same text padded to a multiple of four. */
+        while (textlen % 4 != 0) text[textlen++] = '=';
+        ok = ok && base64url_decode(text, textlen, out, &outlen) == BASE64URL_OK && outlen == len &&
+             memcmp(out, in, len) == 0;
+    }
+
+    /* Bad characters at block edges and inside the bulk and the tail. */
+    static const size_t positions[] = {0, 1, 15, 16, 23, 31, 32, 47, 63, 64, 100, 200, 1332};
+    size_t textlen = base64url_encoded_len(MAXLEN);
+    base64url_encode(in, MAXLEN, text);
+    for (size_t p = 0; ok && p < sizeof(positions) / sizeof(positions[0]); ++p) {
+        for (size_t b = 0; ok && b < sizeof(bad_chars); ++b) {
+            char saved = text[positions[p]];
+            text[positions[p]] = (char)bad_chars[b];
+            memset(out, 0xaa, sizeof(out));
+            ok = base64url_decode(text, textlen, out, &outlen) == BASE64URL_INVALID && outlen == 0;
+            for (size_t i = 0; ok && i < positions[p] / 4 * 3; ++i) ok = out[i] == 0;
+            text[positions[p]] = saved;
+        }
+    }
+
+    for (size_t m = 0; ok && m < sizeof(malformed) / sizeof(malformed[0]); ++m) {
+        ok = base64url_decode(malformed[m], strlen(malformed[m]), out, &outlen) == BASE64URL_INVALID;
+    }
+    return ok && base64url_decode("Zg==", 4, out, &outlen) == BASE64URL_OK && outlen == 1 &&
+           base64url_decode(NULL, 0, NULL, &outlen) == BASE64URL_OK && outlen == 0 &&
+           base64url_encode(NULL, 0, NULL) == BASE64URL_OK;
+}
+
+/*
+ * A pool seeded with zeros serves RFC 8439 A.1 keystream from byte 32
+ * (bytes 0..31 became the next key), and after its first 992 bytes
+ * continues under that key. Output must not depend on how requests are
+ * split; OS-seeded pools, and a pool on either side of fork(), must
+ * disagree.
+ */
+static int check_drbg(void) {
+    static const char *const first =
+        "da41597c5157488d7724e03fb8d84a376a43b8f41518a11cc387b669b2ee6586"
+        "9f07e7be5551387a98ba977c732d080dcb0f29a048e3656912c6533e32ee7aed"
+        "29b721769ce64e43d57133b074d839d531ed1f28510afb45ace10a1f4b794d6f";
+    static const char *const second =
+        "afbdad2845b93cdbb2fe6463d2fe162adae0f6e676f0494218f5ce0596e79f5c";
+    static const size_t splits[] = {1, 7, 12, 16, 32, 33, 100, 991, 2000};
+    uint8_t seed[DRBG_SEEDBYTES] = {0}, a[5000], b[5000], expect[96];
+    drbg *pool = NULL, *other = NULL;
+    int ok;
+
+    ok = drbg_create_seeded(&pool, seed) == DRBG_OK &&
+         drbg_generate(pool, a, 96) == DRBG_OK && from_hex(expect, first) == 96 &&
+         memcmp(a, expect, 96) == 0 &&
+         drbg_generate(pool, a, 992 - 96) == DRBG_OK &&
+         drbg_generate(pool, a, 32) == DRBG_OK && from_hex(expect, second) == 32 &&
+         memcmp(a, expect, 32) == 0;
+    drbg_destroy(pool);
+    pool = NULL;
+
+    memset(seed, 0x5a, sizeof(seed));
+    ok = ok && drbg_create_seeded(&pool, seed) == DRBG_OK &&
+         drbg_create_seeded(&other, seed) == DRBG_OK &&
+         drbg_generate(pool, a, sizeof(a)) == DRBG_OK;
+    for (size_t done = 0, i = 0; ok && done < sizeof(b); ++i) {
+        size_t n = splits[i % (sizeof(splits) / sizeof(splits[0]))];
+        if (n > sizeof(b) - done) n = sizeof(b) - done;
+        ok = drbg_generate(other, b + done, n) == DRBG_OK;
+        done += n;
+    }
+    ok = ok && memcmp(a, b, sizeof(a)) == 0;
+    drbg_destroy(pool);
+    drbg_destroy(other);
+    pool = other = NULL;
+
+    ok = ok && drbg_create(&pool) == DRBG_OK && drbg_create(&other) == DRBG_OK &&
+         drbg_generate(pool, a, 64) == DRBG_OK && drbg_generate(other, b, 64) == DRBG_OK &&
+         memcmp(a, b, 64) != 0 &&
+         drbg_reseed(pool) == DRBG_OK && drbg_generate(pool, b, 64) == DRBG_OK &&
+         memcmp(a, b, 64) != 0 &&
+         drbg_generate(pool, NULL, 0) == DRBG_OK &&
+         drbg_generate(pool, NULL, 1) == DRBG_INVALID_PARAMETER &&
+         drbg_generate(NULL, a, 1) == DRBG_INVALID_PARAMETER;
+
+    /* The child reseeds on its first call instead of repeating the parent. */
+    int fds[2];
+    if (ok && pipe(fds) == 0) {
+        pid_t child = fork();
+        if (child == 0) {
+            close(fds[0]);
+            int written = drbg_generate(pool, a, 64) == DRBG_OK &&
+                          write(fds[1], a, 64) == 64;
+            _exit(written ? 0 : 1);
+        }
+        close(fds[1]);
+        ok = child > 0 && read(fds[0], b, 64) == 64 &&
+             drbg_generate(pool, a, 64) == DRBG_OK && memcmp(a, b, 64) != 0;
+        close(fds[0]);
+        if (child > 0) waitpid(child, NULL, 0);
+    }
+    drbg_destroy(pool);
+    drbg_destroy(other);
+    return ok;
+}
+
+/* Prints the "kat" array; returns the number of mismatches. */
+static int run_known_answers(void) {
+    uint8_t password[32], salt[16], secret[8], ad[12], tag[32];
+    char hex[2 * (BLAKE2B_OUTBYTES + AES256GCM_TAGBYTES) + 1];  /* gcm-16 needs 76 bytes */
+    int failures = 0;
+    int first = 1;
+
+    printf("  \"kat\": [\n");
+    for (int k = ARGON2_KERNEL_REF; k <= ARGON2_KERNEL_NEON; ++k) {
+        if (!argon2_kernel_supported((argon2_kernel)k)) continue;
+        argon2_select_kernel((argon2_kernel)k);
+
+        for (size_t v = 0; v < sizeof(rfc9106_vectors) / sizeof(rfc9106_vectors[0]); ++v) {
+            memset(password, 0x01, sizeof(password));
+            memset(salt, 0x02, sizeof(salt));
+            memset(secret, 0x03, sizeof(secret));
+            memset(ad, 0x04, sizeof(ad));
+
+            argon2_context ctx = {
+                tag, sizeof(tag),
+                password, sizeof(password),
+                salt, sizeof(salt),
+                secret, sizeof(secret),
+                ad, sizeof(ad),
+                3, 32, 4, 0,
+                ARGON2_VERSION_NUMBER, 0, NULL
+            };
+            int rc = argon2_ctx(&ctx, rfc9106_vectors[v].type);
+            to_hex(hex, tag, sizeof(tag));
+            int ok = (rc == ARGON2_OK && strcmp(hex, rfc9106_vectors[v].tag) == 0);
+            failures += !ok;
+
+            printf("%s    {\"kernel\": \"%s\", \"type\": \"%s\", \"ok\": %s}",
+                   first ? "" : ",\n", argon2_kernel_name((argon2_kernel)k),
+                   rfc9106_vectors[v].name, ok ? "true" : "false");
+            first = 0;
+            if (!ok) {
+                fprintf(stderr, "KAT mismatch: kernel=%s type=%s rc=%d got=%s\n",
+                        argon2_kernel_name((argon2_kernel)k), rfc9106_vectors[v].name, rc, hex);
+            }
+        }
+
+        for (size_t v = 0; v < sizeof(blake2_vectors) / sizeof(blake2_vectors[0]); ++v) {
+            int ok = check_blake2(v, hex);
+            failures += !ok;
+
+            printf(",\n    {\"kernel\": \"%s\", \"type\": \"%s\", \"inlen\": %zu, \"ok\": %s}",
+                   argon2_kernel_name((argon2_kernel)k), blake2_vectors[v].name,
+                   blake2_vectors[v].inlen, ok ? "true" : "false");
+            if (!ok) {
+                fprintf(stderr, "KAT mismatch: kernel=%s type=%s inlen=%zu got=%s\n",
+                        argon2_kernel_name((argon2_kernel)k), blake2_vectors[v].name,
+                        blake2_vectors[v].inlen, hex);
+            }
+        }
+
+        aes256gcm_key probe;
+        uint8_t zero_key[AES256GCM_KEYBYTES] = {0};
+        aes256gcm_key_init(&probe, zero_key);
+        const char *impl = aes256gcm_key_impl_name(&probe);
+        for (size_t v = 0; v < sizeof(gcm_vectors) / sizeof(gcm_vectors[0]); ++v) {
+            int ok = check_gcm(v, hex);
+            failures += !ok;
+
+            printf(",\n    {\"kernel\": \"%s\", \"type\": \"%s\", \"impl\": \"%s\", \"ok\": %s}",
+                   argon2_kernel_name((argon2_kernel)k), gcm_vectors[v].name, impl,
+                   ok ? "true" : "false");
+            if (!ok) {
+                fprintf(stderr, "KAT mismatch: kernel=%s type=%s impl=%s got=%s\n",
+                        argon2_kernel_name((argon2_kernel)k), gcm_vectors[v].name, impl, hex);
+            }
+        }
+        int ok = check_stream();
+        failures += !ok;
+        printf(",\n    {\"kernel\": \"%s\", \"type\": \"stream\", \"impl\": \"%s\", \"ok\": %s}",
+               argon2_kernel_name((argon2_kernel)k), impl, ok ? "true" : "false");
+        if (!ok) {
+            fprintf(stderr, "KAT mismatch: kernel=%s type=stream impl=%s\n",
+                    argon2_kernel_name((argon2_kernel)k), impl);
+        }
+        ok = check_batch();
+        failures += !ok;
+        printf(",\n    {\"kernel\": \"%s\", \"type\": \"batch\", \"impl\": \"%s\", \"ok\": %s}",
+               argon2_kernel_name((argon2_kernel)k), impl, ok ? "true" : "false");
+        if (!ok) {
+            fprintf(stderr, "KAT mismatch: kernel=%s type=batch impl=%s\n",
+                    argon2_kernel_name((argon2_kernel)k), impl);
+        }
+        ok = check_base64url();
+        failures += !ok;
+        printf(",\n    {\"kernel\": \"%s\", \"type\": \"base64url\", \"ok\": %s}",
+               argon2_kernel_name((argon2_kernel)k), ok ? "true" : "false");
+        if (!ok) {
+            fprintf(stderr, "KAT mismatch: kernel=%s type=base64url\n",
+                    argon2_kernel_name((argon2_kernel)k));
+        }
+    }
+    argon2_select_kernel(ARGON2_KERNEL_AUTO);
+
+    int ok = check_cache();
+    failures += !ok;
+    printf(",\n    {\"kernel\": \"auto\", \"type\": \"cache\", \"ok\": %s}",
+           ok ? "true" : "false");
+    if (!ok) {
+        fprintf(stderr, "KAT mismatch: type=cache\n");
+    }
+    ok = check_stats();
+    failures += !ok;
+    printf(",\n    {\"kernel\": \"auto\", \"type\": \"stats\", \"ok\": %s}",
+           ok ? "true" : "false");
+    if (!ok) {
+        fprintf(stderr, "KAT mismatch: type=stats\n");
+    }
+    ok = check_limits();
+    failures += !ok;
+    printf(",\n    {\"kernel\": \"auto\", \"type\": \"limits\", \"ok\": %s}",
+           ok ? "true" : "false");
+    if (!ok) {
+        fprintf(stderr, "KAT mismatch: type=limits\n");
+    }
+    ok = check_lane_local();
+    failures += !ok;
+    printf(",\n    {\"kernel\": \"auto\", \"type\": \"lane-local\", \"ok\": %s}",
+           ok ? "true" : "false");
+    if (!ok) {
+        fprintf(stderr, "KAT mismatch: type=lane-local\n");
+    }
+    ok = check_drbg();
+    failures += !ok;
+    printf(",\n    {\"kernel\": \"auto\", \"type\": \"drbg\", \"ok\": %s}",
+           ok ? "true" : "false");
+    if (!ok) {
+        fprintf(stderr, "KAT mismatch: type=drbg\n");
+    }
+    printf("\n  ]");
+    return failures;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Times one grid point; prints its JSON object. */
+static int run_case(const bench_options *opts, argon2_arena *arena, argon2_kernel kernel,
+                    uint32_t m, uint32_t t, uint32_t p, int first) {
+    static const char salt[] = "benchmarksalt123";
+    uint8_t tag[32];
+    double samples[64];
+    unsigned reps = opts->reps < 64 ? opts->reps : 64;
+    argon2_stats stats, best_stats = {0};
+    int rc = ARGON2_OK;
+
+    if (argon2_select_kernel(kernel) != ARGON2_OK) {
+        return ARGON2_KERNEL_UNSUPPORTED;
+    }
+
+    for (unsigned r = 0; r < reps; ++r) {
+        uint8_t password[] = "correct horse battery staple";
+        argon2_context ctx = {
+            tag, sizeof(tag),
+            password, sizeof(password) - 1,
+            (const uint8_t *)salt, sizeof(salt) - 1,
+            NULL, 0, NULL, 0,
+            t, m, p, 0,
+            ARGON2_VERSION_NUMBER, opts->lane_local ? ARGON2_FLAG_LANE_LOCAL : 0,
+            opts->stats ? &stats : NULL
+        };
+        double start = now_seconds();
+        rc = arena != NULL ? argon2_ctx_arena(arena, &ctx, opts->type)
+                           : argon2_ctx(&ctx, opts->type);
+        samples[r] = now_seconds() - start;
+        if (rc != ARGON2_OK) {
+            break;
+        }
+        if (opts->stats && (r == 0 || stats.total_ns < best_stats.total_ns)) {
+            best_stats = stats;
+        }
+    }
+    if (rc != ARGON2_OK) {
+        fprintf(stderr, "argon2_ctx failed: m=%u t=%u p=%u kernel=%s rc=%d\n",
+                m, t, p, argon2_kernel_name(kernel), rc);
+        return rc;
+    }
+
+    qsort(samples, reps, sizeof(samples[0]), compare_double);
+    double best = samples[0];
+    double median = samples[reps / 2];
+
+    /* Blocks actually filled: m rounded down to a multiple of 4 * p. */
+    uint32_t lane_blocks = (m < 8 * p ? 8 * p : m) / (4 * p) * 4;
+    double blocks = (double)lane_blocks * p * t;
+    double mib = (double)lane_blocks * p / 1024.0;
+
+    printf("%s    {\"kernel\": \"%s\", \"m_kib\": %u, \"t\": %u, \"p\": %u, "
+           "\"threads\": %u, \"layout\": \"%s\", \"reps\": %u, \"best_ms\": %.3f, "
+           "\"median_ms\": %.3f, \"mib_per_s\": %.1f, \"ns_per_block\": %.1f, "
+           "\"peak_rss_kib\": %ld",
+           first ? "" : ",\n", argon2_kernel_name(kernel), m, t, p,
+           argon2_thread_limit() == 0 || argon2_thread_limit() > p ? p : argon2_thread_limit(),
+           opts->lane_local && arena == NULL ? "lane-local" : "contiguous",
+           reps, best * 1e3, median * 1e3, mib * t / best, best * 1e9 / blocks,
+           peak_rss_kib());
+    if (opts->stats) {
+        const argon2_stats *st = &best_stats;
+        printf(", \"phases_ms\": {\"alloc\": %.3f, \"init\": %.3f, \"fill\": %.3f, "
+               "\"finalize\": %.3f, \"wipe\": %.3f, \"passes\": [",
+               st->alloc_ns / 1e6, st->init_ns / 1e6, st->fill_ns / 1e6,
+               st->finalize_ns / 1e6, st->wipe_ns / 1e6);
+        uint32_t passes = st->passes < ARGON2_STATS_MAX_PASSES ? st->passes : ARGON2_STATS_MAX_PASSES;
+        for (uint32_t i = 0; i < passes; ++i) {
+            printf("%s%.3f", i ? ", " : "", st->pass_ns[i] / 1e6);
+        }
+        printf("], \"slices\": [%.3f, %.3f, %.3f, %.3f]}, \"blocks_per_s\": %.0f, "
+               "\"minor_faults\": %lld, \"major_faults\": %lld",
+               st->slice_ns[0] / 1e6, st->slice_ns[1] / 1e6, st->slice_ns[2] / 1e6,
+               st->slice_ns[3] / 1e6, st->blocks_per_second,
+               (long long)st->minor_faults, (long long)st->major_faults);
+    }
+    printf("}");
+    fflush(stdout);
+    return ARGON2_OK;
+}
+
+/* Prints the "calibration" array: suggested parameters against measured time. */
+static int run_calibration(const bench_options *opts) {
+    uint8_t password[16] = {0}, salt[16] = {0}, tag[32];
+    uint32_t max_m = 0;
+    int status = 0;
+
+    for (size_t mi = 0; mi < opts->m.count; ++mi) {
+        if (opts->m.values[mi] > max_m) max_m = opts->m.values[mi];
+    }
+    argon2_select_kernel(ARGON2_KERNEL_AUTO);
+
+    printf(",\n  \"calibration\": [\n");
+    for (size_t pi = 0; pi < opts->p.count; ++pi) {
+        argon2_calibration cal;
+        argon2_params params;
+        double t0 = now_seconds();
+        int rc = argon2_calibrate(opts->calibrate_ms, max_m, opts->p.values[pi], &params);
+        double probe = now_seconds() - t0;
+        if (rc != ARGON2_OK || argon2_get_calibration(&cal) != ARGON2_OK) {
+            fprintf(stderr, "argon2_calibrate(p=%u): %d\n", opts->p.values[pi], rc);
+            status = 1;
+            continue;
+        }
+
+        t0 = now_seconds();
+        rc = argon2id_hash_raw(params.t_cost, params.m_cost, params.lanes, password,
+                               sizeof(password), salt, sizeof(salt), tag, sizeof(tag));
+        double actual = now_seconds() - t0;
+        if (rc != ARGON2_OK) {
+            status = 1;
+        }
+
+        printf("%s    {\"target_ms\": %u, \"max_m\": %u, \"p\": %u, \"t\": %u, \"m\": %u, "
+               "\"ns_per_block\": %.1f, \"first_touch_ns_per_block\": %.1f, "
+               "\"probe_ms\": %.2f, \"estimated_ms\": %u, \"actual_ms\": %.2f}",
+               pi == 0 ? "" : ",\n", opts->calibrate_ms, max_m, params.lanes, params.t_cost,
+               params.m_cost, cal.ns_per_block, cal.first_touch_ns_per_block, probe * 1e3,
+               params.estimated_ms, actual * 1e3);
+    }
+    printf("\n  ]");
+    return status;
+}
+
+/* Prints the "blake2" array: best-of-reps MB/s per kernel and mode. */
+static int run_blake2(const bench_options *opts) {
+    size_t len = (size_t)opts->blake2_mib << 20;
+    uint8_t *buf = (uint8_t *)malloc(len);
+    uint8_t out[BLAKE2B_OUTBYTES];
+    int first = 1;
+
+    if (buf == NULL) {
+        fprintf(stderr, "blake2: cannot allocate %u MiB\n", opts->blake2_mib);
+        return 1;
+    }
+    for (size_t i = 0; i < len; ++i) buf[i] = (uint8_t)i;
+
+    printf(",\n  \"blake2\": [\n");
+    for (size_t ki = 0; ki < opts->kernel_count; ++ki) {
+        argon2_select_kernel(opts->kernels[ki]);
+        for (int parallel = 0; parallel <= 1; ++parallel) {
+            double best = 0;
+            for (unsigned r = 0; r < opts->reps; ++r) {
+                double t0 = now_seconds();
+                if (parallel) {
+                    blake2bp(out, sizeof(out), buf, len, NULL, 0);
+                } else {
+                    blake2b(out, sizeof(out), buf, len, NULL, 0);
+                }
+                double elapsed = now_seconds() - t0;
+                if (r == 0 || elapsed < best) best = elapsed;
+            }
+            printf("%s    {\"kernel\": \"%s\", \"hash\": \"%s\", \"mib\": %u, "
+                   "\"mb_per_s\": %.1f}",
+                   first ? "" : ",\n", argon2_kernel_name(opts->kernels[ki]),
+                   parallel ? "blake2bp" : "blake2b", opts->blake2_mib, len / best / 1e6);
+            first = 0;
+        }
+    }
+    printf("\n  ]");
+    argon2_select_kernel(ARGON2_KERNEL_AUTO);
+    free(buf);
+    return 0;
+}
+
+/* Prints the "aead" array: best-of-reps aes256gcm_encrypt MB/s per kernel. */
+static int run_aead(const bench_options *opts) {
+    size_t len = (size_t)opts->aead_mib << 20;
+    uint8_t *buf = (uint8_t *)malloc(len);
+    uint8_t raw[AES256GCM_KEYBYTES] = {0}, iv[AES256GCM_IVBYTES] = {0}, tag[AES256GCM_TAGBYTES];
+
+    if (buf == NULL) {
+        fprintf(stderr, "aead: cannot allocate %u MiB\n", opts->aead_mib);
+        return 1;
+    }
+    for (size_t i = 0; i < len; ++i) buf[i] = (uint8_t)i;
+
+    printf(",\n  \"aead\": [\n");
+    for (size_t ki = 0; ki < opts->kernel_count; ++ki) {
+        aes256gcm_key key;
+        double best = 0;
+
+        argon2_select_kernel(opts->kernels[ki]);
+        aes256gcm_key_init(&key, raw);
+        for (unsigned r = 0; r < opts->reps; ++r) {
+            double t0 = now_seconds();
+            aes256gcm_encrypt(&key, iv, NULL, 0, buf, len, buf, tag);
+            double elapsed = now_seconds() - t0;
+            if (r == 0 || elapsed < best) best = elapsed;
+        }
+        printf("%s    {\"kernel\": \"%s\", \"impl\": \"%s\", \"mib\": %u, \"mb_per_s\": %.1f}",
+               ki == 0 ? "" : ",\n", argon2_kernel_name(opts->kernels[ki]),
+               aes256gcm_key_impl_name(&key), opts->aead_mib, len / best / 1e6);
+        aes256gcm_key_wipe(&key);
+    }
+    printf("\n  ]");
+    argon2_select_kernel(ARGON2_KERNEL_AUTO);
+    free(buf);
+    return 0;
+}
+
+/* Prints the "base64url" array: best-of-reps encode and decode MB/s (of bytes) per kernel. */
+static int run_base64(const bench_options *opts) {
+    size_t len = (size_t)opts->base64_mib << 20, textlen = base64url_encoded_len(len), outlen;
+    uint8_t *buf = (uint8_t *)malloc(len);
+    char *text = (char *)malloc(textlen);
+
+    if (buf == NULL || text == NULL) {
+        fprintf(stderr, "base64: cannot allocate %u MiB\n", opts->base64_mib);
+        free(buf);
+        free(text);
+        return 1;
+    }
+    for (size_t i = 0; i < len; ++i) buf[i] = (uint8_t)(i * 7);
+
+    printf(",\n  \"base64url\": [\n");
+    for (size_t ki = 0; ki < opts->kernel_count; ++ki) {
+        double best_encode = 0, best_decode = 0;
+
+        argon2_select_kernel(opts->kernels[ki]);
+        for (unsigned r = 0; r < opts->reps; ++r) {
+            double t0 = now_seconds();
+            base64url_encode(buf, len, text);
+            double t1 = now_seconds();
+            base64url_decode(text, textlen, buf, &outlen);
+            double t2 = now_seconds();
+            if (r == 0 || t1 - t0 < best_encode) best_encode = t1 - t0;
+            if (r == 0 || t2 - t1 < best_decode) best_decode = t2 - t1;
+        }
+        printf("%s    {\"kernel\": \"%s\", \"mib\": %u, \"encode_mb_per_s\": %.1f, "
+               "\"decode_mb_per_s\": %.1f}",
+               ki == 0 ? "" : ",\n", argon2_kernel_name(opts->kernels[ki]), opts->base64_mib,
+               len / best_encode / 1e6, len / best_decode / 1e6);
+    }
+    printf("\n  ]");
+    argon2_select_kernel(ARGON2_KERNEL_AUTO);
+    free(buf);
+    free(text);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    bench_options opts;
+    argon2_arena *arena = NULL;
+    int status = 0;
+
+    if (parse_args(argc, argv, &opts) != 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    printf("{\n");
+    printf("  \"type\": \"%s\",\n", type_name(opts.type));
+    printf("  \"auto_kernel\": \"%s\",\n", argon2_kernel_name(argon2_active_kernel()));
+    printf("  \"thread_limit\": %u,\n", argon2_thread_limit());
+    printf("  \"arena\": %s,\n", opts.use_arena ? "true" : "false");
+
+    int failures = run_known_answers();
+    printf(",\n  \"kat_passed\": %s", failures == 0 ? "true" : "false");
+    if (failures != 0) {
+        status = 1;
+    }
+
+    if (!opts.kat_only && failures == 0) {
+        if (opts.use_arena && argon2_arena_create(&arena, 0, 0) != ARGON2_OK) {
+            fprintf(stderr, "argon2_arena_create failed\n");
+            return 1;
+        }
+
+        int first = 1;
+        printf(",\n  \"results\": [\n");
+        for (size_t ki = 0; ki < opts.kernel_count; ++ki) {
+            for (size_t mi = 0; mi < opts.m.count; ++mi) {
+                for (size_t ti = 0; ti < opts.t.count; ++ti) {
+                    for (size_t pi = 0; pi < opts.p.count; ++pi) {
+                        if (run_case(&opts, arena, opts.kernels[ki], opts.m.values[mi],
+                                     opts.t.values[ti], opts.p.values[pi], first) == ARGON2_OK) {
+                            first = 0;
+                        } else {
+                            status = 1;
+                        }
+                    }
+                }
+            }
+        }
+        printf("\n  ]");
+        argon2_arena_destroy(arena);
+
+        if (opts.calibrate_ms != 0 && run_calibration(&opts) != 0) {
+            status = 1;
+        }
+        if (opts.blake2_mib != 0 && run_blake2(&opts) != 0) {
+            status = 1;
+        }
+        if (opts.aead_mib != 0 && run_aead(&opts) != 0) {
+            status = 1;
+        }
+        if (opts.base64_mib != 0 && run_base64(&opts) != 0) {
+            status = 1;
+        }
+    }
+
+    printf("\n}\n");
+    return status;
+}
@@ -0,0 +1,134 @@
+/*
+ * AES-256-GCM (NIST SP 800-38D) and a chunked STREAM construction over it
+ * for payloads too large to hold in memory at once.
+ *
+ * The block cipher and GHASH run on AES-NI/PCLMULQDQ on x86-64 and on the
+ * ARMv8 AES/PMULL instructions on arm64 when present; otherwise on a
+ * portable constant-time implementation (bitsliced S-box, masked GHASH).
+ * A key picks its backend when it is initialised; ARGON2_KERNEL_REF (see
+ * argon2_select_kernel) forces the portable code, like it does for BLAKE2.
+ *
+ * STREAM (Hoang, Reyhanitabar, Rogaway, Vizar, "Online Authenticated-
+ * Encryption and its Nonce-Reuse Misuse-Resistance", CRYPTO 2015): the
+ * plaintext is cut into chunks, each sealed with AES-256-GCM under the
+ * nonce
+ *
+ *     prefix (7 bytes) || chunk index (4 bytes, big-endian) || last (1 byte)
+ *
+ * so chunks cannot be reordered, dropped or truncated off the end without
+ * failing authentication: the last chunk carries last = 1 and a reader
+ * must see it before trusting the stream. Each chunk is an independent
+ * GCM message, so chunks can be sealed or opened in any order or on
+ * several threads with the *_chunk functions; aes256gcm_stream wraps them
+ * for the usual front-to-back case. A prefix must never be reused under
+ * the same key.
+ *
+ * All functions return AES_GCM_OK (0) or a negative AES_GCM_* error. On
+ * authentication failure the output buffer is zeroed.
+ */
+
+#ifndef AES_GCM_H
+#define AES_GCM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define AES256GCM_KEYBYTES 32
+#define AES256GCM_IVBYTES 12
+#define AES256GCM_TAGBYTES 16
+#define AES256GCM_STREAM_PREFIXBYTES 7
+
+/* GCM limit per message (and so per chunk): 2^32 - 2 blocks. */
+#define AES256GCM_MAX_BYTES (((uint64_t)1 << 36) - 32)
+
+/* Expanded key and GHASH key powers; contents are private. */
+typedef struct Aes256gcm_key {
+    uint8_t round_keys[15 * 16];
+    uint8_t htable[4 * 16];
+    int impl;
+} aes256gcm_key;
+
+int aes256gcm_key_init(aes256gcm_key *key, const uint8_t raw[AES256GCM_KEYBYTES]);
+void aes256gcm_key_wipe(aes256gcm_key *key);
+
+/* Backend the key runs on: "ref", "aesni" or "armv8". */
+const char *aes256gcm_key_impl_name(const aes256gcm_key *key);
+
+/* One-shot GCM; out may equal in. */
+int aes256gcm_encrypt(const aes256gcm_key *key, const uint8_t iv[AES256GCM_IVBYTES],
+                      const uint8_t *ad, size_t adlen,
+                      const uint8_t *in, size_t inlen,
+                      uint8_t *out, uint8_t tag[AES256GCM_TAGBYTES]);
+int aes256gcm_decrypt(const aes256gcm_key *key, const uint8_t iv[AES256GCM_IVBYTES],
+                      const uint8_t *ad, size_t adlen,
+                      const uint8_t *in, size_t inlen,
+                      const uint8_t tag[AES256GCM_TAGBYTES], uint8_t *out);
+
+/*
+ * Batches: many messages under one key in a single call, for callers that
+ * pay per call (a JS bridge). Records sit back to back in one buffer, each
+ *
+ *     iv (12 bytes) || adlen (4, LE) || inlen (4, LE) || ad || in
+ *
+ * seal writes every record's ciphertext || tag to out, in order; open
+ * takes in = ciphertext || tag and writes the plaintexts back to back.
+ * measure validates a batch and gives the record count and the out size.
+ * An open that fails on any record zeroes all of out and returns
+ * AES_GCM_AUTH_FAILED with *failed (may be NULL) set to that record.
+ */
+#define AES256GCM_BATCH_HEADERBYTES (AES256GCM_IVBYTES + 8)
+
+int aes256gcm_batch_measure(const uint8_t *batch, size_t len, int open,
+                            size_t *records, size_t *outlen);
+int aes256gcm_seal_batch(const aes256gcm_key *key, const uint8_t *batch, size_t len,
+                         uint8_t *out);
+int aes256gcm_open_batch(const aes256gcm_key *key, const uint8_t *batch, size_t len,
+                         uint8_t *out, size_t *failed);
+
+/*
+ * STREAM chunks. seal writes inlen + AES256GCM_TAGBYTES bytes (ciphertext,
+ * then tag); open reads such a chunk and writes inlen - AES256GCM_TAGBYTES
+ * plaintext bytes. ad is authenticated with every chunk.
+ */
+int aes256gcm_stream_seal_chunk(const aes256gcm_key *key,
+                                const uint8_t prefix[AES256GCM_STREAM_PREFIXBYTES],
+                                uint32_t index, int last,
+                                const uint8_t *ad, size_t adlen,
+                                const uint8_t *in, size_t inlen, uint8_t *out);
+int aes256gcm_stream_open_chunk(const aes256gcm_key *key,
+                                const uint8_t prefix[AES256GCM_STREAM_PREFIXBYTES],
+                                uint32_t index, int last,
+                                const uint8_t *ad, size_t adlen,
+                                const uint8_t *in, size_t inlen, uint8_t *out);
+
+/* Sequential STREAM encryptor or decryptor: counts chunks and stops after the last. */
+typedef struct Aes256gcm_stream {
+    aes256gcm_key key;
+    uint8_t prefix[AES256GCM_STREAM_PREFIXBYTES];
+    uint32_t next_index;
+    int finished;
+} aes256gcm_stream;
+
+int aes256gcm_stream_init(aes256gcm_stream *stream, const uint8_t raw[AES256GCM_KEYBYTES],
+                          const uint8_t prefix[AES256GCM_STREAM_PREFIXBYTES]);
+/* Seal or open the next chunk; last marks the final one. */
+int aes256gcm_stream_push(aes256gcm_stream *stream, int last,
+                          const uint8_t *ad, size_t adlen,
+                          const uint8_t *in, size_t inlen, uint8_t *out);
+int aes256gcm_stream_pull(aes256gcm_stream *stream, int last,
+                          const uint8_t *ad, size_t adlen,
+                          const uint8_t *in, size_t inlen, uint8_t *out);
+/* AES_GCM_OK once the last chunk went through, AES_GCM_TRUNCATED before. */
+int aes256gcm_stream_finished(const aes256gcm_stream *stream);
+void aes256gcm_stream_wipe(aes256gcm_stream *stream);
+
+/* Error codes */
+#define AES_GCM_OK 0
+#define AES_GCM_INVALID_PARAMETER -1
+#define AES_GCM_AUTH_FAILED -2
+#define AES_GCM_TOO_LONG -3          /* message or chunk over AES256GCM_MAX_BYTES */
+#define AES_GCM_STREAM_FINISHED -4   /* chunk after the last one */
+#define AES_GCM_STREAM_EXHAUSTED -5  /* 2^32 chunks used */
+#define AES_GCM_TRUNCATED -6         /* stream ended before its last chunk */
+
+#endif /* AES_GCM_H */
@@ -1,5 +1,5 @@
 /*
- * Argon2 reference implementation - minimal header for argon2id
+ * Argon2 reference implementation - minimal header
  * Public domain (CC0) - https://github.com/P-H-C/phc-winner-argon2
  */
 
@@ -20,9 +20,12 @@ typedef enum Argon2_type {
 /*
  * Argon2id hash function - raw output (no encoding)
  *
+ * Lanes are filled concurrently on up to min(parallelism,
+ * argon2_thread_limit()) threads, synchronising at every slice.
+ *
  * @param t_cost      Number of iterations
  * @param m_cost      Memory usage in KiB
- * @param parallelism Number of threads/lanes
+ * @param parallelism Number of lanes
  * @param pwd         Password bytes
  * @param pwdlen      Password length
  * @param salt        Salt bytes
@@ -40,7 +43,281 @@ int argon2id_hash_raw(
     void *hash, const size_t hashlen
 );
 
+/*
+ * Reusable block-matrix arena. Hashing through an arena skips the per-call
+ * allocation, page faults and zeroing of the m_cost KiB matrix: the memory
+ * is 64-byte aligned, kept between calls and grown on demand. Hash state
+ * left in it is wiped when a smaller hash reuses it, by argon2_arena_wipe()
+ * and by argon2_arena_destroy(). An arena must not be used by two hashes at
+ * the same time.
+ */
+typedef struct Argon2_arena argon2_arena;
+
+#define ARGON2_ARENA_HUGEPAGES 0x01 /* 2 MiB-align + madvise(MADV_HUGEPAGE) where available */
+#define ARGON2_ARENA_LOCK      0x02 /* mlock() the matrix, best effort */
+
+/*
+ * @param arena   Receives the new arena
+ * @param m_cost  KiB to reserve up front (0 = allocate on first hash)
+ * @param flags   ARGON2_ARENA_* bits
+ */
+int argon2_arena_create(argon2_arena **arena, uint32_t m_cost, uint32_t flags);
+void argon2_arena_wipe(argon2_arena *arena);
+void argon2_arena_destroy(argon2_arena *arena);
+size_t argon2_arena_capacity(const argon2_arena *arena);
+
+/* argon2id_hash_raw using (and growing) the arena's memory. */
+int argon2id_hash_raw_arena(
+    argon2_arena *arena,
+    const uint32_t t_cost,
+    const uint32_t m_cost,
+    const uint32_t parallelism,
+    const void *pwd, const size_t pwdlen,
+    const void *salt, const size_t saltlen,
+    void *hash, const size_t hashlen
+);
+
+/*
+ * General Argon2 (RFC 9106): any variant, output length, optional secret
+ * (pepper) and associated data. A longer output can be split into several
+ * independent keys, e.g. 64 bytes -> encryption key + MAC key from one
+ * derivation. Lanes run on up to min(lanes, threads, argon2_thread_limit())
+ * threads; threads = 0 leaves only the process-wide limit.
+ *
+ * pwd and secret are non-const because ARGON2_FLAG_CLEAR_PASSWORD and
+ * ARGON2_FLAG_CLEAR_SECRET wipe them (and zero their lengths) as soon as
+ * they have been absorbed.
+ *
+ * ARGON2_FLAG_LANE_LOCAL lays each lane out on its own page (2 MiB-aligned
+ * once a lane is that large) in fresh memory that the lane's worker is the
+ * first to touch, so on a multi-socket Linux host a lane lives on the node
+ * of the core filling it. Worth it from p >= 2 on big matrices; the tag is
+ * the same either way. Ignored by argon2_ctx_arena, whose memory is
+ * already resident.
+ *
+ * stats, when set, receives a per-phase breakdown of the hash (see
+ * argon2_stats) and, like out, must stay valid until the hash finishes.
+ */
+#define ARGON2_MAX_LANES 0xFFFFFF
+
+/*
+ * Largest m_cost (KiB): the matrix size in bytes must fit a size_t, which
+ * caps it just under 4 GiB on 32-bit ABIs (armeabi-v7a, x86).
+ */
+#define ARGON2_MAX_MEMORY \
+    ((uint64_t)SIZE_MAX / 1024 < UINT32_MAX ? (uint32_t)(SIZE_MAX / 1024) : UINT32_MAX)
+
+#define ARGON2_FLAG_CLEAR_PASSWORD (UINT32_C(1) << 0)
+#define ARGON2_FLAG_CLEAR_SECRET   (UINT32_C(1) << 1)
+#define ARGON2_FLAG_LANE_LOCAL     (UINT32_C(1) << 2)
+
+typedef struct Argon2_Context {
+    uint8_t *out;           /* output tag */
+    uint32_t outlen;        /* >= 4 */
+
+    uint8_t *pwd;
+    uint32_t pwdlen;
+
+    const uint8_t *salt;
+    uint32_t saltlen;       /* >= 8 */
+
+    uint8_t *secret;        /* optional key/pepper, may be NULL */
+    uint32_t secretlen;
+
+    const uint8_t *ad;      /* optional associated data, may be NULL */
+    uint32_t adlen;
+
+    uint32_t t_cost;        /* passes */
+    uint32_t m_cost;        /* KiB */
+    uint32_t lanes;         /* parallelism */
+    uint32_t threads;       /* thread cap for this hash, 0 = default */
+
+    uint32_t version;       /* must be ARGON2_VERSION_NUMBER */
+    uint32_t flags;         /* ARGON2_FLAG_* */
+
+    struct Argon2_stats *stats; /* optional instrumentation, may be NULL */
+} argon2_context;
+
+int argon2_ctx(argon2_context *context, argon2_type type);
+
+/* argon2_ctx using (and growing) the arena's memory. */
+int argon2_ctx_arena(argon2_arena *arena, argon2_context *context, argon2_type type);
+
+/*
+ * Steppable hashing. argon2_init validates the context, takes the memory
+ * (from the arena if one is given) and absorbs the inputs; the context is
+ * not referenced afterwards except for the out buffer, which finish fills.
+ * argon2_step fills up to max_segments segments (0 = everything left; a
+ * full hash is t_cost * 4 * lanes segments), so a long derivation can be
+ * time-sliced. argon2_finish writes the tag if the hash is complete and
+ * always wipes and frees the state.
+ *
+ * argon2_cancel may be called from any thread until argon2_finish is
+ * called; a running step stops at its next slice boundary with
+ * ARGON2_CANCELLED. The progress callback runs on the hashing thread after
+ * each slice; keep it short, the other lane workers wait on it.
+ */
+typedef struct Argon2_state argon2_state;
+
+typedef void (*argon2_progress_fn)(uint32_t segments_done, uint32_t segments_total,
+                                   void *user);
+
+int argon2_init(argon2_state **state, argon2_arena *arena, argon2_context *context,
+                argon2_type type);
+void argon2_set_progress(argon2_state *state, argon2_progress_fn progress, void *user);
+
+/* @return ARGON2_PENDING, ARGON2_OK once complete, or ARGON2_CANCELLED */
+int argon2_step(argon2_state *state, uint32_t max_segments);
+void argon2_cancel(argon2_state *state);
+
+/* @return ARGON2_OK with the tag written, or ARGON2_CANCELLED if unfinished */
+int argon2_finish(argon2_state *state);
+
+/*
+ * Batch Argon2id: hash count independent (password, salt) pairs that share
+ * t_cost/m_cost/parallelism. Items are processed two at a time on each
+ * worker with interleaved compression, and workers (up to the thread
+ * limit) run in parallel, so total throughput is well above count serial
+ * calls. Peak memory is 2 * m_cost KiB per worker.
+ *
+ * @param inputs   count password/salt pairs
+ * @param hashes   Output buffer of count * hashlen bytes; item i at i * hashlen
+ * @param results  Optional per-item ARGON2_* codes (count entries)
+ * @return ARGON2_OK if every item succeeded, otherwise the first item error
+ */
+typedef struct Argon2_batch_input {
+    const void *pwd;
+    size_t pwdlen;
+    const void *salt;
+    size_t saltlen;
+} argon2_batch_input;
+
+int argon2id_hash_raw_batch(
+    const uint32_t t_cost,
+    const uint32_t m_cost,
+    const uint32_t parallelism,
+    const argon2_batch_input *inputs, const size_t count,
+    void *hashes, const size_t hashlen,
+    int *results
+);
+
+/* Upper bound on worker threads per hash, whatever the limit below says. */
+#define ARGON2_MAX_THREADS 16
+
+/*
+ * Cap the threads a single hash may use (process-wide, default 4). 0 means
+ * one thread per lane. Has no effect when built with ARGON2_NO_THREADS.
+ */
+void argon2_set_thread_limit(uint32_t max_threads);
+uint32_t argon2_thread_limit(void);
+
+/*
+ * fill_block (compression function) backends. ARGON2_KERNEL_AUTO picks the
+ * fastest one the running CPU supports; the others force a specific kernel,
+ * e.g. to benchmark or cross-check against the scalar reference.
+ */
+typedef enum Argon2_kernel {
+    ARGON2_KERNEL_AUTO = 0,
+    ARGON2_KERNEL_REF = 1,
+    ARGON2_KERNEL_SSE2 = 2,
+    ARGON2_KERNEL_SSSE3 = 3,
+    ARGON2_KERNEL_AVX2 = 4,
+    ARGON2_KERNEL_AVX512 = 5,
+    ARGON2_KERNEL_NEON = 6
+} argon2_kernel;
+
+/*
+ * Select the kernel used by subsequent hashes (process-wide).
+ * @return ARGON2_OK, or ARGON2_KERNEL_UNSUPPORTED if this build/CPU lacks it
+ */
+int argon2_select_kernel(argon2_kernel kernel);
+
+/* Kernel that the next hash will run (never ARGON2_KERNEL_AUTO). */
+argon2_kernel argon2_active_kernel(void);
+
+/* Non-zero if the kernel is compiled in and supported by this CPU. */
+int argon2_kernel_supported(argon2_kernel kernel);
+
+/* Short lowercase name ("ref", "avx2", "neon", ...). */
+const char *argon2_kernel_name(argon2_kernel kernel);
+
+/*
+ * Measured cost of the active kernel on this device, per 1 KiB block.
+ * first_touch_ns_per_block is the extra cost of the first pass over fresh
+ * memory (page faults, zeroing); ns_per_block is a steady-state pass.
+ */
+typedef struct Argon2_calibration {
+    double ns_per_block;
+    double first_touch_ns_per_block;
+    uint32_t lanes;             /* lanes the probe ran with */
+    argon2_kernel kernel;       /* kernel the probe ran with */
+} argon2_calibration;
+
+/*
+ * Where the time of one hash went, filled in when argon2_context.stats is
+ * set (nothing is measured otherwise). Times are wall-clock nanoseconds.
+ * Slices are timed from one slice boundary to the next, so with several
+ * lanes they include the wait for the slowest lane. Page faults are the
+ * process-wide delta over the hash (other threads' faults included) and
+ * -1 where getrusage does not report them.
+ */
+#define ARGON2_STATS_MAX_PASSES 16
+
+typedef struct Argon2_stats {
+    uint64_t queue_ns;          /* waiting in an argon2_scheduler queue */
+    uint64_t alloc_ns;          /* taking the block matrix (or arena) */
+    uint64_t init_ns;           /* H0 and the first two blocks of each lane */
+    uint64_t fill_ns;           /* all passes */
+    uint64_t pass_ns[ARGON2_STATS_MAX_PASSES]; /* later passes add to the last */
+    uint64_t slice_ns[4];       /* per sync point, summed over passes */
+    uint64_t finalize_ns;       /* XOR of the last column and the tag */
+    uint64_t wipe_ns;           /* wiping and freeing the matrix */
+    uint64_t total_ns;          /* init to finish, including gaps between steps */
+    uint64_t blocks;            /* blocks filled */
+    double blocks_per_second;   /* blocks / fill time */
+    int64_t minor_faults;
+    int64_t major_faults;
+    uint32_t passes;            /* passes completed */
+    uint32_t threads;           /* lane threads used (fewest of any slice run) */
+    argon2_kernel kernel;
+    int cached;                 /* answered by an argon2_cache, nothing ran */
+} argon2_stats;
+
+typedef struct Argon2_params {
+    uint32_t t_cost;
+    uint32_t m_cost;            /* KiB */
+    uint32_t lanes;
+    uint32_t estimated_ms;      /* predicted wall time on this device */
+} argon2_params;
+
+/*
+ * Run a short timed Argon2id probe (two passes over min(m_cost, 32 MiB),
+ * twice) with the given lanes and store the result in the process-wide
+ * cache. m_cost 0 probes the full 32 MiB.
+ */
+int argon2_measure(argon2_calibration *calibration, uint32_t m_cost, uint32_t lanes);
+
+/*
+ * Read or seed the cached calibration, e.g. to persist it across launches
+ * so startup never pays for a probe. Passing NULL clears the cache.
+ * @return ARGON2_OK, or ARGON2_INCORRECT_PARAMETER if nothing is cached
+ */
+int argon2_get_calibration(argon2_calibration *calibration);
+void argon2_set_calibration(const argon2_calibration *calibration);
+
+/*
+ * Strongest Argon2id parameters that finish in about target_ms on this
+ * device: the largest m_cost up to max_m_cost whose first pass fits, then
+ * as many passes as the rest of the budget allows (t_cost >= 1). lanes is
+ * kept as given since it is part of the stored hash format; the probe runs
+ * with that many lanes so the thread limit is accounted for. Probes only
+ * when no cached calibration matches lanes and the active kernel.
+ */
+int argon2_calibrate(uint32_t target_ms, uint32_t max_m_cost, uint32_t lanes,
+                     argon2_params *params);
+
 /* Error codes */
+#define ARGON2_PENDING 1 /* argon2_step: segments remain */
 #define ARGON2_OK 0
 #define ARGON2_OUTPUT_PTR_NULL -1
 #define ARGON2_OUTPUT_TOO_SHORT -2
@@ -54,6 +331,15 @@ int argon2id_hash_raw(
 #define ARGON2_MEMORY_TOO_MUCH -10
 #define ARGON2_LANES_TOO_FEW -11
 #define ARGON2_LANES_TOO_MANY -12
+#define ARGON2_PWD_PTR_MISMATCH -18
+#define ARGON2_SALT_PTR_MISMATCH -19
+#define ARGON2_SECRET_PTR_MISMATCH -20
+#define ARGON2_AD_PTR_MISMATCH -21
 #define ARGON2_MEMORY_ALLOCATION_ERROR -22
+#define ARGON2_INCORRECT_PARAMETER -25
+#define ARGON2_INCORRECT_TYPE -26
+#define ARGON2_KERNEL_UNSUPPORTED -36
+#define ARGON2_CANCELLED -37
+#define ARGON2_CACHE_MISS -38
 
 #endif /* ARGON2_H */
@@ -0,0 +1,60 @@
+/*
+ * Derived-key cache: remembers recent Argon2 tags so that deriving the same
+ * key again in one session (a retry after an unrelated failure, re-opening
+ * the same payload) is a table lookup instead of a memory-hard hash.
+ *
+ * Entries are keyed by a BLAKE2b MAC, under a random per-cache key, of the
+ * variant, version, costs, output length, password, salt, secret and
+ * associated data, each length-prefixed. The password itself is never kept
+ * and the MAC cannot be checked offline without the cache key. Tags live in
+ * one page-aligned block that is mlock()ed (best effort, like
+ * ARGON2_ARENA_LOCK) and excluded from core dumps where the OS allows it;
+ * an entry is wiped when it expires, is evicted or the cache is cleared.
+ *
+ * Entries expire ttl_ms after they were stored, whether or not they are
+ * used in the meantime. A full cache evicts its least recently used entry.
+ * All functions are thread-safe.
+ */
+
+#ifndef ARGON2_CACHE_H
+#define ARGON2_CACHE_H
+
+#include "argon2.h"
+
+typedef struct Argon2_cache argon2_cache;
+
+/* Longest tag kept; longer derivations are never cached. */
+#define ARGON2_CACHE_MAX_TAGBYTES 64
+
+/*
+ * @param entries  Tags kept at most (1..1024)
+ * @param ttl_ms   Lifetime of an entry, > 0
+ */
+int argon2_cache_create(argon2_cache **cache, uint32_t entries, uint32_t ttl_ms);
+
+/* Wipes every entry and frees the cache. */
+void argon2_cache_destroy(argon2_cache *cache);
+
+/*
+ * Copy the cached tag for these inputs into context->out.
+ * @return ARGON2_OK on a hit, ARGON2_CACHE_MISS otherwise
+ */
+int argon2_cache_lookup(argon2_cache *cache, const argon2_context *context, argon2_type type);
+
+/*
+ * Remember context->out as the tag for these inputs, replacing an older
+ * entry for the same inputs.
+ * @return ARGON2_OK, or ARGON2_OUTPUT_TOO_LONG over ARGON2_CACHE_MAX_TAGBYTES
+ */
+int argon2_cache_store(argon2_cache *cache, const argon2_context *context, argon2_type type);
+
+/* Wipe every entry, e.g. on sign-out or when the app is backgrounded. */
+void argon2_cache_clear(argon2_cache *cache);
+
+/* Unexpired entries held. */
+uint32_t argon2_cache_count(argon2_cache *cache);
+
+/* 1 if the entry memory is mlock()ed, 0 if the lock was refused. */
+int argon2_cache_is_locked(const argon2_cache *cache);
+
+#endif /* ARGON2_CACHE_H */
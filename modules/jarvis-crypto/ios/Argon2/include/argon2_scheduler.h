@@ -0,0 +1,81 @@
+/*
+ * Argon2 job scheduler: a fixed worker pool that runs argon2 hashes under a
+ * process memory budget. A job is started only once its m_cost fits in
+ * what the running jobs leave of the budget, so N concurrent derivations
+ * never allocate more than the budget between them. A job larger than the
+ * whole budget is not refused: it waits until nothing else is running and
+ * then runs alone.
+ *
+ * Jobs are taken in priority order, first-in first-out within a priority.
+ * A job that does not fit yet also holds back every job behind it and
+ * every lower-priority job, so a large interactive unlock is never starved
+ * by a stream of small background jobs.
+ */
+
+#ifndef ARGON2_SCHEDULER_H
+#define ARGON2_SCHEDULER_H
+
+#include "argon2.h"
+#include "argon2_cache.h"
+
+typedef struct Argon2_scheduler argon2_scheduler;
+
+typedef enum Argon2_priority {
+    ARGON2_PRIORITY_INTERACTIVE = 0,  /* user is waiting (unlock, import) */
+    ARGON2_PRIORITY_NORMAL = 1,
+    ARGON2_PRIORITY_BACKGROUND = 2    /* re-encryption, prefetch */
+} argon2_priority;
+
+#define ARGON2_PRIORITY_LEVELS 3
+
+/*
+ * Called once per job on a worker thread (or on the cancelling thread for
+ * a job cancelled before it started, or inside submit for a cache hit).
+ * result is ARGON2_OK with the tag in the job's out buffer,
+ * ARGON2_CANCELLED, or another ARGON2_* error.
+ */
+typedef void (*argon2_job_done_fn)(uint64_t job_id, int result, void *user);
+
+/*
+ * @param workers          Jobs run at once (1..ARGON2_MAX_THREADS)
+ * @param memory_budget    KiB shared by running jobs; 0 = unlimited
+ */
+int argon2_scheduler_create(argon2_scheduler **scheduler, uint32_t workers,
+                            uint32_t memory_budget);
+
+/*
+ * Cancels queued jobs, stops running ones at their next slice boundary,
+ * waits for the workers and frees the scheduler. Every job still gets its
+ * callback.
+ */
+void argon2_scheduler_destroy(argon2_scheduler *scheduler);
+
+/*
+ * Queue a hash. pwd, salt, secret and ad are copied (and the copies wiped
+ * after use), so only context->out must stay valid until the callback.
+ * ARGON2_FLAG_CLEAR_* apply to the caller's buffers at submit time.
+ *
+ * @return ARGON2_OK with *job_id set, or a context validation error
+ */
+int argon2_scheduler_submit(argon2_scheduler *scheduler, argon2_context *context,
+                            argon2_type type, argon2_priority priority,
+                            argon2_job_done_fn done, void *user, uint64_t *job_id);
+
+/*
+ * Cancel a queued or running job. Its callback reports ARGON2_CANCELLED.
+ * @return ARGON2_OK, or ARGON2_INCORRECT_PARAMETER if the job has already
+ *         finished or never existed
+ */
+int argon2_scheduler_cancel(argon2_scheduler *scheduler, uint64_t job_id);
+
+/*
+ * Answer submits from cache when it holds the tag, and store the tag of
+ * every job that completes. NULL detaches it. The cache must outlive the
+ * scheduler or be detached first.
+ */
+void argon2_scheduler_set_cache(argon2_scheduler *scheduler, argon2_cache *cache);
+
+/* KiB currently reserved by running jobs. */
+uint32_t argon2_scheduler_memory_in_use(argon2_scheduler *scheduler);
+
+#endif /* ARGON2_SCHEDULER_H */
@@ -0,0 +1,40 @@
+/*
+ * base64url (RFC 4648 section 5), the text form keys, nonces and
+ * ciphertext take across the JS bridges and on the wire.
+ *
+ * The encoder writes no padding. The decoder takes input with or without
+ * '=' padding and rejects characters outside the alphabet, padding
+ * anywhere but the end, and lengths no encoder produces (1 mod 4); like
+ * most decoders it ignores the unused low bits of the last character.
+ *
+ * Whole blocks run on SSSE3 or AVX2 on x86-64 and on NEON on ARM, with the
+ * rest in portable code; the kernel follows argon2_active_kernel() like
+ * BLAKE2b does, so ARGON2_KERNEL_REF (and SSE2, which lacks a byte
+ * shuffle) use the portable code throughout.
+ *
+ * Functions return BASE64URL_OK (0) or BASE64URL_INVALID. A failed decode
+ * zeroes whatever it had written to out.
+ */
+
+#ifndef BASE64URL_H
+#define BASE64URL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BASE64URL_OK 0
+#define BASE64URL_INVALID (-1)
+
+/* Characters base64url_encode writes for len bytes. */
+size_t base64url_encoded_len(size_t len);
+
+/* Bytes base64url_decode writes at most for len characters. */
+size_t base64url_decoded_max(size_t len);
+
+/* Writes base64url_encoded_len(inlen) characters to out, not terminated. */
+int base64url_encode(const uint8_t *in, size_t inlen, char *out);
+
+/* out holds base64url_decoded_max(inlen) bytes; *outlen gets the count. */
+int base64url_decode(const char *in, size_t inlen, uint8_t *out, size_t *outlen);
+
+#endif /* BASE64URL_H */
@@ -0,0 +1,67 @@
+/*
+ * BLAKE2b (RFC 7693) and BLAKE2bp - the hash under Argon2, exposed for
+ * general integrity hashing and keyed MACs.
+ *
+ * BLAKE2bp hashes four interleaved BLAKE2b leaves and a root. Its output
+ * differs from BLAKE2b; it is a separate function, not a faster BLAKE2b.
+ * The leaves are compressed side by side in SIMD lanes (AVX2 four at a
+ * time, NEON two), following argon2_select_kernel() so ARGON2_KERNEL_REF
+ * forces the portable code, and the one-shot blake2bp() splits them over
+ * threads for large inputs (up to argon2_thread_limit()). For bulk
+ * integrity hashing prefer blake2bp; plain blake2b is one serial chain.
+ *
+ * All functions return 0 on success and -1 on invalid lengths or NULL
+ * pointers, as in the reference implementation.
+ */
+
+#ifndef BLAKE2B_H
+#define BLAKE2B_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define BLAKE2B_BLOCKBYTES 128
+#define BLAKE2B_OUTBYTES 64
+#define BLAKE2B_KEYBYTES 64
+
+#define BLAKE2BP_PARALLELISM 4
+
+typedef struct Blake2b_state {
+    uint64_t h[8];
+    uint64_t t[2];
+    uint64_t f[2];
+    uint8_t buf[BLAKE2B_BLOCKBYTES];
+    size_t buflen;
+    size_t outlen;
+    uint8_t last_node;
+} blake2b_state;
+
+typedef struct Blake2bp_state {
+    blake2b_state S[BLAKE2BP_PARALLELISM];
+    blake2b_state R;
+    uint8_t buf[BLAKE2BP_PARALLELISM * BLAKE2B_BLOCKBYTES];
+    size_t buflen;
+    size_t outlen;
+} blake2bp_state;
+
+/* Streaming BLAKE2b; outlen 1..64, keylen 0..64. */
+int blake2b_init(blake2b_state *S, size_t outlen);
+int blake2b_init_key(blake2b_state *S, size_t outlen, const void *key, size_t keylen);
+int blake2b_update(blake2b_state *S, const void *in, size_t inlen);
+/* Writes S->outlen bytes (out must hold outlen) and wipes S. */
+int blake2b_final(blake2b_state *S, void *out, size_t outlen);
+
+int blake2b(void *out, size_t outlen, const void *in, size_t inlen,
+            const void *key, size_t keylen);
+
+/* Streaming BLAKE2bp, same limits. Single-threaded. */
+int blake2bp_init(blake2bp_state *S, size_t outlen);
+int blake2bp_init_key(blake2bp_state *S, size_t outlen, const void *key, size_t keylen);
+int blake2bp_update(blake2bp_state *S, const void *in, size_t inlen);
+int blake2bp_final(blake2bp_state *S, void *out, size_t outlen);
+
+/* One-shot BLAKE2bp; inputs of 1 MiB and more hash the leaves in parallel. */
+int blake2bp(void *out, size_t outlen, const void *in, size_t inlen,
+             const void *key, size_t keylen);
+
+#endif /* BLAKE2B_H */
@@ -0,0 +1,60 @@
+/*
+ * ChaCha20 random pool for salts, nonces and keys: many small requests
+ * served from one buffer instead of a trip to the OS each.
+ *
+ * Fast key erasure (Bernstein, "Fast-key-erasure random-number
+ * generators", 2017): a refill runs ChaCha20 (RFC 8439, zero nonce) under
+ * the pool key, keeps the first 32 bytes as the next key and hands out the
+ * rest, wiping each byte as it goes, so the state never holds anything
+ * already returned and a later compromise cannot recover it.
+ *
+ * The key is mixed with 32 bytes from the OS (getrandom on Linux and
+ * Android, arc4random_buf on Apple) when the pool is created, at the first
+ * refill after DRBG_RESEED_BYTES of output or DRBG_RESEED_MS since the
+ * last reseed, on the first call in a child after fork(), and on
+ * drbg_reseed(). The pool lives in one page that is mlock()ed (best
+ * effort, like the derived-key cache).
+ *
+ * Functions return DRBG_OK (0) or a negative DRBG_* error; a failed
+ * generate zeroes out. All functions are thread-safe.
+ */
+
+#ifndef DRBG_H
+#define DRBG_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DRBG_OK 0
+#define DRBG_INVALID_PARAMETER (-1)
+#define DRBG_MEMORY_ALLOCATION_ERROR (-2)
+#define DRBG_ENTROPY_FAILED (-3)
+
+#define DRBG_SEEDBYTES 32
+#define DRBG_RESEED_BYTES (1u << 20)
+#define DRBG_RESEED_MS (5u * 60 * 1000)
+
+typedef struct Drbg drbg;
+
+/* A pool seeded from the OS. */
+int drbg_create(drbg **pool);
+
+/*
+ * A pool keyed with seed that never touches the OS or reseeds, so its
+ * output is fixed. For known-answer tests only.
+ */
+int drbg_create_seeded(drbg **pool, const uint8_t seed[DRBG_SEEDBYTES]);
+
+/* Wipes the state and frees the pool. */
+void drbg_destroy(drbg *pool);
+
+/*
+ * len random bytes to out. Callers wanting several values (a salt, a
+ * nonce and a key) take them as consecutive slices of one call.
+ */
+int drbg_generate(drbg *pool, uint8_t *out, size_t len);
+
+/* Mix in fresh OS entropy now and drop anything buffered. */
+int drbg_reseed(drbg *pool);
+
+#endif /* DRBG_H */
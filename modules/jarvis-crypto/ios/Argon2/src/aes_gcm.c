@@ -0,0 +1,793 @@
+/*
+ * AES-256-GCM and STREAM - mode logic, backend dispatch and the portable
+ * backend.
+ *
+ * The portable AES computes SubBytes with the Boyar-Peralta circuit on
+ * bit planes (as in BearSSL's aes_ct), four blocks at a time, and GHASH
+ * uses masked integer multiplies instead of branches or tables, so neither
+ * leaks key or data through timing. It is slow next to the hardware backends in
+ * aes_gcm_x86.c / aes_gcm_arm.c and only runs on CPUs without them or
+ * when ARGON2_KERNEL_REF is selected.
+ */
+
+#include "argon2_internal.h"
+
+#include <string.h>
+
+/* GCM works through the data in pieces this size so GHASH reads them from L1. */
+#define GCM_PIECE_BYTES 4096
+
+enum {
+    AES_IMPL_REF = 0,
+    AES_IMPL_AESNI = 1,
+    AES_IMPL_ARMV8 = 2
+};
+
+static inline uint32_t load32_be(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static inline void store32_be(uint8_t *p, uint32_t w) {
+    p[0] = (uint8_t)(w >> 24);
+    p[1] = (uint8_t)(w >> 16);
+    p[2] = (uint8_t)(w >> 8);
+    p[3] = (uint8_t)w;
+}
+
+static inline uint64_t load64_be(const uint8_t *p) {
+    return ((uint64_t)load32_be(p) << 32) | load32_be(p + 4);
+}
+
+static inline void store64_be(uint8_t *p, uint64_t w) {
+    store32_be(p, (uint32_t)(w >> 32));
+    store32_be(p + 4, (uint32_t)w);
+}
+
+static inline void inc32(uint8_t ctr[16]) {
+    store32_be(ctr + 12, load32_be(ctr + 12) + 1);
+}
+
+/* ============== PORTABLE AES ============== */
+
+/*
+ * S-box on eight bit planes: q[i] holds bit i of up to 64 bytes. Boyar and
+ * Peralta, "A depth-16 circuit for the AES S-box" (2011); 113 gates.
+ */
+static void sbox_bitsliced(uint64_t q[8]) {
+    uint64_t x0, x1, x2, x3, x4, x5, x6, x7;
+    uint64_t y1, y2, y3, y4, y5, y6, y7, y8, y9;
+    uint64_t y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+    uint64_t y20, y21;
+    uint64_t z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+    uint64_t z10, z11, z12, z13, z14, z15, z16, z17;
+    uint64_t t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+    uint64_t t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+    uint64_t t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+    uint64_t t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+    uint64_t t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+    uint64_t t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+    uint64_t t60, t61, t62, t63, t64, t65, t66, t67;
+    uint64_t s0, s1, s2, s3, s4, s5, s6, s7;
+
+    x0 = q[7];
+    x1 = q[6];
+    x2 = q[5];
+    x3 = q[4];
+    x4 = q[3];
+    x5 = q[2];
+    x6 = q[1];
+    x7 = q[0];
+
+    /* Top linear transformation. */
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9 = x0 ^ x3;
+    y8 = x0 ^ x5;
+    t0 = x1 ^ x2;
+    y1 = t0 ^ x7;
+    y4 = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2 = y1 ^ x0;
+    y5 = y1 ^ x6;
+    y3 = y5 ^ y8;
+    t1 = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6 = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7 = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+
+    /* Non-linear section. */
+    t2 = y12 & y15;
+    t3 = y3 & y6;
+    t4 = t3 ^ t2;
+    t5 = y4 & x7;
+    t6 = t5 ^ t2;
+    t7 = y13 & y16;
+    t8 = y5 & y1;
+    t9 = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0 = t44 & y15;
+    z1 = t37 & y6;
+    z2 = t33 & x7;
+    z3 = t43 & y16;
+    z4 = t40 & y1;
+    z5 = t29 & y7;
+    z6 = t42 & y11;
+    z7 = t45 & y17;
+    z8 = t41 & y10;
+    z9 = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+
+    /* Bottom linear transformation. */
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0 = t59 ^ t63;
+    s6 = t56 ^ ~t62;
+    s7 = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3 = t53 ^ t66;
+    s4 = t51 ^ t66;
+    s5 = t47 ^ t65;
+    s1 = t64 ^ ~s3;
+    s2 = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+/* 8x8 bit-matrix transpose: bit c of byte r moves to bit r of byte c. */
+static inline uint64_t transpose8x8(uint64_t x) {
+    uint64_t t;
+    t = (x ^ (x >> 7)) & 0x00aa00aa00aa00aaULL;
+    x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000cccc0000ccccULL;
+    x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000f0f0f0f0ULL;
+    x ^= t ^ (t << 28);
+    return x;
+}
+
+/*
+ * SubBytes on n <= 64 bytes. Each group of eight bytes is bit-transposed
+ * so byte i holds their bit i, which is byte k of plane i for group k.
+ */
+static void sub_bytes(uint8_t *s, size_t n) {
+    uint8_t buf[64] = {0};
+    uint64_t q[8] = {0};
+    uint64_t w[8];
+
+    memcpy(buf, s, n);
+    for (unsigned k = 0; k < 8; ++k) {
+        w[k] = transpose8x8(argon2_load64(buf + 8 * k));
+        for (unsigned i = 0; i < 8; ++i)
+            q[i] |= ((w[k] >> (8 * i)) & 0xff) << (8 * k);
+    }
+    sbox_bitsliced(q);
+    for (unsigned k = 0; k < 8; ++k) {
+        uint64_t x = 0;
+        for (unsigned i = 0; i < 8; ++i)
+            x |= ((q[i] >> (8 * k)) & 0xff) << (8 * i);
+        x = transpose8x8(x);
+        for (unsigned b = 0; b < 8; ++b)
+            buf[8 * k + b] = (uint8_t)(x >> (8 * b));
+    }
+    memcpy(s, buf, n);
+    argon2_secure_wipe(buf, sizeof(buf));
+    argon2_secure_wipe(q, sizeof(q));
+    argon2_secure_wipe(w, sizeof(w));
+}
+
+static inline uint8_t xtime(uint8_t x) {
+    return (uint8_t)((x << 1) ^ (0x1b & -(x >> 7)));
+}
+
+/* State bytes are column-major: s[4 * column + row]. */
+static void shift_rows_mix_columns(uint8_t s[16], int mix) {
+    uint8_t t[16];
+
+    for (unsigned c = 0; c < 4; ++c)
+        for (unsigned r = 0; r < 4; ++r)
+            t[4 * c + r] = s[4 * ((c + r) & 3) + r];
+    if (!mix) {
+        memcpy(s, t, 16);
+        return;
+    }
+    for (unsigned c = 0; c < 4; ++c) {
+        uint8_t a0 = t[4 * c], a1 = t[4 * c + 1], a2 = t[4 * c + 2], a3 = t[4 * c + 3];
+        uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+        s[4 * c + 0] = a0 ^ all ^ xtime(a0 ^ a1);
+        s[4 * c + 1] = a1 ^ all ^ xtime(a1 ^ a2);
+        s[4 * c + 2] = a2 ^ all ^ xtime(a2 ^ a3);
+        s[4 * c + 3] = a3 ^ all ^ xtime(a3 ^ a0);
+    }
+}
+
+static inline void xor_bytes(uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        dst[i] = a[i] ^ b[i];
+}
+
+/* Encrypts n <= 4 blocks in place. */
+static void aes256_encrypt_ref(const uint8_t *round_keys, uint8_t *blocks, size_t n) {
+    for (size_t b = 0; b < n; ++b)
+        xor_bytes(blocks + 16 * b, blocks + 16 * b, round_keys, 16);
+    for (unsigned round = 1; round <= 14; ++round) {
+        sub_bytes(blocks, 16 * n);
+        for (size_t b = 0; b < n; ++b) {
+            shift_rows_mix_columns(blocks + 16 * b, round != 14);
+            xor_bytes(blocks + 16 * b, blocks + 16 * b, round_keys + 16 * round, 16);
+        }
+    }
+}
+
+/* FIPS-197 section 5.2, Nk = 8. */
+static void aes256_expand_key(uint8_t round_keys[15 * 16], const uint8_t key[32]) {
+    uint8_t rcon = 0x01;
+
+    memcpy(round_keys, key, 32);
+    for (unsigned i = 8; i < 60; ++i) {
+        uint8_t w[4];
+        memcpy(w, round_keys + 4 * (i - 1), 4);
+        if (i % 8 == 0) {
+            uint8_t first = w[0];
+            w[0] = w[1];
+            w[1] = w[2];
+            w[2] = w[3];
+            w[3] = first;
+            sub_bytes(w, 4);
+            w[0] ^= rcon;
+            rcon = xtime(rcon);
+        } else if (i % 8 == 4) {
+            sub_bytes(w, 4);
+        }
+        xor_bytes(round_keys + 4 * i, round_keys + 4 * (i - 8), w, 4);
+    }
+}
+
+/* ============== PORTABLE GHASH ============== */
+
+/*
+ * Carry-less 64x64 -> low 64 bits using integer multiplies on operands with
+ * holes every fourth bit, so carries never reach a live bit (BearSSL's
+ * ghash_ctmul64). Integer multiply is constant-time on the CPUs this runs on.
+ */
+static inline uint64_t bmul64(uint64_t x, uint64_t y) {
+    const uint64_t m0 = 0x1111111111111111ULL, m1 = 0x2222222222222222ULL;
+    const uint64_t m2 = 0x4444444444444444ULL, m3 = 0x8888888888888888ULL;
+    uint64_t x0 = x & m0, x1 = x & m1, x2 = x & m2, x3 = x & m3;
+    uint64_t y0 = y & m0, y1 = y & m1, y2 = y & m2, y3 = y & m3;
+    uint64_t z0 = (x0 * y0) ^ (x1 * y3) ^ (x2 * y2) ^ (x3 * y1);
+    uint64_t z1 = (x0 * y1) ^ (x1 * y0) ^ (x2 * y3) ^ (x3 * y2);
+    uint64_t z2 = (x0 * y2) ^ (x1 * y1) ^ (x2 * y0) ^ (x3 * y3);
+    uint64_t z3 = (x0 * y3) ^ (x1 * y2) ^ (x2 * y1) ^ (x3 * y0);
+    return (z0 & m0) | (z1 & m1) | (z2 & m2) | (z3 & m3);
+}
+
+static inline uint64_t rev64(uint64_t x) {
+    x = ((x & 0x5555555555555555ULL) << 1) | ((x >> 1) & 0x5555555555555555ULL);
+    x = ((x & 0x3333333333333333ULL) << 2) | ((x >> 2) & 0x3333333333333333ULL);
+    x = ((x & 0x0f0f0f0f0f0f0f0fULL) << 4) | ((x >> 4) & 0x0f0f0f0f0f0f0f0fULL);
+    x = ((x & 0x00ff00ff00ff00ffULL) << 8) | ((x >> 8) & 0x00ff00ff00ff00ffULL);
+    x = ((x & 0x0000ffff0000ffffULL) << 16) | ((x >> 16) & 0x0000ffff0000ffffULL);
+    return (x << 32) | (x >> 32);
+}
+
+/*
+ * x * h in GF(2^128), GCM bit order. Karatsuba over 64-bit halves; the high
+ * half of each product comes from the bit-reversed operands, then the
+ * 256-bit result is shifted by one (GCM's reflected order) and reduced.
+ */
+static void gf128_mul_ct(uint64_t *x_hi, uint64_t *x_lo, uint64_t h_hi, uint64_t h_lo) {
+    uint64_t y1 = *x_hi, y0 = *x_lo;
+    uint64_t h0r = rev64(h_lo), h1r = rev64(h_hi);
+    uint64_t y0r = rev64(y0), y1r = rev64(y1);
+
+    uint64_t z0 = bmul64(y0, h_lo);
+    uint64_t z1 = bmul64(y1, h_hi);
+    uint64_t z2 = bmul64(y0 ^ y1, h_lo ^ h_hi);
+    uint64_t z0h = bmul64(y0r, h0r);
+    uint64_t z1h = bmul64(y1r, h1r);
+    uint64_t z2h = bmul64(y0r ^ y1r, h0r ^ h1r);
+    z2 ^= z0 ^ z1;
+    z2h ^= z0h ^ z1h;
+    z0h = rev64(z0h) >> 1;
+    z1h = rev64(z1h) >> 1;
+    z2h = rev64(z2h) >> 1;
+
+    uint64_t v0 = z0, v1 = z0h ^ z2, v2 = z1 ^ z2h, v3 = z1h;
+    v3 = (v3 << 1) | (v2 >> 63);
+    v2 = (v2 << 1) | (v1 >> 63);
+    v1 = (v1 << 1) | (v0 >> 63);
+    v0 = v0 << 1;
+
+    v2 ^= v0 ^ (v0 >> 1) ^ (v0 >> 2) ^ (v0 >> 7);
+    v1 ^= (v0 << 63) ^ (v0 << 62) ^ (v0 << 57);
+    v3 ^= v1 ^ (v1 >> 1) ^ (v1 >> 2) ^ (v1 >> 7);
+    v2 ^= (v1 << 63) ^ (v1 << 62) ^ (v1 << 57);
+
+    *x_hi = v3;
+    *x_lo = v2;
+}
+
+static void ref_init(aes256gcm_key *key) {
+    /* htable[0..15] = H = E(K, 0^128), as a GCM block. */
+    memset(key->htable, 0, sizeof(key->htable));
+    aes256_encrypt_ref(key->round_keys, key->htable, 1);
+}
+
+static void ref_ctr32(const aes256gcm_key *key, uint8_t ctr[16], const uint8_t *in,
+                      uint8_t *out, size_t blocks) {
+    uint8_t stream[4 * 16];
+
+    while (blocks > 0) {
+        size_t n = blocks < 4 ? blocks : 4;
+        for (size_t b = 0; b < n; ++b) {
+            memcpy(stream + 16 * b, ctr, 16);
+            inc32(ctr);
+        }
+        aes256_encrypt_ref(key->round_keys, stream, n);
+        xor_bytes(out, in, stream, 16 * n);
+        in += 16 * n;
+        out += 16 * n;
+        blocks -= n;
+    }
+    argon2_secure_wipe(stream, sizeof(stream));
+}
+
+static void ref_ghash(const aes256gcm_key *key, uint8_t xi[16], const uint8_t *in, size_t blocks) {
+    uint64_t h_hi = load64_be(key->htable), h_lo = load64_be(key->htable + 8);
+    uint64_t x_hi = load64_be(xi), x_lo = load64_be(xi + 8);
+
+    for (size_t b = 0; b < blocks; ++b) {
+        x_hi ^= load64_be(in + 16 * b);
+        x_lo ^= load64_be(in + 16 * b + 8);
+        gf128_mul_ct(&x_hi, &x_lo, h_hi, h_lo);
+    }
+    store64_be(xi, x_hi);
+    store64_be(xi + 8, x_lo);
+}
+
+static const argon2_aes_backend ref_backend = {"ref", ref_init, ref_ctr32, ref_ghash};
+
+/* ============== DISPATCH ============== */
+
+static const argon2_aes_backend *key_backend(const aes256gcm_key *key) {
+    const argon2_aes_backend *backend = NULL;
+
+    switch (key->impl) {
+#if defined(ARGON2_HAVE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+    case AES_IMPL_AESNI:
+        backend = argon2_aes_backend_aesni();
+        break;
+#endif
+#if defined(ARGON2_HAVE_ARM_AES)
+    case AES_IMPL_ARMV8:
+        backend = argon2_aes_backend_armv8();
+        break;
+#endif
+    default:
+        break;
+    }
+    return backend != NULL ? backend : &ref_backend;
+}
+
+int aes256gcm_key_init(aes256gcm_key *key, const uint8_t raw[AES256GCM_KEYBYTES]) {
+    if (key == NULL || raw == NULL) return AES_GCM_INVALID_PARAMETER;
+
+    key->impl = AES_IMPL_REF;
+    if (argon2_active_kernel() != ARGON2_KERNEL_REF) {
+#if defined(ARGON2_HAVE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+        if (argon2_aes_backend_aesni() != NULL) key->impl = AES_IMPL_AESNI;
+#endif
+#if defined(ARGON2_HAVE_ARM_AES)
+        if (argon2_aes_backend_armv8() != NULL) key->impl = AES_IMPL_ARMV8;
+#endif
+    }
+    aes256_expand_key(key->round_keys, raw);
+    key_backend(key)->init(key);
+    return AES_GCM_OK;
+}
+
+void aes256gcm_key_wipe(aes256gcm_key *key) {
+    if (key != NULL) {
+        argon2_secure_wipe(key, sizeof(*key));
+    }
+}
+
+const char *aes256gcm_key_impl_name(const aes256gcm_key *key) {
+    return key_backend(key)->name;
+}
+
+/* ============== GCM ============== */
+
+static void ghash_padded(const argon2_aes_backend *backend, const aes256gcm_key *key,
+                         uint8_t xi[16], const uint8_t *in, size_t len) {
+    backend->ghash(key, xi, in, len / 16);
+    if (len % 16 != 0) {
+        uint8_t block[16] = {0};
+        memcpy(block, in + (len & ~(size_t)15), len % 16);
+        backend->ghash(key, xi, block, 1);
+        argon2_secure_wipe(block, sizeof(block));
+    }
+}
+
+/*
+ * CTR over in, GHASH over the ciphertext (in when decrypting, out when
+ * encrypting), then the tag E(J0) ^ S. out may equal in.
+ */
+static void gcm_crypt(const aes256gcm_key *key, const uint8_t iv[AES256GCM_IVBYTES],
+                      const uint8_t *ad, size_t adlen, const uint8_t *in, size_t len,
+                      uint8_t *out, int decrypt, uint8_t tag[AES256GCM_TAGBYTES]) {
+    const argon2_aes_backend *backend = key_backend(key);
+    uint8_t j0[16], ctr[16], xi[16] = {0}, block[16];
+    size_t full = len & ~(size_t)15;
+
+    memcpy(j0, iv, AES256GCM_IVBYTES);
+    store32_be(j0 + 12, 1);
+    memcpy(ctr, j0, 16);
+    inc32(ctr);
+
+    if (adlen != 0) {
+        ghash_padded(backend, key, xi, ad, adlen);
+    }
+    for (size_t off = 0; off < full; off += GCM_PIECE_BYTES) {
+        size_t piece = full - off < GCM_PIECE_BYTES ? full - off : GCM_PIECE_BYTES;
+        if (decrypt) {
+            backend->ghash(key, xi, in + off, piece / 16);
+            backend->ctr32(key, ctr, in + off, out + off, piece / 16);
+        } else {
+            backend->ctr32(key, ctr, in + off, out + off, piece / 16);
+            backend->ghash(key, xi, out + off, piece / 16);
+        }
+    }
+    if (len > full) {
+        size_t rest = len - full;
+        memset(block, 0, sizeof(block));
+        memcpy(block, in + full, rest);
+        if (decrypt) {
+            backend->ghash(key, xi, block, 1);
+        }
+        backend->ctr32(key, ctr, block, block, 1);
+        memcpy(out + full, block, rest);
+        if (!decrypt) {
+            memset(block + rest, 0, sizeof(block) - rest);
+            backend->ghash(key, xi, block, 1);
+        }
+    }
+
+    store64_be(block, (uint64_t)adlen * 8);
+    store64_be(block + 8, (uint64_t)len * 8);
+    backend->ghash(key, xi, block, 1);
+
+    memset(block, 0, sizeof(block));
+    backend->ctr32(key, j0, block, block, 1);
+    xor_bytes(tag, block, xi, AES256GCM_TAGBYTES);
+
+    argon2_secure_wipe(block, sizeof(block));
+    argon2_secure_wipe(xi, sizeof(xi));
+}
+
+static int check_lengths(const aes256gcm_key *key, const uint8_t *iv, const uint8_t *ad,
+                         size_t adlen, const uint8_t *in, size_t inlen, const uint8_t *out) {
+    if (key == NULL || iv == NULL) return AES_GCM_INVALID_PARAMETER;
+    if ((ad == NULL && adlen != 0) || ((in == NULL || out == NULL) && inlen != 0)) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+    if ((uint64_t)inlen > AES256GCM_MAX_BYTES) return AES_GCM_TOO_LONG;
+    return AES_GCM_OK;
+}
+
+int aes256gcm_encrypt(const aes256gcm_key *key, const uint8_t iv[AES256GCM_IVBYTES],
+                      const uint8_t *ad, size_t adlen,
+                      const uint8_t *in, size_t inlen,
+                      uint8_t *out, uint8_t tag[AES256GCM_TAGBYTES]) {
+    int result = check_lengths(key, iv, ad, adlen, in, inlen, out);
+    if (result != AES_GCM_OK) return result;
+    if (tag == NULL) return AES_GCM_INVALID_PARAMETER;
+
+    gcm_crypt(key, iv, ad, adlen, in, inlen, out, 0, tag);
+    return AES_GCM_OK;
+}
+
+int aes256gcm_decrypt(const aes256gcm_key *key, const uint8_t iv[AES256GCM_IVBYTES],
+                      const uint8_t *ad, size_t adlen,
+                      const uint8_t *in, size_t inlen,
+                      const uint8_t tag[AES256GCM_TAGBYTES], uint8_t *out) {
+    uint8_t expected[AES256GCM_TAGBYTES];
+    uint8_t diff = 0;
+
+    int result = check_lengths(key, iv, ad, adlen, in, inlen, out);
+    if (result != AES_GCM_OK) return result;
+    if (tag == NULL) return AES_GCM_INVALID_PARAMETER;
+
+    gcm_crypt(key, iv, ad, adlen, in, inlen, out, 1, expected);
+    for (size_t i = 0; i < AES256GCM_TAGBYTES; ++i)
+        diff |= expected[i] ^ tag[i];
+    argon2_secure_wipe(expected, sizeof(expected));
+
+    if (diff != 0) {
+        if (inlen != 0) {
+            argon2_secure_wipe(out, inlen);
+        }
+        return AES_GCM_AUTH_FAILED;
+    }
+    return AES_GCM_OK;
+}
+
+/* ============== BATCH ============== */
+
+static inline uint32_t load32_le(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+typedef struct {
+    const uint8_t *iv, *ad, *in;
+    size_t adlen, inlen;
+} batch_record;
+
+/* Parses the record at *off and steps past it; AES_GCM_INVALID_PARAMETER if it overruns. */
+static int batch_next(const uint8_t *batch, size_t len, size_t *off, batch_record *record) {
+    size_t rest = len - *off;
+    if (rest < AES256GCM_BATCH_HEADERBYTES) return AES_GCM_INVALID_PARAMETER;
+
+    const uint8_t *p = batch + *off;
+    record->iv = p;
+    record->adlen = load32_le(p + AES256GCM_IVBYTES);
+    record->inlen = load32_le(p + AES256GCM_IVBYTES + 4);
+    rest -= AES256GCM_BATCH_HEADERBYTES;
+    if (record->adlen > rest || record->inlen > rest - record->adlen) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+    record->ad = p + AES256GCM_BATCH_HEADERBYTES;
+    record->in = record->ad + record->adlen;
+    *off += AES256GCM_BATCH_HEADERBYTES + record->adlen + record->inlen;
+    return AES_GCM_OK;
+}
+
+int aes256gcm_batch_measure(const uint8_t *batch, size_t len, int open,
+                            size_t *records, size_t *outlen) {
+    batch_record record;
+    size_t off = 0, count = 0, total = 0;
+
+    if (batch == NULL && len != 0) return AES_GCM_INVALID_PARAMETER;
+    while (off < len) {
+        int result = batch_next(batch, len, &off, &record);
+        if (result != AES_GCM_OK) return result;
+        if (open && record.inlen < AES256GCM_TAGBYTES) return AES_GCM_INVALID_PARAMETER;
+        if ((uint64_t)record.inlen > AES256GCM_MAX_BYTES) return AES_GCM_TOO_LONG;
+        /* Only sealing makes out longer than the records. */
+        if (!open && record.inlen > SIZE_MAX - AES256GCM_TAGBYTES - total) {
+            return AES_GCM_TOO_LONG;
+        }
+        total += open ? record.inlen - AES256GCM_TAGBYTES : record.inlen + AES256GCM_TAGBYTES;
+        count++;
+    }
+    if (records != NULL) *records = count;
+    if (outlen != NULL) *outlen = total;
+    return AES_GCM_OK;
+}
+
+int aes256gcm_seal_batch(const aes256gcm_key *key, const uint8_t *batch, size_t len,
+                         uint8_t *out) {
+    batch_record record;
+    size_t off = 0;
+
+    if (key == NULL) return AES_GCM_INVALID_PARAMETER;
+    int result = aes256gcm_batch_measure(batch, len, 0, NULL, NULL);
+    if (result != AES_GCM_OK) return result;
+    if (out == NULL && len != 0) return AES_GCM_INVALID_PARAMETER;
+
+    while (off < len) {
+        result = batch_next(batch, len, &off, &record);
+        if (result != AES_GCM_OK) return result;
+        gcm_crypt(key, record.iv, record.ad, record.adlen, record.in, record.inlen,
+                  out, 0, out + record.inlen);
+        out += record.inlen + AES256GCM_TAGBYTES;
+    }
+    return AES_GCM_OK;
+}
+
+int aes256gcm_open_batch(const aes256gcm_key *key, const uint8_t *batch, size_t len,
+                         uint8_t *out, size_t *failed) {
+    batch_record record;
+    size_t off = 0, index = 0, outlen = 0, written = 0;
+
+    if (key == NULL) return AES_GCM_INVALID_PARAMETER;
+    int result = aes256gcm_batch_measure(batch, len, 1, NULL, &outlen);
+    if (result != AES_GCM_OK) return result;
+    if (out == NULL && outlen != 0) return AES_GCM_INVALID_PARAMETER;
+
+    for (; off < len; ++index) {
+        result = batch_next(batch, len, &off, &record);
+        if (result != AES_GCM_OK) break;
+        size_t ctlen = record.inlen - AES256GCM_TAGBYTES;
+        result = aes256gcm_decrypt(key, record.iv, record.ad, record.adlen, record.in, ctlen,
+                                   record.in + ctlen, out != NULL ? out + written : NULL);
+        if (result != AES_GCM_OK) {
+            if (failed != NULL) *failed = index;
+            break;
+        }
+        written += ctlen;
+    }
+    /* All of out, including the space of records never reached. */
+    if (result != AES_GCM_OK) {
+        argon2_secure_wipe(out, outlen);
+    }
+    return result;
+}
+
+/* ============== STREAM ============== */
+
+static void stream_nonce(uint8_t iv[AES256GCM_IVBYTES],
+                         const uint8_t prefix[AES256GCM_STREAM_PREFIXBYTES],
+                         uint32_t index, int last) {
+    memcpy(iv, prefix, AES256GCM_STREAM_PREFIXBYTES);
+    store32_be(iv + AES256GCM_STREAM_PREFIXBYTES, index);
+    iv[AES256GCM_IVBYTES - 1] = last ? 1 : 0;
+}
+
+int aes256gcm_stream_seal_chunk(const aes256gcm_key *key,
+                                const uint8_t prefix[AES256GCM_STREAM_PREFIXBYTES],
+                                uint32_t index, int last,
+                                const uint8_t *ad, size_t adlen,
+                                const uint8_t *in, size_t inlen, uint8_t *out) {
+    uint8_t iv[AES256GCM_IVBYTES];
+
+    if (prefix == NULL || out == NULL) return AES_GCM_INVALID_PARAMETER;
+    stream_nonce(iv, prefix, index, last);
+    return aes256gcm_encrypt(key, iv, ad, adlen, in, inlen, out, out + inlen);
+}
+
+int aes256gcm_stream_open_chunk(const aes256gcm_key *key,
+                                const uint8_t prefix[AES256GCM_STREAM_PREFIXBYTES],
+                                uint32_t index, int last,
+                                const uint8_t *ad, size_t adlen,
+                                const uint8_t *in, size_t inlen, uint8_t *out) {
+    uint8_t iv[AES256GCM_IVBYTES];
+
+    if (prefix == NULL || in == NULL || inlen < AES256GCM_TAGBYTES) {
+        return AES_GCM_INVALID_PARAMETER;
+    }
+    inlen -= AES256GCM_TAGBYTES;
+    stream_nonce(iv, prefix, index, last);
+    return aes256gcm_decrypt(key, iv, ad, adlen, in, inlen, in + inlen, out);
+}
+
+int aes256gcm_stream_init(aes256gcm_stream *stream, const uint8_t raw[AES256GCM_KEYBYTES],
+                          const uint8_t prefix[AES256GCM_STREAM_PREFIXBYTES]) {
+    if (stream == NULL || prefix == NULL) return AES_GCM_INVALID_PARAMETER;
+    int result = aes256gcm_key_init(&stream->key, raw);
+    if (result != AES_GCM_OK) return result;
+    memcpy(stream->prefix, prefix, AES256GCM_STREAM_PREFIXBYTES);
+    stream->next_index = 0;
+    stream->finished = 0;
+    return AES_GCM_OK;
+}
+
+/* The last index (2^32 - 1) is only available to a last chunk. */
+static int stream_check(const aes256gcm_stream *stream, int last) {
+    if (stream == NULL) return AES_GCM_INVALID_PARAMETER;
+    if (stream->finished) return AES_GCM_STREAM_FINISHED;
+    if (stream->next_index == UINT32_MAX && !last) return AES_GCM_STREAM_EXHAUSTED;
+    return AES_GCM_OK;
+}
+
+static void stream_advance(aes256gcm_stream *stream, int last) {
+    stream->next_index++;
+    stream->finished = last != 0;
+}
+
+int aes256gcm_stream_push(aes256gcm_stream *stream, int last,
+                          const uint8_t *ad, size_t adlen,
+                          const uint8_t *in, size_t inlen, uint8_t *out) {
+    int result = stream_check(stream, last);
+    if (result != AES_GCM_OK) return result;
+
+    result = aes256gcm_stream_seal_chunk(&stream->key, stream->prefix, stream->next_index,
+                                         last, ad, adlen, in, inlen, out);
+    if (result == AES_GCM_OK) {
+        stream_advance(stream, last);
+    }
+    return result;
+}
+
+int aes256gcm_stream_pull(aes256gcm_stream *stream, int last,
+                          const uint8_t *ad, size_t adlen,
+                          const uint8_t *in, size_t inlen, uint8_t *out) {
+    int result = stream_check(stream, last);
+    if (result != AES_GCM_OK) return result;
+
+    result = aes256gcm_stream_open_chunk(&stream->key, stream->prefix, stream->next_index,
+                                         last, ad, adlen, in, inlen, out);
+    if (result == AES_GCM_OK) {
+        stream_advance(stream, last);
+    }
+    return result;
+}
+
+int aes256gcm_stream_finished(const aes256gcm_stream *stream) {
+    if (stream == NULL) return AES_GCM_INVALID_PARAMETER;
+    return stream->finished ? AES_GCM_OK : AES_GCM_TRUNCATED;
+}
+
+void aes256gcm_stream_wipe(aes256gcm_stream *stream) {
+    if (stream != NULL) {
+        argon2_secure_wipe(stream, sizeof(*stream));
+    }
+}
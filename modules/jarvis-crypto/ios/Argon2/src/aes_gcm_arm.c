@@ -0,0 +1,191 @@
+/*
+ * AES-256-GCM backend for the ARMv8 Cryptography Extensions (AESE/AESMC,
+ * PMULL). Every arm64 Apple device has them; on Android they are checked
+ * with getauxval(). The file must be built with the crypto extension
+ * enabled (CMakeLists.txt adds -march=armv8-a+crypto; Apple's arm64
+ * targets have it by default), otherwise the backend is left out.
+ *
+ * GHASH runs on bit-reversed bytes: after RBIT, bit k of the 128-bit
+ * little-endian value is the coefficient of x^k, so a PMULL product is the
+ * plain polynomial product and reduces by folding with x^128 = x^7 + x^2 +
+ * x + 1 (0x87). Four blocks share one reduction, using H..H^4 in htable.
+ */
+
+#include "argon2_internal.h"
+
+#if defined(ARGON2_HAVE_ARM_AES)
+
+#if defined(__ARM_FEATURE_CRYPTO) || defined(__ARM_FEATURE_AES)
+
+#include <arm_neon.h>
+
+#if defined(__linux__) || defined(__ANDROID__)
+#include <sys/auxv.h>
+#ifndef HWCAP_AES
+#define HWCAP_AES (1 << 3)
+#endif
+#ifndef HWCAP_PMULL
+#define HWCAP_PMULL (1 << 4)
+#endif
+#endif
+
+static inline uint8x16_t aes256_block(const uint8x16_t rk[15], uint8x16_t x) {
+    for (int r = 0; r < 13; ++r)
+        x = vaesmcq_u8(vaeseq_u8(x, rk[r]));
+    return veorq_u8(vaeseq_u8(x, rk[13]), rk[14]);
+}
+
+/* ---- GHASH ---- */
+
+static inline uint64x2_t pmull_lo(uint64x2_t a, uint64x2_t b) {
+    return vreinterpretq_u64_p128(vmull_p64((poly64_t)vgetq_lane_u64(a, 0),
+                                            (poly64_t)vgetq_lane_u64(b, 0)));
+}
+
+static inline uint64x2_t pmull_hi(uint64x2_t a, uint64x2_t b) {
+    return vreinterpretq_u64_p128(vmull_high_p64(vreinterpretq_p64_u64(a),
+                                                 vreinterpretq_p64_u64(b)));
+}
+
+static inline uint64x2_t rbit(uint8x16_t x) {
+    return vreinterpretq_u64_u8(vrbitq_u8(x));
+}
+
+/* Unreduced product a * b accumulated as lo (bits 0-127), mid (64-191), hi (128-255). */
+static inline void pmull_acc(uint64x2_t a, uint64x2_t b, uint64x2_t *lo, uint64x2_t *mid,
+                             uint64x2_t *hi) {
+    uint64x2_t b_swapped = vextq_u64(b, b, 1);
+    *lo = veorq_u64(*lo, pmull_lo(a, b));
+    *hi = veorq_u64(*hi, pmull_hi(a, b));
+    *mid = veorq_u64(*mid, veorq_u64(pmull_lo(a, b_swapped), pmull_hi(a, b_swapped)));
+}
+
+static inline uint64x2_t ghash_reduce(uint64x2_t lo, uint64x2_t mid, uint64x2_t hi) {
+    const uint64x2_t poly = vdupq_n_u64(0x87);
+    uint64_t w0 = vgetq_lane_u64(lo, 0);
+    uint64_t w1 = vgetq_lane_u64(lo, 1) ^ vgetq_lane_u64(mid, 0);
+    uint64_t w2 = vgetq_lane_u64(hi, 0) ^ vgetq_lane_u64(mid, 1);
+    uint64_t w3 = vgetq_lane_u64(hi, 1);
+
+    /* w3 * x^192 = w3 * x^64 * 0x87, then w2 * x^128 = w2 * 0x87. */
+    uint64x2_t t = pmull_lo(vdupq_n_u64(w3), poly);
+    w1 ^= vgetq_lane_u64(t, 0);
+    w2 ^= vgetq_lane_u64(t, 1);
+    t = pmull_lo(vdupq_n_u64(w2), poly);
+    w0 ^= vgetq_lane_u64(t, 0);
+    w1 ^= vgetq_lane_u64(t, 1);
+    return vcombine_u64(vcreate_u64(w0), vcreate_u64(w1));
+}
+
+static inline uint64x2_t gf128_mul(uint64x2_t a, uint64x2_t b) {
+    uint64x2_t lo = vdupq_n_u64(0), mid = vdupq_n_u64(0), hi = vdupq_n_u64(0);
+    pmull_acc(a, b, &lo, &mid, &hi);
+    return ghash_reduce(lo, mid, hi);
+}
+
+static void armv8_init(aes256gcm_key *key) {
+    uint8x16_t rk[15];
+    for (int r = 0; r < 15; ++r)
+        rk[r] = vld1q_u8(key->round_keys + 16 * r);
+
+    /* htable[i] = H^(i+1), bit-reversed. */
+    uint64x2_t h = rbit(aes256_block(rk, vdupq_n_u8(0)));
+    uint64x2_t power = h;
+    for (int i = 0; i < 4; ++i) {
+        vst1q_u64((uint64_t *)(void *)(key->htable + 16 * i), power);
+        power = gf128_mul(power, h);
+    }
+}
+
+#define LOAD_H(i) vld1q_u64((const uint64_t *)(const void *)(key->htable + 16 * (i)))
+
+static void armv8_ghash(const aes256gcm_key *key, uint8_t xi[16], const uint8_t *in,
+                        size_t blocks) {
+    const uint64x2_t h1 = LOAD_H(0);
+    uint64x2_t x = rbit(vld1q_u8(xi));
+
+    if (blocks >= 4) {
+        const uint64x2_t h2 = LOAD_H(1), h3 = LOAD_H(2), h4 = LOAD_H(3);
+        for (; blocks >= 4; blocks -= 4, in += 64) {
+            uint64x2_t lo = vdupq_n_u64(0), mid = vdupq_n_u64(0), hi = vdupq_n_u64(0);
+            pmull_acc(veorq_u64(x, rbit(vld1q_u8(in))), h4, &lo, &mid, &hi);
+            pmull_acc(rbit(vld1q_u8(in + 16)), h3, &lo, &mid, &hi);
+            pmull_acc(rbit(vld1q_u8(in + 32)), h2, &lo, &mid, &hi);
+            pmull_acc(rbit(vld1q_u8(in + 48)), h1, &lo, &mid, &hi);
+            x = ghash_reduce(lo, mid, hi);
+        }
+    }
+    for (; blocks > 0; --blocks, in += 16) {
+        x = gf128_mul(veorq_u64(x, rbit(vld1q_u8(in))), h1);
+    }
+    vst1q_u8(xi, vrbitq_u8(vreinterpretq_u8_u64(x)));
+}
+
+/* ---- CTR ---- */
+
+/* base with its last four bytes replaced by the big-endian counter. */
+static inline uint8x16_t counter_block(uint32x4_t base, uint32_t counter) {
+    return vreinterpretq_u8_u32(vsetq_lane_u32(__builtin_bswap32(counter), base, 3));
+}
+
+static void armv8_ctr32(const aes256gcm_key *key, uint8_t ctr[16], const uint8_t *in,
+                        uint8_t *out, size_t blocks) {
+    uint8x16_t rk[15];
+    for (int r = 0; r < 15; ++r)
+        rk[r] = vld1q_u8(key->round_keys + 16 * r);
+
+    const uint32x4_t base = vreinterpretq_u32_u8(vld1q_u8(ctr));
+    uint32_t counter = ((uint32_t)ctr[12] << 24) | ((uint32_t)ctr[13] << 16) |
+                       ((uint32_t)ctr[14] << 8) | ctr[15];
+
+    /* Eight named blocks rather than an array: compilers keep them in registers. */
+    for (; blocks >= 8; blocks -= 8, in += 128, out += 128) {
+        uint8x16_t b0 = counter_block(base, counter), b1 = counter_block(base, counter + 1);
+        uint8x16_t b2 = counter_block(base, counter + 2), b3 = counter_block(base, counter + 3);
+        uint8x16_t b4 = counter_block(base, counter + 4), b5 = counter_block(base, counter + 5);
+        uint8x16_t b6 = counter_block(base, counter + 6), b7 = counter_block(base, counter + 7);
+        counter += 8;
+        for (int r = 0; r < 13; ++r) {
+            const uint8x16_t k = rk[r];
+            b0 = vaesmcq_u8(vaeseq_u8(b0, k)); b1 = vaesmcq_u8(vaeseq_u8(b1, k));
+            b2 = vaesmcq_u8(vaeseq_u8(b2, k)); b3 = vaesmcq_u8(vaeseq_u8(b3, k));
+            b4 = vaesmcq_u8(vaeseq_u8(b4, k)); b5 = vaesmcq_u8(vaeseq_u8(b5, k));
+            b6 = vaesmcq_u8(vaeseq_u8(b6, k)); b7 = vaesmcq_u8(vaeseq_u8(b7, k));
+        }
+#define LAST_ROUND(i, b) \
+    vst1q_u8(out + 16 * (i), veorq_u8(veorq_u8(vaeseq_u8((b), rk[13]), rk[14]), vld1q_u8(in + 16 * (i))))
+        LAST_ROUND(0, b0); LAST_ROUND(1, b1); LAST_ROUND(2, b2); LAST_ROUND(3, b3);
+        LAST_ROUND(4, b4); LAST_ROUND(5, b5); LAST_ROUND(6, b6); LAST_ROUND(7, b7);
+#undef LAST_ROUND
+    }
+    for (; blocks > 0; --blocks, in += 16, out += 16) {
+        uint8x16_t b = aes256_block(rk, counter_block(base, counter++));
+        vst1q_u8(out, veorq_u8(b, vld1q_u8(in)));
+    }
+    ctr[12] = (uint8_t)(counter >> 24);
+    ctr[13] = (uint8_t)(counter >> 16);
+    ctr[14] = (uint8_t)(counter >> 8);
+    ctr[15] = (uint8_t)counter;
+}
+
+static const argon2_aes_backend armv8_backend = {"armv8", armv8_init, armv8_ctr32, armv8_ghash};
+
+const argon2_aes_backend *argon2_aes_backend_armv8(void) {
+#if defined(__linux__) || defined(__ANDROID__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    if ((hwcap & HWCAP_AES) == 0 || (hwcap & HWCAP_PMULL) == 0) {
+        return NULL;
+    }
+#endif
+    return &armv8_backend;
+}
+
+#else /* built without the crypto extension */
+
+const argon2_aes_backend *argon2_aes_backend_armv8(void) {
+    return NULL;
+}
+
+#endif
+
+#endif /* ARGON2_HAVE_ARM_AES */
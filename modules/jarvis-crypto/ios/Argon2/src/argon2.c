@@ -1,64 +1,39 @@
 /*
- * Argon2 reference implementation - consolidated single file
+ * Argon2 reference implementation - core (H', indexing, API)
  * Public domain (CC0) - https://github.com/P-H-C/phc-winner-argon2
  *
- * This is a minimal implementation for argon2id only.
- * Compiled with -DARGON2_NO_THREADS for single-threaded use.
+ * Argon2d, Argon2i and Argon2id (version 0x13) through argon2_ctx; the
+ * argon2id_* helpers wrap it.
+ * Lanes run on pthreads, one slice at a time; build with -DARGON2_NO_THREADS
+ * to compile the serial loop only.
+ * The compression function has SIMD kernels in fill_block_*.c, selected at
+ * runtime; the scalar fill_block here is the reference they are checked
+ * against.
  */
 
-#include "../include/argon2.h"
+#include "argon2_internal.h"
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-/* ============== BLAKE2B ============== */
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
 
-#define BLAKE2B_BLOCKBYTES 128
-#define BLAKE2B_OUTBYTES 64
-#define BLAKE2B_KEYBYTES 64
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <sys/syscall.h>
+#endif
 
-typedef struct {
-    uint64_t h[8];
-    uint64_t t[2];
-    uint64_t f[2];
-    uint8_t buf[BLAKE2B_BLOCKBYTES];
-    size_t buflen;
-    size_t outlen;
-} blake2b_state;
-
-static const uint64_t blake2b_IV[8] = {
-    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
-    0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
-    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
-    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
-};
+#ifndef ARGON2_NO_THREADS
+#include <pthread.h>
+#endif
 
-static const uint8_t blake2b_sigma[12][16] = {
-    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
-    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
-    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
-    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
-    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
-    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
-    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
-    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
-    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
-    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
-    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
-    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3}
-};
+/* ============== BLAKE2B ============== */
 
 static inline uint64_t rotr64(uint64_t x, unsigned n) {
     return (x >> n) | (x << (64 - n));
 }
 
-static inline uint64_t load64(const void *src) {
-    const uint8_t *p = (const uint8_t *)src;
-    return ((uint64_t)p[0]) | ((uint64_t)p[1] << 8) |
-           ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
-           ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
-           ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
-}
-
 static inline void store32(void *dst, uint32_t w) {
     uint8_t *p = (uint8_t *)dst;
     p[0] = (uint8_t)(w);
@@ -67,182 +42,93 @@ static inline void store32(void *dst, uint32_t w) {
     p[3] = (uint8_t)(w >> 24);
 }
 
-static inline void store64(void *dst, uint64_t w) {
-    uint8_t *p = (uint8_t *)dst;
-    p[0] = (uint8_t)(w);
-    p[1] = (uint8_t)(w >> 8);
-    p[2] = (uint8_t)(w >> 16);
-    p[3] = (uint8_t)(w >> 24);
-    p[4] = (uint8_t)(w >> 32);
-    p[5] = (uint8_t)(w >> 40);
-    p[6] = (uint8_t)(w >> 48);
-    p[7] = (uint8_t)(w >> 56);
-}
-
-#define G(r, i, a, b, c, d)                     \
-    do {                                        \
-        a = a + b + m[blake2b_sigma[r][2*i+0]]; \
-        d = rotr64(d ^ a, 32);                  \
-        c = c + d;                              \
-        b = rotr64(b ^ c, 24);                  \
-        a = a + b + m[blake2b_sigma[r][2*i+1]]; \
-        d = rotr64(d ^ a, 16);                  \
-        c = c + d;                              \
-        b = rotr64(b ^ c, 63);                  \
-    } while (0)
-
-#define ROUND(r)                    \
-    do {                            \
-        G(r, 0, v[0], v[4], v[8], v[12]); \
-        G(r, 1, v[1], v[5], v[9], v[13]); \
-        G(r, 2, v[2], v[6], v[10], v[14]); \
-        G(r, 3, v[3], v[7], v[11], v[15]); \
-        G(r, 4, v[0], v[5], v[10], v[15]); \
-        G(r, 5, v[1], v[6], v[11], v[12]); \
-        G(r, 6, v[2], v[7], v[8], v[13]); \
-        G(r, 7, v[3], v[4], v[9], v[14]); \
-    } while (0)
-
-static void blake2b_compress(blake2b_state *S, const uint8_t block[BLAKE2B_BLOCKBYTES]) {
-    uint64_t m[16];
-    uint64_t v[16];
-
-    for (size_t i = 0; i < 16; ++i)
-        m[i] = load64(block + i * 8);
-
-    for (size_t i = 0; i < 8; ++i)
-        v[i] = S->h[i];
-
-    v[8] = blake2b_IV[0];
-    v[9] = blake2b_IV[1];
-    v[10] = blake2b_IV[2];
-    v[11] = blake2b_IV[3];
-    v[12] = blake2b_IV[4] ^ S->t[0];
-    v[13] = blake2b_IV[5] ^ S->t[1];
-    v[14] = blake2b_IV[6] ^ S->f[0];
-    v[15] = blake2b_IV[7] ^ S->f[1];
-
-    ROUND(0);
-    ROUND(1);
-    ROUND(2);
-    ROUND(3);
-    ROUND(4);
-    ROUND(5);
-    ROUND(6);
-    ROUND(7);
-    ROUND(8);
-    ROUND(9);
-    ROUND(10);
-    ROUND(11);
-
-    for (size_t i = 0; i < 8; ++i)
-        S->h[i] = S->h[i] ^ v[i] ^ v[i + 8];
-}
-
-static void blake2b_init(blake2b_state *S, size_t outlen) {
-    memset(S, 0, sizeof(*S));
-    for (size_t i = 0; i < 8; ++i)
-        S->h[i] = blake2b_IV[i];
-    S->h[0] ^= 0x01010000 ^ outlen;
-    S->outlen = outlen;
-}
-
-static void blake2b_update(blake2b_state *S, const void *in, size_t inlen) {
-    const uint8_t *pin = (const uint8_t *)in;
-
-    if (inlen == 0) return;
-
-    size_t left = S->buflen;
-    size_t fill = BLAKE2B_BLOCKBYTES - left;
-
-    if (inlen > fill) {
-        S->buflen = 0;
-        memcpy(S->buf + left, pin, fill);
-        S->t[0] += BLAKE2B_BLOCKBYTES;
-        if (S->t[0] < BLAKE2B_BLOCKBYTES) S->t[1]++;
-        blake2b_compress(S, S->buf);
-        pin += fill;
-        inlen -= fill;
-
-        while (inlen > BLAKE2B_BLOCKBYTES) {
-            S->t[0] += BLAKE2B_BLOCKBYTES;
-            if (S->t[0] < BLAKE2B_BLOCKBYTES) S->t[1]++;
-            blake2b_compress(S, pin);
-            pin += BLAKE2B_BLOCKBYTES;
-            inlen -= BLAKE2B_BLOCKBYTES;
-        }
-    }
-    memcpy(S->buf + S->buflen, pin, inlen);
-    S->buflen += inlen;
-}
-
-static void blake2b_final(blake2b_state *S, void *out) {
-    S->t[0] += S->buflen;
-    if (S->t[0] < S->buflen) S->t[1]++;
-    S->f[0] = (uint64_t)-1;
-    memset(S->buf + S->buflen, 0, BLAKE2B_BLOCKBYTES - S->buflen);
-    blake2b_compress(S, S->buf);
-
-    uint8_t buffer[BLAKE2B_OUTBYTES];
-    for (size_t i = 0; i < 8; ++i)
-        store64(buffer + i * 8, S->h[i]);
-    memcpy(out, buffer, S->outlen);
-}
-
-static void blake2b_long(void *out, size_t outlen, const void *in, size_t inlen) {
+/*
+ * H' (RFC 9106 section 3.3): variable-length hash built from BLAKE2b-512,
+ * computed for n <= ARGON2_BLAKE2B_MAX_WAYS equal-length inputs at once.
+ * A 1 KiB output is a chain of 31 dependent compressions; the n chains have
+ * the same shape, so each step runs once for all of them on the
+ * multi-buffer BLAKE2b kernels.
+ */
+static void blake2b_long_many(uint8_t *const *out, size_t outlen,
+                              const uint8_t *const *in, size_t inlen, size_t n) {
+    blake2b_state states[ARGON2_BLAKE2B_MAX_WAYS];
+    blake2b_state *S[ARGON2_BLAKE2B_MAX_WAYS] = {NULL};
+    uint8_t out_buffer[ARGON2_BLAKE2B_MAX_WAYS][BLAKE2B_OUTBYTES];
+    uint8_t *chain_out[ARGON2_BLAKE2B_MAX_WAYS];
+    const uint8_t *chain_in[ARGON2_BLAKE2B_MAX_WAYS];
+    const uint8_t *prefix[ARGON2_BLAKE2B_MAX_WAYS] = {NULL};
+    uint8_t *tail[ARGON2_BLAKE2B_MAX_WAYS];
     uint8_t outlen_bytes[4];
     store32(outlen_bytes, (uint32_t)outlen);
 
+    for (size_t i = 0; i < n; ++i) {
+        S[i] = &states[i];
+        chain_out[i] = out_buffer[i];
+        chain_in[i] = out_buffer[i];
+        prefix[i] = outlen_bytes;
+    }
+
     if (outlen <= BLAKE2B_OUTBYTES) {
-        blake2b_state S;
-        blake2b_init(&S, outlen);
-        blake2b_update(&S, outlen_bytes, 4);
-        blake2b_update(&S, in, inlen);
-        blake2b_final(&S, out);
-    } else {
-        uint8_t out_buffer[BLAKE2B_OUTBYTES];
-        blake2b_state S;
-        blake2b_init(&S, BLAKE2B_OUTBYTES);
-        blake2b_update(&S, outlen_bytes, 4);
-        blake2b_update(&S, in, inlen);
-        blake2b_final(&S, out_buffer);
+        for (size_t i = 0; i < n; ++i) {
+            blake2b_init(S[i], outlen);
+        }
+        argon2_blake2b_update_many(S, prefix, 4, n);
+        argon2_blake2b_update_many(S, in, inlen, n);
+        argon2_blake2b_final_many(S, out, n);
+        return;
+    }
 
-        memcpy(out, out_buffer, BLAKE2B_OUTBYTES / 2);
-        out = (uint8_t *)out + BLAKE2B_OUTBYTES / 2;
-        size_t remaining = outlen - BLAKE2B_OUTBYTES / 2;
+    for (size_t i = 0; i < n; ++i) {
+        blake2b_init(S[i], BLAKE2B_OUTBYTES);
+    }
+    argon2_blake2b_update_many(S, prefix, 4, n);
+    argon2_blake2b_update_many(S, in, inlen, n);
+    argon2_blake2b_final_many(S, chain_out, n);
+
+    size_t written = BLAKE2B_OUTBYTES / 2;
+    size_t remaining = outlen - written;
+    for (size_t i = 0; i < n; ++i) {
+        memcpy(out[i], out_buffer[i], written);
+    }
 
-        while (remaining > BLAKE2B_OUTBYTES) {
-            blake2b_init(&S, BLAKE2B_OUTBYTES);
-            blake2b_update(&S, out_buffer, BLAKE2B_OUTBYTES);
-            blake2b_final(&S, out_buffer);
-            memcpy(out, out_buffer, BLAKE2B_OUTBYTES / 2);
-            out = (uint8_t *)out + BLAKE2B_OUTBYTES / 2;
-            remaining -= BLAKE2B_OUTBYTES / 2;
+    while (remaining > BLAKE2B_OUTBYTES) {
+        for (size_t i = 0; i < n; ++i) {
+            blake2b_init(S[i], BLAKE2B_OUTBYTES);
         }
+        argon2_blake2b_update_many(S, chain_in, BLAKE2B_OUTBYTES, n);
+        argon2_blake2b_final_many(S, chain_out, n);
+        for (size_t i = 0; i < n; ++i) {
+            memcpy(out[i] + written, out_buffer[i], BLAKE2B_OUTBYTES / 2);
+        }
+        written += BLAKE2B_OUTBYTES / 2;
+        remaining -= BLAKE2B_OUTBYTES / 2;
+    }
 
-        blake2b_init(&S, remaining);
-        blake2b_update(&S, out_buffer, BLAKE2B_OUTBYTES);
-        blake2b_final(&S, out);
+    for (size_t i = 0; i < n; ++i) {
+        blake2b_init(S[i], remaining);
+        tail[i] = out[i] + written;
     }
+    argon2_blake2b_update_many(S, chain_in, BLAKE2B_OUTBYTES, n);
+    argon2_blake2b_final_many(S, tail, n);
+    argon2_secure_wipe(out_buffer, sizeof(out_buffer));
 }
 
 /* ============== ARGON2 CORE ============== */
 
-#define ARGON2_BLOCK_SIZE 1024
-#define ARGON2_QWORDS_IN_BLOCK (ARGON2_BLOCK_SIZE / 8)
-#define ARGON2_SYNC_POINTS 4
-
-typedef struct block_ {
-    uint64_t v[ARGON2_QWORDS_IN_BLOCK];
-} block;
-
 typedef struct Argon2_instance_t {
     block *memory;
+    block *seeds;               /* ARGON2_FLAG_LANE_LOCAL: blocks 0 and 1 of each lane
+                                   until lane_prepare moves them in, else NULL */
+    size_t mapped_bytes;        /* non-zero: memory is a lane-local mapping */
+    argon2_fill_block_fn fill_block;
+    argon2_fill_block2_fn fill_block2;
     uint32_t passes;
     uint32_t memory_blocks;
     uint32_t segment_length;
     uint32_t lane_length;
+    uint32_t lane_stride;       /* blocks from one lane's start to the next */
     uint32_t lanes;
+    uint32_t threads;
     argon2_type type;
     uint32_t version;
 } argon2_instance_t;
@@ -263,181 +149,487 @@ static void xor_block(block *dst, const block *src) {
         dst->v[i] ^= src->v[i];
 }
 
+/* BlaMka: the 32x32->64 product must be widened before the multiply. */
+#define fBlaMka(x, y) ((x) + (y) + 2 * (uint64_t)(uint32_t)(x) * (uint32_t)(y))
+
 #define R(a, b, c, d)                           \
     do {                                        \
-        a = a + b + 2 * (uint32_t)(a) * (uint32_t)(b); \
+        a = fBlaMka(a, b);                      \
         d = rotr64(d ^ a, 32);                  \
-        c = c + d + 2 * (uint32_t)(c) * (uint32_t)(d); \
+        c = fBlaMka(c, d);                      \
         b = rotr64(b ^ c, 24);                  \
-        a = a + b + 2 * (uint32_t)(a) * (uint32_t)(b); \
+        a = fBlaMka(a, b);                      \
         d = rotr64(d ^ a, 16);                  \
-        c = c + d + 2 * (uint32_t)(c) * (uint32_t)(d); \
+        c = fBlaMka(c, d);                      \
         b = rotr64(b ^ c, 63);                  \
     } while (0)
 
-static void fill_block(const block *prev, const block *ref, block *next, int with_xor) {
-    block blockR, blockTmp;
-    copy_block(&blockR, ref);
-    xor_block(&blockR, prev);
-    copy_block(&blockTmp, &blockR);
+/* Row i is qwords 16i..16i+15. */
+#define ROW_ROUND(v)                            \
+    do {                                        \
+        R((v)[0], (v)[4], (v)[8], (v)[12]);             \
+        R((v)[1], (v)[5], (v)[9], (v)[13]);             \
+        R((v)[2], (v)[6], (v)[10], (v)[14]);            \
+        R((v)[3], (v)[7], (v)[11], (v)[15]);            \
+        R((v)[0], (v)[5], (v)[10], (v)[15]);            \
+        R((v)[1], (v)[6], (v)[11], (v)[12]);            \
+        R((v)[2], (v)[7], (v)[8], (v)[13]);             \
+        R((v)[3], (v)[4], (v)[9], (v)[14]);             \
+    } while (0)
+
+/* Column i is qwords (2i, 2i+1) of each of the eight 16-qword rows. */
+#define COL_ROUND(v)                            \
+    do {                                        \
+        R((v)[0], (v)[32], (v)[64], (v)[96]);           \
+        R((v)[1], (v)[33], (v)[65], (v)[97]);           \
+        R((v)[16], (v)[48], (v)[80], (v)[112]);         \
+        R((v)[17], (v)[49], (v)[81], (v)[113]);         \
+        R((v)[0], (v)[33], (v)[80], (v)[113]);          \
+        R((v)[1], (v)[48], (v)[81], (v)[96]);           \
+        R((v)[16], (v)[49], (v)[64], (v)[97]);          \
+        R((v)[17], (v)[32], (v)[65], (v)[112]);         \
+    } while (0)
+
+/*
+ * Single sweep in: R = ref ^ prev goes to the scratch block and R (^ the old
+ * next on later passes) straight into next, so no second temporary is
+ * needed. ref and next may alias; each qword is read before it is written.
+ */
+static inline void fill_block_load(block *R, const block *prev, const block *ref,
+                                   block *next, int with_xor) {
+    if (with_xor) {
+        for (size_t i = 0; i < ARGON2_QWORDS_IN_BLOCK; ++i) {
+            uint64_t r = ref->v[i] ^ prev->v[i];
+            R->v[i] = r;
+            next->v[i] ^= r;
+        }
+    } else {
+        for (size_t i = 0; i < ARGON2_QWORDS_IN_BLOCK; ++i) {
+            uint64_t r = ref->v[i] ^ prev->v[i];
+            R->v[i] = r;
+            next->v[i] = r;
+        }
+    }
+}
+
+/* Single sweep out: next ^= P(R). */
+static inline void fill_block_store(block *next, const block *R) {
+    for (size_t i = 0; i < ARGON2_QWORDS_IN_BLOCK; ++i) {
+        next->v[i] ^= R->v[i];
+    }
+}
 
+void argon2_fill_block_ref(const block *prev, const block *ref, block *next, int with_xor) {
+    block R;
+    fill_block_load(&R, prev, ref, next, with_xor);
+
+    for (size_t i = 0; i < 8; ++i) {
+        ROW_ROUND(R.v + 16 * i);
+    }
     for (size_t i = 0; i < 8; ++i) {
-        uint64_t *v = blockR.v + 16 * i;
-        R(v[0], v[4], v[8], v[12]);
-        R(v[1], v[5], v[9], v[13]);
-        R(v[2], v[6], v[10], v[14]);
-        R(v[3], v[7], v[11], v[15]);
-        R(v[0], v[5], v[10], v[15]);
-        R(v[1], v[6], v[11], v[12]);
-        R(v[2], v[7], v[8], v[13]);
-        R(v[3], v[4], v[9], v[14]);
+        COL_ROUND(R.v + 2 * i);
     }
 
+    fill_block_store(next, &R);
+}
+
+void argon2_fill_block2_ref(const block *prev0, const block *ref0, block *next0,
+                            const block *prev1, const block *ref1, block *next1,
+                            int with_xor) {
+    block R0, R1;
+    fill_block_load(&R0, prev0, ref0, next0, with_xor);
+    fill_block_load(&R1, prev1, ref1, next1, with_xor);
+
     for (size_t i = 0; i < 8; ++i) {
-        uint64_t *v = blockR.v + 2 * i;
-        R(v[0], v[16], v[32], v[48]);
-        R(v[1], v[17], v[33], v[49]);
-        R(v[64], v[80], v[96], v[112]);
-        R(v[65], v[81], v[97], v[113]);
-        R(v[0], v[17], v[32], v[113]);
-        R(v[1], v[16], v[33], v[112]);
-        R(v[64], v[81], v[96], v[49]);
-        R(v[65], v[80], v[97], v[48]);
-    }
-
-    copy_block(next, &blockTmp);
-    xor_block(next, &blockR);
-    if (with_xor) {
-        xor_block(next, prev);
+        ROW_ROUND(R0.v + 16 * i);
+        ROW_ROUND(R1.v + 16 * i);
+    }
+    for (size_t i = 0; i < 8; ++i) {
+        COL_ROUND(R0.v + 2 * i);
+        COL_ROUND(R1.v + 2 * i);
     }
+
+    fill_block_store(next0, &R0);
+    fill_block_store(next1, &R1);
 }
 
-static uint32_t index_alpha(const argon2_instance_t *instance, const argon2_position_t *position,
-                            uint32_t pseudo_rand, int same_lane) {
-    uint32_t reference_area_size;
-    uint32_t relative_position;
+/* ============== KERNEL DISPATCH ============== */
+
+static argon2_kernel requested_kernel = ARGON2_KERNEL_AUTO;
+
+int argon2_kernel_supported(argon2_kernel kernel) {
+    switch (kernel) {
+    case ARGON2_KERNEL_AUTO:
+    case ARGON2_KERNEL_REF:
+        return 1;
+#if defined(ARGON2_HAVE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+    case ARGON2_KERNEL_SSE2:
+        return __builtin_cpu_supports("sse2");
+    case ARGON2_KERNEL_SSSE3:
+        return __builtin_cpu_supports("ssse3");
+    case ARGON2_KERNEL_AVX2:
+        return __builtin_cpu_supports("avx2");
+    case ARGON2_KERNEL_AVX512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+#if defined(ARGON2_HAVE_NEON_KERNEL)
+    case ARGON2_KERNEL_NEON:
+        return 1;
+#endif
+    default:
+        return 0;
+    }
+}
 
-    if (position->pass == 0) {
-        if (position->slice == 0) {
-            reference_area_size = position->index - 1;
-        } else {
-            if (same_lane) {
-                reference_area_size = position->slice * instance->segment_length + position->index - 1;
-            } else {
-                reference_area_size = position->slice * instance->segment_length +
-                                     ((position->index == 0) ? -1 : 0);
-            }
-        }
-    } else {
-        if (same_lane) {
-            reference_area_size = instance->lane_length - instance->segment_length + position->index - 1;
-        } else {
-            reference_area_size = instance->lane_length - instance->segment_length +
-                                 ((position->index == 0) ? -1 : 0);
+const char *argon2_kernel_name(argon2_kernel kernel) {
+    switch (kernel) {
+    case ARGON2_KERNEL_AUTO: return "auto";
+    case ARGON2_KERNEL_REF: return "ref";
+    case ARGON2_KERNEL_SSE2: return "sse2";
+    case ARGON2_KERNEL_SSSE3: return "ssse3";
+    case ARGON2_KERNEL_AVX2: return "avx2";
+    case ARGON2_KERNEL_AVX512: return "avx512";
+    case ARGON2_KERNEL_NEON: return "neon";
+    default: return "unknown";
+    }
+}
+
+int argon2_select_kernel(argon2_kernel kernel) {
+    if (!argon2_kernel_supported(kernel)) {
+        return ARGON2_KERNEL_UNSUPPORTED;
+    }
+    requested_kernel = kernel;
+    return ARGON2_OK;
+}
+
+argon2_kernel argon2_active_kernel(void) {
+    if (requested_kernel != ARGON2_KERNEL_AUTO) {
+        return requested_kernel;
+    }
+    /* Fastest first. */
+    static const argon2_kernel preference[] = {
+        ARGON2_KERNEL_AVX512, ARGON2_KERNEL_AVX2, ARGON2_KERNEL_SSSE3,
+        ARGON2_KERNEL_SSE2, ARGON2_KERNEL_NEON
+    };
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); ++i) {
+        if (argon2_kernel_supported(preference[i])) {
+            return preference[i];
         }
     }
+    return ARGON2_KERNEL_REF;
+}
 
-    uint64_t relative_position64 = pseudo_rand;
-    relative_position64 = (relative_position64 * relative_position64) >> 32;
-    relative_position64 = reference_area_size - 1 -
-                         ((reference_area_size * relative_position64) >> 32);
-    relative_position = (uint32_t)relative_position64;
+argon2_fill_block_fn argon2_fill_block_impl(void) {
+    switch (argon2_active_kernel()) {
+#if defined(ARGON2_HAVE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+    case ARGON2_KERNEL_SSE2: return argon2_fill_block_sse2;
+    case ARGON2_KERNEL_SSSE3: return argon2_fill_block_ssse3;
+    case ARGON2_KERNEL_AVX2: return argon2_fill_block_avx2;
+    case ARGON2_KERNEL_AVX512: return argon2_fill_block_avx512;
+#endif
+#if defined(ARGON2_HAVE_NEON_KERNEL)
+    case ARGON2_KERNEL_NEON: return argon2_fill_block_neon;
+#endif
+    default: return argon2_fill_block_ref;
+    }
+}
 
-    uint32_t start_position = 0;
-    if (position->pass != 0) {
-        start_position = (position->slice == ARGON2_SYNC_POINTS - 1) ? 0 :
-                        (position->slice + 1) * instance->segment_length;
+argon2_fill_block2_fn argon2_fill_block2_impl(void) {
+    switch (argon2_active_kernel()) {
+    case ARGON2_KERNEL_REF: return argon2_fill_block2_ref;
+#if defined(ARGON2_HAVE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+    case ARGON2_KERNEL_AVX2: return argon2_fill_block2_avx2;
+#endif
+#if defined(ARGON2_HAVE_NEON_KERNEL)
+    case ARGON2_KERNEL_NEON: return argon2_fill_block2_neon;
+#endif
+    default: return NULL;
     }
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ARGON2_PREFETCH(p) __builtin_prefetch((p), 0, 3)
+#define ARGON2_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define ARGON2_PREFETCH(p) ((void)(p))
+#define ARGON2_ALWAYS_INLINE inline
+#endif
 
-    return (start_position + relative_position) % instance->lane_length;
+#define ARGON2_CACHE_LINE 64
+
+/*
+ * Pull a whole reference block toward L1. Issuing all sixteen lines at once
+ * lets their misses overlap instead of trickling in as the kernel loads.
+ */
+static inline void prefetch_block(const block *b) {
+    const uint8_t *p = (const uint8_t *)b->v;
+    for (size_t off = 0; off < ARGON2_BLOCK_SIZE; off += ARGON2_CACHE_LINE) {
+        ARGON2_PREFETCH(p + off);
+    }
 }
 
-static void fill_segment(const argon2_instance_t *instance, argon2_position_t position) {
-    block *ref_block = NULL, *curr_block = NULL;
+/*
+ * Walks one segment block by block. Split out of fill_segment so that the
+ * batch path can advance two independent instances in lockstep.
+ *
+ * Everything index_alpha used to branch on per block (pass, slice, lane
+ * wraparound) is folded into area_base/start_position at segment_begin, so
+ * the per-block reference is a multiply, two compares and a conditional
+ * subtract.
+ *
+ * The reference block for index i is resolved one step early: in
+ * data-independent slices the address stream runs ahead of the fill (the
+ * next address block is generated while the current one still has an
+ * entry left), so block i + 1's reference is known and prefetched while
+ * block i is being compressed. In data-dependent slices it is prefetched
+ * as soon as the previous block, which carries pseudo_rand, is written.
+ */
+typedef struct Argon2_segment_t {
+    const argon2_instance_t *instance;
+    block *memory;
+    block *prev, *curr, *next_ref;
+    uint32_t lane;
+    uint32_t lane_length;
+    uint32_t lane_stride;
+    uint32_t lanes;
+    uint32_t area_base;         /* reference area size before index terms */
+    uint32_t start_position;    /* first block of the reference window */
+    int own_lane_only;          /* pass 0, slice 0: never reference other lanes */
     block address_block, input_block, zero_block;
-    int data_independent = (instance->type == Argon2_i) ||
-                          (instance->type == Argon2_id && position.pass == 0 && position.slice < ARGON2_SYNC_POINTS / 2);
+} argon2_segment_t;
 
-    if (data_independent) {
-        memset(zero_block.v, 0, sizeof(zero_block.v));
-        memset(input_block.v, 0, sizeof(input_block.v));
-        input_block.v[0] = position.pass;
-        input_block.v[1] = position.lane;
-        input_block.v[2] = position.slice;
-        input_block.v[3] = instance->memory_blocks;
-        input_block.v[4] = instance->passes;
-        input_block.v[5] = instance->type;
-    }
-
-    uint32_t starting_index = 0;
-    if (position.pass == 0 && position.slice == 0) {
-        starting_index = 2;
-        if (data_independent) {
-            input_block.v[6]++;
-            fill_block(&zero_block, &input_block, &address_block, 0);
-            fill_block(&zero_block, &address_block, &address_block, 0);
+static int segment_data_independent(const argon2_instance_t *instance,
+                                    argon2_position_t position) {
+    return instance->type == Argon2_i ||
+           (instance->type == Argon2_id && position.pass == 0 &&
+            position.slice < ARGON2_SYNC_POINTS / 2);
+}
+
+static void next_addresses(argon2_segment_t *seg) {
+    seg->input_block.v[6]++;
+    seg->instance->fill_block(&seg->zero_block, &seg->input_block, &seg->address_block, 0);
+    seg->instance->fill_block(&seg->zero_block, &seg->address_block, &seg->address_block, 0);
+}
+
+/*
+ * RFC 9106 section 3.4.1.2 mapping from pseudo_rand to a reference block.
+ * single_lane is a compile-time constant in every caller.
+ */
+static ARGON2_ALWAYS_INLINE block *segment_ref(const argon2_segment_t *seg, uint32_t index,
+                                               uint64_t pseudo_rand, const int single_lane) {
+    uint32_t ref_lane = seg->lane;
+    uint32_t area = seg->area_base + index - 1;
+
+    if (!single_lane && !seg->own_lane_only) {
+        ref_lane = (uint32_t)(pseudo_rand >> 32) % seg->lanes;
+        if (ref_lane != seg->lane) {
+            area = seg->area_base - (index == 0);
         }
     }
 
-    uint32_t curr_offset = position.lane * instance->lane_length +
-                          position.slice * instance->segment_length + starting_index;
-    uint32_t prev_offset = curr_offset - 1;
-    if (curr_offset % instance->lane_length == 0) {
-        prev_offset += instance->lane_length;
+    uint64_t x = (uint32_t)pseudo_rand;
+    x = (x * x) >> 32;
+    uint32_t position = seg->start_position + area - 1 - (uint32_t)((area * x) >> 32);
+    if (position >= seg->lane_length) {
+        position -= seg->lane_length;
+    }
+    return seg->memory + (size_t)ref_lane * seg->lane_stride + position;
+}
+
+/* Reference of a data-independent index, generating addresses on demand. */
+static ARGON2_ALWAYS_INLINE block *segment_ref_independent(argon2_segment_t *seg, uint32_t index,
+                                                           const int single_lane) {
+    if (index % ARGON2_QWORDS_IN_BLOCK == 0) {
+        next_addresses(seg);
+    }
+    block *ref = segment_ref(seg, index, seg->address_block.v[index % ARGON2_QWORDS_IN_BLOCK],
+                             single_lane);
+    prefetch_block(ref);
+    return ref;
+}
+
+/* Returns the first index of the segment to fill. */
+static ARGON2_ALWAYS_INLINE uint32_t segment_begin(argon2_segment_t *seg,
+                                                   const argon2_instance_t *instance,
+                                                   argon2_position_t position,
+                                                   const int data_independent,
+                                                   const int single_lane) {
+    uint32_t segment_length = instance->segment_length;
+
+    seg->instance = instance;
+    seg->memory = instance->memory;
+    seg->lane = position.lane;
+    seg->lane_length = instance->lane_length;
+    seg->lane_stride = instance->lane_stride;
+    seg->lanes = instance->lanes;
+    seg->own_lane_only = (position.pass == 0 && position.slice == 0);
+    if (position.pass == 0) {
+        seg->area_base = position.slice * segment_length;
+        seg->start_position = 0;
+    } else {
+        seg->area_base = instance->lane_length - segment_length;
+        seg->start_position = (position.slice == ARGON2_SYNC_POINTS - 1)
+                                  ? 0 : (position.slice + 1) * segment_length;
     }
 
-    for (uint32_t i = starting_index; i < instance->segment_length; ++i, ++curr_offset, ++prev_offset) {
-        if (curr_offset % instance->lane_length == 1) {
-            prev_offset = curr_offset - 1;
+    uint32_t starting_index = seg->own_lane_only ? 2 : 0;
+
+    block *lane_start = instance->memory + (size_t)position.lane * instance->lane_stride;
+    seg->curr = lane_start + position.slice * segment_length + starting_index;
+    seg->prev = (seg->curr == lane_start) ? lane_start + instance->lane_length - 1
+                                          : seg->curr - 1;
+
+    if (data_independent) {
+        memset(seg->zero_block.v, 0, sizeof(seg->zero_block.v));
+        memset(seg->input_block.v, 0, sizeof(seg->input_block.v));
+        seg->input_block.v[0] = position.pass;
+        seg->input_block.v[1] = position.lane;
+        seg->input_block.v[2] = position.slice;
+        seg->input_block.v[3] = instance->memory_blocks;
+        seg->input_block.v[4] = instance->passes;
+        seg->input_block.v[5] = instance->type;
+        if (starting_index % ARGON2_QWORDS_IN_BLOCK != 0) {
+            next_addresses(seg);
         }
+        seg->next_ref = segment_ref_independent(seg, starting_index, single_lane);
+    }
+    return starting_index;
+}
 
-        uint64_t pseudo_rand;
-        if (data_independent) {
-            if (i % ARGON2_QWORDS_IN_BLOCK == 0) {
-                input_block.v[6]++;
-                fill_block(&zero_block, &input_block, &address_block, 0);
-                fill_block(&zero_block, &address_block, &address_block, 0);
-            }
-            pseudo_rand = address_block.v[i % ARGON2_QWORDS_IN_BLOCK];
+/* Resolves prev/ref/curr for index i, then steps to i + 1. */
+static ARGON2_ALWAYS_INLINE void segment_locate(argon2_segment_t *seg, uint32_t i,
+                                                block **prev, block **ref, block **curr,
+                                                const int data_independent,
+                                                const int single_lane) {
+    if (data_independent) {
+        *ref = seg->next_ref;
+        if (i + 1 < seg->instance->segment_length) {
+            seg->next_ref = segment_ref_independent(seg, i + 1, single_lane);
+        }
+    } else {
+        *ref = segment_ref(seg, i, seg->prev->v[0], single_lane);
+        prefetch_block(*ref);
+    }
+
+    *prev = seg->prev;
+    *curr = seg->curr;
+
+    seg->prev = seg->curr;
+    seg->curr++;
+}
+
+static ARGON2_ALWAYS_INLINE void fill_segment_spec(const argon2_instance_t *instance,
+                                                   argon2_position_t position,
+                                                   const int data_independent,
+                                                   const int single_lane) {
+    argon2_segment_t seg;
+    block *prev, *ref, *curr;
+    argon2_fill_block_fn fill_block = instance->fill_block;
+    uint32_t segment_length = instance->segment_length;
+    int with_xor = (position.pass != 0);
+
+    uint32_t i = segment_begin(&seg, instance, position, data_independent, single_lane);
+    for (; i < segment_length; ++i) {
+        segment_locate(&seg, i, &prev, &ref, &curr, data_independent, single_lane);
+        fill_block(prev, ref, curr, with_xor);
+    }
+}
+
+/*
+ * Same segment of two instances with identical geometry, one block of each
+ * per step, so the two-way kernel can overlap their dependency chains.
+ */
+static ARGON2_ALWAYS_INLINE void fill_segment_pair_spec(const argon2_instance_t *a,
+                                                        const argon2_instance_t *b,
+                                                        argon2_position_t position,
+                                                        const int data_independent,
+                                                        const int single_lane) {
+    argon2_segment_t seg_a, seg_b;
+    block *prev_a, *ref_a, *curr_a, *prev_b, *ref_b, *curr_b;
+    uint32_t segment_length = a->segment_length;
+    int with_xor = (position.pass != 0);
+
+    uint32_t i = segment_begin(&seg_a, a, position, data_independent, single_lane);
+    segment_begin(&seg_b, b, position, data_independent, single_lane);
+
+    for (; i < segment_length; ++i) {
+        segment_locate(&seg_a, i, &prev_a, &ref_a, &curr_a, data_independent, single_lane);
+        segment_locate(&seg_b, i, &prev_b, &ref_b, &curr_b, data_independent, single_lane);
+        if (a->fill_block2 != NULL) {
+            a->fill_block2(prev_a, ref_a, curr_a, prev_b, ref_b, curr_b, with_xor);
         } else {
-            pseudo_rand = instance->memory[prev_offset].v[0];
+            a->fill_block(prev_a, ref_a, curr_a, with_xor);
+            a->fill_block(prev_b, ref_b, curr_b, with_xor);
         }
+    }
+}
+
+/*
+ * One copy of the segment loop per (addressing mode, lane count) so that
+ * neither is re-tested per block; lanes == 1 (p = 1) never computes a
+ * reference lane.
+ */
+static void fill_segment_i1(const argon2_instance_t *instance, argon2_position_t position) {
+    fill_segment_spec(instance, position, 1, 1);
+}
+
+static void fill_segment_d1(const argon2_instance_t *instance, argon2_position_t position) {
+    fill_segment_spec(instance, position, 0, 1);
+}
+
+static void fill_segment_in(const argon2_instance_t *instance, argon2_position_t position) {
+    fill_segment_spec(instance, position, 1, 0);
+}
+
+static void fill_segment_dn(const argon2_instance_t *instance, argon2_position_t position) {
+    fill_segment_spec(instance, position, 0, 0);
+}
+
+static void fill_segment(const argon2_instance_t *instance, argon2_position_t position) {
+    int data_independent = segment_data_independent(instance, position);
 
-        uint32_t ref_lane = ((uint32_t)(pseudo_rand >> 32)) % instance->lanes;
-        if (position.pass == 0 && position.slice == 0) {
-            ref_lane = position.lane;
+    if (instance->lanes == 1) {
+        if (data_independent) {
+            fill_segment_i1(instance, position);
+        } else {
+            fill_segment_d1(instance, position);
         }
+    } else if (data_independent) {
+        fill_segment_in(instance, position);
+    } else {
+        fill_segment_dn(instance, position);
+    }
+}
 
-        position.index = i;
-        uint32_t ref_index = index_alpha(instance, &position, (uint32_t)pseudo_rand, ref_lane == position.lane);
-        uint32_t ref_offset = ref_lane * instance->lane_length + ref_index;
+static void fill_segment_pair(const argon2_instance_t *a, const argon2_instance_t *b,
+                              argon2_position_t position) {
+    int data_independent = segment_data_independent(a, position);
 
-        ref_block = instance->memory + ref_offset;
-        curr_block = instance->memory + curr_offset;
-        int with_xor = (position.pass != 0);
-        fill_block(instance->memory + prev_offset, ref_block, curr_block, with_xor);
+    if (a->lanes == 1) {
+        if (data_independent) {
+            fill_segment_pair_spec(a, b, position, 1, 1);
+        } else {
+            fill_segment_pair_spec(a, b, position, 0, 1);
+        }
+    } else if (data_independent) {
+        fill_segment_pair_spec(a, b, position, 1, 0);
+    } else {
+        fill_segment_pair_spec(a, b, position, 0, 0);
     }
 }
 
-static int initialize(argon2_instance_t *instance, const void *pwd, size_t pwdlen,
-                      const void *salt, size_t saltlen) {
-    /* +8: the prehash seed appends a 4-byte block index + 4-byte lane (written at
-     * offsets BLAKE2B_OUTBYTES and +4 below) before blake2b_long reads
-     * BLAKE2B_OUTBYTES + 8 bytes. Declaring only BLAKE2B_OUTBYTES overflows this
-     * stack buffer by 8 bytes -> SIGABRT (__stack_chk_fail) on EVERY Argon2id hash
-     * (e.g. password-protected K2 backup/import). Matches the reference
-     * ARGON2_PREHASH_SEED_LENGTH (= ARGON2_PREHASH_DIGEST_LENGTH + 8). */
-    uint8_t blockhash[BLAKE2B_OUTBYTES + 8];
+/* H0 (RFC 9106 section 3.2): the parameters and inputs hashed into 64 bytes. */
+static void initial_hash(uint8_t *blockhash, const argon2_instance_t *instance,
+                         argon2_context *context) {
     uint8_t value[4];
 
     blake2b_state BlakeHash;
     blake2b_init(&BlakeHash, BLAKE2B_OUTBYTES);
-
     store32(value, instance->lanes);
     blake2b_update(&BlakeHash, value, 4);
-    store32(value, 32);  // hashlen
+    store32(value, context->outlen);
     blake2b_update(&BlakeHash, value, 4);
-    store32(value, instance->memory_blocks);
+    store32(value, context->m_cost);  // requested m, not the rounded m'
     blake2b_update(&BlakeHash, value, 4);
     store32(value, instance->passes);
     blake2b_update(&BlakeHash, value, 4);
@@ -445,60 +637,650 @@ static int initialize(argon2_instance_t *instance, const void *pwd, size_t pwdle
     blake2b_update(&BlakeHash, value, 4);
     store32(value, instance->type);
     blake2b_update(&BlakeHash, value, 4);
-    store32(value, (uint32_t)pwdlen);
+    store32(value, context->pwdlen);
     blake2b_update(&BlakeHash, value, 4);
-    blake2b_update(&BlakeHash, pwd, pwdlen);
-    store32(value, (uint32_t)saltlen);
+    if (context->pwdlen != 0) {
+        blake2b_update(&BlakeHash, context->pwd, context->pwdlen);
+        if (context->flags & ARGON2_FLAG_CLEAR_PASSWORD) {
+            argon2_secure_wipe(context->pwd, context->pwdlen);
+            context->pwdlen = 0;
+        }
+    }
+    store32(value, context->saltlen);
     blake2b_update(&BlakeHash, value, 4);
-    blake2b_update(&BlakeHash, salt, saltlen);
-    store32(value, 0);  // secretlen
+    if (context->saltlen != 0) {
+        blake2b_update(&BlakeHash, context->salt, context->saltlen);
+    }
+    store32(value, context->secretlen);
     blake2b_update(&BlakeHash, value, 4);
-    store32(value, 0);  // adlen
+    if (context->secretlen != 0) {
+        blake2b_update(&BlakeHash, context->secret, context->secretlen);
+        if (context->flags & ARGON2_FLAG_CLEAR_SECRET) {
+            argon2_secure_wipe(context->secret, context->secretlen);
+            context->secretlen = 0;
+        }
+    }
+    store32(value, context->adlen);
     blake2b_update(&BlakeHash, value, 4);
+    if (context->adlen != 0) {
+        blake2b_update(&BlakeHash, context->ad, context->adlen);
+    }
+
+    blake2b_final(&BlakeHash, blockhash, BLAKE2B_OUTBYTES);
+}
+
+/*
+ * Fill blocks 0 and 1 of every lane of count instances (count > 1 for the
+ * batch API): B[l][j] = H'(H0 || j || l), with the 2 * lanes * count H'
+ * calls run ARGON2_BLAKE2B_MAX_WAYS at a time on the multi-buffer kernels.
+ * A lane-local instance gets them in its seeds buffer instead, so that its
+ * lanes stay untouched until their workers fault them in.
+ */
+static int initialize(argon2_instance_t *instances, argon2_context *contexts, size_t count) {
+    uint8_t blockhash[BLAKE2B_OUTBYTES];
+    /* +8: each seed appends a 4-byte block index + 4-byte lane to H0 (at
+     * offsets BLAKE2B_OUTBYTES and +4 below) before blake2b_long reads
+     * BLAKE2B_OUTBYTES + 8 bytes. Declaring only BLAKE2B_OUTBYTES overflows this
+     * stack buffer by 8 bytes -> SIGABRT (__stack_chk_fail) on EVERY Argon2id hash
+     * (e.g. password-protected K2 backup/import). Matches the reference
+     * ARGON2_PREHASH_SEED_LENGTH (= ARGON2_PREHASH_DIGEST_LENGTH + 8). */
+    uint8_t seeds[ARGON2_BLAKE2B_MAX_WAYS][BLAKE2B_OUTBYTES + 8];
+    const uint8_t *in[ARGON2_BLAKE2B_MAX_WAYS];
+    uint8_t *out[ARGON2_BLAKE2B_MAX_WAYS];
+    size_t n = 0;
+
+    for (size_t k = 0; k < count; ++k) {
+        const argon2_instance_t *instance = &instances[k];
+        initial_hash(blockhash, instance, &contexts[k]);
+
+        for (uint32_t l = 0; l < instance->lanes; ++l) {
+            for (uint32_t j = 0; j < 2; ++j) {
+                memcpy(seeds[n], blockhash, BLAKE2B_OUTBYTES);
+                store32(seeds[n] + BLAKE2B_OUTBYTES, j);
+                store32(seeds[n] + BLAKE2B_OUTBYTES + 4, l);
+                in[n] = seeds[n];
+                out[n] = instance->seeds != NULL
+                             ? (uint8_t *)instance->seeds[2 * (size_t)l + j].v
+                             : (uint8_t *)instance->memory[(size_t)l * instance->lane_stride + j].v;
+                if (++n == ARGON2_BLAKE2B_MAX_WAYS) {
+                    blake2b_long_many(out, ARGON2_BLOCK_SIZE, in, sizeof(seeds[0]), n);
+                    n = 0;
+                }
+            }
+        }
+    }
+    if (n != 0) {
+        blake2b_long_many(out, ARGON2_BLOCK_SIZE, in, sizeof(seeds[0]), n);
+    }
+
+    argon2_secure_wipe(blockhash, sizeof(blockhash));
+    argon2_secure_wipe(seeds, sizeof(seeds));
+    return ARGON2_OK;
+}
+
+/* Tag of count <= 2 instances (a batch pair), hashed side by side. */
+static void finalize(const argon2_instance_t *instances, uint8_t *const *out, size_t outlen,
+                     size_t count) {
+    block blockhash[2];
+    const uint8_t *in[2];
+
+    for (size_t k = 0; k < count; ++k) {
+        const argon2_instance_t *instance = &instances[k];
+        copy_block(&blockhash[k], instance->memory + instance->lane_length - 1);
+
+        for (uint32_t l = 1; l < instance->lanes; ++l) {
+            xor_block(&blockhash[k], instance->memory + (size_t)l * instance->lane_stride +
+                                         instance->lane_length - 1);
+        }
+        in[k] = (const uint8_t *)blockhash[k].v;
+    }
+
+    blake2b_long_many(out, outlen, in, ARGON2_BLOCK_SIZE, count);
+    argon2_secure_wipe(blockhash, sizeof(blockhash));
+}
 
-    blake2b_final(&BlakeHash, blockhash);
+/* ============== LANE SCHEDULING ============== */
 
-    uint8_t blockhash_bytes[ARGON2_BLOCK_SIZE];
-    for (uint32_t l = 0; l < instance->lanes; ++l) {
-        store32(blockhash + BLAKE2B_OUTBYTES, 0);
-        store32(blockhash + BLAKE2B_OUTBYTES + 4, l);
-        blake2b_long(blockhash_bytes, ARGON2_BLOCK_SIZE, blockhash, BLAKE2B_OUTBYTES + 8);
-        memcpy(instance->memory[l * instance->lane_length].v, blockhash_bytes, ARGON2_BLOCK_SIZE);
+#ifndef ARGON2_DEFAULT_THREAD_LIMIT
+#define ARGON2_DEFAULT_THREAD_LIMIT 4
+#endif
 
-        store32(blockhash + BLAKE2B_OUTBYTES, 1);
-        blake2b_long(blockhash_bytes, ARGON2_BLOCK_SIZE, blockhash, BLAKE2B_OUTBYTES + 8);
-        memcpy(instance->memory[l * instance->lane_length + 1].v, blockhash_bytes, ARGON2_BLOCK_SIZE);
+static uint32_t thread_limit = ARGON2_DEFAULT_THREAD_LIMIT;
+
+void argon2_set_thread_limit(uint32_t max_threads) {
+    thread_limit = max_threads;
+}
+
+uint32_t argon2_thread_limit(void) {
+    return thread_limit;
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ARGON2_ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define ARGON2_ATOMIC_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#else
+#define ARGON2_ATOMIC_LOAD(p) (*(volatile const int *)(p))
+#define ARGON2_ATOMIC_STORE(p, v) (*(volatile int *)(p) = (v))
+#endif
+
+uint64_t argon2_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * Slice timing for argon2_stats. A slice that spans several argon2_step
+ * calls is charged only the time spent inside them: carry holds what the
+ * earlier steps spent on it.
+ */
+typedef struct {
+    argon2_stats *stats;
+    uint64_t mark;                  /* last slice boundary or step start */
+    uint64_t carry;
+} slice_timer_t;
+
+static void slice_timed(slice_timer_t *timer, uint32_t slice) {
+    uint64_t now = argon2_now_ns();
+    uint64_t elapsed = now - timer->mark + timer->carry;
+    uint32_t pass = slice / ARGON2_SYNC_POINTS;
+
+    timer->mark = now;
+    timer->carry = 0;
+    if (pass >= ARGON2_STATS_MAX_PASSES) {
+        pass = ARGON2_STATS_MAX_PASSES - 1;
+    }
+    timer->stats->pass_ns[pass] += elapsed;
+    timer->stats->slice_ns[slice % ARGON2_SYNC_POINTS] += elapsed;
+    timer->stats->fill_ns += elapsed;
+}
+
+/*
+ * Cancellation, progress and timing for one run of slices. All are looked
+ * at only between slices, so a cancel takes effect within one slice (~1/4
+ * of a pass) and none of them costs anything per block.
+ */
+typedef struct {
+    const int *cancel;              /* non-zero stops at the next slice boundary */
+    argon2_progress_fn progress;    /* may be NULL */
+    void *progress_user;
+    uint32_t segments_total;
+    slice_timer_t *timer;           /* NULL unless stats were requested */
+    int prepare;                    /* lane-local lanes not yet seeded */
+} slice_control_t;
+
+#if defined(__linux__) && !defined(__ANDROID__) && defined(SYS_mbind)
+#define ARGON2_HAVE_MBIND 1
+#define ARGON2_MPOL_LOCAL 4         /* <linux/mempolicy.h> */
+#endif
+
+/*
+ * Hand a lane-local lane to the thread that will fill it: bind its range
+ * to whichever node touches it (the default policy does that already, but
+ * a process started under numactl --interleave would not get it) and move
+ * its two seed blocks in. Pass 0 then writes the rest front to back from
+ * this same thread, so every page of the lane is first touched, and so
+ * placed, by its own worker.
+ */
+static void lane_prepare(const argon2_instance_t *instance, uint32_t lane) {
+    block *start = instance->memory + (size_t)lane * instance->lane_stride;
+    block *seeds = instance->seeds + 2 * (size_t)lane;
+
+#if defined(ARGON2_HAVE_MBIND)
+    (void)syscall(SYS_mbind, start, (size_t)instance->lane_length * sizeof(block),
+                  ARGON2_MPOL_LOCAL, NULL, 0UL, 0U);
+#endif
+    copy_block(&start[0], &seeds[0]);
+    copy_block(&start[1], &seeds[1]);
+    argon2_secure_wipe(seeds, 2 * sizeof(block));
+}
+
+/* Slice index s counts across passes: pass s / 4, slice s % 4. */
+static void report_slice(const argon2_instance_t *instance, const slice_control_t *control,
+                         uint32_t slices_done) {
+    if (control->timer != NULL) {
+        slice_timed(control->timer, slices_done - 1);
+    }
+    if (control->progress != NULL) {
+        control->progress(slices_done * instance->lanes, control->segments_total,
+                          control->progress_user);
+    }
+}
+
+/* argon2_stats.threads: the fewest threads any run of slices had. */
+static void note_threads(const slice_control_t *control, uint32_t threads) {
+    if (control->timer != NULL) {
+        argon2_stats *stats = control->timer->stats;
+        if (stats->threads == 0 || threads < stats->threads) {
+            stats->threads = threads;
+        }
+    }
+}
+
+static uint32_t fill_slices_serial(const argon2_instance_t *instance, uint32_t first,
+                                   uint32_t count, const slice_control_t *control) {
+    uint32_t s = first;
+    note_threads(control, 1);
+    if (control->prepare) {
+        for (uint32_t lane = 0; lane < instance->lanes; ++lane) {
+            lane_prepare(instance, lane);
+        }
+    }
+    for (; s < first + count; ++s) {
+        if (ARGON2_ATOMIC_LOAD(control->cancel)) {
+            break;
+        }
+        for (uint32_t lane = 0; lane < instance->lanes; ++lane) {
+            argon2_position_t position = {s / ARGON2_SYNC_POINTS, lane, s % ARGON2_SYNC_POINTS, 0};
+            fill_segment(instance, position);
+        }
+        report_slice(instance, control, s + 1);
+    }
+    return s - first;
+}
+
+#ifndef ARGON2_NO_THREADS
+
+/*
+ * Workers stay alive for the whole run and meet at a barrier after every
+ * slice (pthread_barrier_t is not available on Apple platforms). Worker w
+ * fills lanes w, w + threads, ... so p may exceed the thread count. The
+ * last worker to reach the barrier samples the cancel flag for everyone,
+ * so all of them stop after the same slice.
+ */
+typedef struct {
+    const argon2_instance_t *instance;
+    const slice_control_t *control;
+    uint32_t first;
+    uint32_t count;
+    uint32_t completed;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    uint32_t threads;
+    uint32_t arrived;
+    uint32_t generation;
+    int started;
+    int stop;
+} lane_sync_t;
+
+typedef struct {
+    lane_sync_t *sync;
+    uint32_t id;
+} lane_worker_t;
+
+/* Returns non-zero if the run was cancelled during this slice. */
+static int lane_sync_wait(lane_sync_t *sync) {
+    pthread_mutex_lock(&sync->mutex);
+    uint32_t generation = sync->generation;
+    if (++sync->arrived == sync->threads) {
+        sync->arrived = 0;
+        sync->generation++;
+        sync->stop = ARGON2_ATOMIC_LOAD(sync->control->cancel);
+        pthread_cond_broadcast(&sync->cond);
+    } else {
+        while (generation == sync->generation) {
+            pthread_cond_wait(&sync->cond, &sync->mutex);
+        }
+    }
+    int stop = sync->stop;
+    pthread_mutex_unlock(&sync->mutex);
+    return stop;
+}
+
+static void *lane_worker(void *arg) {
+    lane_worker_t *worker = (lane_worker_t *)arg;
+    lane_sync_t *sync = worker->sync;
+    const argon2_instance_t *instance = sync->instance;
+
+    /* The thread count is final only once every spawn attempt has returned. */
+    pthread_mutex_lock(&sync->mutex);
+    while (!sync->started) {
+        pthread_cond_wait(&sync->cond, &sync->mutex);
+    }
+    uint32_t threads = sync->threads;
+    pthread_mutex_unlock(&sync->mutex);
+
+    /* Slice 0 reads only its own lane, so the barrier after it is early enough. */
+    if (sync->control->prepare) {
+        for (uint32_t lane = worker->id; lane < instance->lanes; lane += threads) {
+            lane_prepare(instance, lane);
+        }
+    }
+
+    for (uint32_t s = sync->first; s < sync->first + sync->count; ++s) {
+        for (uint32_t lane = worker->id; lane < instance->lanes; lane += threads) {
+            argon2_position_t position = {s / ARGON2_SYNC_POINTS, lane, s % ARGON2_SYNC_POINTS, 0};
+            fill_segment(instance, position);
+        }
+        int stop = lane_sync_wait(sync);
+        if (worker->id == 0) {
+            sync->completed = s + 1 - sync->first;
+            report_slice(instance, sync->control, s + 1);
+        }
+        if (stop) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static uint32_t fill_slices_threaded(const argon2_instance_t *instance, uint32_t first,
+                                     uint32_t count, const slice_control_t *control) {
+    lane_sync_t sync;
+    lane_worker_t workers[ARGON2_MAX_THREADS];
+    pthread_t handles[ARGON2_MAX_THREADS];
+    uint32_t spawned = 0;
+
+    if (ARGON2_ATOMIC_LOAD(control->cancel)) {
+        return 0;
+    }
+
+    sync.instance = instance;
+    sync.control = control;
+    sync.first = first;
+    sync.count = count;
+    sync.completed = 0;
+    sync.arrived = 0;
+    sync.generation = 0;
+    sync.started = 0;
+    sync.threads = 0;
+    sync.stop = 0;
+    if (pthread_mutex_init(&sync.mutex, NULL) != 0) {
+        return fill_slices_serial(instance, first, count, control);
+    }
+    if (pthread_cond_init(&sync.cond, NULL) != 0) {
+        pthread_mutex_destroy(&sync.mutex);
+        return fill_slices_serial(instance, first, count, control);
     }
 
-    memset(blockhash, 0, sizeof(blockhash));
+    /* The calling thread is worker 0; a failed spawn just means fewer workers. */
+    for (uint32_t id = 1; id < instance->threads; ++id) {
+        workers[id].sync = &sync;
+        workers[id].id = id;
+        if (pthread_create(&handles[id], NULL, lane_worker, &workers[id]) != 0) {
+            break;
+        }
+        spawned++;
+    }
+
+    pthread_mutex_lock(&sync.mutex);
+    sync.threads = spawned + 1;
+    sync.started = 1;
+    pthread_cond_broadcast(&sync.cond);
+    pthread_mutex_unlock(&sync.mutex);
+    note_threads(control, sync.threads);
+
+    workers[0].sync = &sync;
+    workers[0].id = 0;
+    lane_worker(&workers[0]);
+
+    for (uint32_t id = 1; id <= spawned; ++id) {
+        pthread_join(handles[id], NULL);
+    }
+    pthread_cond_destroy(&sync.cond);
+    pthread_mutex_destroy(&sync.mutex);
+    return sync.completed;
+}
+
+#endif /* ARGON2_NO_THREADS */
+
+/* Fills count whole slices starting at first; returns how many completed. */
+static uint32_t fill_slices(const argon2_instance_t *instance, uint32_t first, uint32_t count,
+                            const slice_control_t *control) {
+#ifndef ARGON2_NO_THREADS
+    if (instance->threads > 1) {
+        return fill_slices_threaded(instance, first, count, control);
+    }
+#endif
+    return fill_slices_serial(instance, first, count, control);
+}
+
+/* ============== MEMORY ============== */
+
+#define ARGON2_MEMORY_ALIGNMENT 64
+#define ARGON2_HUGEPAGE_SIZE (2u * 1024 * 1024)
+
+/* memset through a volatile pointer so wipes of dead buffers survive -O2. */
+static void *(*const volatile memset_sec)(void *, int, size_t) = &memset;
+
+void argon2_secure_wipe(void *v, size_t n) {
+    if (v != NULL && n != 0) {
+        memset_sec(v, 0, n);
+    }
+}
+
+struct Argon2_arena {
+    block *memory;
+    size_t capacity;  /* bytes reserved */
+    size_t used;      /* high-water mark of bytes holding hash state */
+    uint32_t flags;
+    int locked;
+};
+
+/*
+ * Blocks need no zeroing: pass 0 writes every block before anything reads
+ * it, so plain aligned allocation replaces the old calloc.
+ */
+static block *memory_alloc(size_t bytes, uint32_t flags) {
+    size_t alignment = ARGON2_MEMORY_ALIGNMENT;
+    void *memory = NULL;
+
+#if defined(MADV_HUGEPAGE)
+    if (flags & ARGON2_ARENA_HUGEPAGES) {
+        alignment = ARGON2_HUGEPAGE_SIZE;
+    }
+#endif
+    if (posix_memalign(&memory, alignment, bytes) != 0) {
+        return NULL;
+    }
+#if defined(MADV_HUGEPAGE)
+    if (flags & ARGON2_ARENA_HUGEPAGES) {
+        /* Advisory: THP may be disabled system-wide. */
+        (void)madvise(memory, bytes, MADV_HUGEPAGE);
+    }
+#else
+    (void)flags;
+#endif
+    return (block *)memory;
+}
+
+static size_t arena_round_size(size_t bytes, uint32_t flags) {
+    /* Near SIZE_MAX the allocation fails anyway; don't let rounding wrap it small. */
+    if ((flags & ARGON2_ARENA_HUGEPAGES) && bytes <= SIZE_MAX - (ARGON2_HUGEPAGE_SIZE - 1)) {
+        return (bytes + ARGON2_HUGEPAGE_SIZE - 1) & ~(size_t)(ARGON2_HUGEPAGE_SIZE - 1);
+    }
+    return bytes;
+}
+
+static void arena_release_memory(argon2_arena *arena) {
+    if (arena->memory == NULL) {
+        return;
+    }
+    argon2_secure_wipe(arena->memory, arena->used);
+    if (arena->locked) {
+        munlock(arena->memory, arena->capacity);
+        arena->locked = 0;
+    }
+    free(arena->memory);
+    arena->memory = NULL;
+    arena->capacity = 0;
+    arena->used = 0;
+}
+
+static int arena_reserve(argon2_arena *arena, size_t bytes) {
+    if (arena->memory != NULL && arena->capacity >= bytes) {
+        return ARGON2_OK;
+    }
+    arena_release_memory(arena);
+
+    size_t capacity = arena_round_size(bytes, arena->flags);
+    arena->memory = memory_alloc(capacity, arena->flags);
+    if (arena->memory == NULL) {
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+    arena->capacity = capacity;
+    if (arena->flags & ARGON2_ARENA_LOCK) {
+        /* Best effort: RLIMIT_MEMLOCK is small on most systems. */
+        arena->locked = (mlock(arena->memory, capacity) == 0);
+    }
+    return ARGON2_OK;
+}
+
+int argon2_arena_create(argon2_arena **arena, uint32_t m_cost, uint32_t flags) {
+    if (arena == NULL) {
+        return ARGON2_OUTPUT_PTR_NULL;
+    }
+    *arena = NULL;
+    if (m_cost > ARGON2_MAX_MEMORY) {
+        return ARGON2_MEMORY_TOO_MUCH;
+    }
+
+    argon2_arena *a = (argon2_arena *)calloc(1, sizeof(*a));
+    if (a == NULL) {
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+    a->flags = flags;
+    if (m_cost != 0) {
+        int result = arena_reserve(a, (size_t)m_cost * sizeof(block));
+        if (result != ARGON2_OK) {
+            free(a);
+            return result;
+        }
+    }
+    *arena = a;
     return ARGON2_OK;
 }
 
-static void finalize(const argon2_instance_t *instance, void *out, size_t outlen) {
-    block blockhash;
-    copy_block(&blockhash, instance->memory + instance->lane_length - 1);
+void argon2_arena_wipe(argon2_arena *arena) {
+    if (arena != NULL && arena->memory != NULL) {
+        argon2_secure_wipe(arena->memory, arena->used);
+        arena->used = 0;
+    }
+}
 
-    for (uint32_t l = 1; l < instance->lanes; ++l) {
-        xor_block(&blockhash, instance->memory + l * instance->lane_length + instance->lane_length - 1);
+void argon2_arena_destroy(argon2_arena *arena) {
+    if (arena == NULL) {
+        return;
     }
+    arena_release_memory(arena);
+    free(arena);
+}
 
-    blake2b_long(out, outlen, blockhash.v, ARGON2_BLOCK_SIZE);
-    memset(blockhash.v, 0, sizeof(blockhash.v));
+size_t argon2_arena_capacity(const argon2_arena *arena) {
+    return arena != NULL ? arena->capacity : 0;
 }
 
-/* ============== ARGON2ID API ============== */
+/*
+ * Hand out the block matrix for one hash. With an arena, state left by a
+ * previous larger hash that this one will not overwrite is wiped now.
+ */
+static int memory_acquire(argon2_arena *arena, argon2_instance_t *instance) {
+    size_t bytes = (size_t)instance->memory_blocks * sizeof(block);
 
-int argon2id_hash_raw(const uint32_t t_cost, const uint32_t m_cost,
-                      const uint32_t parallelism, const void *pwd,
-                      const size_t pwdlen, const void *salt,
-                      const size_t saltlen, void *hash,
-                      const size_t hashlen) {
-    if (hash == NULL) return ARGON2_OUTPUT_PTR_NULL;
-    if (hashlen < 4) return ARGON2_OUTPUT_TOO_SHORT;
-    if (saltlen < 8) return ARGON2_SALT_TOO_SHORT;
+    if (arena == NULL) {
+        instance->memory = memory_alloc(bytes, 0);
+        return instance->memory != NULL ? ARGON2_OK : ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+
+    int result = arena_reserve(arena, bytes);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+    if (arena->used > bytes) {
+        argon2_secure_wipe((uint8_t *)arena->memory + bytes, arena->used - bytes);
+    }
+    arena->used = bytes;
+    instance->memory = arena->memory;
+    return ARGON2_OK;
+}
+
+/*
+ * ARGON2_FLAG_LANE_LOCAL layout: every lane starts on its own page - its
+ * own 2 MiB huge page once a lane is that large - in a fresh anonymous
+ * mapping that nothing has touched, so lanes share no page or huge-page
+ * TLB entry and each is faulted in by its own worker (see lane_prepare).
+ * Blocks 0 and 1 wait in instance->seeds until then.
+ */
+static int memory_acquire_lanes(argon2_instance_t *instance) {
+    long page = sysconf(_SC_PAGESIZE);
+    size_t alignment = page > 0 ? (size_t)page : 4096;
+    size_t lane_bytes = (size_t)instance->lane_length * sizeof(block);
+
+#if defined(MADV_HUGEPAGE)
+    if (lane_bytes >= ARGON2_HUGEPAGE_SIZE) {
+        alignment = ARGON2_HUGEPAGE_SIZE;
+    }
+#endif
+    size_t stride = (lane_bytes + alignment - 1) & ~(alignment - 1);
+    size_t bytes = stride * instance->lanes;
+    if (stride / sizeof(block) > UINT32_MAX || bytes / instance->lanes != stride ||
+        bytes > SIZE_MAX - alignment) {
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+
+    instance->seeds = (block *)malloc(2 * (size_t)instance->lanes * sizeof(block));
+    if (instance->seeds == NULL) {
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+    /* Over-map by one alignment unit and trim, for the huge-page case. */
+    uint8_t *mapping = (uint8_t *)mmap(NULL, bytes + alignment, PROT_READ | PROT_WRITE,
+                                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == (uint8_t *)MAP_FAILED) {
+        free(instance->seeds);
+        instance->seeds = NULL;
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+    size_t head = (alignment - (uintptr_t)mapping % alignment) % alignment;
+    if (head != 0) {
+        munmap(mapping, head);
+    }
+    munmap(mapping + head + bytes, alignment - head);
+#if defined(MADV_HUGEPAGE)
+    if (alignment == ARGON2_HUGEPAGE_SIZE) {
+        (void)madvise(mapping + head, bytes, MADV_HUGEPAGE);
+    }
+#endif
+
+    instance->memory = (block *)(mapping + head);
+    instance->mapped_bytes = bytes;
+    instance->lane_stride = (uint32_t)(stride / sizeof(block));
+    return ARGON2_OK;
+}
+
+static void memory_release(argon2_arena *arena, argon2_instance_t *instance) {
+    if (instance->mapped_bytes != 0) {
+        for (uint32_t l = 0; l < instance->lanes; ++l) {
+            argon2_secure_wipe(instance->memory + (size_t)l * instance->lane_stride,
+                               (size_t)instance->lane_length * sizeof(block));
+        }
+        munmap(instance->memory, instance->mapped_bytes);
+        argon2_secure_wipe(instance->seeds, 2 * (size_t)instance->lanes * sizeof(block));
+        free(instance->seeds);
+        instance->seeds = NULL;
+        instance->mapped_bytes = 0;
+    } else if (arena == NULL) {
+        argon2_secure_wipe(instance->memory, (size_t)instance->memory_blocks * sizeof(block));
+        free(instance->memory);
+    }
+    /* Arena memory is wiped on reuse, argon2_arena_wipe() or destroy. */
+    instance->memory = NULL;
+}
+
+/* ============== CONTEXT API ============== */
+
+/* Validates the cost parameters and derives the matrix geometry. */
+static int instance_setup(argon2_instance_t *instance, uint32_t t_cost, uint32_t m_cost,
+                          uint32_t parallelism, argon2_type type) {
     if (t_cost < 1) return ARGON2_TIME_TOO_SMALL;
-    if (m_cost < 8 * parallelism) return ARGON2_MEMORY_TOO_LITTLE;
     if (parallelism < 1) return ARGON2_LANES_TOO_FEW;
+    if (parallelism > ARGON2_MAX_LANES) return ARGON2_LANES_TOO_MANY;
+    /* Segments are counted in a uint32_t (argon2_step, stats). */
+    if ((uint64_t)t_cost * ARGON2_SYNC_POINTS * parallelism > UINT32_MAX) {
+        return ARGON2_TIME_TOO_LARGE;
+    }
+    if (m_cost < 8 * parallelism) return ARGON2_MEMORY_TOO_LITTLE;
+    if (m_cost > ARGON2_MAX_MEMORY) return ARGON2_MEMORY_TOO_MUCH;
+    if (type != Argon2_d && type != Argon2_i && type != Argon2_id) return ARGON2_INCORRECT_TYPE;
 
     uint32_t memory_blocks = m_cost;
     if (memory_blocks < 2 * ARGON2_SYNC_POINTS * parallelism) {
@@ -507,40 +1289,559 @@ int argon2id_hash_raw(const uint32_t t_cost, const uint32_t m_cost,
     uint32_t segment_length = memory_blocks / (parallelism * ARGON2_SYNC_POINTS);
     memory_blocks = segment_length * parallelism * ARGON2_SYNC_POINTS;
 
+    instance->memory = NULL;
+    instance->seeds = NULL;
+    instance->mapped_bytes = 0;
+    instance->fill_block = argon2_fill_block_impl();
+    instance->fill_block2 = argon2_fill_block2_impl();
+    instance->passes = t_cost;
+    instance->memory_blocks = memory_blocks;
+    instance->segment_length = segment_length;
+    instance->lane_length = segment_length * ARGON2_SYNC_POINTS;
+    instance->lane_stride = instance->lane_length;
+    instance->lanes = parallelism;
+    instance->threads = parallelism;
+    if (thread_limit != 0 && instance->threads > thread_limit) {
+        instance->threads = thread_limit;
+    }
+    if (instance->threads > ARGON2_MAX_THREADS) {
+        instance->threads = ARGON2_MAX_THREADS;
+    }
+    instance->type = type;
+    instance->version = ARGON2_VERSION_NUMBER;
+    return ARGON2_OK;
+}
+
+/* Checks everything initialize() reads apart from the cost parameters. */
+static int validate_context(const argon2_context *context) {
+    if (context->out == NULL) return ARGON2_OUTPUT_PTR_NULL;
+    if (context->outlen < 4) return ARGON2_OUTPUT_TOO_SHORT;
+    if (context->pwd == NULL && context->pwdlen != 0) return ARGON2_PWD_PTR_MISMATCH;
+    if (context->salt == NULL && context->saltlen != 0) return ARGON2_SALT_PTR_MISMATCH;
+    if (context->saltlen < 8) return ARGON2_SALT_TOO_SHORT;
+    if (context->secret == NULL && context->secretlen != 0) return ARGON2_SECRET_PTR_MISMATCH;
+    if (context->ad == NULL && context->adlen != 0) return ARGON2_AD_PTR_MISMATCH;
+    if (context->version != ARGON2_VERSION_NUMBER) return ARGON2_INCORRECT_PARAMETER;
+    return ARGON2_OK;
+}
+
+int argon2_check_context(const argon2_context *context, argon2_type type) {
     argon2_instance_t instance;
-    instance.memory = NULL;
-    instance.passes = t_cost;
-    instance.memory_blocks = memory_blocks;
-    instance.segment_length = segment_length;
-    instance.lane_length = segment_length * ARGON2_SYNC_POINTS;
-    instance.lanes = parallelism;
-    instance.type = Argon2_id;
-    instance.version = ARGON2_VERSION_NUMBER;
-
-    instance.memory = (block *)calloc(memory_blocks, sizeof(block));
-    if (instance.memory == NULL) {
+
+    if (context == NULL) return ARGON2_INCORRECT_PARAMETER;
+    int result = validate_context(context);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+    return instance_setup(&instance, context->t_cost, context->m_cost, context->lanes, type);
+}
+
+/*
+ * A hash in progress. The one-shot calls keep it on the stack; the
+ * init/step/finish API hands out a heap copy. Only out/outlen are kept
+ * from the context, so the caller's context need not outlive init.
+ */
+struct Argon2_state {
+    argon2_instance_t instance;
+    argon2_arena *arena;
+    uint8_t *out;
+    uint32_t outlen;
+    uint32_t next_segment;      /* slice * lanes + lane of the next segment to fill */
+    uint32_t total_segments;
+    int cancelled;
+    int lanes_pending;          /* lane-local lanes not yet seeded */
+    argon2_progress_fn progress;
+    void *progress_user;
+    slice_timer_t timer;        /* timer.stats is NULL unless requested */
+    uint64_t started;
+    int64_t minor_faults;       /* counts at init, for the deltas */
+    int64_t major_faults;
+};
+
+/* Process-wide page-fault counts, -1 if unavailable. */
+static void fault_counts(int64_t *minor, int64_t *major) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        *minor = (int64_t)usage.ru_minflt;
+        *major = (int64_t)usage.ru_majflt;
+    } else {
+        *minor = -1;
+        *major = -1;
+    }
+}
+
+static int state_begin(argon2_state *state, argon2_arena *arena, argon2_context *context,
+                       argon2_type type) {
+    argon2_instance_t *instance = &state->instance;
+
+    if (context == NULL) return ARGON2_INCORRECT_PARAMETER;
+    int result = validate_context(context);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+    result = instance_setup(instance, context->t_cost, context->m_cost, context->lanes, type);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+    if (context->threads != 0 && instance->threads > context->threads) {
+        instance->threads = context->threads;
+    }
+
+    state->arena = arena;
+    state->out = context->out;
+    state->outlen = context->outlen;
+    state->next_segment = 0;
+    state->total_segments = instance->passes * ARGON2_SYNC_POINTS * instance->lanes;
+    state->cancelled = 0;
+    state->lanes_pending = 0;
+    state->progress = NULL;
+    state->progress_user = NULL;
+    state->timer.stats = context->stats;
+    state->timer.carry = 0;
+
+    argon2_stats *stats = context->stats;
+    uint64_t t0 = 0, t1 = 0;
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(*stats));
+        stats->kernel = argon2_active_kernel();
+        fault_counts(&state->minor_faults, &state->major_faults);
+        t0 = state->started = argon2_now_ns();
+    }
+
+    /* An arena's memory is already resident, so the layout flag passes it by. */
+    if ((context->flags & ARGON2_FLAG_LANE_LOCAL) && arena == NULL) {
+        result = memory_acquire_lanes(instance);
+        state->lanes_pending = 1;
+    } else {
+        result = memory_acquire(arena, instance);
+    }
+    if (result != ARGON2_OK) {
+        return result;
+    }
+    if (stats != NULL) {
+        t1 = argon2_now_ns();
+        stats->alloc_ns = t1 - t0;
+    }
+
+    result = initialize(instance, context, 1);
+    if (result != ARGON2_OK) {
+        memory_release(arena, instance);
+        return result;
+    }
+    if (stats != NULL) {
+        stats->init_ns = argon2_now_ns() - t1;
+    }
+    return ARGON2_OK;
+}
+
+/*
+ * Fill up to max_segments segments (0 = all remaining). Whole slices go
+ * through fill_slices and so use the worker threads; a step that starts or
+ * ends mid-slice fills those segments on the calling thread.
+ */
+static int state_run(argon2_state *state, uint32_t max_segments) {
+    const argon2_instance_t *instance = &state->instance;
+    uint32_t lanes = instance->lanes;
+    uint32_t budget = state->total_segments - state->next_segment;
+    slice_control_t control;
+
+    if (max_segments != 0 && max_segments < budget) {
+        budget = max_segments;
+    }
+    control.cancel = &state->cancelled;
+    control.progress = state->progress;
+    control.progress_user = state->progress_user;
+    control.segments_total = state->total_segments;
+    control.timer = NULL;
+    control.prepare = state->lanes_pending;
+    if (state->timer.stats != NULL) {
+        control.timer = &state->timer;
+        state->timer.mark = argon2_now_ns();
+    }
+
+    while (budget > 0 && !ARGON2_ATOMIC_LOAD(&state->cancelled)) {
+        uint32_t slice = state->next_segment / lanes;
+        uint32_t lane = state->next_segment % lanes;
+
+        if (lane == 0 && budget >= lanes) {
+            uint32_t done = fill_slices(instance, slice, budget / lanes, &control);
+            control.prepare = 0;
+            state->next_segment += done * lanes;
+            budget -= done * lanes;
+            if (done == 0) {
+                break;
+            }
+            continue;
+        }
+
+        if (control.prepare) {
+            for (uint32_t l = 0; l < lanes; ++l) {
+                lane_prepare(instance, l);
+            }
+            control.prepare = 0;
+        }
+        note_threads(&control, 1);
+        argon2_position_t position = {slice / ARGON2_SYNC_POINTS, lane, slice % ARGON2_SYNC_POINTS, 0};
+        fill_segment(instance, position);
+        state->next_segment++;
+        budget--;
+        if (state->next_segment % lanes == 0) {
+            report_slice(instance, &control, state->next_segment / lanes);
+        }
+    }
+
+    state->lanes_pending = control.prepare;
+    if (control.timer != NULL) {
+        state->timer.carry += argon2_now_ns() - state->timer.mark;
+    }
+    if (ARGON2_ATOMIC_LOAD(&state->cancelled)) {
+        return ARGON2_CANCELLED;
+    }
+    return state->next_segment == state->total_segments ? ARGON2_OK : ARGON2_PENDING;
+}
+
+static void stats_finish(argon2_state *state, uint64_t t0, uint64_t t1) {
+    const argon2_instance_t *instance = &state->instance;
+    argon2_stats *stats = state->timer.stats;
+    uint64_t t2 = argon2_now_ns();
+    int64_t minor, major;
+
+    stats->finalize_ns = t1 - t0;
+    stats->wipe_ns = t2 - t1;
+    stats->total_ns = t2 - state->started;
+    stats->blocks = (uint64_t)state->next_segment * instance->segment_length;
+    stats->passes = state->next_segment / (ARGON2_SYNC_POINTS * instance->lanes);
+    if (stats->fill_ns != 0) {
+        stats->blocks_per_second = (double)stats->blocks * 1e9 / (double)stats->fill_ns;
+    }
+    fault_counts(&minor, &major);
+    stats->minor_faults = minor >= 0 && state->minor_faults >= 0 ? minor - state->minor_faults : -1;
+    stats->major_faults = major >= 0 && state->major_faults >= 0 ? major - state->major_faults : -1;
+}
+
+/* Writes the tag if the matrix is complete; always releases the memory. */
+static int state_end(argon2_state *state) {
+    int result = ARGON2_CANCELLED;
+    uint64_t t0 = 0, t1 = 0;
+
+    if (state->timer.stats != NULL) {
+        t0 = argon2_now_ns();
+    }
+    if (state->next_segment == state->total_segments && !ARGON2_ATOMIC_LOAD(&state->cancelled)) {
+        finalize(&state->instance, &state->out, state->outlen, 1);
+        result = ARGON2_OK;
+    }
+    if (state->timer.stats != NULL) {
+        t1 = argon2_now_ns();
+    }
+    memory_release(state->arena, &state->instance);
+    if (state->timer.stats != NULL) {
+        stats_finish(state, t0, t1);
+    }
+    return result;
+}
+
+static int argon2_hash_context(argon2_arena *arena, argon2_context *context, argon2_type type) {
+    argon2_state state;
+
+    int result = state_begin(&state, arena, context, type);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+    state_run(&state, 0);
+    return state_end(&state);
+}
+
+int argon2_ctx(argon2_context *context, argon2_type type) {
+    return argon2_hash_context(NULL, context, type);
+}
+
+int argon2_ctx_arena(argon2_arena *arena, argon2_context *context, argon2_type type) {
+    if (arena == NULL) return ARGON2_MEMORY_ALLOCATION_ERROR;
+    return argon2_hash_context(arena, context, type);
+}
+
+/* ============== STEPPABLE API ============== */
+
+int argon2_init(argon2_state **state, argon2_arena *arena, argon2_context *context,
+                argon2_type type) {
+    if (state == NULL) return ARGON2_OUTPUT_PTR_NULL;
+    *state = NULL;
+
+    argon2_state *s = (argon2_state *)malloc(sizeof(*s));
+    if (s == NULL) {
         return ARGON2_MEMORY_ALLOCATION_ERROR;
     }
+    int result = state_begin(s, arena, context, type);
+    if (result != ARGON2_OK) {
+        free(s);
+        return result;
+    }
+    *state = s;
+    return ARGON2_OK;
+}
+
+void argon2_set_progress(argon2_state *state, argon2_progress_fn progress, void *user) {
+    if (state == NULL) return;
+    state->progress = progress;
+    state->progress_user = user;
+}
 
-    int result = initialize(&instance, pwd, pwdlen, salt, saltlen);
+int argon2_step(argon2_state *state, uint32_t max_segments) {
+    if (state == NULL) return ARGON2_INCORRECT_PARAMETER;
+    return state_run(state, max_segments);
+}
+
+void argon2_cancel(argon2_state *state) {
+    if (state == NULL) return;
+    ARGON2_ATOMIC_STORE(&state->cancelled, 1);
+}
+
+int argon2_finish(argon2_state *state) {
+    if (state == NULL) return ARGON2_INCORRECT_PARAMETER;
+    int result = state_end(state);
+    argon2_secure_wipe(state, sizeof(*state));
+    free(state);
+    return result;
+}
+
+/* ============== ARGON2ID API ============== */
+
+/*
+ * Fills a context for the raw helpers. The password is never cleared, so
+ * dropping const is safe.
+ */
+static int raw_context(argon2_context *context, uint32_t t_cost, uint32_t m_cost,
+                       uint32_t parallelism, const void *pwd, size_t pwdlen,
+                       const void *salt, size_t saltlen, void *hash, size_t hashlen) {
+    if (pwdlen > UINT32_MAX) return ARGON2_PWD_TOO_LONG;
+    if (saltlen > UINT32_MAX) return ARGON2_SALT_TOO_LONG;
+    if (hashlen > UINT32_MAX) return ARGON2_OUTPUT_TOO_LONG;
+
+    memset(context, 0, sizeof(*context));
+    context->out = (uint8_t *)hash;
+    context->outlen = (uint32_t)hashlen;
+    context->pwd = (uint8_t *)(uintptr_t)pwd;
+    context->pwdlen = (uint32_t)pwdlen;
+    context->salt = (const uint8_t *)salt;
+    context->saltlen = (uint32_t)saltlen;
+    context->t_cost = t_cost;
+    context->m_cost = m_cost;
+    context->lanes = parallelism;
+    context->version = ARGON2_VERSION_NUMBER;
+    return ARGON2_OK;
+}
+
+static int argon2id_hash(argon2_arena *arena, uint32_t t_cost, uint32_t m_cost,
+                         uint32_t parallelism, const void *pwd, size_t pwdlen,
+                         const void *salt, size_t saltlen, void *hash, size_t hashlen) {
+    argon2_context context;
+
+    int result = raw_context(&context, t_cost, m_cost, parallelism, pwd, pwdlen,
+                             salt, saltlen, hash, hashlen);
     if (result != ARGON2_OK) {
-        free(instance.memory);
         return result;
     }
+    return argon2_hash_context(arena, &context, Argon2_id);
+}
+
+int argon2id_hash_raw(const uint32_t t_cost, const uint32_t m_cost,
+                      const uint32_t parallelism, const void *pwd,
+                      const size_t pwdlen, const void *salt,
+                      const size_t saltlen, void *hash,
+                      const size_t hashlen) {
+    return argon2id_hash(NULL, t_cost, m_cost, parallelism, pwd, pwdlen,
+                         salt, saltlen, hash, hashlen);
+}
+
+int argon2id_hash_raw_arena(argon2_arena *arena, const uint32_t t_cost,
+                            const uint32_t m_cost, const uint32_t parallelism,
+                            const void *pwd, const size_t pwdlen,
+                            const void *salt, const size_t saltlen,
+                            void *hash, const size_t hashlen) {
+    if (arena == NULL) return ARGON2_MEMORY_ALLOCATION_ERROR;
+    return argon2id_hash(arena, t_cost, m_cost, parallelism, pwd, pwdlen,
+                         salt, saltlen, hash, hashlen);
+}
+
+/* ============== BATCH API ============== */
+
+/*
+ * Items are hashed two at a time on one thread (fill_segment_pair), and
+ * pairs are handed out to up to thread-limit workers. Each worker owns an
+ * arena sized for one pair, reused for every pair it takes.
+ */
+typedef struct {
+    argon2_instance_t shape;
+    uint32_t m_cost;
+    const argon2_batch_input *inputs;
+    size_t count;
+    uint8_t *hashes;
+    size_t hashlen;
+    int *results;
+    size_t next_pair;
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_t mutex;
+#endif
+} batch_job_t;
+
+static int batch_take_pair(batch_job_t *job, size_t *pair) {
+    int taken;
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_lock(&job->mutex);
+#endif
+    taken = job->next_pair * 2 < job->count;
+    if (taken) {
+        *pair = job->next_pair++;
+    }
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_unlock(&job->mutex);
+#endif
+    return taken;
+}
 
-    for (uint32_t pass = 0; pass < instance.passes; ++pass) {
+/* Hashes items [first, first + n), n being 1 or 2, in the worker's arena. */
+static void batch_hash_items(batch_job_t *job, argon2_arena *arena, size_t first, size_t n) {
+    argon2_instance_t instances[2];
+    argon2_context contexts[2];
+    uint8_t *outs[2];
+    size_t items[2];
+    size_t live = 0;
+    size_t bytes = (size_t)job->shape.memory_blocks * sizeof(block);
+
+    for (size_t k = 0; k < n; ++k) {
+        const argon2_batch_input *in = &job->inputs[first + k];
+        int result = raw_context(&contexts[live], job->shape.passes, job->m_cost,
+                                 job->shape.lanes, in->pwd, in->pwdlen, in->salt, in->saltlen,
+                                 job->hashes + (first + k) * job->hashlen, job->hashlen);
+        if (result == ARGON2_OK) {
+            result = validate_context(&contexts[live]);
+        }
+        job->results[first + k] = result;
+        if (result == ARGON2_OK) {
+            items[live++] = first + k;
+        }
+    }
+    if (live == 0) {
+        return;
+    }
+
+    if (arena_reserve(arena, 2 * bytes) != ARGON2_OK) {
+        for (size_t k = 0; k < live; ++k) {
+            job->results[items[k]] = ARGON2_MEMORY_ALLOCATION_ERROR;
+        }
+        return;
+    }
+    if (arena->used < live * bytes) {
+        arena->used = live * bytes;
+    }
+
+    for (size_t k = 0; k < live; ++k) {
+        instances[k] = job->shape;
+        instances[k].memory = arena->memory + k * job->shape.memory_blocks;
+        outs[k] = contexts[k].out;
+    }
+    initialize(instances, contexts, live);
+
+    for (uint32_t pass = 0; pass < job->shape.passes; ++pass) {
         for (uint32_t slice = 0; slice < ARGON2_SYNC_POINTS; ++slice) {
-            for (uint32_t lane = 0; lane < instance.lanes; ++lane) {
+            for (uint32_t lane = 0; lane < job->shape.lanes; ++lane) {
                 argon2_position_t position = {pass, lane, slice, 0};
-                fill_segment(&instance, position);
+                if (live == 2) {
+                    fill_segment_pair(&instances[0], &instances[1], position);
+                } else {
+                    fill_segment(&instances[0], position);
+                }
             }
         }
     }
 
-    finalize(&instance, hash, hashlen);
+    finalize(instances, outs, job->hashlen, live);
+}
 
-    memset(instance.memory, 0, memory_blocks * sizeof(block));
-    free(instance.memory);
+static void *batch_worker(void *arg) {
+    batch_job_t *job = (batch_job_t *)arg;
+    argon2_arena *arena = NULL;
+    size_t pair;
 
-    return ARGON2_OK;
+    if (argon2_arena_create(&arena, 0, 0) != ARGON2_OK) {
+        return NULL;  /* Remaining pairs are taken by the other workers. */
+    }
+    while (batch_take_pair(job, &pair)) {
+        size_t first = pair * 2;
+        size_t n = (job->count - first) >= 2 ? 2 : 1;
+        batch_hash_items(job, arena, first, n);
+    }
+    argon2_arena_destroy(arena);
+    return NULL;
+}
+
+int argon2id_hash_raw_batch(const uint32_t t_cost, const uint32_t m_cost,
+                            const uint32_t parallelism,
+                            const argon2_batch_input *inputs, const size_t count,
+                            void *hashes, const size_t hashlen, int *results) {
+    batch_job_t job;
+    int *own_results = NULL;
+
+    if (count == 0) return ARGON2_OK;
+    if (inputs == NULL || hashes == NULL) return ARGON2_OUTPUT_PTR_NULL;
+    if (hashlen < 4) return ARGON2_OUTPUT_TOO_SHORT;
+
+    int result = instance_setup(&job.shape, t_cost, m_cost, parallelism, Argon2_id);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+    job.shape.threads = 1;
+    job.m_cost = m_cost;
+    job.inputs = inputs;
+    job.count = count;
+    job.hashes = (uint8_t *)hashes;
+    job.hashlen = hashlen;
+    job.next_pair = 0;
+    if (results == NULL) {
+        own_results = (int *)malloc(count * sizeof(int));
+        if (own_results == NULL) {
+            return ARGON2_MEMORY_ALLOCATION_ERROR;
+        }
+        results = own_results;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        results[i] = ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+    job.results = results;
+
+#ifndef ARGON2_NO_THREADS
+    size_t pairs = (count + 1) / 2;
+    uint32_t workers = thread_limit != 0 ? thread_limit : ARGON2_MAX_THREADS;
+    if (workers > ARGON2_MAX_THREADS) workers = ARGON2_MAX_THREADS;
+    if (workers > pairs) workers = (uint32_t)pairs;
+    /* Extra workers on a busy core only add cold arenas. */
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0 && workers > (uint32_t)cpus) workers = (uint32_t)cpus;
+
+    pthread_t handles[ARGON2_MAX_THREADS];
+    uint32_t spawned = 0;
+    if (pthread_mutex_init(&job.mutex, NULL) == 0) {
+        for (uint32_t w = 1; w < workers; ++w) {
+            if (pthread_create(&handles[spawned], NULL, batch_worker, &job) != 0) {
+                break;
+            }
+            spawned++;
+        }
+        batch_worker(&job);
+        for (uint32_t w = 0; w < spawned; ++w) {
+            pthread_join(handles[w], NULL);
+        }
+        pthread_mutex_destroy(&job.mutex);
+    }
+#else
+    batch_worker(&job);
+#endif
+
+    result = ARGON2_OK;
+    for (size_t i = 0; i < count && result == ARGON2_OK; ++i) {
+        result = results[i];
+    }
+    free(own_results);
+    return result;
 }
@@ -0,0 +1,195 @@
+/*
+ * Internal definitions shared between the core and the architecture-
+ * specific kernels (fill_block, BLAKE2b, AES-GCM, base64url). Not part of
+ * the public API.
+ */
+
+#ifndef ARGON2_INTERNAL_H
+#define ARGON2_INTERNAL_H
+
+#include "../include/argon2.h"
+#include "../include/blake2b.h"
+#include "../include/aes_gcm.h"
+#include "../include/base64url.h"
+
+#include <string.h>
+
+#define ARGON2_BLOCK_SIZE 1024
+#define ARGON2_QWORDS_IN_BLOCK (ARGON2_BLOCK_SIZE / 8)
+#define ARGON2_SYNC_POINTS 4
+
+typedef struct block_ {
+    uint64_t v[ARGON2_QWORDS_IN_BLOCK];
+} block;
+
+/*
+ * Compression function G: next = G(prev ^ ref), additionally XORed with the
+ * previous contents of next when with_xor is set (passes after the first).
+ * ref and next may alias (address block generation relies on this).
+ */
+typedef void (*argon2_fill_block_fn)(const block *prev, const block *ref,
+                                     block *next, int with_xor);
+
+/*
+ * Two independent compressions interleaved so their dependency chains
+ * overlap; used by the batch API. Kernels without one fall back to two
+ * argon2_fill_block_fn calls.
+ */
+typedef void (*argon2_fill_block2_fn)(const block *prev0, const block *ref0, block *next0,
+                                      const block *prev1, const block *ref1, block *next1,
+                                      int with_xor);
+
+void argon2_fill_block_ref(const block *prev, const block *ref, block *next, int with_xor);
+void argon2_fill_block2_ref(const block *prev0, const block *ref0, block *next0,
+                            const block *prev1, const block *ref1, block *next1,
+                            int with_xor);
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define ARGON2_HAVE_X86_KERNELS 1
+void argon2_fill_block_sse2(const block *prev, const block *ref, block *next, int with_xor);
+void argon2_fill_block_ssse3(const block *prev, const block *ref, block *next, int with_xor);
+void argon2_fill_block_avx2(const block *prev, const block *ref, block *next, int with_xor);
+void argon2_fill_block2_avx2(const block *prev0, const block *ref0, block *next0,
+                             const block *prev1, const block *ref1, block *next1,
+                             int with_xor);
+void argon2_fill_block_avx512(const block *prev, const block *ref, block *next, int with_xor);
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64) || (defined(__ARM_NEON) && defined(__arm__))
+#define ARGON2_HAVE_NEON_KERNEL 1
+void argon2_fill_block_neon(const block *prev, const block *ref, block *next, int with_xor);
+void argon2_fill_block2_neon(const block *prev0, const block *ref0, block *next0,
+                             const block *prev1, const block *ref1, block *next1,
+                             int with_xor);
+#endif
+
+/* Static so every compression backend sees constants it can fold. */
+static const uint64_t argon2_blake2b_IV[8] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL,
+    0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL,
+    0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+static const uint8_t argon2_blake2b_sigma[12][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0},
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3}
+};
+
+/* BLAKE2b compression of one 128-byte block into S->h (counters already set). */
+void argon2_blake2b_compress_ref(blake2b_state *S, const uint8_t *block);
+
+/* Independent compressions, one state per 64-bit SIMD lane. */
+#if defined(ARGON2_HAVE_X86_KERNELS)
+void argon2_blake2b_compress4_avx2(blake2b_state *const S[4], const uint8_t *const blocks[4]);
+void argon2_blake2b_compress8_avx512(blake2b_state *const S[8], const uint8_t *const blocks[8]);
+#endif
+#if defined(ARGON2_HAVE_NEON_KERNEL)
+void argon2_blake2b_compress2_neon(blake2b_state *const S[2], const uint8_t *const blocks[2]);
+#endif
+
+/*
+ * Compress blocks[i] into S[i] for i < n on the widest multi-buffer backend
+ * the active kernel allows (AVX-512 x8, AVX2 x4, NEON x2), the rest one at
+ * a time. The states must be distinct.
+ */
+void argon2_blake2b_compress_many(blake2b_state *const *S, const uint8_t *const *blocks, size_t n);
+
+/*
+ * Lockstep blake2b_update / blake2b_final over n <= ARGON2_BLAKE2B_MAX_WAYS
+ * states that have absorbed equal lengths so far; in[i] and out[i] belong
+ * to S[i]. final_many writes S[i]->outlen bytes and wipes each state.
+ */
+#define ARGON2_BLAKE2B_MAX_WAYS 8
+void argon2_blake2b_update_many(blake2b_state *const *S, const uint8_t *const *in,
+                                size_t inlen, size_t n);
+void argon2_blake2b_final_many(blake2b_state *const *S, uint8_t *const *out, size_t n);
+
+/*
+ * AES-256-GCM backend. Round keys are in FIPS-197 byte order for every
+ * backend; htable and the GHASH representation behind it are the
+ * backend's own. Counters and the GHASH accumulator are passed as plain
+ * 16-byte GCM blocks.
+ */
+typedef struct Argon2_aes_backend {
+    const char *name;
+    /* Fill key->htable from key->round_keys. */
+    void (*init)(aes256gcm_key *key);
+    /* out = in ^ E(ctr), E(ctr + 1), ...; advances the low 32 bits of ctr. */
+    void (*ctr32)(const aes256gcm_key *key, uint8_t ctr[16], const uint8_t *in,
+                  uint8_t *out, size_t blocks);
+    /* xi = (xi ^ in[0]) * H, then each further block the same way. */
+    void (*ghash)(const aes256gcm_key *key, uint8_t xi[16], const uint8_t *in, size_t blocks);
+} argon2_aes_backend;
+
+/* Hardware backends, or NULL if this build or CPU lacks the instructions. */
+#if defined(ARGON2_HAVE_X86_KERNELS)
+const argon2_aes_backend *argon2_aes_backend_aesni(void);
+#endif
+#if defined(__aarch64__) || defined(_M_ARM64)
+#define ARGON2_HAVE_ARM_AES 1
+const argon2_aes_backend *argon2_aes_backend_armv8(void);
+#endif
+
+/*
+ * base64url bulk kernels. They convert whole blocks from the start of the
+ * input and return how many input bytes they took (a multiple of 3 when
+ * encoding, of 4 when decoding); base64url.c does the rest. A decoder
+ * stops before the first block holding a character outside the alphabet
+ * and leaves reporting it to the portable code.
+ */
+#if defined(ARGON2_HAVE_X86_KERNELS)
+size_t argon2_base64url_encode_ssse3(const uint8_t *in, size_t inlen, char *out);
+size_t argon2_base64url_decode_ssse3(const char *in, size_t inlen, uint8_t *out);
+size_t argon2_base64url_encode_avx2(const uint8_t *in, size_t inlen, char *out);
+size_t argon2_base64url_decode_avx2(const char *in, size_t inlen, uint8_t *out);
+#endif
+#if defined(ARGON2_HAVE_NEON_KERNEL)
+size_t argon2_base64url_encode_neon(const uint8_t *in, size_t inlen, char *out);
+size_t argon2_base64url_decode_neon(const char *in, size_t inlen, uint8_t *out);
+#endif
+
+/* Little-endian 64-bit load; a plain (unaligned) load on little-endian hosts. */
+static inline uint64_t argon2_load64(const void *src) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    uint64_t w;
+    memcpy(&w, src, sizeof(w));
+    return w;
+#else
+    const uint8_t *p = (const uint8_t *)src;
+    return ((uint64_t)p[0]) | ((uint64_t)p[1] << 8) |
+           ((uint64_t)p[2] << 16) | ((uint64_t)p[3] << 24) |
+           ((uint64_t)p[4] << 32) | ((uint64_t)p[5] << 40) |
+           ((uint64_t)p[6] << 48) | ((uint64_t)p[7] << 56);
+#endif
+}
+
+/* Everything argon2_init would reject, without allocating. */
+int argon2_check_context(const argon2_context *context, argon2_type type);
+
+/* CLOCK_MONOTONIC in nanoseconds, for argon2_stats. */
+uint64_t argon2_now_ns(void);
+
+/* Zero memory in a way the compiler cannot elide. */
+void argon2_secure_wipe(void *v, size_t n);
+
+/* len bytes from the OS CSPRNG (drbg.c); 0 on success. */
+int argon2_os_random(uint8_t *out, size_t len);
+
+/* Kernel picked by argon2_select_kernel() / CPU detection. Never NULL. */
+argon2_fill_block_fn argon2_fill_block_impl(void);
+
+/* Two-way variant of the active kernel, or NULL if it has none. */
+argon2_fill_block2_fn argon2_fill_block2_impl(void);
+
+#endif /* ARGON2_INTERNAL_H */
@@ -0,0 +1,144 @@
+/*
+ * base64url - portable code and kernel dispatch. The SIMD kernels in
+ * base64url_x86.c / base64url_neon.c take the bulk of the input; this file
+ * finishes the tail, handles padding and reports invalid characters.
+ */
+
+#include "argon2_internal.h"
+
+#define BAD 0xff
+
+static const char alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+static const uint8_t decode_table[256] = {
+    BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+    BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+    BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,  62, BAD, BAD,
+     52,  53,  54,  55,  56,  57,  58,  59,  60,  61, BAD, BAD, BAD, BAD, BAD, BAD,
+    BAD,   0,   1,   2,   3,   4,   5,   6,   7,   8,   9,  10,  11,  12,  13,  14,
+     15,  16,  17,  18,  19,  20,  21,  22,  23,  24,  25, BAD, BAD, BAD, BAD,  63,
+    BAD,  26,  27,  28,  29,  30,  31,  32,  33,  34,  35,  36,  37,  38,  39,  40,
+     41,  42,  43,  44,  45,  46,  47,  48,  49,  50,  51, BAD, BAD, BAD, BAD, BAD,
+    BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+    BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+    BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+    BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+    BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+    BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+    BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD,
+    BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD, BAD
+};
+
+static size_t encode_bulk(const uint8_t *in, size_t inlen, char *out) {
+    switch (argon2_active_kernel()) {
+#if defined(ARGON2_HAVE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+    case ARGON2_KERNEL_AVX512:
+    case ARGON2_KERNEL_AVX2:
+        return argon2_base64url_encode_avx2(in, inlen, out);
+    case ARGON2_KERNEL_SSSE3:
+        return argon2_base64url_encode_ssse3(in, inlen, out);
+#endif
+#if defined(ARGON2_HAVE_NEON_KERNEL)
+    case ARGON2_KERNEL_NEON:
+        return argon2_base64url_encode_neon(in, inlen, out);
+#endif
+    default:
+        return 0;
+    }
+}
+
+static size_t decode_bulk(const char *in, size_t inlen, uint8_t *out) {
+    switch (argon2_active_kernel()) {
+#if defined(ARGON2_HAVE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+    case ARGON2_KERNEL_AVX512:
+    case ARGON2_KERNEL_AVX2:
+        return argon2_base64url_decode_avx2(in, inlen, out);
+    case ARGON2_KERNEL_SSSE3:
+        return argon2_base64url_decode_ssse3(in, inlen, out);
+#endif
+#if defined(ARGON2_HAVE_NEON_KERNEL)
+    case ARGON2_KERNEL_NEON:
+        return argon2_base64url_decode_neon(in, inlen, out);
+#endif
+    default:
+        return 0;
+    }
+}
+
+size_t base64url_encoded_len(size_t len) {
+    return len / 3 * 4 + (len % 3 * 4 + 2) / 3;
+}
+
+size_t base64url_decoded_max(size_t len) {
+    return len / 4 * 3 + len % 4 * 3 / 4;
+}
+
+int base64url_encode(const uint8_t *in, size_t inlen, char *out) {
+    if ((in == NULL || out == NULL) && inlen != 0) return BASE64URL_INVALID;
+    if (inlen > SIZE_MAX / 4 * 3) return BASE64URL_INVALID;
+
+    size_t i = encode_bulk(in, inlen, out);
+    out += i / 3 * 4;
+    for (; i + 3 <= inlen; i += 3, out += 4) {
+        uint32_t w = (uint32_t)in[i] << 16 | (uint32_t)in[i + 1] << 8 | in[i + 2];
+        out[0] = alphabet[w >> 18];
+        out[1] = alphabet[(w >> 12) & 63];
+        out[2] = alphabet[(w >> 6) & 63];
+        out[3] = alphabet[w & 63];
+    }
+    if (inlen - i == 1) {
+        out[0] = alphabet[in[i] >> 2];
+        out[1] = alphabet[(in[i] & 3) << 4];
+    } else if (inlen - i == 2) {
+        uint32_t w = (uint32_t)in[i] << 8 | in[i + 1];
+        out[0] = alphabet[w >> 10];
+        out[1] = alphabet[(w >> 4) & 63];
+        out[2] = alphabet[(w << 2) & 63];
+    }
+    return BASE64URL_OK;
+}
+
+int base64url_decode(const char *in, size_t inlen, uint8_t *out, size_t *outlen) {
+    const uint8_t *text = (const uint8_t *)in;
+    size_t i, o;
+
+    if (outlen == NULL || (in == NULL && inlen != 0)) return BASE64URL_INVALID;
+    *outlen = 0;
+
+    /* Up to two '=' may pad the text to a multiple of four. */
+    if (inlen % 4 == 0 && inlen != 0 && text[inlen - 1] == '=') {
+        inlen -= text[inlen - 2] == '=' ? 2 : 1;
+    }
+    if (inlen % 4 == 1) return BASE64URL_INVALID;
+    if (out == NULL && inlen != 0) return BASE64URL_INVALID;
+
+    i = decode_bulk(in, inlen, out);
+    o = i / 4 * 3;
+    for (; i + 4 <= inlen; i += 4, o += 3) {
+        uint32_t a = decode_table[text[i]], b = decode_table[text[i + 1]];
+        uint32_t c = decode_table[text[i + 2]], d = decode_table[text[i + 3]];
+        if ((a | b | c | d) > 63) goto invalid;
+        uint32_t w = a << 18 | b << 12 | c << 6 | d;
+        out[o] = (uint8_t)(w >> 16);
+        out[o + 1] = (uint8_t)(w >> 8);
+        out[o + 2] = (uint8_t)w;
+    }
+    if (inlen - i >= 2) {
+        uint32_t a = decode_table[text[i]], b = decode_table[text[i + 1]];
+        uint32_t c = inlen - i == 3 ? decode_table[text[i + 2]] : 0;
+        if ((a | b | c) > 63) goto invalid;
+        out[o++] = (uint8_t)(a << 2 | b >> 4);
+        if (inlen - i == 3) {
+            out[o++] = (uint8_t)(b << 4 | c >> 2);
+        }
+    }
+    *outlen = o;
+    return BASE64URL_OK;
+
+invalid:
+    if (o != 0) {
+        argon2_secure_wipe(out, o);
+    }
+    return BASE64URL_INVALID;
+}
@@ -0,0 +1,99 @@
+/*
+ * base64url kernels for ARM NEON. vld3q/vst4q (and vld4q/vst3q) do the
+ * byte (de)interleaving, so every step is plain lane-wise arithmetic on
+ * one 6-bit field per register: 48 bytes to 64 characters and back per
+ * iteration. Characters are classified by range compare as in
+ * base64url_x86.c, which keeps the code valid on 32-bit NEON too (no
+ * 64-byte vqtbl4q lookups).
+ */
+
+#include "argon2_internal.h"
+
+#if defined(ARGON2_HAVE_NEON_KERNEL)
+
+#include <arm_neon.h>
+
+static inline uint8x16_t encode_translate_neon(uint8x16_t idx) {
+    uint8x16_t shift = vdupq_n_u8('A');
+    shift = vbslq_u8(vcgeq_u8(idx, vdupq_n_u8(26)), vdupq_n_u8('a' - 26), shift);
+    shift = vbslq_u8(vcgeq_u8(idx, vdupq_n_u8(52)), vdupq_n_u8((uint8_t)('0' - 52)), shift);
+    shift = vbslq_u8(vceqq_u8(idx, vdupq_n_u8(62)), vdupq_n_u8((uint8_t)('-' - 62)), shift);
+    shift = vbslq_u8(vceqq_u8(idx, vdupq_n_u8(63)), vdupq_n_u8('_' - 63), shift);
+    return vaddq_u8(idx, shift);
+}
+
+static inline uint8x16_t in_range_neon(uint8x16_t c, uint8_t lo, uint8_t hi) {
+    return vandq_u8(vcgeq_u8(c, vdupq_n_u8(lo)), vcleq_u8(c, vdupq_n_u8(hi)));
+}
+
+/* Clears lanes of *valid that hold a character outside the alphabet. */
+static inline uint8x16_t decode_translate_neon(uint8x16_t c, uint8x16_t *valid) {
+    uint8x16_t upper = in_range_neon(c, 'A', 'Z');
+    uint8x16_t lower = in_range_neon(c, 'a', 'z');
+    uint8x16_t digit = in_range_neon(c, '0', '9');
+    uint8x16_t dash = vceqq_u8(c, vdupq_n_u8('-'));
+    uint8x16_t under = vceqq_u8(c, vdupq_n_u8('_'));
+
+    *valid = vandq_u8(*valid, vorrq_u8(vorrq_u8(upper, lower),
+                                       vorrq_u8(digit, vorrq_u8(dash, under))));
+    uint8x16_t shift = vorrq_u8(
+        vorrq_u8(vandq_u8(upper, vdupq_n_u8((uint8_t)-'A')),
+                 vandq_u8(lower, vdupq_n_u8((uint8_t)(26 - 'a')))),
+        vorrq_u8(vandq_u8(digit, vdupq_n_u8(52 - '0')),
+                 vorrq_u8(vandq_u8(dash, vdupq_n_u8(62 - '-')),
+                          vandq_u8(under, vdupq_n_u8((uint8_t)(63 - '_'))))));
+    return vaddq_u8(c, shift);
+}
+
+static inline int all_set_neon(uint8x16_t v) {
+#if defined(__aarch64__) || defined(_M_ARM64)
+    return vminvq_u8(v) == 0xff;
+#else
+    uint8x8_t m = vand_u8(vget_low_u8(v), vget_high_u8(v));
+    m = vpmin_u8(m, m);
+    m = vpmin_u8(m, m);
+    m = vpmin_u8(m, m);
+    return vget_lane_u8(m, 0) == 0xff;
+#endif
+}
+
+size_t argon2_base64url_encode_neon(const uint8_t *in, size_t inlen, char *out) {
+    const uint8x16_t mask = vdupq_n_u8(63);
+    size_t i = 0;
+
+    for (; i + 48 <= inlen; i += 48, out += 64) {
+        uint8x16x3_t s = vld3q_u8(in + i);
+        uint8x16x4_t t;
+        t.val[0] = encode_translate_neon(vshrq_n_u8(s.val[0], 2));
+        t.val[1] = encode_translate_neon(
+            vandq_u8(vorrq_u8(vshlq_n_u8(s.val[0], 4), vshrq_n_u8(s.val[1], 4)), mask));
+        t.val[2] = encode_translate_neon(
+            vandq_u8(vorrq_u8(vshlq_n_u8(s.val[1], 2), vshrq_n_u8(s.val[2], 6)), mask));
+        t.val[3] = encode_translate_neon(vandq_u8(s.val[2], mask));
+        vst4q_u8((uint8_t *)out, t);
+    }
+    return i;
+}
+
+size_t argon2_base64url_decode_neon(const char *in, size_t inlen, uint8_t *out) {
+    size_t i = 0;
+
+    for (; i + 64 <= inlen; i += 64, out += 48) {
+        uint8x16x4_t s = vld4q_u8((const uint8_t *)in + i);
+        uint8x16_t valid = vdupq_n_u8(0xff);
+        uint8x16_t a = decode_translate_neon(s.val[0], &valid);
+        uint8x16_t b = decode_translate_neon(s.val[1], &valid);
+        uint8x16_t c = decode_translate_neon(s.val[2], &valid);
+        uint8x16_t d = decode_translate_neon(s.val[3], &valid);
+        if (!all_set_neon(valid)) break;
+
+        uint8x16x3_t t;
+        t.val[0] = vorrq_u8(vshlq_n_u8(a, 2), vshrq_n_u8(b, 4));
+        t.val[1] = vorrq_u8(vshlq_n_u8(b, 4), vshrq_n_u8(c, 2));
+        t.val[2] = vorrq_u8(vshlq_n_u8(c, 6), d);
+        vst3q_u8(out, t);
+    }
+    return i;
+}
+
+#endif /* ARGON2_HAVE_NEON_KERNEL */
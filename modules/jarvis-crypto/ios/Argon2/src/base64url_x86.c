@@ -0,0 +1,201 @@
+/*
+ * base64url kernels for x86-64 SSSE3 and AVX2 (Muła and Lemire, "Faster
+ * Base64 Encoding and Decoding Using AVX2 Instructions", 2018).
+ *
+ * Encoding spreads each 3 input bytes over a 32-bit lane with pshufb,
+ * splits them into four 6-bit indices with two multiplies, and maps the
+ * indices to ASCII with a 16-entry offset table. Decoding classifies each
+ * character by range compare (the URL alphabet's '-' and '_' do not fit
+ * the nibble tables used for standard base64), adds the range's offset
+ * and packs four 6-bit values into 3 bytes with pmaddubsw/pmaddwd. Built
+ * with per-function target attributes like fill_block_x86.c.
+ */
+
+#include "argon2_internal.h"
+
+#if defined(ARGON2_HAVE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define ARGON2_TARGET(isa) __attribute__((target(isa)))
+
+#define LOAD128(p) _mm_loadu_si128((const __m128i *)(const void *)(p))
+#define STORE128(p, x) _mm_storeu_si128((__m128i *)(void *)(p), (x))
+#define LOAD256(p) _mm256_loadu_si256((const __m256i *)(const void *)(p))
+#define STORE256(p, x) _mm256_storeu_si256((__m256i *)(void *)(p), (x))
+
+/* Offsets from a 6-bit index to its character, by the class encode_translate picks. */
+#define ENCODE_OFFSETS                                                               \
+    'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,  \
+    '0' - 52, '0' - 52, '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0
+
+/* ---- SSSE3 ---- */
+
+/* Bytes 0..11 of in to sixteen 6-bit indices, one per byte in output order. */
+ARGON2_TARGET("ssse3")
+static inline __m128i encode_split_ssse3(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    __m128i hi = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+                                 _mm_set1_epi32(0x04000040));
+    __m128i lo = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+                                 _mm_set1_epi32(0x01000010));
+    return _mm_or_si128(hi, lo);
+}
+
+/*
+ * 0..25 become class 13 ('A'), 26..51 class 0 ('a'), 52..61 classes 1..10
+ * (digits), 62 and 63 classes 11 and 12.
+ */
+ARGON2_TARGET("ssse3")
+static inline __m128i encode_translate_ssse3(__m128i idx) {
+    __m128i cls = _mm_subs_epu8(idx, _mm_set1_epi8(51));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), idx);
+    cls = _mm_or_si128(cls, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    return _mm_add_epi8(idx, _mm_shuffle_epi8(_mm_setr_epi8(ENCODE_OFFSETS), cls));
+}
+
+/* Sets *valid to all ones in the lanes holding alphabet characters. */
+ARGON2_TARGET("ssse3")
+static inline __m128i decode_translate_ssse3(__m128i c, __m128i *valid) {
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), c));
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)),
+                                  _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), c));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), c));
+    __m128i dash = _mm_cmpeq_epi8(c, _mm_set1_epi8('-'));
+    __m128i under = _mm_cmpeq_epi8(c, _mm_set1_epi8('_'));
+
+    *valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(dash, under)));
+    __m128i shift = _mm_or_si128(
+        _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-'A')),
+                     _mm_and_si128(lower, _mm_set1_epi8(26 - 'a'))),
+        _mm_or_si128(_mm_and_si128(digit, _mm_set1_epi8(52 - '0')),
+                     _mm_or_si128(_mm_and_si128(dash, _mm_set1_epi8(62 - '-')),
+                                  _mm_and_si128(under, _mm_set1_epi8(63 - '_')))));
+    return _mm_add_epi8(c, shift);
+}
+
+/* Sixteen 6-bit values to 12 bytes at the bottom of the register, zeros above. */
+ARGON2_TARGET("ssse3")
+static inline __m128i decode_pack_ssse3(__m128i idx) {
+    __m128i pairs = _mm_maddubs_epi16(idx, _mm_set1_epi32(0x01400140));
+    __m128i words = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(words, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                                 -1, -1, -1, -1));
+}
+
+/* Reads 16 bytes per 12 encoded. */
+ARGON2_TARGET("ssse3")
+size_t argon2_base64url_encode_ssse3(const uint8_t *in, size_t inlen, char *out) {
+    size_t i = 0;
+
+    for (; i + 16 <= inlen; i += 12, out += 16) {
+        STORE128(out, encode_translate_ssse3(encode_split_ssse3(LOAD128(in + i))));
+    }
+    return i;
+}
+
+/*
+ * Writes 16 bytes per 12 decoded, so it stops 8 characters (6 bytes of
+ * out) short of the end.
+ */
+ARGON2_TARGET("ssse3")
+size_t argon2_base64url_decode_ssse3(const char *in, size_t inlen, uint8_t *out) {
+    size_t i = 0;
+
+    for (; i + 24 <= inlen; i += 16, out += 12) {
+        __m128i valid;
+        __m128i idx = decode_translate_ssse3(LOAD128(in + i), &valid);
+        if (_mm_movemask_epi8(valid) != 0xffff) break;
+        STORE128(out, decode_pack_ssse3(idx));
+    }
+    return i;
+}
+
+/* ---- AVX2 ---- */
+
+ARGON2_TARGET("avx2")
+static inline __m256i encode_split_avx2(__m256i in) {
+    in = _mm256_shuffle_epi8(in, _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                                  1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    __m256i hi = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+                                    _mm256_set1_epi32(0x04000040));
+    __m256i lo = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+                                    _mm256_set1_epi32(0x01000010));
+    return _mm256_or_si256(hi, lo);
+}
+
+ARGON2_TARGET("avx2")
+static inline __m256i encode_translate_avx2(__m256i idx) {
+    __m256i cls = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+    __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx);
+    cls = _mm256_or_si256(cls, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+    __m256i offsets = _mm256_setr_epi8(ENCODE_OFFSETS, ENCODE_OFFSETS);
+    return _mm256_add_epi8(idx, _mm256_shuffle_epi8(offsets, cls));
+}
+
+ARGON2_TARGET("avx2")
+static inline __m256i decode_translate_avx2(__m256i c, __m256i *valid) {
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('A' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), c));
+    __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('a' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), c));
+    __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+    __m256i dash = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('-'));
+    __m256i under = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('_'));
+
+    *valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+                             _mm256_or_si256(digit, _mm256_or_si256(dash, under)));
+    __m256i shift = _mm256_or_si256(
+        _mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-'A')),
+                        _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a'))),
+        _mm256_or_si256(_mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')),
+                        _mm256_or_si256(_mm256_and_si256(dash, _mm256_set1_epi8(62 - '-')),
+                                        _mm256_and_si256(under, _mm256_set1_epi8(63 - '_')))));
+    return _mm256_add_epi8(c, shift);
+}
+
+/* 24 bytes at the bottom of the register: each lane packs its 12, then the lanes close up. */
+ARGON2_TARGET("avx2")
+static inline __m256i decode_pack_avx2(__m256i idx) {
+    __m256i pairs = _mm256_maddubs_epi16(idx, _mm256_set1_epi32(0x01400140));
+    __m256i words = _mm256_madd_epi16(pairs, _mm256_set1_epi32(0x00011000));
+    words = _mm256_shuffle_epi8(words, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                                        -1, -1, -1, -1,
+                                                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                                        -1, -1, -1, -1));
+    return _mm256_permutevar8x32_epi32(words, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+}
+
+/* Each lane encodes 12 bytes, loaded 16 at a time from in and in + 12. */
+ARGON2_TARGET("avx2")
+size_t argon2_base64url_encode_avx2(const uint8_t *in, size_t inlen, char *out) {
+    size_t i = 0;
+
+    for (; i + 28 <= inlen; i += 24, out += 32) {
+        __m256i block = _mm256_inserti128_si256(_mm256_castsi128_si256(LOAD128(in + i)),
+                                                LOAD128(in + i + 12), 1);
+        STORE256(out, encode_translate_avx2(encode_split_avx2(block)));
+    }
+    return i + argon2_base64url_encode_ssse3(in + i, inlen - i, out);
+}
+
+/* Writes 32 bytes per 24 decoded, so it stops 12 characters short of the end. */
+ARGON2_TARGET("avx2")
+size_t argon2_base64url_decode_avx2(const char *in, size_t inlen, uint8_t *out) {
+    size_t i = 0;
+
+    for (; i + 44 <= inlen; i += 32, out += 24) {
+        __m256i valid;
+        __m256i idx = decode_translate_avx2(LOAD256(in + i), &valid);
+        if (_mm256_movemask_epi8(valid) != -1) {
+            return i;
+        }
+        STORE256(out, decode_pack_avx2(idx));
+    }
+    return i + argon2_base64url_decode_ssse3(in + i, inlen - i, out);
+}
+
+#endif /* ARGON2_HAVE_X86_KERNELS */
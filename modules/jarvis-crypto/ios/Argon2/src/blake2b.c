@@ -0,0 +1,541 @@
+/*
+ * BLAKE2b and BLAKE2bp (RFC 7693, blake2.net reference semantics).
+ *
+ * A single BLAKE2b message runs on the portable compression function: with
+ * four independent G chains per half-round it keeps a superscalar core as
+ * busy as a one-message SIMD version would. SIMD is used across messages
+ * instead - argon2_blake2b_compress_many() hands independent states to the
+ * multi-buffer kernels in blake2b_x86.c / blake2b_neon.c. The four
+ * BLAKE2bp leaves are such messages, and so are Argon2's per-lane H' chains,
+ * which argon2.c runs through the lockstep update/final below.
+ */
+
+#include "argon2_internal.h"
+
+#include <string.h>
+
+#ifndef ARGON2_NO_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/* One-shot blake2bp hashes its leaves on threads from this input size up. */
+#define BLAKE2BP_THREAD_MIN ((size_t)1 << 20)
+
+/* ============== PORTABLE COMPRESSION ============== */
+
+static inline uint64_t rotr64(uint64_t x, unsigned n) {
+    return (x >> n) | (x << (64 - n));
+}
+
+static inline void store64(void *dst, uint64_t w) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(dst, &w, sizeof(w));
+#else
+    uint8_t *p = (uint8_t *)dst;
+    for (size_t i = 0; i < 8; ++i)
+        p[i] = (uint8_t)(w >> (8 * i));
+#endif
+}
+
+#define G(r, i, a, b, c, d)                     \
+    do {                                        \
+        a = a + b + m[argon2_blake2b_sigma[r][2*i+0]]; \
+        d = rotr64(d ^ a, 32);                  \
+        c = c + d;                              \
+        b = rotr64(b ^ c, 24);                  \
+        a = a + b + m[argon2_blake2b_sigma[r][2*i+1]]; \
+        d = rotr64(d ^ a, 16);                  \
+        c = c + d;                              \
+        b = rotr64(b ^ c, 63);                  \
+    } while (0)
+
+#define ROUND(r)                    \
+    do {                            \
+        G(r, 0, v[0], v[4], v[8], v[12]); \
+        G(r, 1, v[1], v[5], v[9], v[13]); \
+        G(r, 2, v[2], v[6], v[10], v[14]); \
+        G(r, 3, v[3], v[7], v[11], v[15]); \
+        G(r, 4, v[0], v[5], v[10], v[15]); \
+        G(r, 5, v[1], v[6], v[11], v[12]); \
+        G(r, 6, v[2], v[7], v[8], v[13]); \
+        G(r, 7, v[3], v[4], v[9], v[14]); \
+    } while (0)
+
+void argon2_blake2b_compress_ref(blake2b_state *S, const uint8_t *block) {
+    uint64_t m[16];
+    uint64_t v[16];
+
+    for (size_t i = 0; i < 16; ++i)
+        m[i] = argon2_load64(block + i * 8);
+
+    for (size_t i = 0; i < 8; ++i)
+        v[i] = S->h[i];
+
+    v[8] = argon2_blake2b_IV[0];
+    v[9] = argon2_blake2b_IV[1];
+    v[10] = argon2_blake2b_IV[2];
+    v[11] = argon2_blake2b_IV[3];
+    v[12] = argon2_blake2b_IV[4] ^ S->t[0];
+    v[13] = argon2_blake2b_IV[5] ^ S->t[1];
+    v[14] = argon2_blake2b_IV[6] ^ S->f[0];
+    v[15] = argon2_blake2b_IV[7] ^ S->f[1];
+
+    ROUND(0);
+    ROUND(1);
+    ROUND(2);
+    ROUND(3);
+    ROUND(4);
+    ROUND(5);
+    ROUND(6);
+    ROUND(7);
+    ROUND(8);
+    ROUND(9);
+    ROUND(10);
+    ROUND(11);
+
+    for (size_t i = 0; i < 8; ++i)
+        S->h[i] = S->h[i] ^ v[i] ^ v[i + 8];
+}
+
+void argon2_blake2b_compress_many(blake2b_state *const *S, const uint8_t *const *blocks, size_t n) {
+    size_t i = 0;
+
+    switch (argon2_active_kernel()) {
+#if defined(ARGON2_HAVE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+    case ARGON2_KERNEL_AVX512:
+        for (; i + 8 <= n; i += 8) {
+            argon2_blake2b_compress8_avx512(S + i, blocks + i);
+        }
+        /* fall through */
+    case ARGON2_KERNEL_AVX2:
+        for (; i + 4 <= n; i += 4) {
+            argon2_blake2b_compress4_avx2(S + i, blocks + i);
+        }
+        break;
+#endif
+#if defined(ARGON2_HAVE_NEON_KERNEL)
+    case ARGON2_KERNEL_NEON:
+        for (; i + 2 <= n; i += 2) {
+            argon2_blake2b_compress2_neon(S + i, blocks + i);
+        }
+        break;
+#endif
+    default:
+        break;
+    }
+    for (; i < n; ++i) {
+        argon2_blake2b_compress_ref(S[i], blocks[i]);
+    }
+}
+
+/* ============== BLAKE2B ============== */
+
+static inline void increment_counter(blake2b_state *S, uint64_t inc) {
+    S->t[0] += inc;
+    S->t[1] += (S->t[0] < inc);
+}
+
+/*
+ * Parameter block folded straight into h: digest/key length, fanout and
+ * depth in word 0, node offset in word 1, node depth and inner length in
+ * word 2. Leaf length, salt and personalization are always zero here.
+ */
+static void init_param(blake2b_state *S, size_t outlen, size_t keylen, uint8_t fanout,
+                       uint8_t depth, uint64_t node_offset, uint8_t node_depth,
+                       uint8_t inner_length) {
+    memset(S, 0, sizeof(*S));
+    for (size_t i = 0; i < 8; ++i)
+        S->h[i] = argon2_blake2b_IV[i];
+    S->h[0] ^= (uint64_t)outlen | ((uint64_t)keylen << 8) | ((uint64_t)fanout << 16) |
+               ((uint64_t)depth << 24);
+    S->h[1] ^= node_offset;
+    S->h[2] ^= (uint64_t)node_depth | ((uint64_t)inner_length << 8);
+    S->outlen = outlen;
+}
+
+static void absorb_key(blake2b_state *S, const void *key, size_t keylen) {
+    uint8_t block[BLAKE2B_BLOCKBYTES];
+    memset(block, 0, sizeof(block));
+    memcpy(block, key, keylen);
+    blake2b_update(S, block, BLAKE2B_BLOCKBYTES);
+    argon2_secure_wipe(block, sizeof(block));
+}
+
+int blake2b_init(blake2b_state *S, size_t outlen) {
+    if (S == NULL || outlen == 0 || outlen > BLAKE2B_OUTBYTES) return -1;
+    init_param(S, outlen, 0, 1, 1, 0, 0, 0);
+    return 0;
+}
+
+int blake2b_init_key(blake2b_state *S, size_t outlen, const void *key, size_t keylen) {
+    if (S == NULL || outlen == 0 || outlen > BLAKE2B_OUTBYTES) return -1;
+    if (keylen > BLAKE2B_KEYBYTES || (key == NULL && keylen != 0)) return -1;
+    init_param(S, outlen, keylen, 1, 1, 0, 0, 0);
+    if (keylen != 0) {
+        absorb_key(S, key, keylen);
+    }
+    return 0;
+}
+
+/* The last block stays buffered so final can flag it. */
+int blake2b_update(blake2b_state *S, const void *in, size_t inlen) {
+    const uint8_t *pin = (const uint8_t *)in;
+
+    if (inlen == 0) return 0;
+    if (S == NULL || in == NULL) return -1;
+
+    size_t left = S->buflen;
+    size_t fill = BLAKE2B_BLOCKBYTES - left;
+
+    if (inlen > fill) {
+        S->buflen = 0;
+        memcpy(S->buf + left, pin, fill);
+        increment_counter(S, BLAKE2B_BLOCKBYTES);
+        argon2_blake2b_compress_ref(S, S->buf);
+        pin += fill;
+        inlen -= fill;
+
+        while (inlen > BLAKE2B_BLOCKBYTES) {
+            increment_counter(S, BLAKE2B_BLOCKBYTES);
+            argon2_blake2b_compress_ref(S, pin);
+            pin += BLAKE2B_BLOCKBYTES;
+            inlen -= BLAKE2B_BLOCKBYTES;
+        }
+    }
+    memcpy(S->buf + S->buflen, pin, inlen);
+    S->buflen += inlen;
+    return 0;
+}
+
+/* Counts and flags the buffered block as the last one, zero-padded. */
+static void final_block(blake2b_state *S) {
+    increment_counter(S, S->buflen);
+    S->f[0] = (uint64_t)-1;
+    if (S->last_node) {
+        S->f[1] = (uint64_t)-1;
+    }
+    memset(S->buf + S->buflen, 0, BLAKE2B_BLOCKBYTES - S->buflen);
+}
+
+static void final_output(blake2b_state *S, void *out) {
+    uint8_t buffer[BLAKE2B_OUTBYTES];
+
+    for (size_t i = 0; i < 8; ++i)
+        store64(buffer + i * 8, S->h[i]);
+    memcpy(out, buffer, S->outlen);
+
+    argon2_secure_wipe(buffer, sizeof(buffer));
+    argon2_secure_wipe(S->buf, sizeof(S->buf));
+    argon2_secure_wipe(S->h, sizeof(S->h));
+}
+
+int blake2b_final(blake2b_state *S, void *out, size_t outlen) {
+    if (S == NULL || out == NULL || outlen < S->outlen) return -1;
+    if (S->f[0] != 0) return -1;
+
+    final_block(S);
+    argon2_blake2b_compress_ref(S, S->buf);
+    final_output(S, out);
+    return 0;
+}
+
+int blake2b(void *out, size_t outlen, const void *in, size_t inlen,
+            const void *key, size_t keylen) {
+    blake2b_state S;
+
+    if (out == NULL || (in == NULL && inlen != 0)) return -1;
+    if (blake2b_init_key(&S, outlen, key, keylen) != 0) return -1;
+    blake2b_update(&S, in, inlen);
+    return blake2b_final(&S, out, outlen);
+}
+
+/* ============== MULTI-BUFFER BLAKE2B ============== */
+
+/*
+ * blake2b_update over n states with the same history, so every state has
+ * the same buflen and each step compresses all of them together.
+ */
+void argon2_blake2b_update_many(blake2b_state *const *S, const uint8_t *const *in,
+                                size_t inlen, size_t n) {
+    const uint8_t *blocks[ARGON2_BLAKE2B_MAX_WAYS] = {NULL};
+    size_t offset = 0;
+
+    if (inlen == 0 || n == 0) return;
+
+    size_t left = S[0]->buflen;
+    size_t fill = BLAKE2B_BLOCKBYTES - left;
+
+    if (inlen > fill) {
+        for (size_t i = 0; i < n; ++i) {
+            memcpy(S[i]->buf + left, in[i], fill);
+            S[i]->buflen = 0;
+            increment_counter(S[i], BLAKE2B_BLOCKBYTES);
+            blocks[i] = S[i]->buf;
+        }
+        argon2_blake2b_compress_many(S, blocks, n);
+        offset = fill;
+        inlen -= fill;
+
+        while (inlen > BLAKE2B_BLOCKBYTES) {
+            for (size_t i = 0; i < n; ++i) {
+                increment_counter(S[i], BLAKE2B_BLOCKBYTES);
+                blocks[i] = in[i] + offset;
+            }
+            argon2_blake2b_compress_many(S, blocks, n);
+            offset += BLAKE2B_BLOCKBYTES;
+            inlen -= BLAKE2B_BLOCKBYTES;
+        }
+    }
+    for (size_t i = 0; i < n; ++i) {
+        memcpy(S[i]->buf + S[i]->buflen, in[i] + offset, inlen);
+        S[i]->buflen += inlen;
+    }
+}
+
+void argon2_blake2b_final_many(blake2b_state *const *S, uint8_t *const *out, size_t n) {
+    const uint8_t *blocks[ARGON2_BLAKE2B_MAX_WAYS] = {NULL};
+
+    for (size_t i = 0; i < n; ++i) {
+        final_block(S[i]);
+        blocks[i] = S[i]->buf;
+    }
+    argon2_blake2b_compress_many(S, blocks, n);
+    for (size_t i = 0; i < n; ++i) {
+        final_output(S[i], out[i]);
+    }
+}
+
+/* ============== BLAKE2BP ============== */
+
+#define BLAKE2BP_STRIDE (BLAKE2BP_PARALLELISM * BLAKE2B_BLOCKBYTES)
+
+static void blake2bp_init_leaf(blake2b_state *S, size_t outlen, size_t keylen, uint64_t offset) {
+    init_param(S, outlen, keylen, BLAKE2BP_PARALLELISM, 2, offset, 0, BLAKE2B_OUTBYTES);
+    /* Leaves always produce a full inner digest for the root. */
+    S->outlen = BLAKE2B_OUTBYTES;
+    S->last_node = offset == BLAKE2BP_PARALLELISM - 1;
+}
+
+int blake2bp_init_key(blake2bp_state *S, size_t outlen, const void *key, size_t keylen) {
+    if (S == NULL || outlen == 0 || outlen > BLAKE2B_OUTBYTES) return -1;
+    if (keylen > BLAKE2B_KEYBYTES || (key == NULL && keylen != 0)) return -1;
+
+    memset(S->buf, 0, sizeof(S->buf));
+    S->buflen = 0;
+    S->outlen = outlen;
+
+    init_param(&S->R, outlen, keylen, BLAKE2BP_PARALLELISM, 2, 0, 1, BLAKE2B_OUTBYTES);
+    S->R.last_node = 1;
+    for (size_t i = 0; i < BLAKE2BP_PARALLELISM; ++i) {
+        blake2bp_init_leaf(&S->S[i], outlen, keylen, i);
+        if (keylen != 0) {
+            absorb_key(&S->S[i], key, keylen);
+        }
+    }
+    return 0;
+}
+
+int blake2bp_init(blake2bp_state *S, size_t outlen) {
+    return blake2bp_init_key(S, outlen, NULL, 0);
+}
+
+/*
+ * Absorb whole strides into count consecutive leaves in lockstep: leaf i
+ * takes block i of every stride, with in pointing at the first leaf's
+ * block. Like blake2b_update, each leaf keeps its latest block buffered for
+ * final, so the leaves of a group are always all buffered or all empty.
+ */
+static void leaves_absorb(blake2b_state *leaves, size_t count, const uint8_t *in,
+                          size_t strides) {
+    blake2b_state *S[BLAKE2BP_PARALLELISM] = {NULL};
+    const uint8_t *blocks[BLAKE2BP_PARALLELISM] = {NULL};
+
+    if (strides == 0) return;
+    for (size_t i = 0; i < count; ++i) {
+        S[i] = &leaves[i];
+    }
+
+    if (leaves[0].buflen == BLAKE2B_BLOCKBYTES) {
+        for (size_t i = 0; i < count; ++i) {
+            increment_counter(S[i], BLAKE2B_BLOCKBYTES);
+            S[i]->buflen = 0;
+            blocks[i] = S[i]->buf;
+        }
+        argon2_blake2b_compress_many(S, blocks, count);
+    }
+    for (size_t s = 0; s + 1 < strides; ++s) {
+        for (size_t i = 0; i < count; ++i) {
+            increment_counter(S[i], BLAKE2B_BLOCKBYTES);
+            blocks[i] = in + s * BLAKE2BP_STRIDE + i * BLAKE2B_BLOCKBYTES;
+        }
+        argon2_blake2b_compress_many(S, blocks, count);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        memcpy(S[i]->buf, in + (strides - 1) * BLAKE2BP_STRIDE + i * BLAKE2B_BLOCKBYTES,
+               BLAKE2B_BLOCKBYTES);
+        S[i]->buflen = BLAKE2B_BLOCKBYTES;
+    }
+}
+
+int blake2bp_update(blake2bp_state *S, const void *in, size_t inlen) {
+    const uint8_t *pin = (const uint8_t *)in;
+
+    if (inlen == 0) return 0;
+    if (S == NULL || in == NULL) return -1;
+
+    size_t left = S->buflen;
+    size_t fill = sizeof(S->buf) - left;
+
+    if (left != 0 && inlen >= fill) {
+        memcpy(S->buf + left, pin, fill);
+        for (size_t i = 0; i < BLAKE2BP_PARALLELISM; ++i) {
+            blake2b_update(&S->S[i], S->buf + i * BLAKE2B_BLOCKBYTES, BLAKE2B_BLOCKBYTES);
+        }
+        pin += fill;
+        inlen -= fill;
+        left = 0;
+    }
+
+    size_t strides = inlen / BLAKE2BP_STRIDE;
+    leaves_absorb(S->S, BLAKE2BP_PARALLELISM, pin, strides);
+    pin += strides * BLAKE2BP_STRIDE;
+    inlen -= strides * BLAKE2BP_STRIDE;
+
+    if (inlen > 0) {
+        memcpy(S->buf + left, pin, inlen);
+    }
+    S->buflen = left + inlen;
+    return 0;
+}
+
+int blake2bp_final(blake2bp_state *S, void *out, size_t outlen) {
+    uint8_t hash[BLAKE2BP_PARALLELISM][BLAKE2B_OUTBYTES];
+
+    if (S == NULL || out == NULL || outlen < S->outlen) return -1;
+
+    for (size_t i = 0; i < BLAKE2BP_PARALLELISM; ++i) {
+        if (S->buflen > i * BLAKE2B_BLOCKBYTES) {
+            size_t left = S->buflen - i * BLAKE2B_BLOCKBYTES;
+            if (left > BLAKE2B_BLOCKBYTES) left = BLAKE2B_BLOCKBYTES;
+            blake2b_update(&S->S[i], S->buf + i * BLAKE2B_BLOCKBYTES, left);
+        }
+        blake2b_final(&S->S[i], hash[i], BLAKE2B_OUTBYTES);
+    }
+    for (size_t i = 0; i < BLAKE2BP_PARALLELISM; ++i) {
+        blake2b_update(&S->R, hash[i], BLAKE2B_OUTBYTES);
+    }
+    argon2_secure_wipe(hash, sizeof(hash));
+    argon2_secure_wipe(S->buf, sizeof(S->buf));
+    return blake2b_final(&S->R, out, S->outlen);
+}
+
+/*
+ * One-shot leaf group: the whole strides in lockstep, then each leaf's
+ * share of the tail (which may be empty) and its digest.
+ */
+typedef struct {
+    blake2b_state *leaves;
+    const uint8_t *in;
+    size_t inlen;
+    size_t first;
+    size_t count;
+    uint8_t (*hash)[BLAKE2B_OUTBYTES];
+} blake2bp_group;
+
+static void blake2bp_group_run(const blake2bp_group *group) {
+    size_t strides = group->inlen / BLAKE2BP_STRIDE;
+    size_t tail = group->inlen % BLAKE2BP_STRIDE;
+    const uint8_t *rest = group->in + strides * BLAKE2BP_STRIDE;
+
+    leaves_absorb(group->leaves + group->first, group->count,
+                  group->in + group->first * BLAKE2B_BLOCKBYTES, strides);
+    for (size_t i = group->first; i < group->first + group->count; ++i) {
+        if (tail > i * BLAKE2B_BLOCKBYTES) {
+            size_t left = tail - i * BLAKE2B_BLOCKBYTES;
+            if (left > BLAKE2B_BLOCKBYTES) left = BLAKE2B_BLOCKBYTES;
+            blake2b_update(&group->leaves[i], rest + i * BLAKE2B_BLOCKBYTES, left);
+        }
+        blake2b_final(&group->leaves[i], group->hash[i], BLAKE2B_OUTBYTES);
+    }
+}
+
+#ifndef ARGON2_NO_THREADS
+
+static void *blake2bp_worker(void *arg) {
+    blake2bp_group_run((const blake2bp_group *)arg);
+    return NULL;
+}
+
+/*
+ * Leaf groups to run in parallel: 1, 2 or 4, bounded by the thread limit
+ * and online CPUs. Small inputs stay on the caller's thread.
+ */
+static size_t blake2bp_groups(size_t inlen) {
+    if (inlen < BLAKE2BP_THREAD_MIN) {
+        return 1;
+    }
+    size_t groups = BLAKE2BP_PARALLELISM;
+    uint32_t limit = argon2_thread_limit();
+    if (limit != 0 && limit < groups) {
+        groups = limit;
+    }
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus > 0 && (size_t)cpus < groups) {
+        groups = (size_t)cpus;
+    }
+    return groups >= 4 ? 4 : groups >= 2 ? 2 : 1;
+}
+
+#endif /* ARGON2_NO_THREADS */
+
+int blake2bp(void *out, size_t outlen, const void *in, size_t inlen,
+             const void *key, size_t keylen) {
+    blake2bp_state S;
+    uint8_t hash[BLAKE2BP_PARALLELISM][BLAKE2B_OUTBYTES];
+    blake2bp_group groups[BLAKE2BP_PARALLELISM];
+    size_t group_count = 1;
+
+    if (out == NULL || (in == NULL && inlen != 0)) return -1;
+    if (blake2bp_init_key(&S, outlen, key, keylen) != 0) return -1;
+
+#ifndef ARGON2_NO_THREADS
+    group_count = blake2bp_groups(inlen);
+#endif
+    for (size_t g = 0; g < group_count; ++g) {
+        groups[g].leaves = S.S;
+        groups[g].in = (const uint8_t *)in;
+        groups[g].inlen = inlen;
+        groups[g].count = BLAKE2BP_PARALLELISM / group_count;
+        groups[g].first = g * groups[g].count;
+        groups[g].hash = hash;
+    }
+
+#ifndef ARGON2_NO_THREADS
+    pthread_t threads[BLAKE2BP_PARALLELISM];
+    size_t started = 0;
+
+    /* Group 0 runs on this thread; groups that fail to start run inline. */
+    for (size_t g = 1; g < group_count; ++g) {
+        if (pthread_create(&threads[g], NULL, blake2bp_worker, &groups[g]) != 0) {
+            break;
+        }
+        started = g;
+    }
+    for (size_t g = started + 1; g < group_count; ++g) {
+        blake2bp_group_run(&groups[g]);
+    }
+    blake2bp_group_run(&groups[0]);
+    for (size_t g = 1; g <= started; ++g) {
+        pthread_join(threads[g], NULL);
+    }
+#else
+    blake2bp_group_run(&groups[0]);
+#endif
+
+    for (size_t i = 0; i < BLAKE2BP_PARALLELISM; ++i) {
+        blake2b_update(&S.R, hash[i], BLAKE2B_OUTBYTES);
+    }
+    argon2_secure_wipe(hash, sizeof(hash));
+    return blake2b_final(&S.R, out, outlen);
+}
@@ -0,0 +1,105 @@
+/*
+ * Multi-buffer BLAKE2b compression for ARM NEON: two independent states,
+ * one per 64-bit lane, so each G is vertical arithmetic on uint64x2_t with
+ * no diagonal shuffles. Rotations match fill_block_neon.c.
+ */
+
+#include "argon2_internal.h"
+
+#if defined(ARGON2_HAVE_NEON_KERNEL)
+
+#include <arm_neon.h>
+
+static inline uint64x2_t rotr32_neon(uint64x2_t x) {
+    return vreinterpretq_u64_u32(vrev64q_u32(vreinterpretq_u32_u64(x)));
+}
+
+static inline uint64x2_t rotr24_neon(uint64x2_t x) {
+    return vsriq_n_u64(vshlq_n_u64(x, 40), x, 24);
+}
+
+static inline uint64x2_t rotr16_neon(uint64x2_t x) {
+    return vsriq_n_u64(vshlq_n_u64(x, 48), x, 16);
+}
+
+static inline uint64x2_t rotr63_neon(uint64x2_t x) {
+    return vsriq_n_u64(vshlq_n_u64(x, 1), x, 63);
+}
+
+#define G2(r, i, a, b, c, d)                                                    \
+    do {                                                                        \
+        a = vaddq_u64(vaddq_u64(a, b), m[argon2_blake2b_sigma[r][2*i+0]]);      \
+        d = rotr32_neon(veorq_u64(d, a));                                       \
+        c = vaddq_u64(c, d);                                                    \
+        b = rotr24_neon(veorq_u64(b, c));                                       \
+        a = vaddq_u64(vaddq_u64(a, b), m[argon2_blake2b_sigma[r][2*i+1]]);      \
+        d = rotr16_neon(veorq_u64(d, a));                                       \
+        c = vaddq_u64(c, d);                                                    \
+        b = rotr63_neon(veorq_u64(b, c));                                       \
+    } while (0)
+
+#define ROUND2(r)                               \
+    do {                                        \
+        G2(r, 0, v[0], v[4], v[8], v[12]);      \
+        G2(r, 1, v[1], v[5], v[9], v[13]);      \
+        G2(r, 2, v[2], v[6], v[10], v[14]);     \
+        G2(r, 3, v[3], v[7], v[11], v[15]);     \
+        G2(r, 4, v[0], v[5], v[10], v[15]);     \
+        G2(r, 5, v[1], v[6], v[11], v[12]);     \
+        G2(r, 6, v[2], v[7], v[8], v[13]);      \
+        G2(r, 7, v[3], v[4], v[9], v[14]);      \
+    } while (0)
+
+/* Lane 0 from x, lane 1 from y: the low or high words of each. */
+#define ZIP_LO(x, y) vcombine_u64(vget_low_u64(x), vget_low_u64(y))
+#define ZIP_HI(x, y) vcombine_u64(vget_high_u64(x), vget_high_u64(y))
+
+void argon2_blake2b_compress2_neon(blake2b_state *const S[2], const uint8_t *const blocks[2]) {
+    uint64x2_t m[16], v[16], h[8];
+
+    for (size_t i = 0; i < 8; ++i) {
+        uint64x2_t x = vreinterpretq_u64_u8(vld1q_u8(blocks[0] + 16 * i));
+        uint64x2_t y = vreinterpretq_u64_u8(vld1q_u8(blocks[1] + 16 * i));
+        m[2 * i + 0] = ZIP_LO(x, y);
+        m[2 * i + 1] = ZIP_HI(x, y);
+    }
+    for (size_t i = 0; i < 4; ++i) {
+        uint64x2_t x = vld1q_u64(&S[0]->h[2 * i]);
+        uint64x2_t y = vld1q_u64(&S[1]->h[2 * i]);
+        h[2 * i + 0] = ZIP_LO(x, y);
+        h[2 * i + 1] = ZIP_HI(x, y);
+    }
+
+    for (size_t i = 0; i < 8; ++i) {
+        v[i] = h[i];
+        v[i + 8] = vdupq_n_u64(argon2_blake2b_IV[i]);
+    }
+    uint64x2_t t0 = vld1q_u64(&S[0]->t[0]), t1 = vld1q_u64(&S[1]->t[0]);
+    uint64x2_t f0 = vld1q_u64(&S[0]->f[0]), f1 = vld1q_u64(&S[1]->f[0]);
+    v[12] = veorq_u64(v[12], ZIP_LO(t0, t1));
+    v[13] = veorq_u64(v[13], ZIP_HI(t0, t1));
+    v[14] = veorq_u64(v[14], ZIP_LO(f0, f1));
+    v[15] = veorq_u64(v[15], ZIP_HI(f0, f1));
+
+    ROUND2(0);
+    ROUND2(1);
+    ROUND2(2);
+    ROUND2(3);
+    ROUND2(4);
+    ROUND2(5);
+    ROUND2(6);
+    ROUND2(7);
+    ROUND2(8);
+    ROUND2(9);
+    ROUND2(10);
+    ROUND2(11);
+
+    for (size_t i = 0; i < 4; ++i) {
+        uint64x2_t x = veorq_u64(h[2 * i + 0], veorq_u64(v[2 * i + 0], v[2 * i + 8]));
+        uint64x2_t y = veorq_u64(h[2 * i + 1], veorq_u64(v[2 * i + 1], v[2 * i + 9]));
+        vst1q_u64(&S[0]->h[2 * i], ZIP_LO(x, y));
+        vst1q_u64(&S[1]->h[2 * i], ZIP_HI(x, y));
+    }
+}
+
+#endif /* ARGON2_HAVE_NEON_KERNEL */
@@ -0,0 +1,237 @@
+/*
+ * Multi-buffer BLAKE2b compression for x86-64: four independent states per
+ * AVX2 register, eight per AVX-512 register, one per 64-bit lane.
+ *
+ * v[i] holds word i of every state, so each G is plain vertical
+ * arithmetic with no diagonal shuffles. A single-message AVX2 compression
+ * (one row per register) was no faster than the scalar code, which
+ * already has four independent G chains per half-round. Built with a
+ * per-function target attribute like fill_block_x86.c.
+ */
+
+#include "argon2_internal.h"
+
+#if defined(ARGON2_HAVE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define ARGON2_TARGET(isa) __attribute__((target(isa)))
+
+#define ROTR32_256(x) _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR24_256(x)                                                            \
+    _mm256_shuffle_epi8((x), _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2,              \
+                                              11, 12, 13, 14, 15, 8, 9, 10,        \
+                                              3, 4, 5, 6, 7, 0, 1, 2,              \
+                                              11, 12, 13, 14, 15, 8, 9, 10))
+#define ROTR16_256(x)                                                            \
+    _mm256_shuffle_epi8((x), _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1,              \
+                                              10, 11, 12, 13, 14, 15, 8, 9,        \
+                                              2, 3, 4, 5, 6, 7, 0, 1,              \
+                                              10, 11, 12, 13, 14, 15, 8, 9))
+#define ROTR63_256(x) _mm256_xor_si256(_mm256_srli_epi64((x), 63), _mm256_add_epi64((x), (x)))
+
+#define G4(r, i, a, b, c, d)                                                        \
+    do {                                                                            \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), m[argon2_blake2b_sigma[r][2*i+0]]); \
+        d = ROTR32_256(_mm256_xor_si256(d, a));                                     \
+        c = _mm256_add_epi64(c, d);                                                 \
+        b = ROTR24_256(_mm256_xor_si256(b, c));                                     \
+        a = _mm256_add_epi64(_mm256_add_epi64(a, b), m[argon2_blake2b_sigma[r][2*i+1]]); \
+        d = ROTR16_256(_mm256_xor_si256(d, a));                                     \
+        c = _mm256_add_epi64(c, d);                                                 \
+        b = ROTR63_256(_mm256_xor_si256(b, c));                                     \
+    } while (0)
+
+#define ROUND4(r)                               \
+    do {                                        \
+        G4(r, 0, v[0], v[4], v[8], v[12]);      \
+        G4(r, 1, v[1], v[5], v[9], v[13]);      \
+        G4(r, 2, v[2], v[6], v[10], v[14]);     \
+        G4(r, 3, v[3], v[7], v[11], v[15]);     \
+        G4(r, 4, v[0], v[5], v[10], v[15]);     \
+        G4(r, 5, v[1], v[6], v[11], v[12]);     \
+        G4(r, 6, v[2], v[7], v[8], v[13]);      \
+        G4(r, 7, v[3], v[4], v[9], v[14]);      \
+    } while (0)
+
+/* 4x4 transpose of 64-bit words: row j of the input is lane j of the output. */
+#define TRANSPOSE4(r0, r1, r2, r3)                                  \
+    do {                                                            \
+        __m256i t0 = _mm256_unpacklo_epi64(r0, r1);                 \
+        __m256i t1 = _mm256_unpackhi_epi64(r0, r1);                 \
+        __m256i t2 = _mm256_unpacklo_epi64(r2, r3);                 \
+        __m256i t3 = _mm256_unpackhi_epi64(r2, r3);                 \
+        r0 = _mm256_permute2x128_si256(t0, t2, 0x20);               \
+        r1 = _mm256_permute2x128_si256(t1, t3, 0x20);               \
+        r2 = _mm256_permute2x128_si256(t0, t2, 0x31);               \
+        r3 = _mm256_permute2x128_si256(t1, t3, 0x31);               \
+    } while (0)
+
+#define LOAD256(p) _mm256_loadu_si256((const __m256i *)(const void *)(p))
+#define STORE256(p, x) _mm256_storeu_si256((__m256i *)(void *)(p), (x))
+
+ARGON2_TARGET("avx2")
+void argon2_blake2b_compress4_avx2(blake2b_state *const S[4], const uint8_t *const blocks[4]) {
+    __m256i m[16], v[16], h[8];
+
+    for (size_t k = 0; k < 4; ++k) {
+        m[4 * k + 0] = LOAD256(blocks[0] + 32 * k);
+        m[4 * k + 1] = LOAD256(blocks[1] + 32 * k);
+        m[4 * k + 2] = LOAD256(blocks[2] + 32 * k);
+        m[4 * k + 3] = LOAD256(blocks[3] + 32 * k);
+        TRANSPOSE4(m[4 * k + 0], m[4 * k + 1], m[4 * k + 2], m[4 * k + 3]);
+    }
+    for (size_t k = 0; k < 2; ++k) {
+        h[4 * k + 0] = LOAD256(&S[0]->h[4 * k]);
+        h[4 * k + 1] = LOAD256(&S[1]->h[4 * k]);
+        h[4 * k + 2] = LOAD256(&S[2]->h[4 * k]);
+        h[4 * k + 3] = LOAD256(&S[3]->h[4 * k]);
+        TRANSPOSE4(h[4 * k + 0], h[4 * k + 1], h[4 * k + 2], h[4 * k + 3]);
+    }
+
+    for (size_t i = 0; i < 8; ++i) {
+        v[i] = h[i];
+        v[i + 8] = _mm256_set1_epi64x((long long)argon2_blake2b_IV[i]);
+    }
+    /* t and f are laid out contiguously: one transpose gives v[12..15]. */
+    __m256i tf0 = LOAD256(&S[0]->t[0]);
+    __m256i tf1 = LOAD256(&S[1]->t[0]);
+    __m256i tf2 = LOAD256(&S[2]->t[0]);
+    __m256i tf3 = LOAD256(&S[3]->t[0]);
+    TRANSPOSE4(tf0, tf1, tf2, tf3);
+    v[12] = _mm256_xor_si256(v[12], tf0);
+    v[13] = _mm256_xor_si256(v[13], tf1);
+    v[14] = _mm256_xor_si256(v[14], tf2);
+    v[15] = _mm256_xor_si256(v[15], tf3);
+
+    ROUND4(0);
+    ROUND4(1);
+    ROUND4(2);
+    ROUND4(3);
+    ROUND4(4);
+    ROUND4(5);
+    ROUND4(6);
+    ROUND4(7);
+    ROUND4(8);
+    ROUND4(9);
+    ROUND4(10);
+    ROUND4(11);
+
+    for (size_t i = 0; i < 8; ++i)
+        h[i] = _mm256_xor_si256(h[i], _mm256_xor_si256(v[i], v[i + 8]));
+    for (size_t k = 0; k < 2; ++k) {
+        TRANSPOSE4(h[4 * k + 0], h[4 * k + 1], h[4 * k + 2], h[4 * k + 3]);
+        STORE256(&S[0]->h[4 * k], h[4 * k + 0]);
+        STORE256(&S[1]->h[4 * k], h[4 * k + 1]);
+        STORE256(&S[2]->h[4 * k], h[4 * k + 2]);
+        STORE256(&S[3]->h[4 * k], h[4 * k + 3]);
+    }
+}
+
+/* ---- AVX-512: eight states ---- */
+
+#define G8(r, i, a, b, c, d)                                                        \
+    do {                                                                            \
+        a = _mm512_add_epi64(_mm512_add_epi64(a, b), m[argon2_blake2b_sigma[r][2*i+0]]); \
+        d = _mm512_ror_epi64(_mm512_xor_si512(d, a), 32);                          \
+        c = _mm512_add_epi64(c, d);                                                 \
+        b = _mm512_ror_epi64(_mm512_xor_si512(b, c), 24);                          \
+        a = _mm512_add_epi64(_mm512_add_epi64(a, b), m[argon2_blake2b_sigma[r][2*i+1]]); \
+        d = _mm512_ror_epi64(_mm512_xor_si512(d, a), 16);                          \
+        c = _mm512_add_epi64(c, d);                                                 \
+        b = _mm512_ror_epi64(_mm512_xor_si512(b, c), 63);                          \
+    } while (0)
+
+#define ROUND8(r)                               \
+    do {                                        \
+        G8(r, 0, v[0], v[4], v[8], v[12]);      \
+        G8(r, 1, v[1], v[5], v[9], v[13]);      \
+        G8(r, 2, v[2], v[6], v[10], v[14]);     \
+        G8(r, 3, v[3], v[7], v[11], v[15]);     \
+        G8(r, 4, v[0], v[5], v[10], v[15]);     \
+        G8(r, 5, v[1], v[6], v[11], v[12]);     \
+        G8(r, 6, v[2], v[7], v[8], v[13]);      \
+        G8(r, 7, v[3], v[4], v[9], v[14]);      \
+    } while (0)
+
+/*
+ * 8x8 transpose of 64-bit words in place: pair rows with unpack, then
+ * regroup 128-bit lanes twice. 0x88 picks lanes (0, 2, 0, 2), 0xdd (1, 3, 1, 3).
+ */
+ARGON2_TARGET("avx512f")
+static inline void transpose8(__m512i r[8]) {
+    __m512i t[8], u[8];
+
+    for (size_t k = 0; k < 4; ++k) {
+        t[2 * k + 0] = _mm512_unpacklo_epi64(r[2 * k], r[2 * k + 1]);
+        t[2 * k + 1] = _mm512_unpackhi_epi64(r[2 * k], r[2 * k + 1]);
+    }
+    /* u[0..3]: even words, u[4..7]: odd words. */
+    for (size_t odd = 0; odd < 2; ++odd) {
+        u[4 * odd + 0] = _mm512_shuffle_i64x2(t[odd + 0], t[odd + 2], 0x88);
+        u[4 * odd + 1] = _mm512_shuffle_i64x2(t[odd + 4], t[odd + 6], 0x88);
+        u[4 * odd + 2] = _mm512_shuffle_i64x2(t[odd + 0], t[odd + 2], 0xdd);
+        u[4 * odd + 3] = _mm512_shuffle_i64x2(t[odd + 4], t[odd + 6], 0xdd);
+    }
+    r[0] = _mm512_shuffle_i64x2(u[0], u[1], 0x88);
+    r[4] = _mm512_shuffle_i64x2(u[0], u[1], 0xdd);
+    r[2] = _mm512_shuffle_i64x2(u[2], u[3], 0x88);
+    r[6] = _mm512_shuffle_i64x2(u[2], u[3], 0xdd);
+    r[1] = _mm512_shuffle_i64x2(u[4], u[5], 0x88);
+    r[5] = _mm512_shuffle_i64x2(u[4], u[5], 0xdd);
+    r[3] = _mm512_shuffle_i64x2(u[6], u[7], 0x88);
+    r[7] = _mm512_shuffle_i64x2(u[6], u[7], 0xdd);
+}
+
+#define LOAD512(p) _mm512_loadu_si512((const void *)(p))
+#define STORE512(p, x) _mm512_storeu_si512((void *)(p), (x))
+
+ARGON2_TARGET("avx512f")
+void argon2_blake2b_compress8_avx512(blake2b_state *const S[8], const uint8_t *const blocks[8]) {
+    __m512i m[16], v[16], h[8];
+
+    for (size_t j = 0; j < 8; ++j) {
+        m[j] = LOAD512(blocks[j]);
+        m[j + 8] = LOAD512(blocks[j] + 64);
+        h[j] = LOAD512(S[j]->h);
+    }
+    transpose8(m);
+    transpose8(m + 8);
+    transpose8(h);
+
+    for (size_t i = 0; i < 8; ++i) {
+        v[i] = h[i];
+        v[i + 8] = _mm512_set1_epi64((long long)argon2_blake2b_IV[i]);
+    }
+    /* Counters and finalization flags: one word from each state. */
+#define WORD8(field) _mm512_setr_epi64(                                          \
+        (long long)S[0]->field, (long long)S[1]->field, (long long)S[2]->field,   \
+        (long long)S[3]->field, (long long)S[4]->field, (long long)S[5]->field,   \
+        (long long)S[6]->field, (long long)S[7]->field)
+    v[12] = _mm512_xor_si512(v[12], WORD8(t[0]));
+    v[13] = _mm512_xor_si512(v[13], WORD8(t[1]));
+    v[14] = _mm512_xor_si512(v[14], WORD8(f[0]));
+    v[15] = _mm512_xor_si512(v[15], WORD8(f[1]));
+#undef WORD8
+
+    ROUND8(0);
+    ROUND8(1);
+    ROUND8(2);
+    ROUND8(3);
+    ROUND8(4);
+    ROUND8(5);
+    ROUND8(6);
+    ROUND8(7);
+    ROUND8(8);
+    ROUND8(9);
+    ROUND8(10);
+    ROUND8(11);
+
+    for (size_t i = 0; i < 8; ++i)
+        h[i] = _mm512_xor_si512(h[i], _mm512_xor_si512(v[i], v[i + 8]));
+    transpose8(h);
+    for (size_t j = 0; j < 8; ++j)
+        STORE512(S[j]->h, h[j]);
+}
+
+#endif /* ARGON2_HAVE_X86_KERNELS */
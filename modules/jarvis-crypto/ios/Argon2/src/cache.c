@@ -0,0 +1,297 @@
+/*
+ * Derived-key cache - a small fixed table of (input MAC, tag) entries in
+ * locked memory, scanned linearly: it holds a handful of keys, so a scan
+ * costs less than keeping an index in sync.
+ */
+
+#include "argon2_internal.h"
+#include "../include/argon2_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef ARGON2_NO_THREADS
+#include <pthread.h>
+#endif
+
+#define CACHE_IDBYTES 32
+#define CACHE_MAX_ENTRIES 1024
+
+typedef struct {
+    uint8_t id[CACHE_IDBYTES];
+    uint8_t tag[ARGON2_CACHE_MAX_TAGBYTES];
+    uint32_t taglen;        /* 0 = free slot */
+    uint64_t expires;       /* ns, cache_now() clock */
+    uint64_t last_used;     /* cache tick, for LRU eviction */
+} cache_entry;
+
+/* Everything secret lives here, in the locked block. */
+typedef struct {
+    uint8_t mac_key[BLAKE2B_KEYBYTES];
+    cache_entry entries[];
+} cache_memory;
+
+struct Argon2_cache {
+    cache_memory *memory;
+    size_t memory_bytes;
+    uint32_t capacity;
+    uint64_t ttl_ns;
+    uint64_t tick;
+    int locked;
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_t mutex;
+#endif
+};
+
+static void lock(argon2_cache *cache) {
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_lock(&cache->mutex);
+#else
+    (void)cache;
+#endif
+}
+
+static void unlock(argon2_cache *cache) {
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_unlock(&cache->mutex);
+#else
+    (void)cache;
+#endif
+}
+
+/* Includes time asleep, so a TTL is not stretched by the device suspending. */
+static uint64_t cache_now(void) {
+    struct timespec ts;
+#if defined(CLOCK_BOOTTIME)
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts); /* Darwin: counts sleep already */
+#endif
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void mac_u32(blake2b_state *S, uint32_t v) {
+    uint8_t le[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+    blake2b_update(S, le, sizeof(le));
+}
+
+static void mac_field(blake2b_state *S, const uint8_t *data, uint32_t len) {
+    mac_u32(S, len);
+    if (len != 0) {
+        blake2b_update(S, data, len);
+    }
+}
+
+/* Length-prefixed like H0, so no two different inputs share an encoding. */
+static void entry_id(const argon2_cache *cache, const argon2_context *context,
+                     argon2_type type, uint8_t id[CACHE_IDBYTES]) {
+    blake2b_state S;
+
+    blake2b_init_key(&S, CACHE_IDBYTES, cache->memory->mac_key, BLAKE2B_KEYBYTES);
+    mac_u32(&S, (uint32_t)type);
+    mac_u32(&S, context->version);
+    mac_u32(&S, context->t_cost);
+    mac_u32(&S, context->m_cost);
+    mac_u32(&S, context->lanes);
+    mac_u32(&S, context->outlen);
+    mac_field(&S, context->pwd, context->pwdlen);
+    mac_field(&S, context->salt, context->saltlen);
+    mac_field(&S, context->secret, context->secretlen);
+    mac_field(&S, context->ad, context->adlen);
+    blake2b_final(&S, id, CACHE_IDBYTES);
+}
+
+static int id_equal(const uint8_t *a, const uint8_t *b) {
+    uint8_t diff = 0;
+    for (size_t i = 0; i < CACHE_IDBYTES; ++i) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+static void entry_wipe(cache_entry *entry) {
+    argon2_secure_wipe(entry, sizeof(*entry));
+}
+
+/*
+ * Drops expired entries and returns the live one matching id, or NULL.
+ * The caller holds the lock.
+ */
+static cache_entry *find_entry(argon2_cache *cache, const uint8_t id[CACHE_IDBYTES],
+                               uint64_t now) {
+    cache_entry *found = NULL;
+    for (uint32_t i = 0; i < cache->capacity; ++i) {
+        cache_entry *entry = &cache->memory->entries[i];
+        if (entry->taglen == 0) {
+            continue;
+        }
+        if (entry->expires <= now) {
+            entry_wipe(entry);
+        } else if (id != NULL && id_equal(entry->id, id)) {
+            found = entry;
+        }
+    }
+    return found;
+}
+
+int argon2_cache_create(argon2_cache **cache, uint32_t entries, uint32_t ttl_ms) {
+    if (cache == NULL) return ARGON2_OUTPUT_PTR_NULL;
+    *cache = NULL;
+    if (entries < 1 || entries > CACHE_MAX_ENTRIES || ttl_ms == 0) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+
+    argon2_cache *c = (argon2_cache *)calloc(1, sizeof(*c));
+    if (c == NULL) {
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+#ifndef ARGON2_NO_THREADS
+    if (pthread_mutex_init(&c->mutex, NULL) != 0) {
+        free(c);
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+#endif
+
+    long page = sysconf(_SC_PAGESIZE);
+    size_t page_size = page > 0 ? (size_t)page : 4096;
+    size_t bytes = sizeof(cache_memory) + (size_t)entries * sizeof(cache_entry);
+    bytes = (bytes + page_size - 1) & ~(page_size - 1);
+
+    void *memory = NULL;
+    if (posix_memalign(&memory, page_size, bytes) != 0) {
+        argon2_cache_destroy(c);
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+    memset(memory, 0, bytes);
+    /* Best effort, as for ARGON2_ARENA_LOCK. */
+    c->locked = (mlock(memory, bytes) == 0);
+#if defined(MADV_DONTDUMP)
+    (void)madvise(memory, bytes, MADV_DONTDUMP);
+#endif
+
+    c->memory = (cache_memory *)memory;
+    c->memory_bytes = bytes;
+    c->capacity = entries;
+    c->ttl_ns = (uint64_t)ttl_ms * 1000000u;
+
+    if (argon2_os_random(c->memory->mac_key, sizeof(c->memory->mac_key)) != 0) {
+        argon2_cache_destroy(c);
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+    *cache = c;
+    return ARGON2_OK;
+}
+
+void argon2_cache_destroy(argon2_cache *cache) {
+    if (cache == NULL) return;
+    if (cache->memory != NULL) {
+        argon2_secure_wipe(cache->memory, cache->memory_bytes);
+        if (cache->locked) {
+            munlock(cache->memory, cache->memory_bytes);
+        }
+        free(cache->memory);
+    }
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_destroy(&cache->mutex);
+#endif
+    free(cache);
+}
+
+int argon2_cache_lookup(argon2_cache *cache, const argon2_context *context, argon2_type type) {
+    uint8_t id[CACHE_IDBYTES];
+
+    if (cache == NULL) return ARGON2_INCORRECT_PARAMETER;
+    int result = argon2_check_context(context, type);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+    if (context->outlen > ARGON2_CACHE_MAX_TAGBYTES) {
+        return ARGON2_CACHE_MISS;
+    }
+
+    /* The MAC key never changes, so the id is computed outside the lock. */
+    entry_id(cache, context, type, id);
+
+    lock(cache);
+    cache_entry *entry = find_entry(cache, id, cache_now());
+    if (entry != NULL && entry->taglen == context->outlen) {
+        memcpy(context->out, entry->tag, entry->taglen);
+        entry->last_used = ++cache->tick;
+        result = ARGON2_OK;
+    } else {
+        result = ARGON2_CACHE_MISS;
+    }
+    unlock(cache);
+
+    argon2_secure_wipe(id, sizeof(id));
+    return result;
+}
+
+int argon2_cache_store(argon2_cache *cache, const argon2_context *context, argon2_type type) {
+    uint8_t id[CACHE_IDBYTES];
+
+    if (cache == NULL) return ARGON2_INCORRECT_PARAMETER;
+    int result = argon2_check_context(context, type);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+    if (context->outlen > ARGON2_CACHE_MAX_TAGBYTES) {
+        return ARGON2_OUTPUT_TOO_LONG;
+    }
+
+    entry_id(cache, context, type, id);
+
+    lock(cache);
+    uint64_t now = cache_now();
+    cache_entry *entry = find_entry(cache, id, now);
+    if (entry == NULL) {
+        /* A free slot, else the least recently used entry. */
+        for (uint32_t i = 0; i < cache->capacity; ++i) {
+            cache_entry *candidate = &cache->memory->entries[i];
+            if (candidate->taglen == 0) {
+                entry = candidate;
+                break;
+            }
+            if (entry == NULL || candidate->last_used < entry->last_used) {
+                entry = candidate;
+            }
+        }
+        entry_wipe(entry);
+        memcpy(entry->id, id, CACHE_IDBYTES);
+    }
+    memcpy(entry->tag, context->out, context->outlen);
+    entry->taglen = context->outlen;
+    entry->expires = now + cache->ttl_ns;
+    entry->last_used = ++cache->tick;
+    unlock(cache);
+
+    argon2_secure_wipe(id, sizeof(id));
+    return ARGON2_OK;
+}
+
+void argon2_cache_clear(argon2_cache *cache) {
+    if (cache == NULL) return;
+    lock(cache);
+    argon2_secure_wipe(cache->memory->entries, (size_t)cache->capacity * sizeof(cache_entry));
+    unlock(cache);
+}
+
+uint32_t argon2_cache_count(argon2_cache *cache) {
+    uint32_t count = 0;
+
+    if (cache == NULL) return 0;
+    lock(cache);
+    find_entry(cache, NULL, cache_now());
+    for (uint32_t i = 0; i < cache->capacity; ++i) {
+        count += cache->memory->entries[i].taglen != 0;
+    }
+    unlock(cache);
+    return count;
+}
+
+int argon2_cache_is_locked(const argon2_cache *cache) {
+    return cache != NULL && cache->locked;
+}
@@ -0,0 +1,212 @@
+/*
+ * Argon2 parameter autotuning - times a short probe hash on this device and
+ * turns the measured cost per block into the strongest t/m/p that fits a
+ * wall-time target under a memory ceiling.
+ *
+ * The probe runs two passes through the steppable API so the first-touch
+ * cost of fresh memory (pass 1) and the steady-state compression cost
+ * (pass 2) are measured separately: a real hash pays the first once and
+ * the second t times. The result is cached per process and can be exported
+ * and restored with argon2_get/set_calibration so later launches skip the
+ * probe entirely.
+ */
+
+#include "argon2_internal.h"
+
+#include <string.h>
+#include <time.h>
+
+#ifndef ARGON2_NO_THREADS
+#include <pthread.h>
+#endif
+
+/*
+ * 32 MiB spills the last-level cache of current phones and laptops, so the
+ * probe sees DRAM latency as real hashes do; smaller probes run from cache
+ * and under-predict by up to 2x. Two passes take ~50-150 ms on-device.
+ */
+#define ARGON2_PROBE_M_COST (32 * 1024)
+#define ARGON2_PROBE_RUNS 2
+
+static argon2_calibration cached;
+static int cached_valid;
+
+#ifndef ARGON2_NO_THREADS
+static pthread_mutex_t cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+#define CACHE_LOCK() pthread_mutex_lock(&cache_mutex)
+#define CACHE_UNLOCK() pthread_mutex_unlock(&cache_mutex)
+#else
+#define CACHE_LOCK() ((void)0)
+#define CACHE_UNLOCK() ((void)0)
+#endif
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* One two-pass probe; fills first/steady ns per block of the whole matrix. */
+static int probe_once(uint32_t m_cost, uint32_t lanes, double *first_ns, double *steady_ns) {
+    static const uint8_t salt[16] = "argon2calibrate";
+    uint8_t pwd[8] = "probepwd";
+    uint8_t tag[32];
+    argon2_state *state;
+
+    argon2_context context = {
+        tag, sizeof(tag),
+        pwd, sizeof(pwd),
+        salt, sizeof(salt),
+        NULL, 0, NULL, 0,
+        2, m_cost, lanes, 0,
+        ARGON2_VERSION_NUMBER, 0, NULL
+    };
+    int result = argon2_init(&state, NULL, &context, Argon2_id);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+
+    uint32_t blocks = m_cost / (ARGON2_SYNC_POINTS * lanes) * ARGON2_SYNC_POINTS * lanes;
+    uint32_t pass_segments = ARGON2_SYNC_POINTS * lanes;
+
+    double t0 = now_ns();
+    int first = argon2_step(state, pass_segments);
+    double t1 = now_ns();
+    int second = first == ARGON2_PENDING ? argon2_step(state, pass_segments) : first;
+    double t2 = now_ns();
+
+    /* Two passes are exactly two steps; anything else was not a real fill. */
+    if (first != ARGON2_PENDING || second != ARGON2_OK) {
+        argon2_cancel(state);
+        argon2_finish(state);
+        return second != ARGON2_OK && second != ARGON2_PENDING ? second
+                                                                : ARGON2_INCORRECT_PARAMETER;
+    }
+    result = argon2_finish(state);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+    *first_ns = (t1 - t0) / blocks;
+    *steady_ns = (t2 - t1) / blocks;
+    return ARGON2_OK;
+}
+
+int argon2_measure(argon2_calibration *calibration, uint32_t m_cost, uint32_t lanes) {
+    double best_first = 0, best_steady = 0;
+
+    if (calibration == NULL) return ARGON2_OUTPUT_PTR_NULL;
+    if (lanes < 1) return ARGON2_LANES_TOO_FEW;
+    if (lanes > ARGON2_MAX_LANES) return ARGON2_LANES_TOO_MANY;
+
+    if (m_cost == 0 || m_cost > ARGON2_PROBE_M_COST) {
+        m_cost = ARGON2_PROBE_M_COST;
+    }
+    if (m_cost < 8 * lanes) {
+        m_cost = 8 * lanes;
+    }
+
+    for (int run = 0; run < ARGON2_PROBE_RUNS; ++run) {
+        double first, steady;
+        int result = probe_once(m_cost, lanes, &first, &steady);
+        if (result != ARGON2_OK) {
+            return result;
+        }
+        if (run == 0 || steady < best_steady) {
+            best_steady = steady;
+        }
+        /*
+         * Freed probe memory is often handed straight back by the allocator
+         * already faulted in, so only the worst first pass is representative.
+         */
+        if (first > best_first) {
+            best_first = first;
+        }
+    }
+
+    calibration->ns_per_block = best_steady;
+    calibration->first_touch_ns_per_block = best_first > best_steady ? best_first - best_steady : 0;
+    calibration->lanes = lanes;
+    calibration->kernel = argon2_active_kernel();
+
+    CACHE_LOCK();
+    cached = *calibration;
+    cached_valid = 1;
+    CACHE_UNLOCK();
+    return ARGON2_OK;
+}
+
+int argon2_get_calibration(argon2_calibration *calibration) {
+    if (calibration == NULL) return ARGON2_OUTPUT_PTR_NULL;
+    CACHE_LOCK();
+    int valid = cached_valid;
+    if (valid) {
+        *calibration = cached;
+    }
+    CACHE_UNLOCK();
+    return valid ? ARGON2_OK : ARGON2_INCORRECT_PARAMETER;
+}
+
+void argon2_set_calibration(const argon2_calibration *calibration) {
+    CACHE_LOCK();
+    if (calibration != NULL && calibration->ns_per_block > 0 && calibration->lanes > 0) {
+        cached = *calibration;
+        cached_valid = 1;
+    } else {
+        cached_valid = 0;
+    }
+    CACHE_UNLOCK();
+}
+
+int argon2_calibrate(uint32_t target_ms, uint32_t max_m_cost, uint32_t lanes,
+                     argon2_params *params) {
+    argon2_calibration cal;
+
+    if (params == NULL) return ARGON2_OUTPUT_PTR_NULL;
+    if (target_ms == 0) return ARGON2_TIME_TOO_SMALL;
+    if (lanes < 1) return ARGON2_LANES_TOO_FEW;
+    if (lanes > ARGON2_MAX_LANES) return ARGON2_LANES_TOO_MANY;
+    if (max_m_cost < 8 * lanes) return ARGON2_MEMORY_TOO_LITTLE;
+
+    /* A cached figure is reused only if it describes this lane count and kernel. */
+    if (argon2_get_calibration(&cal) != ARGON2_OK || cal.lanes != lanes ||
+        cal.kernel != argon2_active_kernel()) {
+        int result = argon2_measure(&cal, max_m_cost, lanes);
+        if (result != ARGON2_OK) {
+            return result;
+        }
+    }
+
+    /*
+     * time(t, m) ~= m * (first_touch + t * ns_per_block). Memory is worth
+     * more than passes, so take the largest m whose single pass fits, then
+     * spend what is left of the budget on extra passes.
+     */
+    double budget_ns = (double)target_ms * 1e6;
+    double one_pass = cal.first_touch_ns_per_block + cal.ns_per_block;
+    double m_fit = budget_ns / one_pass;
+    uint32_t m_cost = max_m_cost;
+    if (m_fit < (double)m_cost) {
+        m_cost = (uint32_t)m_fit;
+    }
+    m_cost -= m_cost % (ARGON2_SYNC_POINTS * lanes);
+    if (m_cost < 8 * lanes) {
+        m_cost = 8 * lanes;
+    }
+
+    double per_pass = (double)m_cost * cal.ns_per_block;
+    double passes = (budget_ns - (double)m_cost * cal.first_touch_ns_per_block) / per_pass;
+    /* Segments (t * 4 * lanes) are counted in 32 bits; past that the core refuses t. */
+    double max_passes = (double)(UINT32_MAX / (ARGON2_SYNC_POINTS * lanes));
+    if (passes > max_passes) {
+        passes = max_passes;
+    }
+    uint32_t t_cost = passes >= 1.0 ? (uint32_t)passes : 1;
+
+    double estimated_ms = ((double)m_cost * cal.first_touch_ns_per_block +
+                           (double)t_cost * per_pass) / 1e6 + 0.5;
+    params->t_cost = t_cost;
+    params->m_cost = m_cost;
+    params->lanes = lanes;
+    params->estimated_ms = estimated_ms < (double)UINT32_MAX ? (uint32_t)estimated_ms : UINT32_MAX;
+    return ARGON2_OK;
+}
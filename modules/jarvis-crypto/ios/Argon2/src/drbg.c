@@ -0,0 +1,333 @@
+/*
+ * ChaCha20 fast-key-erasure pool (see drbg.h), and the OS entropy source
+ * it and the derived-key cache seed from.
+ *
+ * Requests are a few dozen bytes, so the portable ChaCha20 below is
+ * plenty: a 1 KiB refill costs about a microsecond and serves dozens of
+ * salts and nonces.
+ */
+
+#include "argon2_internal.h"
+#include "../include/drbg.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+#ifndef ARGON2_NO_THREADS
+#include <pthread.h>
+#endif
+
+#define DRBG_BUFFERBYTES 1024 /* 16 ChaCha20 blocks per refill */
+
+/* Everything secret lives here, in the locked page. */
+typedef struct {
+    uint8_t key[DRBG_SEEDBYTES];
+    uint8_t buffer[DRBG_BUFFERBYTES];
+} drbg_secret;
+
+struct Drbg {
+    drbg_secret *secret;
+    size_t secret_bytes;
+    size_t avail;           /* unserved bytes at the end of buffer */
+    uint64_t since_reseed;  /* bytes handed out */
+    uint64_t reseeded_ns;   /* argon2_now_ns() */
+    unsigned long process;  /* process_id() when last reseeded */
+    int seeded;             /* drbg_create_seeded: never reseeds */
+    int locked;
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_t mutex;
+#endif
+};
+
+#ifndef ARGON2_NO_THREADS
+/* Bumped in the child by an atfork handler; a pool compares it per call. */
+static volatile unsigned long fork_generation;
+static pthread_once_t atfork_once = PTHREAD_ONCE_INIT;
+
+static void forked_child(void) {
+    ++fork_generation;
+}
+
+static void install_atfork(void) {
+    pthread_atfork(NULL, NULL, forked_child);
+}
+#endif
+
+/* Changes in a child after fork(); a getpid() syscall only without pthreads. */
+static unsigned long process_id(void) {
+#ifndef ARGON2_NO_THREADS
+    return fork_generation;
+#else
+    return (unsigned long)getpid();
+#endif
+}
+
+int argon2_os_random(uint8_t *out, size_t len) {
+#if defined(__linux__) && defined(SYS_getrandom)
+    /* Blocks only until the kernel pool is first initialised. */
+    while (len > 0) {
+        long n = syscall(SYS_getrandom, out, len, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno == ENOSYS) break;  /* kernels before 3.17 */
+            return -1;
+        }
+        out += n;
+        len -= (size_t)n;
+    }
+    if (len == 0) return 0;
+#endif
+#if defined(__APPLE__) || defined(__ANDROID__) || defined(__OpenBSD__) || defined(__FreeBSD__)
+    arc4random_buf(out, len);
+    return 0;
+#else
+    return getentropy(out, len);
+#endif
+}
+
+static void lock(drbg *pool) {
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_lock(&pool->mutex);
+#else
+    (void)pool;
+#endif
+}
+
+static void unlock(drbg *pool) {
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_unlock(&pool->mutex);
+#else
+    (void)pool;
+#endif
+}
+
+static uint32_t load32_le(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+           ((uint32_t)p[3] << 24);
+}
+
+static void store32_le(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+#define ROTL32(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+#define QUARTERROUND(a, b, c, d)                   \
+    do {                                           \
+        x[a] += x[b]; x[d] = ROTL32(x[d] ^ x[a], 16); \
+        x[c] += x[d]; x[b] = ROTL32(x[b] ^ x[c], 12); \
+        x[a] += x[b]; x[d] = ROTL32(x[d] ^ x[a], 8);  \
+        x[c] += x[d]; x[b] = ROTL32(x[b] ^ x[c], 7);  \
+    } while (0)
+
+/* ChaCha20 keystream (RFC 8439) under a zero nonce, blocks 0..blocks-1. */
+static void chacha20_keystream(const uint8_t key[DRBG_SEEDBYTES], uint8_t *out, size_t blocks) {
+    uint32_t input[16], x[16];
+
+    input[0] = 0x61707865;
+    input[1] = 0x3320646e;
+    input[2] = 0x79622d32;
+    input[3] = 0x6b206574;
+    for (int i = 0; i < 8; ++i) {
+        input[4 + i] = load32_le(key + 4 * i);
+    }
+    input[13] = input[14] = input[15] = 0;
+
+    for (size_t b = 0; b < blocks; ++b, out += 64) {
+        input[12] = (uint32_t)b;
+        memcpy(x, input, sizeof(x));
+        for (int i = 0; i < 10; ++i) {
+            QUARTERROUND(0, 4, 8, 12);
+            QUARTERROUND(1, 5, 9, 13);
+            QUARTERROUND(2, 6, 10, 14);
+            QUARTERROUND(3, 7, 11, 15);
+            QUARTERROUND(0, 5, 10, 15);
+            QUARTERROUND(1, 6, 11, 12);
+            QUARTERROUND(2, 7, 8, 13);
+            QUARTERROUND(3, 4, 9, 14);
+        }
+        for (int i = 0; i < 16; ++i) {
+            store32_le(out + 4 * i, x[i] + input[i]);
+        }
+    }
+    argon2_secure_wipe(input, sizeof(input));
+    argon2_secure_wipe(x, sizeof(x));
+}
+
+/* New key from the front of a fresh buffer; the rest is served. */
+static void refill(drbg *pool) {
+    drbg_secret *s = pool->secret;
+
+    chacha20_keystream(s->key, s->buffer, DRBG_BUFFERBYTES / 64);
+    memcpy(s->key, s->buffer, DRBG_SEEDBYTES);
+    argon2_secure_wipe(s->buffer, DRBG_SEEDBYTES);
+    pool->avail = DRBG_BUFFERBYTES - DRBG_SEEDBYTES;
+}
+
+/* The caller holds the lock. */
+static int reseed(drbg *pool) {
+    uint8_t fresh[DRBG_SEEDBYTES];
+    drbg_secret *s = pool->secret;
+
+    if (argon2_os_random(fresh, sizeof(fresh)) != 0) {
+        argon2_secure_wipe(fresh, sizeof(fresh));
+        return DRBG_ENTROPY_FAILED;
+    }
+    for (size_t i = 0; i < DRBG_SEEDBYTES; ++i) {
+        s->key[i] ^= fresh[i];
+    }
+    argon2_secure_wipe(fresh, sizeof(fresh));
+
+    /* Nothing derived from the old key is served after this. */
+    argon2_secure_wipe(s->buffer, sizeof(s->buffer));
+    pool->avail = 0;
+    pool->since_reseed = 0;
+    pool->reseeded_ns = argon2_now_ns();
+    pool->process = process_id();
+    return DRBG_OK;
+}
+
+/*
+ * Checked before each refill rather than per call: a clock read costs as
+ * much as the copy, and at most one buffer is served past either limit.
+ */
+static int reseed_due(const drbg *pool) {
+    return !pool->seeded &&
+           (pool->since_reseed >= DRBG_RESEED_BYTES ||
+            argon2_now_ns() - pool->reseeded_ns >= (uint64_t)DRBG_RESEED_MS * 1000000u);
+}
+
+static int create(drbg **pool) {
+    *pool = NULL;
+
+    drbg *d = (drbg *)calloc(1, sizeof(*d));
+    if (d == NULL) {
+        return DRBG_MEMORY_ALLOCATION_ERROR;
+    }
+#ifndef ARGON2_NO_THREADS
+    pthread_once(&atfork_once, install_atfork);
+    if (pthread_mutex_init(&d->mutex, NULL) != 0) {
+        free(d);
+        return DRBG_MEMORY_ALLOCATION_ERROR;
+    }
+#endif
+
+    long page = sysconf(_SC_PAGESIZE);
+    size_t page_size = page > 0 ? (size_t)page : 4096;
+    size_t bytes = (sizeof(drbg_secret) + page_size - 1) & ~(page_size - 1);
+
+    void *memory = NULL;
+    if (posix_memalign(&memory, page_size, bytes) != 0) {
+        drbg_destroy(d);
+        return DRBG_MEMORY_ALLOCATION_ERROR;
+    }
+    memset(memory, 0, bytes);
+    /* Best effort, as for the derived-key cache. */
+    d->locked = (mlock(memory, bytes) == 0);
+#if defined(MADV_DONTDUMP)
+    (void)madvise(memory, bytes, MADV_DONTDUMP);
+#endif
+
+    d->secret = (drbg_secret *)memory;
+    d->secret_bytes = bytes;
+    *pool = d;
+    return DRBG_OK;
+}
+
+int drbg_create(drbg **pool) {
+    if (pool == NULL) return DRBG_INVALID_PARAMETER;
+
+    int result = create(pool);
+    if (result != DRBG_OK) {
+        return result;
+    }
+    /* The key starts at zero, so the first reseed sets it outright. */
+    result = reseed(*pool);
+    if (result != DRBG_OK) {
+        drbg_destroy(*pool);
+        *pool = NULL;
+    }
+    return result;
+}
+
+int drbg_create_seeded(drbg **pool, const uint8_t seed[DRBG_SEEDBYTES]) {
+    if (pool == NULL) return DRBG_INVALID_PARAMETER;
+    if (seed == NULL) {
+        *pool = NULL;
+        return DRBG_INVALID_PARAMETER;
+    }
+
+    int result = create(pool);
+    if (result == DRBG_OK) {
+        memcpy((*pool)->secret->key, seed, DRBG_SEEDBYTES);
+        (*pool)->seeded = 1;
+    }
+    return result;
+}
+
+void drbg_destroy(drbg *pool) {
+    if (pool == NULL) return;
+    if (pool->secret != NULL) {
+        argon2_secure_wipe(pool->secret, pool->secret_bytes);
+        if (pool->locked) {
+            munlock(pool->secret, pool->secret_bytes);
+        }
+        free(pool->secret);
+    }
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_destroy(&pool->mutex);
+#endif
+    free(pool);
+}
+
+int drbg_generate(drbg *pool, uint8_t *out, size_t len) {
+    if (pool == NULL || (out == NULL && len != 0)) {
+        return DRBG_INVALID_PARAMETER;
+    }
+
+    lock(pool);
+    /* A forked child must not repeat what the parent has buffered. */
+    int result = !pool->seeded && process_id() != pool->process ? reseed(pool) : DRBG_OK;
+    drbg_secret *s = pool->secret;
+    for (size_t done = 0; result == DRBG_OK && done < len;) {
+        if (pool->avail == 0) {
+            if (reseed_due(pool) && (result = reseed(pool)) != DRBG_OK) {
+                break;
+            }
+            refill(pool);
+        }
+        uint8_t *p = s->buffer + DRBG_BUFFERBYTES - pool->avail;
+        size_t n = len - done < pool->avail ? len - done : pool->avail;
+        memcpy(out + done, p, n);
+        argon2_secure_wipe(p, n);
+        pool->avail -= n;
+        pool->since_reseed += n;
+        done += n;
+    }
+    unlock(pool);
+
+    if (result != DRBG_OK && len != 0) {
+        memset(out, 0, len);
+    }
+    return result;
+}
+
+int drbg_reseed(drbg *pool) {
+    if (pool == NULL) return DRBG_INVALID_PARAMETER;
+    if (pool->seeded) return DRBG_OK;
+
+    lock(pool);
+    int result = reseed(pool);
+    unlock(pool);
+    return result;
+}
@@ -0,0 +1,147 @@
+/*
+ * Argon2 fill_block kernel for ARM NEON (arm64 devices, Apple silicon
+ * simulators). Same two-register round layout as the SSSE3 kernel: each
+ * uint64x2_t holds two qwords of a BLAKE2b state row and vextq_u64 stands in
+ * for palignr when (un)diagonalizing.
+ */
+
+#include "argon2_internal.h"
+
+#if defined(ARGON2_HAVE_NEON_KERNEL)
+
+#include <arm_neon.h>
+
+static inline uint64x2_t blamka_neon(uint64x2_t x, uint64x2_t y) {
+    uint64x2_t z = vmull_u32(vmovn_u64(x), vmovn_u64(y));
+    return vaddq_u64(vaddq_u64(x, y), vaddq_u64(z, z));
+}
+
+static inline uint64x2_t rotr32_neon(uint64x2_t x) {
+    return vreinterpretq_u64_u32(vrev64q_u32(vreinterpretq_u32_u64(x)));
+}
+
+static inline uint64x2_t rotr24_neon(uint64x2_t x) {
+    return vsriq_n_u64(vshlq_n_u64(x, 40), x, 24);
+}
+
+static inline uint64x2_t rotr16_neon(uint64x2_t x) {
+    return vsriq_n_u64(vshlq_n_u64(x, 48), x, 16);
+}
+
+static inline uint64x2_t rotr63_neon(uint64x2_t x) {
+    return vsriq_n_u64(vshlq_n_u64(x, 1), x, 63);
+}
+
+#define G1_NEON(A0, B0, C0, D0, A1, B1, C1, D1)         \
+    do {                                                \
+        A0 = blamka_neon(A0, B0);                       \
+        A1 = blamka_neon(A1, B1);                       \
+        D0 = rotr32_neon(veorq_u64(D0, A0));            \
+        D1 = rotr32_neon(veorq_u64(D1, A1));            \
+        C0 = blamka_neon(C0, D0);                       \
+        C1 = blamka_neon(C1, D1);                       \
+        B0 = rotr24_neon(veorq_u64(B0, C0));            \
+        B1 = rotr24_neon(veorq_u64(B1, C1));            \
+    } while (0)
+
+#define G2_NEON(A0, B0, C0, D0, A1, B1, C1, D1)         \
+    do {                                                \
+        A0 = blamka_neon(A0, B0);                       \
+        A1 = blamka_neon(A1, B1);                       \
+        D0 = rotr16_neon(veorq_u64(D0, A0));            \
+        D1 = rotr16_neon(veorq_u64(D1, A1));            \
+        C0 = blamka_neon(C0, D0);                       \
+        C1 = blamka_neon(C1, D1);                       \
+        B0 = rotr63_neon(veorq_u64(B0, C0));            \
+        B1 = rotr63_neon(veorq_u64(B1, C1));            \
+    } while (0)
+
+#define DIAGONALIZE_NEON(A0, B0, C0, D0, A1, B1, C1, D1)    \
+    do {                                                    \
+        uint64x2_t t0 = vextq_u64(B0, B1, 1);               \
+        uint64x2_t t1 = vextq_u64(B1, B0, 1);               \
+        B0 = t0; B1 = t1;                                   \
+        t0 = C0; C0 = C1; C1 = t0;                          \
+        t0 = vextq_u64(D0, D1, 1);                          \
+        t1 = vextq_u64(D1, D0, 1);                          \
+        D0 = t1; D1 = t0;                                   \
+    } while (0)
+
+#define UNDIAGONALIZE_NEON(A0, B0, C0, D0, A1, B1, C1, D1)  \
+    do {                                                    \
+        uint64x2_t t0 = vextq_u64(B1, B0, 1);               \
+        uint64x2_t t1 = vextq_u64(B0, B1, 1);               \
+        B0 = t0; B1 = t1;                                   \
+        t0 = C0; C0 = C1; C1 = t0;                          \
+        t0 = vextq_u64(D1, D0, 1);                          \
+        t1 = vextq_u64(D0, D1, 1);                          \
+        D0 = t1; D1 = t0;                                   \
+    } while (0)
+
+#define ROUND_NEON(A0, A1, B0, B1, C0, C1, D0, D1)              \
+    do {                                                        \
+        G1_NEON(A0, B0, C0, D0, A1, B1, C1, D1);                \
+        G2_NEON(A0, B0, C0, D0, A1, B1, C1, D1);                \
+        DIAGONALIZE_NEON(A0, B0, C0, D0, A1, B1, C1, D1);       \
+        G1_NEON(A0, B0, C0, D0, A1, B1, C1, D1);                \
+        G2_NEON(A0, B0, C0, D0, A1, B1, C1, D1);                \
+        UNDIAGONALIZE_NEON(A0, B0, C0, D0, A1, B1, C1, D1);     \
+    } while (0)
+
+#define LOAD_NEON(state, block_XY, prev, ref, next)                                 \
+    do {                                                                            \
+        for (unsigned i = 0; i < 64; ++i) {                                         \
+            state[i] = veorq_u64(vld1q_u64((prev)->v + 2 * i), vld1q_u64((ref)->v + 2 * i)); \
+            block_XY[i] = with_xor ? veorq_u64(state[i], vld1q_u64((next)->v + 2 * i)) \
+                                   : state[i];                                      \
+        }                                                                           \
+    } while (0)
+
+#define ROW_ROUND_NEON(s, i)                                                        \
+    ROUND_NEON(s[8 * i + 0], s[8 * i + 1], s[8 * i + 2], s[8 * i + 3],              \
+               s[8 * i + 4], s[8 * i + 5], s[8 * i + 6], s[8 * i + 7])
+
+#define COL_ROUND_NEON(s, i)                                                        \
+    ROUND_NEON(s[8 * 0 + i], s[8 * 1 + i], s[8 * 2 + i], s[8 * 3 + i],              \
+               s[8 * 4 + i], s[8 * 5 + i], s[8 * 6 + i], s[8 * 7 + i])
+
+#define STORE_NEON(next, state, block_XY)                                           \
+    do {                                                                            \
+        for (unsigned i = 0; i < 64; ++i) {                                         \
+            vst1q_u64((next)->v + 2 * i, veorq_u64(state[i], block_XY[i]));         \
+        }                                                                           \
+    } while (0)
+
+void argon2_fill_block_neon(const block *prev, const block *ref, block *next, int with_xor) {
+    uint64x2_t state[64], block_XY[64];
+
+    LOAD_NEON(state, block_XY, prev, ref, next);
+    for (unsigned i = 0; i < 8; ++i) {
+        ROW_ROUND_NEON(state, i);
+    }
+    for (unsigned i = 0; i < 8; ++i) {
+        COL_ROUND_NEON(state, i);
+    }
+    STORE_NEON(next, state, block_XY);
+}
+
+void argon2_fill_block2_neon(const block *prev0, const block *ref0, block *next0,
+                             const block *prev1, const block *ref1, block *next1,
+                             int with_xor) {
+    uint64x2_t state0[64], block_XY0[64], state1[64], block_XY1[64];
+
+    LOAD_NEON(state0, block_XY0, prev0, ref0, next0);
+    LOAD_NEON(state1, block_XY1, prev1, ref1, next1);
+    for (unsigned i = 0; i < 8; ++i) {
+        ROW_ROUND_NEON(state0, i);
+        ROW_ROUND_NEON(state1, i);
+    }
+    for (unsigned i = 0; i < 8; ++i) {
+        COL_ROUND_NEON(state0, i);
+        COL_ROUND_NEON(state1, i);
+    }
+    STORE_NEON(next0, state0, block_XY0);
+    STORE_NEON(next1, state1, block_XY1);
+}
+
+#endif /* ARGON2_HAVE_NEON_KERNEL */
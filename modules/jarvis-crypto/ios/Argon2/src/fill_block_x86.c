@@ -0,0 +1,420 @@
+/*
+ * Argon2 fill_block kernels for x86 (SSE2, SSSE3, AVX2, AVX-512F).
+ *
+ * Each kernel is compiled with a per-function target attribute so this file
+ * builds with baseline flags; argon2.c only calls a kernel after CPU
+ * detection confirms the instruction set is available. The round structure
+ * follows the reference optimized implementation (blamka-round-opt.h).
+ */
+
+#include "argon2_internal.h"
+
+#if defined(ARGON2_HAVE_X86_KERNELS) && (defined(__GNUC__) || defined(__clang__))
+
+#include <immintrin.h>
+
+#define ARGON2_TARGET(isa) __attribute__((target(isa)))
+
+/* ============== SSE2 / SSSE3 ============== */
+
+#define BLAMKA_128(x, y)                                            \
+    _mm_add_epi64(_mm_add_epi64((x), (y)),                          \
+                  _mm_add_epi64(_mm_mul_epu32((x), (y)), _mm_mul_epu32((x), (y))))
+
+#define ROTR32_128(x) _mm_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR63_128(x) _mm_xor_si128(_mm_srli_epi64((x), 63), _mm_add_epi64((x), (x)))
+
+/* SSE2 has no byte shuffle: 24 is a shift pair, 16 a word shuffle. */
+#define ROTR24_SSE2(x) _mm_xor_si128(_mm_srli_epi64((x), 24), _mm_slli_epi64((x), 40))
+#define ROTR16_SSE2(x)                                                      \
+    _mm_shufflehi_epi16(_mm_shufflelo_epi16((x), _MM_SHUFFLE(0, 3, 2, 1)),  \
+                        _MM_SHUFFLE(0, 3, 2, 1))
+
+#define ROTR24_SSSE3(x) \
+    _mm_shuffle_epi8((x), _mm_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, 15, 8, 9, 10))
+#define ROTR16_SSSE3(x) \
+    _mm_shuffle_epi8((x), _mm_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, 14, 15, 8, 9))
+
+#define G1_128(ROTR24, A0, B0, C0, D0, A1, B1, C1, D1)  \
+    do {                                                \
+        A0 = BLAMKA_128(A0, B0);                        \
+        A1 = BLAMKA_128(A1, B1);                        \
+        D0 = ROTR32_128(_mm_xor_si128(D0, A0));         \
+        D1 = ROTR32_128(_mm_xor_si128(D1, A1));         \
+        C0 = BLAMKA_128(C0, D0);                        \
+        C1 = BLAMKA_128(C1, D1);                        \
+        B0 = ROTR24(_mm_xor_si128(B0, C0));             \
+        B1 = ROTR24(_mm_xor_si128(B1, C1));             \
+    } while (0)
+
+#define G2_128(ROTR16, A0, B0, C0, D0, A1, B1, C1, D1)  \
+    do {                                                \
+        A0 = BLAMKA_128(A0, B0);                        \
+        A1 = BLAMKA_128(A1, B1);                        \
+        D0 = ROTR16(_mm_xor_si128(D0, A0));             \
+        D1 = ROTR16(_mm_xor_si128(D1, A1));             \
+        C0 = BLAMKA_128(C0, D0);                        \
+        C1 = BLAMKA_128(C1, D1);                        \
+        B0 = ROTR63_128(_mm_xor_si128(B0, C0));         \
+        B1 = ROTR63_128(_mm_xor_si128(B1, C1));         \
+    } while (0)
+
+#define DIAGONALIZE_SSE2(A0, B0, C0, D0, A1, B1, C1, D1)             \
+    do {                                                             \
+        __m128i t0 = D0, t1 = B0;                                    \
+        D0 = C0; C0 = C1; C1 = D0;                                   \
+        D0 = _mm_unpackhi_epi64(D1, _mm_unpacklo_epi64(t0, t0));     \
+        D1 = _mm_unpackhi_epi64(t0, _mm_unpacklo_epi64(D1, D1));     \
+        B0 = _mm_unpackhi_epi64(B0, _mm_unpacklo_epi64(B1, B1));     \
+        B1 = _mm_unpackhi_epi64(B1, _mm_unpacklo_epi64(t1, t1));     \
+    } while (0)
+
+#define UNDIAGONALIZE_SSE2(A0, B0, C0, D0, A1, B1, C1, D1)           \
+    do {                                                             \
+        __m128i t0 = C0, t1;                                         \
+        C0 = C1; C1 = t0;                                            \
+        t0 = B0; t1 = D0;                                            \
+        B0 = _mm_unpackhi_epi64(B1, _mm_unpacklo_epi64(B0, B0));     \
+        B1 = _mm_unpackhi_epi64(t0, _mm_unpacklo_epi64(B1, B1));     \
+        D0 = _mm_unpackhi_epi64(D0, _mm_unpacklo_epi64(D1, D1));     \
+        D1 = _mm_unpackhi_epi64(D1, _mm_unpacklo_epi64(t1, t1));     \
+    } while (0)
+
+#define DIAGONALIZE_SSSE3(A0, B0, C0, D0, A1, B1, C1, D1)            \
+    do {                                                             \
+        __m128i t0 = _mm_alignr_epi8(B1, B0, 8);                     \
+        __m128i t1 = _mm_alignr_epi8(B0, B1, 8);                     \
+        B0 = t0; B1 = t1;                                            \
+        t0 = C0; C0 = C1; C1 = t0;                                   \
+        t0 = _mm_alignr_epi8(D1, D0, 8);                             \
+        t1 = _mm_alignr_epi8(D0, D1, 8);                             \
+        D0 = t1; D1 = t0;                                            \
+    } while (0)
+
+#define UNDIAGONALIZE_SSSE3(A0, B0, C0, D0, A1, B1, C1, D1)          \
+    do {                                                             \
+        __m128i t0 = _mm_alignr_epi8(B0, B1, 8);                     \
+        __m128i t1 = _mm_alignr_epi8(B1, B0, 8);                     \
+        B0 = t0; B1 = t1;                                            \
+        t0 = C0; C0 = C1; C1 = t0;                                   \
+        t0 = _mm_alignr_epi8(D0, D1, 8);                             \
+        t1 = _mm_alignr_epi8(D1, D0, 8);                             \
+        D0 = t1; D1 = t0;                                            \
+    } while (0)
+
+#define ROUND_128(ISA, A0, A1, B0, B1, C0, C1, D0, D1)                      \
+    do {                                                                    \
+        G1_128(ROTR24_##ISA, A0, B0, C0, D0, A1, B1, C1, D1);               \
+        G2_128(ROTR16_##ISA, A0, B0, C0, D0, A1, B1, C1, D1);               \
+        DIAGONALIZE_##ISA(A0, B0, C0, D0, A1, B1, C1, D1);                  \
+        G1_128(ROTR24_##ISA, A0, B0, C0, D0, A1, B1, C1, D1);               \
+        G2_128(ROTR16_##ISA, A0, B0, C0, D0, A1, B1, C1, D1);               \
+        UNDIAGONALIZE_##ISA(A0, B0, C0, D0, A1, B1, C1, D1);                \
+    } while (0)
+
+#define FILL_BLOCK_128(ISA)                                                         \
+    do {                                                                            \
+        __m128i state[64], block_XY[64];                                            \
+        const __m128i *p = (const __m128i *)prev->v;                                \
+        const __m128i *r = (const __m128i *)ref->v;                                 \
+        __m128i *n = (__m128i *)next->v;                                            \
+        for (unsigned i = 0; i < 64; ++i) {                                         \
+            state[i] = _mm_xor_si128(_mm_loadu_si128(p + i), _mm_loadu_si128(r + i)); \
+            block_XY[i] = with_xor ? _mm_xor_si128(state[i], _mm_loadu_si128(n + i))  \
+                                   : state[i];                                      \
+        }                                                                           \
+        for (unsigned i = 0; i < 8; ++i) {                                          \
+            ROUND_128(ISA, state[8 * i + 0], state[8 * i + 1], state[8 * i + 2],    \
+                      state[8 * i + 3], state[8 * i + 4], state[8 * i + 5],         \
+                      state[8 * i + 6], state[8 * i + 7]);                          \
+        }                                                                           \
+        for (unsigned i = 0; i < 8; ++i) {                                          \
+            ROUND_128(ISA, state[8 * 0 + i], state[8 * 1 + i], state[8 * 2 + i],    \
+                      state[8 * 3 + i], state[8 * 4 + i], state[8 * 5 + i],         \
+                      state[8 * 6 + i], state[8 * 7 + i]);                          \
+        }                                                                           \
+        for (unsigned i = 0; i < 64; ++i) {                                         \
+            _mm_storeu_si128(n + i, _mm_xor_si128(state[i], block_XY[i]));         \
+        }                                                                           \
+    } while (0)
+
+ARGON2_TARGET("sse2")
+void argon2_fill_block_sse2(const block *prev, const block *ref, block *next, int with_xor) {
+    FILL_BLOCK_128(SSE2);
+}
+
+ARGON2_TARGET("ssse3")
+void argon2_fill_block_ssse3(const block *prev, const block *ref, block *next, int with_xor) {
+    FILL_BLOCK_128(SSSE3);
+}
+
+/* ============== AVX2 ============== */
+
+#define BLAMKA_256(x, y)                                                \
+    _mm256_add_epi64(_mm256_add_epi64((x), (y)),                        \
+                     _mm256_add_epi64(_mm256_mul_epu32((x), (y)),       \
+                                      _mm256_mul_epu32((x), (y))))
+
+#define ROTR32_256(x) _mm256_shuffle_epi32((x), _MM_SHUFFLE(2, 3, 0, 1))
+#define ROTR24_256(x)                                                           \
+    _mm256_shuffle_epi8((x), _mm256_setr_epi8(3, 4, 5, 6, 7, 0, 1, 2, 11, 12, 13, 14, \
+                                              15, 8, 9, 10, 3, 4, 5, 6, 7, 0, 1, 2,  \
+                                              11, 12, 13, 14, 15, 8, 9, 10))
+#define ROTR16_256(x)                                                           \
+    _mm256_shuffle_epi8((x), _mm256_setr_epi8(2, 3, 4, 5, 6, 7, 0, 1, 10, 11, 12, 13, \
+                                              14, 15, 8, 9, 2, 3, 4, 5, 6, 7, 0, 1,  \
+                                              10, 11, 12, 13, 14, 15, 8, 9))
+#define ROTR63_256(x) _mm256_xor_si256(_mm256_srli_epi64((x), 63), _mm256_add_epi64((x), (x)))
+
+#define G_256(ROTA, ROTB, A0, A1, B0, B1, C0, C1, D0, D1)   \
+    do {                                                    \
+        A0 = BLAMKA_256(A0, B0);                            \
+        A1 = BLAMKA_256(A1, B1);                            \
+        D0 = ROTA(_mm256_xor_si256(D0, A0));                \
+        D1 = ROTA(_mm256_xor_si256(D1, A1));                \
+        C0 = BLAMKA_256(C0, D0);                            \
+        C1 = BLAMKA_256(C1, D1);                            \
+        B0 = ROTB(_mm256_xor_si256(B0, C0));                \
+        B1 = ROTB(_mm256_xor_si256(B1, C1));                \
+    } while (0)
+
+#define GG_256(A0, A1, B0, B1, C0, C1, D0, D1)                          \
+    do {                                                                \
+        G_256(ROTR32_256, ROTR24_256, A0, A1, B0, B1, C0, C1, D0, D1);  \
+        G_256(ROTR16_256, ROTR63_256, A0, A1, B0, B1, C0, C1, D0, D1);  \
+    } while (0)
+
+/* Row rounds: each register holds four columns of one row. */
+#define DIAGONALIZE_1_256(A0, B0, C0, D0, A1, B1, C1, D1)               \
+    do {                                                                \
+        B0 = _mm256_permute4x64_epi64(B0, _MM_SHUFFLE(0, 3, 2, 1));     \
+        C0 = _mm256_permute4x64_epi64(C0, _MM_SHUFFLE(1, 0, 3, 2));     \
+        D0 = _mm256_permute4x64_epi64(D0, _MM_SHUFFLE(2, 1, 0, 3));     \
+        B1 = _mm256_permute4x64_epi64(B1, _MM_SHUFFLE(0, 3, 2, 1));     \
+        C1 = _mm256_permute4x64_epi64(C1, _MM_SHUFFLE(1, 0, 3, 2));     \
+        D1 = _mm256_permute4x64_epi64(D1, _MM_SHUFFLE(2, 1, 0, 3));     \
+    } while (0)
+
+#define UNDIAGONALIZE_1_256(A0, B0, C0, D0, A1, B1, C1, D1)             \
+    do {                                                                \
+        B0 = _mm256_permute4x64_epi64(B0, _MM_SHUFFLE(2, 1, 0, 3));     \
+        C0 = _mm256_permute4x64_epi64(C0, _MM_SHUFFLE(1, 0, 3, 2));     \
+        D0 = _mm256_permute4x64_epi64(D0, _MM_SHUFFLE(0, 3, 2, 1));     \
+        B1 = _mm256_permute4x64_epi64(B1, _MM_SHUFFLE(2, 1, 0, 3));     \
+        C1 = _mm256_permute4x64_epi64(C1, _MM_SHUFFLE(1, 0, 3, 2));     \
+        D1 = _mm256_permute4x64_epi64(D1, _MM_SHUFFLE(0, 3, 2, 1));     \
+    } while (0)
+
+/* Column rounds: each register holds the 2-qword halves of two columns. */
+#define DIAGONALIZE_2_256(A0, A1, B0, B1, C0, C1, D0, D1)               \
+    do {                                                                \
+        __m256i t1 = _mm256_blend_epi32(B0, B1, 0xCC);                  \
+        __m256i t2 = _mm256_blend_epi32(B0, B1, 0x33);                  \
+        B1 = _mm256_permute4x64_epi64(t1, _MM_SHUFFLE(2, 3, 0, 1));     \
+        B0 = _mm256_permute4x64_epi64(t2, _MM_SHUFFLE(2, 3, 0, 1));     \
+        t1 = C0; C0 = C1; C1 = t1;                                      \
+        t1 = _mm256_blend_epi32(D0, D1, 0xCC);                          \
+        t2 = _mm256_blend_epi32(D0, D1, 0x33);                          \
+        D0 = _mm256_permute4x64_epi64(t1, _MM_SHUFFLE(2, 3, 0, 1));     \
+        D1 = _mm256_permute4x64_epi64(t2, _MM_SHUFFLE(2, 3, 0, 1));     \
+    } while (0)
+
+#define UNDIAGONALIZE_2_256(A0, A1, B0, B1, C0, C1, D0, D1)             \
+    do {                                                                \
+        __m256i t1 = _mm256_blend_epi32(B0, B1, 0xCC);                  \
+        __m256i t2 = _mm256_blend_epi32(B0, B1, 0x33);                  \
+        B0 = _mm256_permute4x64_epi64(t1, _MM_SHUFFLE(2, 3, 0, 1));     \
+        B1 = _mm256_permute4x64_epi64(t2, _MM_SHUFFLE(2, 3, 0, 1));     \
+        t1 = C0; C0 = C1; C1 = t1;                                      \
+        t1 = _mm256_blend_epi32(D0, D1, 0x33);                          \
+        t2 = _mm256_blend_epi32(D0, D1, 0xCC);                          \
+        D0 = _mm256_permute4x64_epi64(t1, _MM_SHUFFLE(2, 3, 0, 1));     \
+        D1 = _mm256_permute4x64_epi64(t2, _MM_SHUFFLE(2, 3, 0, 1));     \
+    } while (0)
+
+#define ROW_ROUND_256(s, i)                                                             \
+    do {                                                                                \
+        GG_256(s[8 * i + 0], s[8 * i + 4], s[8 * i + 1], s[8 * i + 5],                  \
+               s[8 * i + 2], s[8 * i + 6], s[8 * i + 3], s[8 * i + 7]);                 \
+        DIAGONALIZE_1_256(s[8 * i + 0], s[8 * i + 1], s[8 * i + 2], s[8 * i + 3],       \
+                          s[8 * i + 4], s[8 * i + 5], s[8 * i + 6], s[8 * i + 7]);      \
+        GG_256(s[8 * i + 0], s[8 * i + 4], s[8 * i + 1], s[8 * i + 5],                  \
+               s[8 * i + 2], s[8 * i + 6], s[8 * i + 3], s[8 * i + 7]);                 \
+        UNDIAGONALIZE_1_256(s[8 * i + 0], s[8 * i + 1], s[8 * i + 2], s[8 * i + 3],     \
+                            s[8 * i + 4], s[8 * i + 5], s[8 * i + 6], s[8 * i + 7]);    \
+    } while (0)
+
+#define COL_ROUND_256(s, i)                                                             \
+    do {                                                                                \
+        GG_256(s[0 + i], s[4 + i], s[8 + i], s[12 + i],                                 \
+               s[16 + i], s[20 + i], s[24 + i], s[28 + i]);                             \
+        DIAGONALIZE_2_256(s[0 + i], s[4 + i], s[8 + i], s[12 + i],                      \
+                          s[16 + i], s[20 + i], s[24 + i], s[28 + i]);                  \
+        GG_256(s[0 + i], s[4 + i], s[8 + i], s[12 + i],                                 \
+               s[16 + i], s[20 + i], s[24 + i], s[28 + i]);                             \
+        UNDIAGONALIZE_2_256(s[0 + i], s[4 + i], s[8 + i], s[12 + i],                    \
+                            s[16 + i], s[20 + i], s[24 + i], s[28 + i]);                \
+    } while (0)
+
+#define LOAD_256(state, block_XY, prev, ref, next)                                      \
+    do {                                                                                \
+        const __m256i *p_ = (const __m256i *)(prev)->v;                                 \
+        const __m256i *r_ = (const __m256i *)(ref)->v;                                  \
+        const __m256i *n_ = (const __m256i *)(next)->v;                                 \
+        for (unsigned i = 0; i < 32; ++i) {                                             \
+            state[i] = _mm256_xor_si256(_mm256_loadu_si256(p_ + i),                     \
+                                        _mm256_loadu_si256(r_ + i));                    \
+            block_XY[i] = with_xor ? _mm256_xor_si256(state[i], _mm256_loadu_si256(n_ + i)) \
+                                   : state[i];                                          \
+        }                                                                               \
+    } while (0)
+
+#define STORE_256(next, state, block_XY)                                                \
+    do {                                                                                \
+        __m256i *n_ = (__m256i *)(next)->v;                                             \
+        for (unsigned i = 0; i < 32; ++i) {                                             \
+            _mm256_storeu_si256(n_ + i, _mm256_xor_si256(state[i], block_XY[i]));       \
+        }                                                                               \
+    } while (0)
+
+ARGON2_TARGET("avx2")
+void argon2_fill_block_avx2(const block *prev, const block *ref, block *next, int with_xor) {
+    __m256i state[32], block_XY[32];
+
+    LOAD_256(state, block_XY, prev, ref, next);
+    for (unsigned i = 0; i < 4; ++i) {
+        ROW_ROUND_256(state, i);
+    }
+    for (unsigned i = 0; i < 4; ++i) {
+        COL_ROUND_256(state, i);
+    }
+    STORE_256(next, state, block_XY);
+}
+
+ARGON2_TARGET("avx2")
+void argon2_fill_block2_avx2(const block *prev0, const block *ref0, block *next0,
+                             const block *prev1, const block *ref1, block *next1,
+                             int with_xor) {
+    __m256i state0[32], block_XY0[32], state1[32], block_XY1[32];
+
+    LOAD_256(state0, block_XY0, prev0, ref0, next0);
+    LOAD_256(state1, block_XY1, prev1, ref1, next1);
+    for (unsigned i = 0; i < 4; ++i) {
+        ROW_ROUND_256(state0, i);
+        ROW_ROUND_256(state1, i);
+    }
+    for (unsigned i = 0; i < 4; ++i) {
+        COL_ROUND_256(state0, i);
+        COL_ROUND_256(state1, i);
+    }
+    STORE_256(next0, state0, block_XY0);
+    STORE_256(next1, state1, block_XY1);
+}
+
+/* ============== AVX-512F ============== */
+
+#define BLAMKA_512(x, y)                                                \
+    _mm512_add_epi64(_mm512_add_epi64((x), (y)),                        \
+                     _mm512_add_epi64(_mm512_mul_epu32((x), (y)),       \
+                                      _mm512_mul_epu32((x), (y))))
+
+#define G_512(RA, RB, A0, B0, C0, D0, A1, B1, C1, D1)           \
+    do {                                                        \
+        A0 = BLAMKA_512(A0, B0);                                \
+        A1 = BLAMKA_512(A1, B1);                                \
+        D0 = _mm512_ror_epi64(_mm512_xor_si512(D0, A0), RA);    \
+        D1 = _mm512_ror_epi64(_mm512_xor_si512(D1, A1), RA);    \
+        C0 = BLAMKA_512(C0, D0);                                \
+        C1 = BLAMKA_512(C1, D1);                                \
+        B0 = _mm512_ror_epi64(_mm512_xor_si512(B0, C0), RB);    \
+        B1 = _mm512_ror_epi64(_mm512_xor_si512(B1, C1), RB);    \
+    } while (0)
+
+#define ROUND_512(A0, B0, C0, D0, A1, B1, C1, D1)                       \
+    do {                                                                \
+        G_512(32, 24, A0, B0, C0, D0, A1, B1, C1, D1);                  \
+        G_512(16, 63, A0, B0, C0, D0, A1, B1, C1, D1);                  \
+        B0 = _mm512_permutex_epi64(B0, _MM_SHUFFLE(0, 3, 2, 1));        \
+        B1 = _mm512_permutex_epi64(B1, _MM_SHUFFLE(0, 3, 2, 1));        \
+        C0 = _mm512_permutex_epi64(C0, _MM_SHUFFLE(1, 0, 3, 2));        \
+        C1 = _mm512_permutex_epi64(C1, _MM_SHUFFLE(1, 0, 3, 2));        \
+        D0 = _mm512_permutex_epi64(D0, _MM_SHUFFLE(2, 1, 0, 3));        \
+        D1 = _mm512_permutex_epi64(D1, _MM_SHUFFLE(2, 1, 0, 3));        \
+        G_512(32, 24, A0, B0, C0, D0, A1, B1, C1, D1);                  \
+        G_512(16, 63, A0, B0, C0, D0, A1, B1, C1, D1);                  \
+        B0 = _mm512_permutex_epi64(B0, _MM_SHUFFLE(2, 1, 0, 3));        \
+        B1 = _mm512_permutex_epi64(B1, _MM_SHUFFLE(2, 1, 0, 3));        \
+        C0 = _mm512_permutex_epi64(C0, _MM_SHUFFLE(1, 0, 3, 2));        \
+        C1 = _mm512_permutex_epi64(C1, _MM_SHUFFLE(1, 0, 3, 2));        \
+        D0 = _mm512_permutex_epi64(D0, _MM_SHUFFLE(0, 3, 2, 1));        \
+        D1 = _mm512_permutex_epi64(D1, _MM_SHUFFLE(0, 3, 2, 1));        \
+    } while (0)
+
+#define SWAP_HALVES_512(A0, A1)                                             \
+    do {                                                                    \
+        __m512i t0 = _mm512_shuffle_i64x2(A0, A1, _MM_SHUFFLE(1, 0, 1, 0)); \
+        __m512i t1 = _mm512_shuffle_i64x2(A0, A1, _MM_SHUFFLE(3, 2, 3, 2)); \
+        A0 = t0;                                                            \
+        A1 = t1;                                                            \
+    } while (0)
+
+#define SWAP_QUARTERS_512(A0, A1)                                   \
+    do {                                                            \
+        SWAP_HALVES_512(A0, A1);                                    \
+        A0 = _mm512_permutexvar_epi64(quarters, A0);                \
+        A1 = _mm512_permutexvar_epi64(quarters, A1);                \
+    } while (0)
+
+#define UNSWAP_QUARTERS_512(A0, A1)                                 \
+    do {                                                            \
+        A0 = _mm512_permutexvar_epi64(quarters, A0);                \
+        A1 = _mm512_permutexvar_epi64(quarters, A1);                \
+        SWAP_HALVES_512(A0, A1);                                    \
+    } while (0)
+
+ARGON2_TARGET("avx512f")
+void argon2_fill_block_avx512(const block *prev, const block *ref, block *next, int with_xor) {
+    __m512i state[16], block_XY[16];
+    const __m512i quarters = _mm512_setr_epi64(0, 1, 4, 5, 2, 3, 6, 7);
+    const __m512i *p = (const __m512i *)prev->v;
+    const __m512i *r = (const __m512i *)ref->v;
+    __m512i *n = (__m512i *)next->v;
+
+    for (unsigned i = 0; i < 16; ++i) {
+        state[i] = _mm512_xor_si512(_mm512_loadu_si512(p + i), _mm512_loadu_si512(r + i));
+        block_XY[i] = with_xor ? _mm512_xor_si512(state[i], _mm512_loadu_si512(n + i))
+                               : state[i];
+    }
+
+    for (unsigned i = 0; i < 2; ++i) {
+        __m512i *s = state + 8 * i;
+        SWAP_HALVES_512(s[0], s[2]);
+        SWAP_HALVES_512(s[1], s[3]);
+        SWAP_HALVES_512(s[4], s[6]);
+        SWAP_HALVES_512(s[5], s[7]);
+        ROUND_512(s[0], s[2], s[1], s[3], s[4], s[6], s[5], s[7]);
+        SWAP_HALVES_512(s[0], s[2]);
+        SWAP_HALVES_512(s[1], s[3]);
+        SWAP_HALVES_512(s[4], s[6]);
+        SWAP_HALVES_512(s[5], s[7]);
+    }
+
+    for (unsigned i = 0; i < 2; ++i) {
+        __m512i *s = state + i;
+        SWAP_QUARTERS_512(s[0], s[2]);
+        SWAP_QUARTERS_512(s[4], s[6]);
+        SWAP_QUARTERS_512(s[8], s[10]);
+        SWAP_QUARTERS_512(s[12], s[14]);
+        ROUND_512(s[0], s[4], s[8], s[12], s[2], s[6], s[10], s[14]);
+        UNSWAP_QUARTERS_512(s[0], s[2]);
+        UNSWAP_QUARTERS_512(s[4], s[6]);
+        UNSWAP_QUARTERS_512(s[8], s[10]);
+        UNSWAP_QUARTERS_512(s[12], s[14]);
+    }
+
+    for (unsigned i = 0; i < 16; ++i) {
+        _mm512_storeu_si512(n + i, _mm512_xor_si512(state[i], block_XY[i]));
+    }
+}
+
+#endif /* ARGON2_HAVE_X86_KERNELS */
@@ -0,0 +1,481 @@
+/*
+ * Argon2 job scheduler - worker pool, memory budget and priority queues
+ * around the steppable API (argon2_init/step/finish).
+ *
+ * Running jobs are driven with argon2_step so that a cancel reaches them at
+ * the next slice boundary through argon2_cancel. Built with
+ * -DARGON2_NO_THREADS, submit runs the job on the calling thread.
+ */
+
+#include "argon2_internal.h"
+#include "../include/argon2_scheduler.h"
+#include "../include/argon2_cache.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef ARGON2_NO_THREADS
+#include <pthread.h>
+#endif
+
+typedef struct Argon2_job {
+    struct Argon2_job *next;
+    uint64_t id;
+    argon2_type type;
+    argon2_context context;         /* input pointers refer to buffer */
+    uint8_t *buffer;                /* pwd | salt | secret | ad copies */
+    size_t buffer_len;
+    argon2_job_done_fn done;
+    void *user;
+    argon2_state *state;            /* set while running */
+    argon2_cache *cache;            /* receives the tag on success */
+    uint64_t submitted;             /* for argon2_stats.queue_ns */
+    int cancelled;
+} argon2_job;
+
+typedef struct {
+    argon2_job *head;
+    argon2_job *tail;
+} job_queue;
+
+struct Argon2_scheduler {
+    job_queue queues[ARGON2_PRIORITY_LEVELS];
+    argon2_job *running[ARGON2_MAX_THREADS];
+    uint32_t workers;
+    uint32_t memory_budget;
+    uint32_t memory_in_use;
+    uint64_t next_id;
+    argon2_cache *cache;
+    int shutting_down;
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t threads[ARGON2_MAX_THREADS];
+#endif
+};
+
+static void lock(argon2_scheduler *scheduler) {
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_lock(&scheduler->mutex);
+#else
+    (void)scheduler;
+#endif
+}
+
+static void unlock(argon2_scheduler *scheduler) {
+#ifndef ARGON2_NO_THREADS
+    pthread_mutex_unlock(&scheduler->mutex);
+#else
+    (void)scheduler;
+#endif
+}
+
+static void job_free(argon2_job *job) {
+    if (job->buffer != NULL) {
+        argon2_secure_wipe(job->buffer, job->buffer_len);
+        free(job->buffer);
+    }
+    free(job);
+}
+
+/* Copies the inputs so the caller may release them once submit returns. */
+static int job_create(argon2_job **out, argon2_context *context, argon2_type type,
+                      argon2_job_done_fn done, void *user) {
+    argon2_job *job = (argon2_job *)calloc(1, sizeof(*job));
+    if (job == NULL) {
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+
+    job->buffer_len = (size_t)context->pwdlen + context->saltlen +
+                      context->secretlen + context->adlen;
+    if (job->buffer_len != 0) {
+        job->buffer = (uint8_t *)malloc(job->buffer_len);
+        if (job->buffer == NULL) {
+            free(job);
+            return ARGON2_MEMORY_ALLOCATION_ERROR;
+        }
+    }
+
+    uint8_t *p = job->buffer;
+    job->context = *context;
+    if (context->pwdlen != 0) {
+        memcpy(p, context->pwd, context->pwdlen);
+        job->context.pwd = p;
+        p += context->pwdlen;
+    }
+    if (context->saltlen != 0) {
+        memcpy(p, context->salt, context->saltlen);
+        job->context.salt = p;
+        p += context->saltlen;
+    }
+    if (context->secretlen != 0) {
+        memcpy(p, context->secret, context->secretlen);
+        job->context.secret = p;
+        p += context->secretlen;
+    }
+    if (context->adlen != 0) {
+        memcpy(p, context->ad, context->adlen);
+        job->context.ad = p;
+    }
+    /* The copies are wiped by job_free; the clear flags now concern the caller's buffers. */
+    job->context.flags = context->flags & ARGON2_FLAG_LANE_LOCAL;
+    if ((context->flags & ARGON2_FLAG_CLEAR_PASSWORD) && context->pwdlen != 0) {
+        argon2_secure_wipe(context->pwd, context->pwdlen);
+        context->pwdlen = 0;
+    }
+    if ((context->flags & ARGON2_FLAG_CLEAR_SECRET) && context->secretlen != 0) {
+        argon2_secure_wipe(context->secret, context->secretlen);
+        context->secretlen = 0;
+    }
+
+    job->type = type;
+    job->done = done;
+    job->user = user;
+    if (context->stats != NULL) {
+        job->submitted = argon2_now_ns();
+    }
+    *out = job;
+    return ARGON2_OK;
+}
+
+/* Runs one job to completion or cancellation; the caller holds no lock. */
+static int job_run(argon2_scheduler *scheduler, argon2_job *job) {
+    argon2_state *state = NULL;
+    uint64_t started = job->context.stats != NULL ? argon2_now_ns() : 0;
+
+    int result = argon2_init(&state, NULL, &job->context, job->type);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+    if (job->context.stats != NULL) {
+        /* After init, which resets the stats. */
+        job->context.stats->queue_ns = started - job->submitted;
+    }
+
+    lock(scheduler);
+    job->state = state;
+    if (job->cancelled) {
+        argon2_cancel(state);
+    }
+    unlock(scheduler);
+
+    result = argon2_step(state, 0);
+
+    lock(scheduler);
+    job->state = NULL;
+    unlock(scheduler);
+
+    int finished = argon2_finish(state);
+    return result == ARGON2_OK ? finished : result;
+}
+
+static void job_complete(argon2_job *job, int result) {
+    if (result == ARGON2_OK && job->cache != NULL) {
+        /* Before the callback: it may release out. */
+        (void)argon2_cache_store(job->cache, &job->context, job->type);
+    }
+    if (job->done != NULL) {
+        job->done(job->id, result, job->user);
+    }
+    job_free(job);
+}
+
+static argon2_job *queue_pop(job_queue *queue) {
+    argon2_job *job = queue->head;
+    if (job != NULL) {
+        queue->head = job->next;
+        if (queue->head == NULL) {
+            queue->tail = NULL;
+        }
+        job->next = NULL;
+    }
+    return job;
+}
+
+/* Unlinks the job with this id, or returns NULL. */
+static argon2_job *queue_remove(job_queue *queue, uint64_t id) {
+    argon2_job *prev = NULL;
+    for (argon2_job *job = queue->head; job != NULL; prev = job, job = job->next) {
+        if (job->id != id) {
+            continue;
+        }
+        if (prev != NULL) {
+            prev->next = job->next;
+        } else {
+            queue->head = job->next;
+        }
+        if (queue->tail == job) {
+            queue->tail = prev;
+        }
+        job->next = NULL;
+        return job;
+    }
+    return NULL;
+}
+
+#ifndef ARGON2_NO_THREADS
+
+static void queue_push(job_queue *queue, argon2_job *job) {
+    job->next = NULL;
+    if (queue->tail != NULL) {
+        queue->tail->next = job;
+    } else {
+        queue->head = job;
+    }
+    queue->tail = job;
+}
+
+/*
+ * Highest-priority head that fits in the remaining budget, or that is
+ * larger than the whole budget and would run alone. The first head found
+ * stops the scan whether or not it fits: nothing may overtake it.
+ */
+static argon2_job *take_next_job(argon2_scheduler *scheduler) {
+    for (uint32_t level = 0; level < ARGON2_PRIORITY_LEVELS; ++level) {
+        argon2_job *head = scheduler->queues[level].head;
+        if (head == NULL) {
+            continue;
+        }
+        if (scheduler->memory_budget != 0 && scheduler->memory_in_use != 0 &&
+            (uint64_t)scheduler->memory_in_use + head->context.m_cost >
+                scheduler->memory_budget) {
+            return NULL;
+        }
+        scheduler->memory_in_use += head->context.m_cost;
+        return queue_pop(&scheduler->queues[level]);
+    }
+    return NULL;
+}
+
+typedef struct {
+    argon2_scheduler *scheduler;
+    uint32_t slot;
+} worker_arg;
+
+static void *scheduler_worker(void *arg) {
+    worker_arg *self = (worker_arg *)arg;
+    argon2_scheduler *scheduler = self->scheduler;
+    uint32_t slot = self->slot;
+    free(self);
+
+    pthread_mutex_lock(&scheduler->mutex);
+    for (;;) {
+        argon2_job *job = NULL;
+        while (!scheduler->shutting_down && (job = take_next_job(scheduler)) == NULL) {
+            pthread_cond_wait(&scheduler->cond, &scheduler->mutex);
+        }
+        if (job == NULL) {
+            break;
+        }
+        scheduler->running[slot] = job;
+        pthread_mutex_unlock(&scheduler->mutex);
+
+        int result = job_run(scheduler, job);
+
+        pthread_mutex_lock(&scheduler->mutex);
+        scheduler->running[slot] = NULL;
+        scheduler->memory_in_use -= job->context.m_cost;
+        /* Freed budget may let a waiting job start on another worker. */
+        pthread_cond_broadcast(&scheduler->cond);
+        pthread_mutex_unlock(&scheduler->mutex);
+
+        job_complete(job, result);
+
+        pthread_mutex_lock(&scheduler->mutex);
+    }
+    pthread_mutex_unlock(&scheduler->mutex);
+    return NULL;
+}
+
+#endif /* ARGON2_NO_THREADS */
+
+int argon2_scheduler_create(argon2_scheduler **scheduler, uint32_t workers,
+                            uint32_t memory_budget) {
+    if (scheduler == NULL) return ARGON2_OUTPUT_PTR_NULL;
+    *scheduler = NULL;
+    if (workers < 1 || workers > ARGON2_MAX_THREADS) return ARGON2_INCORRECT_PARAMETER;
+
+    argon2_scheduler *s = (argon2_scheduler *)calloc(1, sizeof(*s));
+    if (s == NULL) {
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+    s->memory_budget = memory_budget;
+    s->next_id = 1;
+
+#ifndef ARGON2_NO_THREADS
+    if (pthread_mutex_init(&s->mutex, NULL) != 0) {
+        free(s);
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+    if (pthread_cond_init(&s->cond, NULL) != 0) {
+        pthread_mutex_destroy(&s->mutex);
+        free(s);
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+    for (uint32_t i = 0; i < workers; ++i) {
+        worker_arg *arg = (worker_arg *)malloc(sizeof(*arg));
+        if (arg == NULL) {
+            break;
+        }
+        arg->scheduler = s;
+        arg->slot = i;
+        if (pthread_create(&s->threads[i], NULL, scheduler_worker, arg) != 0) {
+            free(arg);
+            break;
+        }
+        s->workers++;
+    }
+    if (s->workers == 0) {
+        pthread_cond_destroy(&s->cond);
+        pthread_mutex_destroy(&s->mutex);
+        free(s);
+        return ARGON2_MEMORY_ALLOCATION_ERROR;
+    }
+#endif
+
+    *scheduler = s;
+    return ARGON2_OK;
+}
+
+void argon2_scheduler_destroy(argon2_scheduler *scheduler) {
+    argon2_job *cancelled = NULL;
+
+    if (scheduler == NULL) return;
+
+    lock(scheduler);
+    scheduler->shutting_down = 1;
+    for (uint32_t level = 0; level < ARGON2_PRIORITY_LEVELS; ++level) {
+        argon2_job *job;
+        while ((job = queue_pop(&scheduler->queues[level])) != NULL) {
+            job->next = cancelled;
+            cancelled = job;
+        }
+    }
+    for (uint32_t i = 0; i < ARGON2_MAX_THREADS; ++i) {
+        argon2_job *job = scheduler->running[i];
+        if (job != NULL) {
+            job->cancelled = 1;
+            if (job->state != NULL) {
+                argon2_cancel(job->state);
+            }
+        }
+    }
+#ifndef ARGON2_NO_THREADS
+    pthread_cond_broadcast(&scheduler->cond);
+#endif
+    unlock(scheduler);
+
+    while (cancelled != NULL) {
+        argon2_job *next = cancelled->next;
+        job_complete(cancelled, ARGON2_CANCELLED);
+        cancelled = next;
+    }
+
+#ifndef ARGON2_NO_THREADS
+    for (uint32_t i = 0; i < scheduler->workers; ++i) {
+        pthread_join(scheduler->threads[i], NULL);
+    }
+    pthread_cond_destroy(&scheduler->cond);
+    pthread_mutex_destroy(&scheduler->mutex);
+#endif
+    free(scheduler);
+}
+
+int argon2_scheduler_submit(argon2_scheduler *scheduler, argon2_context *context,
+                            argon2_type type, argon2_priority priority,
+                            argon2_job_done_fn done, void *user, uint64_t *job_id) {
+    argon2_job *job;
+
+    if (scheduler == NULL || (unsigned)priority >= ARGON2_PRIORITY_LEVELS) {
+        return ARGON2_INCORRECT_PARAMETER;
+    }
+    int result = argon2_check_context(context, type);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+    result = job_create(&job, context, type, done, user);
+    if (result != ARGON2_OK) {
+        return result;
+    }
+
+    lock(scheduler);
+    if (scheduler->shutting_down) {
+        unlock(scheduler);
+        job_free(job);
+        return ARGON2_CANCELLED;
+    }
+    job->id = scheduler->next_id++;
+    if (job_id != NULL) {
+        *job_id = job->id;
+    }
+    if (scheduler->cache != NULL) {
+        if (argon2_cache_lookup(scheduler->cache, &job->context, job->type) == ARGON2_OK) {
+            if (job->context.stats != NULL) {
+                memset(job->context.stats, 0, sizeof(*job->context.stats));
+                job->context.stats->cached = 1;
+            }
+            unlock(scheduler);
+            job_complete(job, ARGON2_OK);
+            return ARGON2_OK;
+        }
+        job->cache = scheduler->cache;
+    }
+#ifndef ARGON2_NO_THREADS
+    queue_push(&scheduler->queues[priority], job);
+    pthread_cond_broadcast(&scheduler->cond);
+    unlock(scheduler);
+#else
+    unlock(scheduler);
+    job_complete(job, job_run(scheduler, job));
+#endif
+    return ARGON2_OK;
+}
+
+int argon2_scheduler_cancel(argon2_scheduler *scheduler, uint64_t job_id) {
+    argon2_job *job = NULL;
+
+    if (scheduler == NULL) return ARGON2_INCORRECT_PARAMETER;
+
+    lock(scheduler);
+    for (uint32_t level = 0; level < ARGON2_PRIORITY_LEVELS && job == NULL; ++level) {
+        job = queue_remove(&scheduler->queues[level], job_id);
+    }
+    if (job != NULL) {
+#ifndef ARGON2_NO_THREADS
+        /* A smaller job queued behind this one may fit now. */
+        pthread_cond_broadcast(&scheduler->cond);
+#endif
+        unlock(scheduler);
+        job_complete(job, ARGON2_CANCELLED);
+        return ARGON2_OK;
+    }
+
+    for (uint32_t i = 0; i < ARGON2_MAX_THREADS; ++i) {
+        argon2_job *running = scheduler->running[i];
+        if (running != NULL && running->id == job_id) {
+            running->cancelled = 1;
+            if (running->state != NULL) {
+                argon2_cancel(running->state);
+            }
+            unlock(scheduler);
+            return ARGON2_OK;
+        }
+    }
+    unlock(scheduler);
+    return ARGON2_INCORRECT_PARAMETER;
+}
+
+void argon2_scheduler_set_cache(argon2_scheduler *scheduler, argon2_cache *cache) {
+    if (scheduler == NULL) return;
+    lock(scheduler);
+    scheduler->cache = cache;
+    unlock(scheduler);
+}
+
+uint32_t argon2_scheduler_memory_in_use(argon2_scheduler *scheduler) {
+    if (scheduler == NULL) return 0;
+    lock(scheduler);
+    uint32_t in_use = scheduler->memory_in_use;
+    unlock(scheduler);
+    return in_use;
+}
@@ -0,0 +1,647 @@
+/*
+ * qr_provision - password-protected QR payloads for a fleet of nodes.
+ *
+ * Reads node records on stdin, one per line, tab-separated:
+ *
+ *     node_id  password  [kid  k2  [created_at  [cc_url]]]
+ *
+ * and writes one line per record to stdout, in input order:
+ *
+ *     node_id  kid  k2  qr
+ *
+ * qr is the string K2QRCode renders for an encrypted payload: the
+ * EncryptedQRPayload that generateEncryptedQRPayload() builds, through
+ * encodeQRPayload() (src/services/qrPayloadService.ts) - same fields in
+ * the same order, JSON.stringify's escaping, Argon2id m=19456 t=2 p=1 and
+ * AES-256-GCM of K2 under the canonical AAD - so qrImportService opens it
+ * with the password. A record without kid and k2 gets a fresh pair made
+ * like generateK2(); k2 is base64url of 32 bytes, and created_at (an ISO
+ * 8601 time) defaults to now. Blank lines and lines starting with '#' are
+ * skipped.
+ *
+ * Derivations run on --jobs workers (default: every online CPU), fewer if
+ * workers * 19 MiB would exceed --memory (default: half the RAM). Each
+ * worker keeps one arena, so a matrix is allocated and faulted in once per
+ * worker, not once per node. Records are read a few per worker ahead and
+ * each is written as soon as every earlier one is. A bad record is
+ * reported on stderr with its line number and skipped; the exit status is
+ * then 1.
+ *
+ *   qr_provision [--jobs N] [--memory MIB] [--cc-url URL] [--seed HEX]
+ *                < nodes.tsv > payloads.tsv
+ *
+ * --cc-url is the cc_url of records that do not give one. --seed takes
+ * salts, nonces and generated keys from a ChaCha20 pool keyed with those
+ * 32 bytes instead of the OS: reproducible output, for tests only.
+ */
+
+#include "aes_gcm.h"
+#include "argon2.h"
+#include "base64url.h"
+#include "drbg.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* PAYLOAD_VERSION and ARGON2_PARAMS in qrPayloadService.ts */
+#define QR_VERSION 1
+#define QR_M_COST 19456
+#define QR_T_COST 2
+#define QR_LANES 1
+
+#define QR_SALTBYTES 16
+#define QR_KEYBYTES 32   /* derived key, and K2 */
+#define QR_KIDBYTES 4    /* random part of a generated kid */
+#define READ_AHEAD 4     /* records in flight per worker */
+
+typedef struct {
+    unsigned jobs;
+    unsigned memory_mib;
+    const char *cc_url;
+    const char *seed;
+} tool_options;
+
+/* ---- output buffers ---- */
+
+typedef struct {
+    char *data;
+    size_t len, cap;
+    int failed;  /* an allocation failed; contents are incomplete */
+} strbuf;
+
+static void wipe(void *v, size_t n) {
+    volatile uint8_t *p = (volatile uint8_t *)v;
+    while (n--) *p++ = 0;
+}
+
+static void sb_free(strbuf *sb) {
+    if (sb->data != NULL) {
+        wipe(sb->data, sb->cap);
+        free(sb->data);
+    }
+    memset(sb, 0, sizeof(*sb));
+}
+
+/* Grows by copying, so no secret is left behind in a freed block. */
+static char *sb_reserve(strbuf *sb, size_t n) {
+    if (sb->failed) return NULL;
+    if (sb->cap - sb->len < n + 1) {
+        size_t cap = sb->cap != 0 ? sb->cap : 256;
+        while (cap - sb->len < n + 1) cap *= 2;
+        char *data = (char *)malloc(cap);
+        if (data == NULL) {
+            sb->failed = 1;
+            return NULL;
+        }
+        if (sb->data != NULL) {
+            memcpy(data, sb->data, sb->len);
+            wipe(sb->data, sb->cap);
+            free(sb->data);
+        }
+        sb->data = data;
+        sb->cap = cap;
+    }
+    return sb->data + sb->len;
+}
+
+static void sb_put(strbuf *sb, const char *s, size_t n) {
+    char *p = sb_reserve(sb, n);
+    if (p == NULL) return;
+    memcpy(p, s, n);
+    sb->len += n;
+    sb->data[sb->len] = '\0';
+}
+
+static void sb_puts(strbuf *sb, const char *s) {
+    sb_put(sb, s, strlen(s));
+}
+
+static void sb_base64url(strbuf *sb, const uint8_t *in, size_t len) {
+    size_t n = base64url_encoded_len(len);
+    char *p = sb_reserve(sb, n);
+    if (p == NULL) return;
+    base64url_encode(in, len, p);
+    sb->len += n;
+    sb->data[sb->len] = '\0';
+}
+
+/* A JSON string the way JSON.stringify writes it: only '"', '\' and C0 escaped. */
+static void sb_json_string(strbuf *sb, const char *s) {
+    static const char hex[] = "0123456789abcdef";
+
+    sb_put(sb, "\"", 1);
+    for (const char *run = s;; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c != '\0' && c != '"' && c != '\\' && c >= 0x20) continue;
+
+        sb_put(sb, run, (size_t)(s - run));
+        if (c == '\0') break;
+        run = s + 1;
+        switch (c) {
+        case '"': sb_puts(sb, "\\\""); break;
+        case '\\': sb_puts(sb, "\\\\"); break;
+        case '\b': sb_puts(sb, "\\b"); break;
+        case '\t': sb_puts(sb, "\\t"); break;
+        case '\n': sb_puts(sb, "\\n"); break;
+        case '\f': sb_puts(sb, "\\f"); break;
+        case '\r': sb_puts(sb, "\\r"); break;
+        default: {
+            char u[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+            sb_put(sb, u, sizeof(u));
+        }
+        }
+    }
+    sb_put(sb, "\"", 1);
+}
+
+/* ---- records ---- */
+
+enum { SLOT_FREE, SLOT_QUEUED, SLOT_DONE };
+
+typedef struct {
+    int state;
+    size_t line;
+    char *text;  /* the input line, split in place; holds the password */
+    const char *node_id, *password, *kid, *k2_text, *created_at, *cc_url;
+    char kid_buf[40];
+    char k2_buf[48];
+    char created_buf[64];
+    uint8_t k2[QR_KEYBYTES];
+    uint8_t salt[QR_SALTBYTES];
+    uint8_t nonce[AES256GCM_IVBYTES];
+    strbuf qr;
+    const char *error;  /* NULL once sealed */
+    int status;
+} record;
+
+static void record_clear(record *r) {
+    if (r->text != NULL) {
+        wipe(r->text, strlen(r->text));
+        free(r->text);
+    }
+    sb_free(&r->qr);
+    wipe(r, sizeof(*r));
+}
+
+/* Strict UTF-8 (no overlongs, surrogates or values past U+10FFFF), as a JS string round-trips. */
+static int valid_utf8(const char *text) {
+    const unsigned char *s = (const unsigned char *)text;
+
+    while (*s != 0) {
+        unsigned c = *s++;
+        int more;
+        unsigned min;
+        if (c < 0x80) continue;
+        if (c >= 0xc2 && c <= 0xdf) { more = 1; min = 0x80; c &= 0x1f; }
+        else if (c >= 0xe0 && c <= 0xef) { more = 2; min = 0x800; c &= 0x0f; }
+        else if (c >= 0xf0 && c <= 0xf4) { more = 3; min = 0x10000; c &= 0x07; }
+        else return 0;
+        while (more-- > 0) {
+            if ((*s & 0xc0) != 0x80) return 0;
+            c = c << 6 | (*s++ & 0x3f);
+        }
+        if (c < min || c > 0x10ffff || (c >= 0xd800 && c <= 0xdfff)) return 0;
+    }
+    return 1;
+}
+
+/* new Date().toISOString(), and its year and month for generateK2's kid. */
+static void iso_now(char out[64], char yyyymm[24]) {
+    struct timespec ts;
+    struct tm tm;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    gmtime_r(&ts.tv_sec, &tm);
+    snprintf(out, 64, "%04d-%02d-%02dT%02d:%02d:%02d.%03ldZ", tm.tm_year + 1900,
+             tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, ts.tv_nsec / 1000000);
+    snprintf(yyyymm, 24, "%04d%02d", tm.tm_year + 1900, tm.tm_mon + 1);
+}
+
+/*
+ * Splits r->text into fields and draws the record's random values, in the
+ * order the app draws them (K2 and kid, then salt and nonce).
+ * @return NULL, or why the record is rejected
+ */
+static const char *parse_record(record *r, const tool_options *opts, drbg *pool) {
+    const char *fields[6] = {NULL};
+    size_t count = 0;
+    char yyyymm[24];
+
+    for (char *p = r->text; count < 6;) {
+        fields[count++] = p;
+        p = strchr(p, '\t');
+        if (p == NULL) break;
+        *p++ = '\0';
+    }
+    if (count < 2 || count == 3) {
+        return "expected node_id, password[, kid, k2[, created_at[, cc_url]]]";
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (!valid_utf8(fields[i])) return "not valid UTF-8";
+    }
+    r->node_id = fields[0];
+    r->password = fields[1];
+    r->kid = count > 2 ? fields[2] : "";
+    r->k2_text = count > 3 ? fields[3] : "";
+    r->created_at = count > 4 ? fields[4] : "";
+    r->cc_url = count > 5 && fields[5][0] != '\0' ? fields[5] : opts->cc_url;
+    if (r->node_id[0] == '\0') return "empty node_id";
+
+    iso_now(r->created_buf, yyyymm);
+    if (r->created_at[0] == '\0') r->created_at = r->created_buf;
+
+    if (r->kid[0] == '\0' && r->k2_text[0] == '\0') {
+        uint8_t fresh[QR_KEYBYTES + QR_KIDBYTES];
+        char suffix[8];
+        if (drbg_generate(pool, fresh, sizeof(fresh)) != DRBG_OK) return "random generation failed";
+        memcpy(r->k2, fresh, QR_KEYBYTES);
+        base64url_encode(fresh, QR_KEYBYTES, r->k2_buf);
+        r->k2_buf[base64url_encoded_len(QR_KEYBYTES)] = '\0';
+        base64url_encode(fresh + QR_KEYBYTES, QR_KIDBYTES, suffix);
+        suffix[6] = '\0';
+        snprintf(r->kid_buf, sizeof(r->kid_buf), "k2-%s-%s", yyyymm, suffix);
+        wipe(fresh, sizeof(fresh));
+        r->kid = r->kid_buf;
+        r->k2_text = r->k2_buf;
+    } else {
+        uint8_t raw[QR_KEYBYTES + 3];
+        size_t len = strlen(r->k2_text), rawlen;
+        if (r->kid[0] == '\0') return "k2 without kid";
+        if (base64url_decoded_max(len) > sizeof(raw) ||
+            base64url_decode(r->k2_text, len, raw, &rawlen) != BASE64URL_OK ||
+            rawlen != QR_KEYBYTES) {
+            wipe(raw, sizeof(raw));
+            return "k2 is not base64url of 32 bytes";
+        }
+        memcpy(r->k2, raw, QR_KEYBYTES);
+        wipe(raw, sizeof(raw));
+    }
+
+    uint8_t salt_nonce[QR_SALTBYTES + AES256GCM_IVBYTES];
+    if (drbg_generate(pool, salt_nonce, sizeof(salt_nonce)) != DRBG_OK) return "random generation failed";
+    memcpy(r->salt, salt_nonce, QR_SALTBYTES);
+    memcpy(r->nonce, salt_nonce + QR_SALTBYTES, AES256GCM_IVBYTES);
+    return NULL;
+}
+
+/* Argon2id, AES-GCM and the payload, on a worker. */
+static void seal_record(record *r, argon2_arena *arena) {
+    uint8_t key[QR_KEYBYTES], ciphertext[QR_KEYBYTES], tag[AES256GCM_TAGBYTES];
+    aes256gcm_key aes;
+    strbuf aad = {0}, json = {0};
+    char number[16];
+
+    size_t pwdlen = strlen(r->password);
+    int rc = arena != NULL
+        ? argon2id_hash_raw_arena(arena, QR_T_COST, QR_M_COST, QR_LANES, r->password, pwdlen,
+                                  r->salt, QR_SALTBYTES, key, QR_KEYBYTES)
+        : argon2id_hash_raw(QR_T_COST, QR_M_COST, QR_LANES, r->password, pwdlen,
+                            r->salt, QR_SALTBYTES, key, QR_KEYBYTES);
+    if (rc != ARGON2_OK) {
+        r->error = "Argon2 failed";
+        r->status = rc;
+        goto out;
+    }
+
+    /* buildCanonicalAAD: the strings go in as they are, unescaped. */
+    snprintf(number, sizeof(number), "%d", QR_VERSION);
+    sb_puts(&aad, "{\"v\":");
+    sb_puts(&aad, number);
+    sb_puts(&aad, ",\"node_id\":\"");
+    sb_puts(&aad, r->node_id);
+    sb_puts(&aad, "\",\"kid\":\"");
+    sb_puts(&aad, r->kid);
+    sb_puts(&aad, "\"}");
+    if (aad.failed) {
+        r->error = "out of memory";
+        goto out;
+    }
+
+    rc = aes256gcm_key_init(&aes, key);
+    if (rc == AES_GCM_OK) {
+        rc = aes256gcm_encrypt(&aes, r->nonce, (const uint8_t *)aad.data, aad.len,
+                               r->k2, QR_KEYBYTES, ciphertext, tag);
+    }
+    aes256gcm_key_wipe(&aes);
+    if (rc != AES_GCM_OK) {
+        r->error = "AES-GCM failed";
+        r->status = rc;
+        goto out;
+    }
+
+    /* EncryptedQRPayload in declaration order; cc_url only when set. */
+    sb_puts(&json, "{\"v\":");
+    sb_puts(&json, number);
+    sb_puts(&json, ",\"mode\":\"enc\",\"node_id\":");
+    sb_json_string(&json, r->node_id);
+    sb_puts(&json, ",\"kid\":");
+    sb_json_string(&json, r->kid);
+    sb_puts(&json, ",\"kdf\":\"argon2id\",\"salt\":\"");
+    sb_base64url(&json, r->salt, QR_SALTBYTES);
+    snprintf(number, sizeof(number), "%d", QR_M_COST);
+    sb_puts(&json, "\",\"params\":{\"m\":");
+    sb_puts(&json, number);
+    snprintf(number, sizeof(number), "%d", QR_T_COST);
+    sb_puts(&json, ",\"t\":");
+    sb_puts(&json, number);
+    snprintf(number, sizeof(number), "%d", QR_LANES);
+    sb_puts(&json, ",\"p\":");
+    sb_puts(&json, number);
+    sb_puts(&json, "},\"nonce\":\"");
+    sb_base64url(&json, r->nonce, AES256GCM_IVBYTES);
+    sb_puts(&json, "\",\"ciphertext\":\"");
+    sb_base64url(&json, ciphertext, QR_KEYBYTES);
+    sb_puts(&json, "\",\"tag\":\"");
+    sb_base64url(&json, tag, AES256GCM_TAGBYTES);
+    sb_puts(&json, "\",\"created_at\":");
+    sb_json_string(&json, r->created_at);
+    if (r->cc_url != NULL) {
+        sb_puts(&json, ",\"cc_url\":");
+        sb_json_string(&json, r->cc_url);
+    }
+    sb_puts(&json, "}");
+
+    if (!json.failed) {
+        sb_base64url(&r->qr, (const uint8_t *)json.data, json.len);
+    }
+    if (json.failed || r->qr.failed) {
+        r->error = "out of memory";
+    }
+
+out:
+    wipe(key, sizeof(key));
+    sb_free(&aad);
+    sb_free(&json);
+}
+
+/* ---- pipeline ---- */
+
+/*
+ * Records live in a ring of window slots indexed by sequence number: the
+ * reader fills slot read, workers take slot run, the writer empties slot
+ * emitted. emitted <= run <= read <= emitted + window.
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t queued;  /* a record to seal, or closing */
+    pthread_cond_t done;    /* a record was sealed */
+    record *slots;
+    size_t window;
+    uint64_t read, run, emitted;
+    int closing;
+    size_t written, failed;
+} pipeline;
+
+static void *worker(void *arg) {
+    pipeline *p = (pipeline *)arg;
+    argon2_arena *arena = NULL;
+
+    /* Each worker touches its own arena first; without one, hashes allocate per call. */
+    if (argon2_arena_create(&arena, QR_M_COST, 0) != ARGON2_OK) {
+        arena = NULL;
+    }
+    for (;;) {
+        pthread_mutex_lock(&p->mutex);
+        while (p->run == p->read && !p->closing) {
+            pthread_cond_wait(&p->queued, &p->mutex);
+        }
+        if (p->run == p->read) {
+            pthread_mutex_unlock(&p->mutex);
+            break;
+        }
+        record *r = &p->slots[p->run++ % p->window];
+        pthread_mutex_unlock(&p->mutex);
+
+        seal_record(r, arena);
+
+        pthread_mutex_lock(&p->mutex);
+        r->state = SLOT_DONE;
+        pthread_cond_signal(&p->done);
+        pthread_mutex_unlock(&p->mutex);
+    }
+    argon2_arena_destroy(arena);
+    return NULL;
+}
+
+/*
+ * Writes the finished records at the head of the window, waiting for the
+ * first when wait is set. Slots being written are not touched by workers.
+ */
+static void emit(pipeline *p, int wait) {
+    pthread_mutex_lock(&p->mutex);
+    if (wait) {
+        while (p->emitted < p->read && p->slots[p->emitted % p->window].state != SLOT_DONE) {
+            pthread_cond_wait(&p->done, &p->mutex);
+        }
+    }
+    while (p->emitted < p->read) {
+        record *r = &p->slots[p->emitted % p->window];
+        if (r->state != SLOT_DONE) break;
+        pthread_mutex_unlock(&p->mutex);
+
+        if (r->error == NULL) {
+            printf("%s\t%s\t%s\t%s\n", r->node_id, r->kid, r->k2_text, r->qr.data);
+            p->written++;
+        } else {
+            fprintf(stderr, "qr_provision: line %zu: %s", r->line, r->error);
+            if (r->status != 0) fprintf(stderr, " (%d)", r->status);
+            fputc('\n', stderr);
+            p->failed++;
+        }
+        record_clear(r);
+
+        pthread_mutex_lock(&p->mutex);
+        r->state = SLOT_FREE;
+        p->emitted++;
+    }
+    pthread_mutex_unlock(&p->mutex);
+    fflush(stdout);
+}
+
+/* ---- command line ---- */
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--jobs N] [--memory MIB] [--cc-url URL] [--seed HEX]\n"
+            "          < nodes.tsv > payloads.tsv\n"
+            "  input:  node_id TAB password [TAB kid TAB k2 [TAB created_at [TAB cc_url]]]\n"
+            "  output: node_id TAB kid TAB k2 TAB qr\n",
+            prog);
+}
+
+static int parse_unsigned(const char *arg, unsigned *value) {
+    char *end;
+    unsigned long v = strtoul(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0' || v == 0 || v > 1u << 20) return -1;
+    *value = (unsigned)v;
+    return 0;
+}
+
+static int parse_args(int argc, char **argv, tool_options *opts) {
+    memset(opts, 0, sizeof(*opts));
+    for (int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        if (value == NULL) return -1;
+        if (strcmp(arg, "--jobs") == 0) {
+            if (parse_unsigned(value, &opts->jobs) != 0) return -1;
+        } else if (strcmp(arg, "--memory") == 0) {
+            if (parse_unsigned(value, &opts->memory_mib) != 0) return -1;
+        } else if (strcmp(arg, "--cc-url") == 0) {
+            if (!valid_utf8(value) || strchr(value, '\t') != NULL) return -1;
+            opts->cc_url = value;
+        } else if (strcmp(arg, "--seed") == 0) {
+            if (strlen(value) != 2 * DRBG_SEEDBYTES) return -1;
+            opts->seed = value;
+        } else {
+            return -1;
+        }
+        ++i;
+    }
+    return 0;
+}
+
+static int create_pool(const tool_options *opts, drbg **pool) {
+    uint8_t seed[DRBG_SEEDBYTES];
+
+    if (opts->seed == NULL) {
+        return drbg_create(pool);
+    }
+    for (size_t i = 0; i < DRBG_SEEDBYTES; ++i) {
+        unsigned byte;
+        if (sscanf(opts->seed + 2 * i, "%2x", &byte) != 1) return DRBG_INVALID_PARAMETER;
+        seed[i] = (uint8_t)byte;
+    }
+    int result = drbg_create_seeded(pool, seed);
+    wipe(seed, sizeof(seed));
+    return result;
+}
+
+/* Workers: --jobs (or every CPU), fewer if the matrices would not fit --memory (or half the RAM). */
+static unsigned worker_count(const tool_options *opts) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned jobs = opts->jobs != 0 ? opts->jobs : cpus > 0 ? (unsigned)cpus : 1;
+    uint64_t budget_kib = (uint64_t)opts->memory_mib * 1024;
+
+    if (budget_kib == 0) {
+        long pages = sysconf(_SC_PHYS_PAGES), page = sysconf(_SC_PAGESIZE);
+        budget_kib = pages > 0 && page > 0 ? (uint64_t)pages * (uint64_t)page / 2048 : QR_M_COST;
+    }
+    uint64_t fit = budget_kib / QR_M_COST;
+    return fit < jobs ? (unsigned)fit : jobs;
+}
+
+int main(int argc, char **argv) {
+    tool_options opts;
+    drbg *pool = NULL;
+    pipeline p;
+    pthread_t threads[1024];
+    char *line = NULL;
+    size_t line_cap = 0, line_number = 0, rejected = 0;
+    ssize_t len;
+
+    if (parse_args(argc, argv, &opts) != 0) {
+        usage(argv[0]);
+        return 2;
+    }
+    unsigned workers = worker_count(&opts);
+    if (workers == 0) {
+        fprintf(stderr, "qr_provision: --memory is below one derivation (%u MiB)\n",
+                (QR_M_COST + 1023) / 1024);
+        return 2;
+    }
+    if (workers > sizeof(threads) / sizeof(threads[0])) {
+        workers = sizeof(threads) / sizeof(threads[0]);
+    }
+    if (create_pool(&opts, &pool) != DRBG_OK) {
+        fprintf(stderr, "qr_provision: cannot seed the random pool\n");
+        return 1;
+    }
+
+    memset(&p, 0, sizeof(p));
+    p.window = (size_t)workers * READ_AHEAD;
+    p.slots = (record *)calloc(p.window, sizeof(record));
+    if (p.slots == NULL) {
+        fprintf(stderr, "qr_provision: out of memory\n");
+        drbg_destroy(pool);
+        return 1;
+    }
+    pthread_mutex_init(&p.mutex, NULL);
+    pthread_cond_init(&p.queued, NULL);
+    pthread_cond_init(&p.done, NULL);
+
+    /* p = 1, so each derivation runs on its worker with no lane threads. */
+    unsigned started = 0;
+    while (started < workers && pthread_create(&threads[started], NULL, worker, &p) == 0) {
+        ++started;
+    }
+    if (started == 0) {
+        fprintf(stderr, "qr_provision: cannot start workers\n");
+        free(p.slots);
+        drbg_destroy(pool);
+        return 1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    while ((len = getline(&line, &line_cap, stdin)) >= 0) {
+        ++line_number;
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        if (len == 0 || line[0] == '#') continue;
+
+        if (p.read - p.emitted == p.window) {
+            emit(&p, 1);
+        }
+        record *r = &p.slots[p.read % p.window];
+        r->line = line_number;
+        r->text = strdup(line);
+        const char *error = r->text != NULL ? parse_record(r, &opts, pool) : "out of memory";
+        if (error != NULL) {
+            fprintf(stderr, "qr_provision: line %zu: %s\n", line_number, error);
+            record_clear(r);
+            ++rejected;
+            continue;
+        }
+
+        pthread_mutex_lock(&p.mutex);
+        r->state = SLOT_QUEUED;
+        p.read++;
+        pthread_cond_signal(&p.queued);
+        pthread_mutex_unlock(&p.mutex);
+        emit(&p, 0);
+    }
+    if (line != NULL) {
+        wipe(line, line_cap);
+        free(line);
+    }
+
+    pthread_mutex_lock(&p.mutex);
+    p.closing = 1;
+    pthread_cond_broadcast(&p.queued);
+    pthread_mutex_unlock(&p.mutex);
+    while (p.emitted < p.read) {
+        emit(&p, 1);
+    }
+    for (unsigned i = 0; i < started; ++i) {
+        pthread_join(threads[i], NULL);
+    }
+
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    fprintf(stderr, "qr_provision: %zu payloads, %zu failed, %u workers, %.1f s (%.1f/s)\n",
+            p.written, p.failed + rejected, started, seconds,
+            seconds > 0 ? p.written / seconds : 0.0);
+
+    pthread_cond_destroy(&p.done);
+    pthread_cond_destroy(&p.queued);
+    pthread_mutex_destroy(&p.mutex);
+    free(p.slots);
+    drbg_destroy(pool);
+    return p.failed + rejected == 0 && !ferror(stdout) ? 0 : 1;
+}
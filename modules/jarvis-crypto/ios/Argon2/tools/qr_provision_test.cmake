@@ -0,0 +1,21 @@
+# Runs qr_provision over a fixed fleet with a fixed seed and compares its
+# output with payloads checked against the app's import path.
+#
+#   cmake -DTOOL=... -DINPUT=... -DEXPECTED=... -DOUTPUT=... -P qr_provision_test.cmake
+
+execute_process(
+  COMMAND ${TOOL} --jobs 3 --memory 64 --seed
+          000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f
+  INPUT_FILE ${INPUT}
+  OUTPUT_FILE ${OUTPUT}
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 1)
+  message(FATAL_ERROR "qr_provision exited with ${result}; the fixture has one bad record")
+endif()
+
+execute_process(
+  COMMAND ${CMAKE_COMMAND} -E compare_files ${OUTPUT} ${EXPECTED}
+  RESULT_VARIABLE result)
+if(NOT result EQUAL 0)
+  message(FATAL_ERROR "${OUTPUT} differs from ${EXPECTED}")
+endif()
@@ -6,6 +6,12 @@
 #ifndef JarvisCrypto_Bridging_Header_h
 #define JarvisCrypto_Bridging_Header_h
 
+#include "aes_gcm.h"
 #include "argon2.h"
+#include "argon2_cache.h"
+#include "argon2_scheduler.h"
+#include "base64url.h"
+#include "blake2b.h"
+#include "drbg.h"
 
 #endif /* JarvisCrypto_Bridging_Header_h */
@@ -1,5 +1,4 @@
 import ExpoModulesCore
-import CryptoKit
 import Foundation
 
 public class JarvisCryptoModule: Module {
@@ -17,18 +16,174 @@ public class JarvisCryptoModule: Module {
         return
       }
 
+      // Queued on the shared scheduler: bounded memory across concurrent
+      // derivations, and the user-facing unlock goes ahead of background work.
+      Argon2Scheduler.shared.hash(
+        password: password,
+        salt: salt,
+        memory: UInt32(m),
+        iterations: UInt32(t),
+        parallelism: UInt32(p),
+        hashLength: 32,
+        priority: ARGON2_PRIORITY_INTERACTIVE
+      ) { result in
+        switch result {
+        case .success(let key):
+          promise.resolve(key.base64URLEncodedString())
+        case .failure(let error):
+          promise.reject("ARGON2_ERROR", error.localizedDescription)
+        }
+      }
+    }
+
+    // argon2id plus where its time went (allocation, init, each pass and
+    // slice, finalize, wipe, queueing) for on-device latency telemetry.
+    AsyncFunction("argon2idWithStats") { (password: String, saltB64: String, params: [String: Int], promise: Promise) in
+      guard let salt = Data(base64URLEncoded: saltB64) else {
+        promise.reject("INVALID_SALT", "Salt must be valid base64url")
+        return
+      }
+
+      guard let m = params["m"], let t = params["t"], let p = params["p"] else {
+        promise.reject("INVALID_PARAMS", "Params must include m, t, p")
+        return
+      }
+
+      Argon2Scheduler.shared.hash(
+        password: password,
+        salt: salt,
+        memory: UInt32(m),
+        iterations: UInt32(t),
+        parallelism: UInt32(p),
+        hashLength: 32,
+        priority: ARGON2_PRIORITY_INTERACTIVE,
+        collectStats: true
+      ) { result in
+        switch result {
+        case .success(let output):
+          promise.resolve([
+            "key": output.key.base64URLEncodedString(),
+            "stats": output.stats?.dictionary ?? [:],
+          ])
+        case .failure(let error):
+          promise.reject("ARGON2_ERROR", error.localizedDescription)
+        }
+      }
+    }
+
+    // Byte-buffer variants: arguments arrive as JS typed arrays and their
+    // memory is handed to the C core as-is, results come back as Uint8Array.
+
+    AsyncFunction("argon2idBytes") { (password: Uint8Array, salt: Uint8Array, params: [String: Int], promise: Promise) in
+      guard let m = params["m"], let t = params["t"], let p = params["p"] else {
+        promise.reject("INVALID_PARAMS", "Params must include m, t, p")
+        return
+      }
+
+      Argon2Scheduler.shared.hash(
+        password: password.bytes,
+        salt: salt.bytes,
+        memory: UInt32(m),
+        iterations: UInt32(t),
+        parallelism: UInt32(p),
+        hashLength: 32,
+        priority: ARGON2_PRIORITY_INTERACTIVE
+      ) { result in
+        switch result {
+        case .success(let key):
+          promise.resolve(key)
+        case .failure(let error):
+          promise.reject("ARGON2_ERROR", error.localizedDescription)
+        }
+      }
+    }
+
+    AsyncFunction("aesGcmSealBytes") { (key: Uint8Array, iv: Uint8Array, plaintext: Uint8Array, aad: Uint8Array, promise: Promise) in
+      guard key.byteLength == 32 else {
+        promise.reject("INVALID_KEY", "Key must be 32 bytes")
+        return
+      }
+      guard iv.byteLength == 12 else {
+        promise.reject("INVALID_IV", "IV must be 12 bytes")
+        return
+      }
+
       do {
-        let key = try Argon2.hash(
-          password: password,
-          salt: salt,
-          memory: UInt32(m),
-          iterations: UInt32(t),
-          parallelism: UInt32(p),
-          hashLength: 32
-        )
-        promise.resolve(key.base64URLEncodedString())
+        promise.resolve(try AesGcm.seal(key: key.bytes, iv: iv.bytes, aad: aad.bytes, plaintext: plaintext.bytes))
+      } catch {
+        promise.reject("ENCRYPT_ERROR", error.localizedDescription)
+      }
+    }
+
+    AsyncFunction("aesGcmOpenBytes") { (key: Uint8Array, iv: Uint8Array, ciphertext: Uint8Array, tag: Uint8Array, aad: Uint8Array, promise: Promise) in
+      guard key.byteLength == 32 else {
+        promise.reject("INVALID_KEY", "Key must be 32 bytes")
+        return
+      }
+      guard iv.byteLength == 12 else {
+        promise.reject("INVALID_IV", "IV must be 12 bytes")
+        return
+      }
+      guard tag.byteLength == 16 else {
+        promise.reject("INVALID_TAG", "Tag must be 16 bytes")
+        return
+      }
+
+      do {
+        promise.resolve(try AesGcm.open(
+          key: key.bytes, iv: iv.bytes, aad: aad.bytes, ciphertext: ciphertext.bytes, tag: tag.bytes
+        ))
+      } catch {
+        promise.reject("DECRYPT_ERROR", "Authentication failed")
+      }
+    }
+
+    // A key expanded once and held natively, for many messages under it
+    // (every config pushed to one node). Records cross the bridge packed
+    // into one buffer each way; the layout is in aes_gcm.h.
+    Class(AeadKey.self) {
+      Constructor { (key: Uint8Array) throws -> AeadKey in
+        try AeadKey(raw: key.bytes)
+      }
+
+      AsyncFunction("sealBatch") { (aeadKey: AeadKey, batch: Uint8Array, promise: Promise) in
+        do {
+          promise.resolve(try aeadKey.sealBatch(batch.bytes))
+        } catch {
+          promise.reject("ENCRYPT_ERROR", error.localizedDescription)
+        }
+      }
+
+      AsyncFunction("openBatch") { (aeadKey: AeadKey, batch: Uint8Array, promise: Promise) in
+        do {
+          promise.resolve(try aeadKey.openBatch(batch.bytes))
+        } catch AesGcmError.recordAuthenticationFailed(let record) {
+          promise.reject("DECRYPT_ERROR", "Authentication failed (record \(record))")
+        } catch {
+          promise.reject("DECRYPT_ERROR", error.localizedDescription)
+        }
+      }
+    }
+
+    AsyncFunction("randomBuffer") { (length: Int, promise: Promise) in
+      do {
+        promise.resolve(try RandomPool.shared.bytes(length))
+      } catch {
+        promise.reject("RANDOM_ERROR", "Failed to generate random bytes")
+      }
+    }
+
+    // Several random values (salt, nonce, key) in one crossing, back to
+    // back in one buffer; index.ts cuts them apart.
+    AsyncFunction("randomBuffers") { (lengths: [Int], promise: Promise) in
+      guard lengths.allSatisfy({ $0 >= 0 }) else {
+        promise.reject("INVALID_LENGTH", "Lengths must not be negative")
+        return
+      }
+      do {
+        promise.resolve(try RandomPool.shared.bytes(lengths.reduce(0, +)))
       } catch {
-        promise.reject("ARGON2_ERROR", error.localizedDescription)
+        promise.reject("RANDOM_ERROR", "Failed to generate random bytes")
       }
     }
 
@@ -51,13 +206,12 @@ public class JarvisCryptoModule: Module {
       }
 
       do {
-        let key = SymmetricKey(data: keyData)
-        let nonce = try AES.GCM.Nonce(data: iv)
-        let sealed = try AES.GCM.seal(plaintext, using: key, nonce: nonce, authenticating: aadData)
+        let sealed = try AesGcm.seal(key: keyData, iv: iv, aad: aadData, plaintext: plaintext)
+        let split = sealed.count - Int(AES256GCM_TAGBYTES)
 
         let result: [String: String] = [
-          "ciphertext": sealed.ciphertext.base64URLEncodedString(),
-          "tag": sealed.tag.base64URLEncodedString()
+          "ciphertext": sealed.prefix(split).base64URLEncodedString(),
+          "tag": sealed.suffix(from: split).base64URLEncodedString()
         ]
         promise.resolve(result)
       } catch {
@@ -88,10 +242,7 @@ public class JarvisCryptoModule: Module {
       }
 
       do {
-        let key = SymmetricKey(data: keyData)
-        let nonce = try AES.GCM.Nonce(data: iv)
-        let sealed = try AES.GCM.SealedBox(nonce: nonce, ciphertext: ciphertext, tag: tag)
-        let plaintext = try AES.GCM.open(sealed, using: key, authenticating: aadData)
+        let plaintext = try AesGcm.open(key: keyData, iv: iv, aad: aadData, ciphertext: ciphertext, tag: tag)
         promise.resolve(plaintext.base64URLEncodedString())
       } catch {
         promise.reject("DECRYPT_ERROR", "Authentication failed")
@@ -99,81 +250,536 @@ public class JarvisCryptoModule: Module {
     }
 
     AsyncFunction("randomBytes") { (length: Int, promise: Promise) in
-      var bytes = [UInt8](repeating: 0, count: length)
-      let status = SecRandomCopyBytes(kSecRandomDefault, length, &bytes)
-      if status == errSecSuccess {
-        promise.resolve(Data(bytes).base64URLEncodedString())
-      } else {
+      do {
+        promise.resolve(try RandomPool.shared.bytes(length).base64URLEncodedString())
+      } catch {
         promise.reject("RANDOM_ERROR", "Failed to generate random bytes")
       }
     }
+
+    // base64url for JS, on the same codec the string API uses. Sync calls:
+    // typed arrays and strings cross JSI without a promise round trip.
+    Function("base64UrlEncode") { (data: Uint8Array) -> String in
+      data.bytes.base64URLEncodedString()
+    }
+
+    Function("base64UrlDecode") { (text: String) throws -> Data in
+      guard let data = Data(base64URLEncoded: text) else {
+        throw Base64URLError.invalidInput
+      }
+      return data
+    }
+
+    // Forget every cached derivation, e.g. on sign-out.
+    Function("clearKeyCache") {
+      Argon2Scheduler.shared.clearCache()
+    }
   }
 }
 
 // MARK: - Base64URL Extensions
 
+// Both directions go through the core's SIMD codec (base64url.h) in one
+// pass, with no intermediate standard-base64 string.
 extension Data {
   init?(base64URLEncoded string: String) {
-    var base64 = string
-      .replacingOccurrences(of: "-", with: "+")
-      .replacingOccurrences(of: "_", with: "/")
-
-    let paddingLength = (4 - base64.count % 4) % 4
-    base64 += String(repeating: "=", count: paddingLength)
+    var string = string
+    let decoded: Data? = string.withUTF8 { text in
+      var data = Data(count: base64url_decoded_max(text.count))
+      var count = 0
+      let status = data.withUnsafeMutableBytes { out in
+        text.withMemoryRebound(to: CChar.self) { text in
+          base64url_decode(text.baseAddress, text.count, out.bindMemory(to: UInt8.self).baseAddress, &count)
+        }
+      }
+      guard status == BASE64URL_OK else {
+        return nil
+      }
+      data.count = count
+      return data
+    }
+    guard let decoded = decoded else {
+      return nil
+    }
+    self = decoded
+  }
 
-    self.init(base64Encoded: base64)
+  func base64URLEncodedString() -> String {
+    withUnsafeBytes { $0.base64URLEncodedString() }
   }
+}
 
+extension UnsafeRawBufferPointer {
   func base64URLEncodedString() -> String {
-    return self.base64EncodedString()
-      .replacingOccurrences(of: "+", with: "-")
-      .replacingOccurrences(of: "/", with: "_")
-      .replacingOccurrences(of: "=", with: "")
+    let length = base64url_encoded_len(count)
+    let text = [UInt8](unsafeUninitializedCapacity: length) { buffer, initialized in
+      buffer.withMemoryRebound(to: CChar.self) { buffer in
+        _ = base64url_encode(bindMemory(to: UInt8.self).baseAddress, count, buffer.baseAddress)
+      }
+      initialized = length
+    }
+    return String(decoding: text, as: UTF8.self)
+  }
+}
+
+enum Base64URLError: Error {
+  case invalidInput
+}
+
+extension TypedArray {
+  /// The array's memory, valid while the JS object is alive (for the call).
+  var bytes: UnsafeRawBufferPointer {
+    UnsafeRawBufferPointer(start: rawPointer, count: byteLength)
+  }
+}
+
+// MARK: - AES-256-GCM Implementation
+
+enum AesGcmError: Error {
+  case authenticationFailed
+  case recordAuthenticationFailed(Int)
+  case released
+  case failed(Int32)
+}
+
+/// AES-256-GCM from the C core (aes_gcm.h) over raw buffers. seal returns
+/// ciphertext || tag in one allocation; the JS wrapper splits it.
+enum AesGcm {
+  static func seal(
+    key raw: UnsafeRawBufferPointer,
+    iv: UnsafeRawBufferPointer,
+    aad: UnsafeRawBufferPointer,
+    plaintext: UnsafeRawBufferPointer
+  ) throws -> Data {
+    var sealed = Data(count: plaintext.count + Int(AES256GCM_TAGBYTES))
+    let status: Int32 = withKey(raw) { key in
+      sealed.withUnsafeMutableBytes { out in
+        let ciphertext = out.bindMemory(to: UInt8.self).baseAddress!
+        return aes256gcm_encrypt(
+          key, iv.bindMemory(to: UInt8.self).baseAddress,
+          aad.bindMemory(to: UInt8.self).baseAddress, aad.count,
+          plaintext.bindMemory(to: UInt8.self).baseAddress, plaintext.count,
+          ciphertext, ciphertext + plaintext.count
+        )
+      }
+    }
+    guard status == AES_GCM_OK else {
+      throw AesGcmError.failed(status)
+    }
+    return sealed
+  }
+
+  static func open(
+    key raw: UnsafeRawBufferPointer,
+    iv: UnsafeRawBufferPointer,
+    aad: UnsafeRawBufferPointer,
+    ciphertext: UnsafeRawBufferPointer,
+    tag: UnsafeRawBufferPointer
+  ) throws -> Data {
+    var plaintext = Data(count: ciphertext.count)
+    let status: Int32 = withKey(raw) { key in
+      plaintext.withUnsafeMutableBytes { out in
+        aes256gcm_decrypt(
+          key, iv.bindMemory(to: UInt8.self).baseAddress,
+          aad.bindMemory(to: UInt8.self).baseAddress, aad.count,
+          ciphertext.bindMemory(to: UInt8.self).baseAddress, ciphertext.count,
+          tag.bindMemory(to: UInt8.self).baseAddress,
+          out.bindMemory(to: UInt8.self).baseAddress
+        )
+      }
+    }
+    guard status == AES_GCM_OK else {
+      throw status == AES_GCM_AUTH_FAILED ? AesGcmError.authenticationFailed : AesGcmError.failed(status)
+    }
+    return plaintext
+  }
+
+  static func seal(key: Data, iv: Data, aad: Data, plaintext: Data) throws -> Data {
+    try key.withUnsafeBytes { key in
+      try iv.withUnsafeBytes { iv in
+        try aad.withUnsafeBytes { aad in
+          try plaintext.withUnsafeBytes { plaintext in
+            try seal(key: key, iv: iv, aad: aad, plaintext: plaintext)
+          }
+        }
+      }
+    }
+  }
+
+  static func open(key: Data, iv: Data, aad: Data, ciphertext: Data, tag: Data) throws -> Data {
+    try key.withUnsafeBytes { key in
+      try iv.withUnsafeBytes { iv in
+        try aad.withUnsafeBytes { aad in
+          try ciphertext.withUnsafeBytes { ciphertext in
+            try tag.withUnsafeBytes { tag in
+              try open(key: key, iv: iv, aad: aad, ciphertext: ciphertext, tag: tag)
+            }
+          }
+        }
+      }
+    }
+  }
+
+  /// Expands the key on the stack and wipes it once body returns.
+  private static func withKey(
+    _ raw: UnsafeRawBufferPointer,
+    _ body: (UnsafePointer<aes256gcm_key>) -> Int32
+  ) -> Int32 {
+    var key = aes256gcm_key()
+    defer { aes256gcm_key_wipe(&key) }
+    let status = aes256gcm_key_init(&key, raw.bindMemory(to: UInt8.self).baseAddress)
+    guard status == AES_GCM_OK else {
+      return status
+    }
+    return body(&key)
+  }
+}
+
+/// The native side of a JS AeadKey: the expanded key in its own
+/// allocation, wiped when JS releases the object or it is collected.
+final class AeadKey: SharedObject {
+  private let key = UnsafeMutablePointer<aes256gcm_key>.allocate(capacity: 1)
+  private let lock = NSLock()
+  private var live = false
+
+  init(raw: UnsafeRawBufferPointer) throws {
+    guard raw.count == Int(AES256GCM_KEYBYTES) else {
+      key.deallocate()
+      throw AesGcmError.failed(AES_GCM_INVALID_PARAMETER)
+    }
+    let status = aes256gcm_key_init(key, raw.bindMemory(to: UInt8.self).baseAddress)
+    guard status == AES_GCM_OK else {
+      key.deallocate()
+      throw AesGcmError.failed(status)
+    }
+    live = true
+    super.init()
+  }
+
+  deinit {
+    wipe()
+    key.deallocate()
+  }
+
+  override func sharedObjectDidRelease() {
+    wipe()
+  }
+
+  func sealBatch(_ batch: UnsafeRawBufferPointer) throws -> Data {
+    try run(batch, open: false)
+  }
+
+  func openBatch(_ batch: UnsafeRawBufferPointer) throws -> Data {
+    try run(batch, open: true)
+  }
+
+  private func run(_ batch: UnsafeRawBufferPointer, open: Bool) throws -> Data {
+    lock.lock()
+    defer { lock.unlock() }
+    guard live else {
+      throw AesGcmError.released
+    }
+
+    let records = batch.bindMemory(to: UInt8.self).baseAddress
+    var outlen = 0
+    var status = aes256gcm_batch_measure(records, batch.count, open ? 1 : 0, nil, &outlen)
+    guard status == AES_GCM_OK else {
+      throw AesGcmError.failed(status)
+    }
+
+    var out = Data(count: outlen)
+    var failed = 0
+    status = out.withUnsafeMutableBytes { out in
+      let base = out.bindMemory(to: UInt8.self).baseAddress
+      return open
+        ? aes256gcm_open_batch(key, records, batch.count, base, &failed)
+        : aes256gcm_seal_batch(key, records, batch.count, base)
+    }
+    guard status == AES_GCM_OK else {
+      throw status == AES_GCM_AUTH_FAILED
+        ? AesGcmError.recordAuthenticationFailed(failed)
+        : AesGcmError.failed(status)
+    }
+    return out
+  }
+
+  private func wipe() {
+    lock.lock()
+    if live {
+      aes256gcm_key_wipe(key)
+      live = false
+    }
+    lock.unlock()
+  }
+}
+
+// MARK: - Random Pool
+
+enum RandomError: Error {
+  case invalidLength
+  case generateFailed(Int32)
+}
+
+/// The core's ChaCha20 pool (drbg.h), one per process: salts, nonces and
+/// keys come out of a buffer refilled and periodically reseeded from the
+/// OS, rather than a SecRandomCopyBytes call each.
+final class RandomPool {
+  static let shared = RandomPool()
+
+  private let pool: OpaquePointer?
+
+  private init() {
+    var handle: OpaquePointer?
+    drbg_create(&handle)
+    pool = handle
+  }
+
+  deinit {
+    drbg_destroy(pool)
+  }
+
+  func bytes(_ count: Int) throws -> Data {
+    guard count >= 0 else {
+      throw RandomError.invalidLength
+    }
+    var data = Data(count: count)
+    let status = data.withUnsafeMutableBytes { out in
+      drbg_generate(pool, out.bindMemory(to: UInt8.self).baseAddress, count)
+    }
+    guard status == DRBG_OK else {
+      throw RandomError.generateFailed(status)
+    }
+    return data
   }
 }
 
 // MARK: - Argon2 Implementation
 
+extension argon2_stats {
+  /// The Argon2Stats object of src/JarvisCrypto.types.ts; times in ms.
+  var dictionary: [String: Any] {
+    func ms(_ ns: UInt64) -> Double { Double(ns) / 1e6 }
+    let recorded = Int(min(passes, UInt32(ARGON2_STATS_MAX_PASSES)))
+    let passMs = withUnsafeBytes(of: pass_ns) { Array($0.bindMemory(to: UInt64.self)) }
+      .prefix(recorded).map(ms)
+    let sliceMs = withUnsafeBytes(of: slice_ns) { Array($0.bindMemory(to: UInt64.self)) }.map(ms)
+
+    return [
+      "queueMs": ms(queue_ns),
+      "allocMs": ms(alloc_ns),
+      "initMs": ms(init_ns),
+      "fillMs": ms(fill_ns),
+      "passMs": passMs,
+      "sliceMs": sliceMs,
+      "finalizeMs": ms(finalize_ns),
+      "wipeMs": ms(wipe_ns),
+      "totalMs": ms(total_ns),
+      "blocks": Double(blocks),
+      "blocksPerSecond": blocks_per_second,
+      "minorFaults": Double(minor_faults),
+      "majorFaults": Double(major_faults),
+      "threads": Int(threads),
+      "kernel": cached != 0 ? "" : String(cString: argon2_kernel_name(kernel)),
+      "cached": cached != 0,
+    ]
+  }
+}
+
 enum Argon2Error: Error {
   case invalidInput
-  case hashingFailed
+  case hashingFailed(Int32)
 }
 
-class Argon2 {
-  static func hash(
+/// Swift side of the C job scheduler (argon2_scheduler.h). Two workers and a
+/// 64 MiB budget: at most three production-sized (19 MiB) derivations hold
+/// memory at once, the rest wait in the queue. A payload asking for more
+/// than the budget (m > 65536) still derives, alone once the queue drains.
+final class Argon2Scheduler {
+  /// Repeat derivations within five minutes (retries, re-opening the same
+  /// payload) are answered from a 16-entry derived-key cache.
+  static let shared = Argon2Scheduler(
+    workers: 2, memoryBudgetKiB: 64 * 1024, cacheEntries: 16, cacheTTLms: 5 * 60 * 1000
+  )
+
+  private let scheduler: OpaquePointer?
+  private let cache: OpaquePointer?
+
+  init(workers: UInt32, memoryBudgetKiB: UInt32, cacheEntries: UInt32 = 0, cacheTTLms: UInt32 = 0) {
+    var handle: OpaquePointer?
+    argon2_scheduler_create(&handle, workers, memoryBudgetKiB)
+    scheduler = handle
+
+    var cacheHandle: OpaquePointer?
+    if cacheEntries > 0 {
+      argon2_cache_create(&cacheHandle, cacheEntries, cacheTTLms)
+      argon2_scheduler_set_cache(handle, cacheHandle)
+    }
+    cache = cacheHandle
+  }
+
+  deinit {
+    argon2_scheduler_destroy(scheduler)
+    argon2_cache_destroy(cache)
+  }
+
+  /// Wipes every cached derived key.
+  func clearCache() {
+    argon2_cache_clear(cache)
+  }
+
+  /// A derived key, with the per-phase breakdown when it was asked for.
+  struct Output {
+    let key: Data
+    let stats: argon2_stats?
+  }
+
+  /// Keeps the output buffers and completion alive until the C callback fires.
+  private final class Job {
+    let output: UnsafeMutablePointer<UInt8>
+    let length: Int
+    let stats: UnsafeMutablePointer<argon2_stats>?
+    let completion: (Result<Output, Error>) -> Void
+
+    init(length: Int, collectStats: Bool, completion: @escaping (Result<Output, Error>) -> Void) {
+      self.output = UnsafeMutablePointer<UInt8>.allocate(capacity: length)
+      self.output.initialize(repeating: 0, count: length)
+      self.length = length
+      self.stats = collectStats ? UnsafeMutablePointer<argon2_stats>.allocate(capacity: 1) : nil
+      self.stats?.initialize(to: argon2_stats())
+      self.completion = completion
+    }
+
+    deinit {
+      output.initialize(repeating: 0, count: length)
+      output.deallocate()
+      stats?.deallocate()
+    }
+
+    func finish(_ status: Int32) {
+      if status == ARGON2_OK {
+        completion(.success(Output(key: Data(bytes: output, count: length), stats: stats?.pointee)))
+      } else {
+        completion(.failure(Argon2Error.hashingFailed(status)))
+      }
+    }
+  }
+
+  /// Queues an Argon2id derivation; `completion` runs on a scheduler thread.
+  /// Returns the job id, usable with `cancel(_:)`, or nil if it was rejected.
+  @discardableResult
+  func hash(
     password: String,
     salt: Data,
     memory: UInt32,
     iterations: UInt32,
     parallelism: UInt32,
-    hashLength: Int
-  ) throws -> Data {
-    guard let passwordData = password.data(using: .utf8) else {
-      throw Argon2Error.invalidInput
-    }
-
-    var hash = [UInt8](repeating: 0, count: hashLength)
-
-    let result = passwordData.withUnsafeBytes { passwordBytes in
-      salt.withUnsafeBytes { saltBytes in
-        argon2id_hash_raw(
-          iterations,
-          memory,
-          parallelism,
-          passwordBytes.baseAddress,
-          passwordData.count,
-          saltBytes.baseAddress,
-          salt.count,
-          &hash,
-          hashLength
+    hashLength: Int,
+    priority: argon2_priority,
+    completion: @escaping (Result<Data, Error>) -> Void
+  ) -> UInt64? {
+    hash(
+      password: password, salt: salt, memory: memory, iterations: iterations,
+      parallelism: parallelism, hashLength: hashLength, priority: priority, collectStats: false
+    ) { completion($0.map(\.key)) }
+  }
+
+  /// Same, optionally filling `Output.stats` with the argon2_stats breakdown.
+  @discardableResult
+  func hash(
+    password: String,
+    salt: Data,
+    memory: UInt32,
+    iterations: UInt32,
+    parallelism: UInt32,
+    hashLength: Int,
+    priority: argon2_priority,
+    collectStats: Bool,
+    completion: @escaping (Result<Output, Error>) -> Void
+  ) -> UInt64? {
+    guard var passwordBytes = password.data(using: .utf8).map({ [UInt8]($0) }) else {
+      completion(.failure(Argon2Error.invalidInput))
+      return nil
+    }
+    defer {
+      // The scheduler copied the inputs during submit.
+      for i in passwordBytes.indices { passwordBytes[i] = 0 }
+    }
+
+    return passwordBytes.withUnsafeBytes { pwd in
+      salt.withUnsafeBytes { saltBuf in
+        submit(
+          password: pwd, salt: saltBuf, memory: memory, iterations: iterations,
+          parallelism: parallelism, hashLength: hashLength, priority: priority,
+          collectStats: collectStats, completion: completion
         )
       }
     }
+  }
+
+  /// Same, reading password and salt straight from caller-owned memory.
+  /// Both only need to stay valid for the duration of this call.
+  @discardableResult
+  func hash(
+    password: UnsafeRawBufferPointer,
+    salt: UnsafeRawBufferPointer,
+    memory: UInt32,
+    iterations: UInt32,
+    parallelism: UInt32,
+    hashLength: Int,
+    priority: argon2_priority,
+    completion: @escaping (Result<Data, Error>) -> Void
+  ) -> UInt64? {
+    submit(
+      password: password, salt: salt, memory: memory, iterations: iterations,
+      parallelism: parallelism, hashLength: hashLength, priority: priority, collectStats: false
+    ) { completion($0.map(\.key)) }
+  }
+
+  private func submit(
+    password: UnsafeRawBufferPointer,
+    salt: UnsafeRawBufferPointer,
+    memory: UInt32,
+    iterations: UInt32,
+    parallelism: UInt32,
+    hashLength: Int,
+    priority: argon2_priority,
+    collectStats: Bool,
+    completion: @escaping (Result<Output, Error>) -> Void
+  ) -> UInt64? {
+    guard let scheduler = scheduler else {
+      completion(.failure(Argon2Error.invalidInput))
+      return nil
+    }
 
-    guard result == 0 else {
-      throw Argon2Error.hashingFailed
+    let job = Job(length: hashLength, collectStats: collectStats, completion: completion)
+    let user = Unmanaged.passRetained(job).toOpaque()
+    var jobId: UInt64 = 0
+
+    var context = argon2_context(
+      out: job.output, outlen: UInt32(hashLength),
+      pwd: UnsafeMutablePointer(mutating: password.bindMemory(to: UInt8.self).baseAddress),
+      pwdlen: UInt32(password.count),
+      salt: salt.bindMemory(to: UInt8.self).baseAddress, saltlen: UInt32(salt.count),
+      secret: nil, secretlen: 0,
+      ad: nil, adlen: 0,
+      t_cost: iterations, m_cost: memory, lanes: parallelism, threads: 0,
+      version: UInt32(ARGON2_VERSION_NUMBER), flags: 0,
+      stats: job.stats
+    )
+    let status = argon2_scheduler_submit(scheduler, &context, Argon2_id, priority, { _, status, user in
+      guard let user = user else { return }
+      Unmanaged<Job>.fromOpaque(user).takeRetainedValue().finish(status)
+    }, user, &jobId)
+
+    guard status == ARGON2_OK else {
+      Unmanaged<Job>.fromOpaque(user).release()
+      completion(.failure(Argon2Error.hashingFailed(status)))
+      return nil
     }
+    return jobId
+  }
 
-    return Data(hash)
+  func cancel(_ jobId: UInt64) {
+    argon2_scheduler_cancel(scheduler, jobId)
   }
 }
@@ -4,12 +4,86 @@ export interface Argon2Params {
   p: number; // parallelism
 }
 
+/** Where an Argon2id derivation spent its time; all times in milliseconds. */
+export interface Argon2Stats {
+  queueMs: number; // waiting for a worker and memory budget
+  allocMs: number;
+  initMs: number; // H0 and the first two blocks of each lane
+  fillMs: number;
+  passMs: number[]; // up to 16; later passes add to the last
+  sliceMs: number[]; // 4 sync points, summed over passes
+  finalizeMs: number;
+  wipeMs: number;
+  totalMs: number;
+  blocks: number;
+  blocksPerSecond: number;
+  minorFaults: number; // process-wide, -1 if unavailable
+  majorFaults: number;
+  threads: number;
+  kernel: string; // compression kernel, '' when cached
+  cached: boolean; // answered from the key cache; times are then 0
+}
+
+export interface Argon2StatsResult {
+  key: string; // base64url
+  stats: Argon2Stats;
+}
+
 export interface EncryptResult {
   ciphertext: string; // base64url
   tag: string; // base64url
 }
 
+export type BytesLike = Uint8Array | ArrayBuffer;
+
+export interface EncryptBytesResult {
+  ciphertext: Uint8Array;
+  tag: Uint8Array; // 16 bytes
+}
+
+/** One message for AeadKey.encryptBatch. */
+export interface SealRecord {
+  iv: BytesLike; // 12 bytes
+  aad: BytesLike | string;
+  plaintext: BytesLike;
+}
+
+/** One message for AeadKey.decryptBatch. */
+export interface OpenRecord {
+  iv: BytesLike; // 12 bytes
+  aad: BytesLike | string;
+  ciphertext: BytesLike;
+  tag: BytesLike; // 16 bytes
+}
+
+/**
+ * An AES-256-GCM key expanded once on the native side, for encrypting or
+ * decrypting many messages under it. Call release() when done; the native
+ * copy is wiped then (or when the object is garbage collected).
+ */
+export interface AeadKey {
+  encryptBatch(records: SealRecord[]): Promise<EncryptBytesResult[]>;
+  /** @throws Error naming the first record that fails authentication */
+  decryptBatch(records: OpenRecord[]): Promise<Uint8Array[]>;
+  release(): void;
+}
+
+/**
+ * The native AeadKey shared object. Batches are packed records of
+ * iv(12) || aadLength(u32 LE) || dataLength(u32 LE) || aad || data, where
+ * data is the plaintext to seal or ciphertext || tag to open; results
+ * come back concatenated in record order.
+ */
+export interface NativeAeadKey {
+  sealBatch(batch: Uint8Array): Promise<Uint8Array>;
+  openBatch(batch: Uint8Array): Promise<Uint8Array>;
+  release(): void;
+}
+
 export interface JarvisCryptoModule {
+  /** Holds a 32-byte AES-256-GCM key natively for sealBatch/openBatch */
+  AeadKey: new (key: Uint8Array) => NativeAeadKey;
+
   /**
    * Derive a key from password using Argon2id
    * @param password - User password (UTF-8 string)
@@ -19,6 +93,15 @@ export interface JarvisCryptoModule {
    */
   argon2id(password: string, salt: string, params: Argon2Params): Promise<string>;
 
+  /**
+   * argon2id, also reporting per-phase timings for profiling
+   * @param password - User password (UTF-8 string)
+   * @param salt - Salt bytes (base64url encoded)
+   * @param params - Argon2id parameters
+   * @returns 32-byte key as base64url and its stats
+   */
+  argon2idWithStats(password: string, salt: string, params: Argon2Params): Promise<Argon2StatsResult>;
+
   /**
    * Encrypt plaintext using AES-256-GCM
    * @param key - 32-byte key (base64url)
@@ -58,4 +141,82 @@ export interface JarvisCryptoModule {
    * @returns Random bytes as base64url
    */
   randomBytes(length: number): Promise<string>;
+
+  /**
+   * Derive a key from password using Argon2id, on raw bytes
+   * @param password - Password bytes (UTF-8 encoded by the caller)
+   * @param salt - Salt bytes
+   * @param params - Argon2id parameters
+   * @returns 32-byte key
+   */
+  argon2idBytes(password: Uint8Array, salt: Uint8Array, params: Argon2Params): Promise<Uint8Array>;
+
+  /**
+   * Encrypt using AES-256-GCM, on raw bytes
+   * @param key - 32-byte key
+   * @param iv - 12-byte IV/nonce
+   * @param plaintext - Data to encrypt
+   * @param aad - Associated authenticated data
+   * @returns Ciphertext followed by the 16-byte tag
+   */
+  aesGcmSealBytes(
+    key: Uint8Array,
+    iv: Uint8Array,
+    plaintext: Uint8Array,
+    aad: Uint8Array
+  ): Promise<Uint8Array>;
+
+  /**
+   * Decrypt using AES-256-GCM, on raw bytes
+   * @param key - 32-byte key
+   * @param iv - 12-byte IV/nonce
+   * @param ciphertext - Encrypted data
+   * @param tag - 16-byte authentication tag
+   * @param aad - Associated authenticated data
+   * @returns Decrypted plaintext
+   * @throws Error on authentication failure
+   */
+  aesGcmOpenBytes(
+    key: Uint8Array,
+    iv: Uint8Array,
+    ciphertext: Uint8Array,
+    tag: Uint8Array,
+    aad: Uint8Array
+  ): Promise<Uint8Array>;
+
+  /**
+   * Generate cryptographically secure random bytes
+   * @param length - Number of bytes to generate
+   * @returns Random bytes
+   */
+  randomBuffer(length: number): Promise<Uint8Array>;
+
+  /**
+   * Generate several random values in one call
+   * @param lengths - Byte count of each value
+   * @returns The values back to back, in order
+   */
+  randomBuffers(lengths: number[]): Promise<Uint8Array>;
+
+  /**
+   * Encode bytes as unpadded base64url (synchronous)
+   * @param data - Bytes to encode
+   * @returns base64url text
+   */
+  base64UrlEncode(data: Uint8Array): string;
+
+  /**
+   * Decode padded or unpadded base64url (synchronous)
+   * @param text - base64url text
+   * @returns Decoded bytes
+   * @throws Error on characters outside the alphabet or a malformed length
+   */
+  base64UrlDecode(text: string): Uint8Array;
+
+  /**
+   * Wipe every cached Argon2id derivation. argon2id/argon2idBytes answer a
+   * repeat of the same password, salt and params from a native cache for
+   * five minutes.
+   */
+  clearKeyCache(): void;
 }
@@ -9,8 +9,8 @@
  * Preserves only true UI preferences (theme, auto-play, push toggle).
  * Everything else — auth tokens, household, cached service config,
  * manual URL override, routine bindings, react-query cache, K2 in-memory
- * userId — is wiped. Triggers a fresh service discovery so the app
- * immediately reconnects against the new environment.
+ * userId, cached Argon2 derivations — is wiped. Triggers a fresh service
+ * discovery so the app immediately reconnects against the new environment.
  *
  * SecureStore holds two kinds of secret: the JWT auth tokens (cleared here
  * via clearTokens) and the K2 node-encryption keys
@@ -22,6 +22,7 @@
 
 import AsyncStorage from '@react-native-async-storage/async-storage';
 import type { QueryClient } from '@tanstack/react-query';
+import { clearKeyCache } from 'jarvis-crypto';
 
 import { setK2UserId } from './k2Service';
 import { clearTokens } from './tokenStorage';
@@ -60,6 +61,10 @@ export async function clearUserData(
 
   setK2UserId(null);
 
+  // Keys derived from QR-import passwords stay in native memory for a few
+  // minutes so retries skip Argon2; the next user must not inherit them.
+  clearKeyCache();
+
   if (queryClient) {
     queryClient.clear();
   }
@@ -1,23 +1,8 @@
-import { aesGcmEncrypt, randomBytes } from 'jarvis-crypto';
+import { aesGcmEncryptBytes, randomBuffer } from 'jarvis-crypto';
 
 import { getK2 } from './k2Service';
 import { pushConfigToNode } from '../api/smartHomeApi';
-
-/**
- * Base64url-encode a UTF-8 string (no padding).
- */
-const utf8ToBase64url = (str: string): string => {
-  // TextEncoder is available in React Native hermes
-  const bytes = new TextEncoder().encode(str);
-  let binary = '';
-  for (const b of bytes) {
-    binary += String.fromCharCode(b);
-  }
-  return btoa(binary)
-    .replace(/\+/g, '-')
-    .replace(/\//g, '_')
-    .replace(/=+$/, '');
-};
+import { base64urlToBytes, bytesToBase64url } from '../utils/base64url';
 
 /**
  * Encrypt config data with K2 and push to a node via CC.
@@ -40,20 +25,30 @@ export const encryptAndPushConfig = async (
   }
 
   // Generate 12-byte nonce
-  const nonce = await randomBytes(12);
+  const nonce = await randomBuffer(12);
 
-  // Encode plaintext as base64url
-  const plaintext = utf8ToBase64url(JSON.stringify(configData));
+  // UTF-8 JSON goes to the native AEAD as bytes, without a base64url round trip
+  const plaintext = new TextEncoder().encode(JSON.stringify(configData));
 
   // AAD binds the ciphertext to the node and config type
   const aad = `${nodeId}:${configType}`;
 
   // Encrypt with AES-256-GCM
-  const { ciphertext, tag } = await aesGcmEncrypt(k2.k2, nonce, plaintext, aad);
+  const { ciphertext, tag } = await aesGcmEncryptBytes(
+    base64urlToBytes(k2.k2),
+    nonce,
+    plaintext,
+    aad,
+  );
 
   // Push to CC (which relays via MQTT to node)
   await pushConfigToNode(
     nodeId,
-    { config_type: configType, ciphertext, nonce, tag },
+    {
+      config_type: configType,
+      ciphertext: bytesToBase64url(ciphertext),
+      nonce: bytesToBase64url(nonce),
+      tag: bytesToBase64url(tag),
+    },
   );
 };
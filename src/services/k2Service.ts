@@ -1,6 +1,8 @@
 import * as SecureStore from 'expo-secure-store';
 
-import { randomBytes } from 'jarvis-crypto';
+import { randomBuffers } from 'jarvis-crypto';
+
+import { bytesToBase64url } from '../utils/base64url';
 
 const K2_STORAGE_PREFIX = 'jarvis_k2_';
 const KID_STORAGE_PREFIX = 'jarvis_kid_';
@@ -33,8 +35,10 @@ export interface K2KeyPair {
  * Generate a new K2 key (32 bytes) and key identifier
  */
 export async function generateK2(nodeId: string): Promise<K2KeyPair> {
-  const k2 = await randomBytes(32);
-  const kidSuffix = await randomBytes(4); // 4 bytes for uniqueness
+  // Key and a 4-byte kid suffix for uniqueness, in one native call
+  const [k2Bytes, kidBytes] = await randomBuffers([32, 4]);
+  const k2 = bytesToBase64url(k2Bytes);
+  const kidSuffix = bytesToBase64url(kidBytes);
   const timestamp = new Date().toISOString().slice(0, 7).replace('-', ''); // YYYYMM
   const kid = `k2-${timestamp}-${kidSuffix.slice(0, 6)}`; // e.g., k2-202602-abc123
 
@@ -1,6 +1,7 @@
-import { randomBytes, argon2id, aesGcmEncrypt } from 'jarvis-crypto';
+import { randomBuffers, argon2id, aesGcmEncrypt } from 'jarvis-crypto';
 
 import { K2KeyPair } from './k2Service';
+import { bytesToBase64url } from '../utils/base64url';
 
 // QR payload version
 const PAYLOAD_VERSION = 1;
@@ -75,9 +76,10 @@ export async function generateEncryptedQRPayload(
   password: string,
   commandCenterUrl?: string
 ): Promise<EncryptedQRPayload> {
-  // Generate random salt (16 bytes) and nonce (12 bytes for AES-GCM)
-  const salt = await randomBytes(16);
-  const nonce = await randomBytes(12);
+  // Random salt (16 bytes) and nonce (12 bytes for AES-GCM), in one native call
+  const [saltBytes, nonceBytes] = await randomBuffers([16, 12]);
+  const salt = bytesToBase64url(saltBytes);
+  const nonce = bytesToBase64url(nonceBytes);
 
   // Derive encryption key from password using Argon2id
   const derivedKey = await argon2id(password, salt, ARGON2_PARAMS);
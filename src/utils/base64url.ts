@@ -0,0 +1,33 @@
+/**
+ * Base64url (RFC 4648 section 5, unpadded) for byte arrays, in the form the
+ * node and command center expect for keys, nonces and ciphertext.
+ *
+ * Keys, nonces and tags are converted here with btoa/atob. Anything larger
+ * goes to the native SIMD codec in jarvis-crypto, where one synchronous
+ * call beats building a binary string a character at a time.
+ */
+import { base64urlDecode, base64urlEncode } from 'jarvis-crypto';
+
+const NATIVE_MIN_BYTES = 1024;
+
+export function bytesToBase64url(bytes: Uint8Array): string {
+  if (bytes.length >= NATIVE_MIN_BYTES) {
+    return base64urlEncode(bytes);
+  }
+  const binary = String.fromCharCode.apply(null, bytes as unknown as number[]);
+  return btoa(binary).replace(/\+/g, '-').replace(/\//g, '_').replace(/=+$/, '');
+}
+
+export function base64urlToBytes(str: string): Uint8Array {
+  // Four characters per three bytes
+  if (str.length >= (NATIVE_MIN_BYTES / 3) * 4) {
+    return base64urlDecode(str);
+  }
+  const base64 = str.replace(/-/g, '+').replace(/_/g, '/');
+  const binary = atob(base64 + '='.repeat((4 - (base64.length % 4)) % 4));
+  const bytes = new Uint8Array(binary.length);
+  for (let i = 0; i < binary.length; i++) {
+    bytes[i] = binary.charCodeAt(i);
+  }
+  return bytes;
+}